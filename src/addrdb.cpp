@@ -10,6 +10,7 @@
 #include "addrman.h"
 #include "chainparams.h"
 #include "clientversion.h"
+#include "crypto/common.h"
 #include "fs.h"
 #include "hash.h"
 #include "random.h"
@@ -17,6 +18,12 @@
 #include "tinyformat.h"
 #include "util.h"
 
+#include <algorithm>
+
+/** The journal is folded into a new snapshot once it is larger than the snapshot and this size */
+static const uint64_t ADDRDB_JOURNAL_COMPACT_SIZE = 1024 * 1024;
+static const size_t ADDRDB_JOURNAL_HEADER_SIZE = MESSAGE_START_SIZE + sizeof(uint256);
+
 CBanDB::CBanDB()
 {
     pathBanlist = GetDataDir() / "banlist.dat";
@@ -117,9 +124,10 @@ bool CBanDB::Read(banmap_t& banSet)
 CAddrDB::CAddrDB()
 {
     pathAddr = GetDataDir() / "peers.dat";
+    pathJournal = GetDataDir() / "peers.journal";
 }
 
-bool CAddrDB::Write(const CAddrMan& addr)
+bool CAddrDB::WriteSnapshot(const CAddrMan& addr, uint256& hashSnapshot)
 {
     // Generate random temporary filename
     unsigned short randv = 0;
@@ -130,8 +138,8 @@ bool CAddrDB::Write(const CAddrMan& addr)
     CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
     ssPeers << FLATDATA(Params().MessageStart());
     ssPeers << addr;
-    uint256 hash = Hash(ssPeers.begin(), ssPeers.end());
-    ssPeers << hash;
+    hashSnapshot = Hash(ssPeers.begin(), ssPeers.end());
+    ssPeers << hashSnapshot;
 
     // open output file, and associate with CAutoFile
     fs::path _pathAddr = GetDataDir() / tmpfn;
@@ -153,10 +161,193 @@ bool CAddrDB::Write(const CAddrMan& addr)
     if (!RenameOver(_pathAddr, pathAddr))
         return error("%s: Rename-into-place failed", __func__);
 
+    return true;
+}
+
+bool CAddrDB::Write(const CAddrMan& addr)
+{
+    uint256 hash;
+    bool fWritten = WriteSnapshot(addr, hash);
+    addr.ChangesWritten(fWritten);
+    if (!fWritten)
+        return false;
+
+    // the old journal no longer matches; it is ignored even if this fails
+    return StartJournal(hash);
+}
+
+bool CAddrDB::Flush(CAddrMan& addr)
+{
+    uint256 hashSnapshot;
+    uint64_t nSnapshotSize = 0;
+    uint64_t nJournalSize = 0;
+    if (!ReadSnapshotHash(hashSnapshot, nSnapshotSize) || !ReadJournalHeader(hashSnapshot, nJournalSize) ||
+        nJournalSize > std::max(nSnapshotSize, ADDRDB_JOURNAL_COMPACT_SIZE))
+        return Write(addr);
+
+    if (addr.GetChangeCount() == 0)
+        return true;
+
+    bool fWritten = AppendJournal(addr);
+    addr.ChangesWritten(fWritten);
+    return fWritten;
+}
+
+bool CAddrDB::AppendJournal(CAddrMan& addr)
+{
+    CDataStream ssChanges(SER_DISK, CLIENT_VERSION);
+    addr.SerializeChanges(ssChanges);
+    uint256 hash = Hash(ssChanges.begin(), ssChanges.end());
+
+    CDataStream ssBatch(SER_DISK, CLIENT_VERSION);
+    ssBatch << (uint32_t)ssChanges.size();
+    ssBatch << ssChanges;
+    ssBatch << hash;
+
+    FILE* file = fsbridge::fopen(pathJournal, "ab");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    bool fOk = !fileout.IsNull();
+    if (fOk) {
+        try {
+            fileout << ssBatch;
+            FileCommit(fileout.Get());
+        } catch (const std::exception& e) {
+            fOk = false;
+        }
+        fileout.fclose();
+    }
+    if (!fOk) {
+        // A partial batch ends the journal for readers; drop it so the next
+        // flush writes a full snapshot instead of appending behind it.
+        try {
+            fs::remove(pathJournal);
+        } catch (const fs::filesystem_error& e) {
+        }
+        return error("%s : Failed to append to %s", __func__, pathJournal.string());
+    }
+    return true;
+}
+
+bool CAddrDB::ReadSnapshotHash(uint256& hashSnapshot, uint64_t& nSnapshotSize)
+{
+    FILE* file = fsbridge::fopen(pathAddr, "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+    try {
+        nSnapshotSize = fs::file_size(pathAddr);
+        if (nSnapshotSize < sizeof(uint256) || fseek(filein.Get(), -(long)sizeof(uint256), SEEK_END) != 0)
+            return false;
+        filein >> hashSnapshot;
+    } catch (const std::exception& e) {
+        return false;
+    }
+    return true;
+}
+
+bool CAddrDB::ReadJournalHeader(const uint256& hashSnapshot, uint64_t& nJournalSize)
+{
+    FILE* file = fsbridge::fopen(pathJournal, "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+    unsigned char pchMsgTmp[4];
+    uint256 hashIn;
+    try {
+        nJournalSize = fs::file_size(pathJournal);
+        filein >> FLATDATA(pchMsgTmp);
+        filein >> hashIn;
+    } catch (const std::exception& e) {
+        return false;
+    }
+    return memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)) == 0 && hashIn == hashSnapshot;
+}
 
+bool CAddrDB::StartJournal(const uint256& hashSnapshot)
+{
+    FILE* file = fsbridge::fopen(pathJournal, "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s : Failed to open file %s", __func__, pathJournal.string());
+    try {
+        fileout << FLATDATA(Params().MessageStart());
+        fileout << hashSnapshot;
+    } catch (const std::exception& e) {
+        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
     return true;
 }
 
+void CAddrDB::ReadJournal(CAddrMan& addr, const uint256& hashSnapshot)
+{
+    uint64_t nJournalSize = 0;
+    if (!ReadJournalHeader(hashSnapshot, nJournalSize)) {
+        if (fs::exists(pathJournal))
+            LogPrintf("%s : %s does not belong to peers.dat, ignoring it\n", __func__, pathJournal.string());
+        return;
+    }
+
+    std::vector<unsigned char> vchData(nJournalSize - ADDRDB_JOURNAL_HEADER_SIZE);
+    FILE* file = fsbridge::fopen(pathJournal, "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    try {
+        if (filein.IsNull() || fseek(filein.Get(), ADDRDB_JOURNAL_HEADER_SIZE, SEEK_SET) != 0)
+            throw std::ios_base::failure("cannot seek past the journal header");
+        if (!vchData.empty())
+            filein.read((char*)vchData.data(), vchData.size());
+    } catch (const std::exception& e) {
+        LogPrintf("%s : I/O error - %s\n", __func__, e.what());
+        return;
+    }
+    filein.fclose();
+
+    // Apply batches up to the first incomplete or damaged one, left by a crash mid-append
+    size_t nPos = 0;
+    int nBatches = 0;
+    bool fClean = true;
+    while (nPos < vchData.size()) {
+        if (vchData.size() - nPos < sizeof(uint32_t)) {
+            fClean = false;
+            break;
+        }
+        uint32_t nSize = ReadLE32(&vchData[nPos]);
+        if (vchData.size() - nPos - sizeof(uint32_t) < (uint64_t)nSize + sizeof(uint256)) {
+            fClean = false;
+            break;
+        }
+        const unsigned char* pbegin = &vchData[nPos + sizeof(uint32_t)];
+        uint256 hashIn;
+        memcpy(hashIn.begin(), pbegin + nSize, sizeof(uint256));
+        if (Hash(pbegin, pbegin + nSize) != hashIn) {
+            fClean = false;
+            break;
+        }
+        try {
+            CDataStream ssChanges((const char*)pbegin, (const char*)pbegin + nSize, SER_DISK, CLIENT_VERSION);
+            addr.UnserializeChanges(ssChanges);
+        } catch (const std::exception& e) {
+            LogPrintf("%s : Deserialize error - %s\n", __func__, e.what());
+            fClean = false;
+            break;
+        }
+        nPos += sizeof(uint32_t) + nSize + sizeof(uint256);
+        nBatches++;
+    }
+    LogPrint(BCLog::ADDRMAN, "Applied %d batches of address changes from %s\n", nBatches, pathJournal.string());
+
+    if (!fClean) {
+        // Later appends would be hidden behind the damaged batch; start over
+        // with a full snapshot at the next flush.
+        LogPrintf("%s : %s is damaged after %d batches, discarding the rest\n", __func__, pathJournal.string(), nBatches);
+        try {
+            fs::remove(pathJournal);
+        } catch (const fs::filesystem_error& e) {
+        }
+    }
+}
+
 bool CAddrDB::Read(CAddrMan& addr)
 {
     // open input file, and associate with CAutoFile
@@ -191,7 +382,11 @@ bool CAddrDB::Read(CAddrMan& addr)
     if (hashIn != hashTmp)
         return error("%s : Checksum mismatch, data corrupted", __func__);
 
-    return Read(addr, ssPeers);
+    if (!Read(addr, ssPeers))
+        return false;
+
+    ReadJournal(addr, hashIn);
+    return true;
 }
 
 bool CAddrDB::Read(CAddrMan& addr, CDataStream& ssPeers)
@@ -18,6 +18,7 @@
 class CSubNet;
 class CAddrMan;
 class CDataStream;
+class uint256;
 
 typedef enum BanReason
 {
@@ -79,15 +80,33 @@ public:
 
 typedef std::map<CSubNet, CBanEntry> banmap_t;
 
-/** Access to the (IP) address database (peers.dat) */
+/**
+ * Access to the (IP) address database: a full snapshot in peers.dat and a
+ * journal of the changes made since, in peers.journal. The journal starts
+ * with the network magic and the checksum of the snapshot it belongs to,
+ * followed by batches of CAddrMan::SerializeChanges() records, each prefixed
+ * with its size and followed by its hash.
+ */
 class CAddrDB
 {
 private:
     fs::path pathAddr;
+    fs::path pathJournal;
+
+    bool WriteSnapshot(const CAddrMan& addr, uint256& hashSnapshot);
+    bool AppendJournal(CAddrMan& addr);
+    bool ReadSnapshotHash(uint256& hashSnapshot, uint64_t& nSnapshotSize);
+    bool ReadJournalHeader(const uint256& hashSnapshot, uint64_t& nJournalSize);
+    bool StartJournal(const uint256& hashSnapshot);
+    void ReadJournal(CAddrMan& addr, const uint256& hashSnapshot);
 
 public:
     CAddrDB();
+    //! Write a full snapshot and start a new, empty journal
     bool Write(const CAddrMan& addr);
+    //! Append the changes since the last write to the journal, or write a full snapshot if the journal grew too large
+    bool Flush(CAddrMan& addr);
+    //! Read the snapshot and apply the journal on top of it
     bool Read(CAddrMan& addr);
     bool Read(CAddrMan& addr, CDataStream& ssPeers);
 };
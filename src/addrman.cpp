@@ -7,10 +7,22 @@
 
 #include "addrman.h"
 
+#include "crypto/common.h"
 #include "hash.h"
 #include "serialize.h"
 #include "streams.h"
 
+#include <limits>
+
+CNetAddrHasher::CNetAddrHasher() :
+    k0(GetRand(std::numeric_limits<uint64_t>::max())),
+    k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+size_t CNetAddrHasher::operator()(const CNetAddr& addr) const
+{
+    // CNetAddr equality only compares the 16 address bytes
+    return CSipHasher(k0, k1).Write(ReadLE64(addr.ip)).Write(ReadLE64(addr.ip + 8)).Finalize();
+}
 
 int CAddrInfo::GetTriedBucket(const uint256& nKey) const
 {
@@ -77,12 +89,12 @@ double CAddrInfo::GetChance(int64_t nNow) const
 
 CAddrInfo* CAddrMan::Find(const CNetAddr& addr, int* pnId)
 {
-    std::map<CNetAddr, int>::iterator it = mapAddr.find(addr);
+    auto it = mapAddr.find(addr);
     if (it == mapAddr.end())
         return NULL;
     if (pnId)
         *pnId = (*it).second;
-    std::map<int, CAddrInfo>::iterator it2 = mapInfo.find((*it).second);
+    auto it2 = mapInfo.find((*it).second);
     if (it2 != mapInfo.end())
         return &(*it2).second;
     return NULL;
@@ -95,6 +107,7 @@ CAddrInfo* CAddrMan::Create(const CAddress& addr, const CNetAddr& addrSource, in
     mapAddr[addr] = nId;
     mapInfo[nId].nRandomPos = vRandom.size();
     vRandom.push_back(nId);
+    MarkChanged(addr);
     if (pnId)
         *pnId = nId;
     return &mapInfo[nId];
@@ -129,6 +142,7 @@ void CAddrMan::Delete(int nId)
 
     SwapRandom(info.nRandomPos, vRandom.size() - 1);
     vRandom.pop_back();
+    MarkChanged(info);
     mapAddr.erase(info);
     mapInfo.erase(nId);
     nNew--;
@@ -189,12 +203,14 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
         infoOld.nRefCount = 1;
         vvNew[nUBucket][nUBucketPos] = nIdEvict;
         nNew++;
+        MarkChanged(infoOld);
     }
     assert(vvTried[nKBucket][nKBucketPos] == -1);
 
     vvTried[nKBucket][nKBucketPos] = nId;
     nTried++;
     info.fInTried = true;
+    MarkChanged(info);
 }
 
 void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime)
@@ -219,6 +235,7 @@ void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime
     info.nLastSuccess = nTime;
     info.nLastTry = nTime;
     info.nAttempts = 0;
+    MarkChanged(info);
     // nTime is not updated here, to avoid leaking information about
     // currently-connected peers.
 
@@ -279,11 +296,16 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
         // periodically update nTime
         bool fCurrentlyOnline = (GetAdjustedTime() - addr.nTime < 24 * 60 * 60);
         int64_t nUpdateInterval = (fCurrentlyOnline ? 60 * 60 : 24 * 60 * 60);
-        if (addr.nTime && (!pinfo->nTime || pinfo->nTime < addr.nTime - nUpdateInterval - nTimePenalty))
+        if (addr.nTime && (!pinfo->nTime || pinfo->nTime < addr.nTime - nUpdateInterval - nTimePenalty)) {
             pinfo->nTime = std::max((int64_t)0, addr.nTime - nTimePenalty);
+            MarkChanged(addr);
+        }
 
         // add services
-        pinfo->nServices = ServiceFlags(pinfo->nServices | addr.nServices);
+        if ((pinfo->nServices | addr.nServices) != pinfo->nServices) {
+            pinfo->nServices = ServiceFlags(pinfo->nServices | addr.nServices);
+            MarkChanged(addr);
+        }
 
         // do not update if no new information is present
         if (!addr.nTime || (pinfo->nTime && addr.nTime <= pinfo->nTime))
@@ -353,6 +375,7 @@ void CAddrMan::Attempt_(const CService& addr, bool fCountFailure, int64_t nTime)
     if (fCountFailure && info.nLastCountAttempt < nLastGood) {
         info.nLastCountAttempt = nTime;
         info.nAttempts++;
+        MarkChanged(info);
     }
 }
 
@@ -411,7 +434,7 @@ int CAddrMan::Check_()
     if (vRandom.size() != nTried + nNew)
         return -7;
 
-    for (std::map<int, CAddrInfo>::iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
+    for (std::unordered_map<int, CAddrInfo>::iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
         int n = (*it).first;
         CAddrInfo& info = (*it).second;
         if (info.fInTried) {
@@ -517,8 +540,10 @@ void CAddrMan::Connected_(const CService& addr, int64_t nTime)
 
     // update info
     int64_t nUpdateInterval = 20 * 60;
-    if (nTime - info.nTime > nUpdateInterval)
+    if (nTime - info.nTime > nUpdateInterval) {
         info.nTime = nTime;
+        MarkChanged(info);
+    }
 }
 
 void CAddrMan::SetServices_(const CService& addr, ServiceFlags nServices)
@@ -536,7 +561,10 @@ void CAddrMan::SetServices_(const CService& addr, ServiceFlags nServices)
         return;
 
     // update info
-    info.nServices = nServices;
+    if (info.nServices != nServices) {
+        info.nServices = nServices;
+        MarkChanged(info);
+    }
 }
 
 int CAddrMan::RandomInt(int nMax){
@@ -621,3 +649,115 @@ CAddrInfo CAddrMan::SelectTriedCollision_()
 
     return mapInfo[id_old];
 }
+
+void CAddrMan::ApplyChanges_(const std::vector<CNetAddr>& vDeleted, const std::vector<ChangedEntry>& vUpdated)
+{
+    // Drop deleted entries from the new table in a single pass over it
+    std::unordered_set<int> setDeleted;
+    for (const CNetAddr& addr : vDeleted) {
+        int nId;
+        CAddrInfo* pinfo = Find(addr, &nId);
+        if (pinfo && !pinfo->fInTried)
+            setDeleted.insert(nId);
+    }
+    if (!setDeleted.empty()) {
+        for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+                if (vvNew[bucket][i] != -1 && setDeleted.count(vvNew[bucket][i])) {
+                    mapInfo[vvNew[bucket][i]].nRefCount--;
+                    vvNew[bucket][i] = -1;
+                }
+            }
+        }
+        for (int nId : setDeleted)
+            Delete(nId);
+    }
+
+    // Bring every updated entry up to date, creating the missing ones without a new table reference
+    std::vector<int> vIds;
+    vIds.reserve(vUpdated.size());
+    std::unordered_set<int> setPlaced;
+    for (const ChangedEntry& entry : vUpdated) {
+        const CAddrInfo& infoIn = entry.info;
+        int nId;
+        CAddrInfo* pinfo = Find(infoIn, &nId);
+        if (!pinfo) {
+            pinfo = Create(infoIn, infoIn.source, &nId);
+            nNew++;
+        }
+        CAddrInfo& info = *pinfo;
+        info.nTime = infoIn.nTime;
+        info.nServices = infoIn.nServices;
+        info.nLastSuccess = infoIn.nLastSuccess;
+        info.nAttempts = infoIn.nAttempts;
+        vIds.push_back(nId);
+        if (entry.fTried)
+            continue;
+        setPlaced.insert(nId);
+        if (info.fInTried) {
+            // evicted from tried since the snapshot
+            int nKBucket = info.GetTriedBucket(nKey);
+            int nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
+            if (vvTried[nKBucket][nKBucketPos] == nId)
+                vvTried[nKBucket][nKBucketPos] = -1;
+            info.fInTried = false;
+            nTried--;
+            nNew++;
+        }
+    }
+
+    // Promotions go first, so that their evictions cannot disturb the recorded new table positions
+    for (size_t n = 0; n < vUpdated.size(); n++) {
+        CAddrInfo& info = mapInfo[vIds[n]];
+        if (vUpdated[n].fTried && !info.fInTried)
+            MakeTried(info, vIds[n]);
+    }
+
+    // Drop the current new table references of the recorded new entries in a single pass ...
+    if (!setPlaced.empty()) {
+        for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+            for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+                if (vvNew[bucket][i] != -1 && setPlaced.count(vvNew[bucket][i])) {
+                    mapInfo[vvNew[bucket][i]].nRefCount--;
+                    vvNew[bucket][i] = -1;
+                }
+            }
+        }
+    }
+
+    // ... and reference them from every bucket their record lists
+    for (size_t n = 0; n < vUpdated.size(); n++) {
+        if (vUpdated[n].fTried)
+            continue;
+        int nId = vIds[n];
+        CAddrInfo& info = mapInfo[nId];
+        for (int nUBucket : vUpdated[n].vBuckets) {
+            if (nUBucket < 0 || nUBucket >= ADDRMAN_NEW_BUCKET_COUNT || info.nRefCount >= ADDRMAN_NEW_BUCKETS_PER_ADDRESS)
+                continue;
+            int nUBucketPos = info.GetBucketPosition(nKey, true, nUBucket);
+            int nIdOld = vvNew[nUBucket][nUBucketPos];
+            if (nIdOld == nId || (nIdOld != -1 && setPlaced.count(nIdOld)))
+                continue;
+            // whatever else is there was replaced after the snapshot
+            ClearNew(nUBucket, nUBucketPos);
+            vvNew[nUBucket][nUBucketPos] = nId;
+            info.nRefCount++;
+        }
+    }
+
+    // Place entries left without a reference by their source, as when the bucket count changes
+    for (int nId : setPlaced) {
+        CAddrInfo& info = mapInfo[nId];
+        if (info.nRefCount > 0)
+            continue;
+        int nUBucket = info.GetNewBucket(nKey);
+        int nUBucketPos = info.GetBucketPosition(nKey, true, nUBucket);
+        if (vvNew[nUBucket][nUBucketPos] == -1) {
+            vvNew[nUBucket][nUBucketPos] = nId;
+            info.nRefCount++;
+        } else {
+            Delete(nId);
+        }
+    }
+    setChanged.clear();
+}
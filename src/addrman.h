@@ -18,8 +18,24 @@
 #include <map>
 #include <set>
 #include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+/**
+ * Hasher for CNetAddr keys in hash tables. Salted per table with SipHash, so
+ * peers relaying addresses cannot make them collide.
+ */
+class CNetAddrHasher
+{
+private:
+    uint64_t k0, k1;
+
+public:
+    CNetAddrHasher();
+    size_t operator()(const CNetAddr& addr) const;
+};
+
 /**
  * Extended statistics about a CAddress
  */
@@ -54,6 +70,7 @@ private:
     int nRandomPos;
 
     friend class CAddrMan;
+    friend class CAddrManTest;
 
 public:
     ADD_SERIALIZE_METHODS;
@@ -183,11 +200,18 @@ public:
 //! the maximum number of tried addr collisions to store
 #define ADDRMAN_SET_TRIED_COLLISION_SIZE 10
 
+//! record types of the change journal written by SerializeChanges()
+#define ADDRMAN_CHANGE_DELETE 0
+#define ADDRMAN_CHANGE_NEW 1
+#define ADDRMAN_CHANGE_TRIED 2
+
 /**
  * Stochastical (IP) address manager
  */
 class CAddrMan
 {
+    friend class CAddrManTest;
+
 private:
     //! critical section to protect the inner data structures
     mutable RecursiveMutex cs;
@@ -196,10 +220,10 @@ private:
     int nIdCount;
 
     //! table with information about all nIds
-    std::map<int, CAddrInfo> mapInfo;
+    std::unordered_map<int, CAddrInfo> mapInfo;
 
     //! find an nId based on its network address
-    std::map<CNetAddr, int> mapAddr;
+    std::unordered_map<CNetAddr, int, CNetAddrHasher> mapAddr;
 
     //! randomly-ordered vector of all nIds
     std::vector<int> vRandom;
@@ -222,6 +246,19 @@ private:
     //! Holds addrs inserted into tried table that collide with existing entries. Test-before-evict discpline used to resolve these collisions.
     std::set<int> m_tried_collisions;
 
+    //! addresses added, changed or deleted since the table was last serialized
+    mutable std::unordered_set<CNetAddr, CNetAddrHasher> setChanged;
+
+    //! changes serialized, but not yet known to be on disk (see ChangesWritten())
+    mutable std::unordered_set<CNetAddr, CNetAddrHasher> setChangedWriting;
+
+    //! an entry as recorded in the change journal
+    struct ChangedEntry {
+        CAddrInfo info;
+        bool fTried;
+        std::vector<int> vBuckets; //! the new table buckets referencing it
+    };
+
 protected:
     //! secret key to randomize bucket select with
     uint256 nKey;
@@ -283,6 +320,19 @@ protected:
     //! Update an entry's service bits.
     void SetServices_(const CService& addr, ServiceFlags nServices);
 
+    //! Remember that an address has to be written to the change journal.
+    void MarkChanged(const CNetAddr& addr) { setChanged.insert(addr); }
+
+    //! Apply one batch of SerializeChanges() records.
+    void ApplyChanges_(const std::vector<CNetAddr>& vDeleted, const std::vector<ChangedEntry>& vUpdated);
+
+    //! Hand the pending changes over to a write in progress.
+    void BeginWriteChanges() const
+    {
+        setChangedWriting.insert(setChanged.begin(), setChanged.end());
+        setChanged.clear();
+    }
+
 public:
     /**
      * serialized format:
@@ -312,11 +362,16 @@ public:
      *
      * We don't use ADD_SERIALIZE_METHODS since the serialization and deserialization code has
      * very little in common.
+     *
+     * A snapshot includes every change made so far, so serializing it also
+     * empties the set of changes pending for SerializeChanges(). They are
+     * only dropped once ChangesWritten() reports the snapshot on disk.
      */
     template <typename Stream>
     void Serialize(Stream& s) const
     {
         LOCK(cs);
+        BeginWriteChanges();
 
         unsigned char nVersion = 1;
         s << nVersion;
@@ -327,10 +382,11 @@ public:
 
         int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
         s << nUBuckets;
-        std::map<int, int> mapUnkIds;
+        // ids are handed out sequentially, so index the renumbering by id
+        std::vector<int> vUnkIds(nIdCount, -1);
         int nIds = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
-            mapUnkIds[(*it).first] = nIds;
+        for (std::unordered_map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
+            vUnkIds[(*it).first] = nIds;
             const CAddrInfo& info = (*it).second;
             if (info.nRefCount) {
                 assert(nIds != nNew); // this means nNew was wrong, oh ow
@@ -339,7 +395,7 @@ public:
             }
         }
         nIds = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
+        for (std::unordered_map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
             const CAddrInfo& info = (*it).second;
             if (info.fInTried) {
                 assert(nIds != nTried); // this means nTried was wrong, oh ow
@@ -356,7 +412,7 @@ public:
             s << nSize;
             for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
                 if (vvNew[bucket][i] != -1) {
-                    int nIndex = mapUnkIds[vvNew[bucket][i]];
+                    int nIndex = vUnkIds[vvNew[bucket][i]];
                     s << nIndex;
                 }
             }
@@ -445,9 +501,9 @@ public:
 
         // Prune new entries with refcount 0 (as a result of collisions).
         int nLostUnk = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end();) {
+        for (std::unordered_map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end();) {
             if (it->second.fInTried == false && it->second.nRefCount == 0) {
-                std::map<int, CAddrInfo>::const_iterator itCopy = it++;
+                std::unordered_map<int, CAddrInfo>::const_iterator itCopy = it++;
                 Delete(itCopy->first);
                 nLostUnk++;
             } else {
@@ -457,8 +513,114 @@ public:
         if (nLost + nLostUnk > 0) {
             LogPrint(BCLog::ADDRMAN, "addrman lost %i new and %i tried addresses due to collisions\n", nLostUnk, nLost);
         }
+        setChanged.clear();
+
+        Check();
+    }
+
+    /**
+     * Change journal format, appended to a snapshot between full rewrites:
+     * * number of records
+     * * for each address added, changed or deleted since the last Serialize()
+     *   or SerializeChanges() that reached the disk:
+     *   * record type (ADDRMAN_CHANGE_*)
+     *   * the CNetAddr for deletions, the full CAddrInfo otherwise
+     *   * for new table entries, the new buckets that reference it
+     *
+     * Records hold the current state of an entry rather than the operations
+     * that led to it, so a batch has at most one record per address and can be
+     * applied in any order. The position within a bucket follows from the
+     * bucket, so it is not recorded.
+     */
+    template <typename Stream>
+    void SerializeChanges(Stream& s)
+    {
+        LOCK(cs);
+        BeginWriteChanges();
+
+        // the buckets of the changed new entries, in one pass over the new table
+        std::unordered_map<int, std::vector<int> > mapBuckets;
+        for (const CNetAddr& addr : setChangedWriting) {
+            int nId;
+            const CAddrInfo* pinfo = Find(addr, &nId);
+            if (pinfo && !pinfo->fInTried)
+                mapBuckets[nId];
+        }
+        if (!mapBuckets.empty()) {
+            for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+                for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+                    if (vvNew[bucket][i] == -1)
+                        continue;
+                    std::unordered_map<int, std::vector<int> >::iterator it = mapBuckets.find(vvNew[bucket][i]);
+                    if (it != mapBuckets.end())
+                        it->second.push_back(bucket);
+                }
+            }
+        }
+
+        WriteCompactSize(s, setChangedWriting.size());
+        for (const CNetAddr& addr : setChangedWriting) {
+            int nId;
+            const CAddrInfo* pinfo = Find(addr, &nId);
+            if (!pinfo) {
+                s << (unsigned char)ADDRMAN_CHANGE_DELETE;
+                s << addr;
+            } else if (pinfo->fInTried) {
+                s << (unsigned char)ADDRMAN_CHANGE_TRIED;
+                s << *pinfo;
+            } else {
+                s << (unsigned char)ADDRMAN_CHANGE_NEW;
+                s << *pinfo;
+                s << mapBuckets[nId];
+            }
+        }
+    }
 
+    template <typename Stream>
+    void UnserializeChanges(Stream& s)
+    {
+        std::vector<CNetAddr> vDeleted;
+        std::vector<ChangedEntry> vUpdated;
+        uint64_t nRecords = ReadCompactSize(s);
+        for (uint64_t n = 0; n < nRecords; n++) {
+            unsigned char nType;
+            s >> nType;
+            if (nType == ADDRMAN_CHANGE_DELETE) {
+                CNetAddr addr;
+                s >> addr;
+                vDeleted.push_back(addr);
+            } else if (nType == ADDRMAN_CHANGE_NEW || nType == ADDRMAN_CHANGE_TRIED) {
+                ChangedEntry entry;
+                s >> entry.info;
+                entry.fTried = nType == ADDRMAN_CHANGE_TRIED;
+                if (!entry.fTried)
+                    s >> entry.vBuckets;
+                vUpdated.push_back(std::move(entry));
+            } else {
+                throw std::ios_base::failure("Unknown record type in addrman change journal");
+            }
+        }
+
+        LOCK(cs);
         Check();
+        ApplyChanges_(vDeleted, vUpdated);
+        Check();
+    }
+
+    //! Number of addresses changed since the table was last serialized
+    size_t GetChangeCount() const
+    {
+        LOCK(cs);
+        return setChanged.size();
+    }
+
+    //! Report whether the last Serialize() or SerializeChanges() reached the disk. If not, its changes are pending again.
+    void ChangesWritten(bool fWritten) const
+    {
+        LOCK(cs);
+        if (!fWritten)
+            setChanged.insert(setChangedWriting.begin(), setChangedWriting.end());
+        setChangedWriting.clear();
     }
 
 
@@ -484,6 +646,8 @@ public:
         nLastGood = 1; //Initially at 1 so that "never" is strictly worse.
         mapInfo.clear();
         mapAddr.clear();
+        setChanged.clear();
+        setChangedWriting.clear();
     }
 
     CAddrMan()
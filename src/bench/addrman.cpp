@@ -0,0 +1,127 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "addrman.h"
+#include "clientversion.h"
+#include "random.h"
+#include "streams.h"
+#include "utiltime.h"
+
+#include <vector>
+
+// A well connected node's address table: 100k addresses learned from 1000 peers.
+static const size_t NUM_ADDRESSES = 100000;
+static const size_t NUM_SOURCES = 1000;
+
+static CNetAddr RandomIPv4(FastRandomContext& rng)
+{
+    uint8_t ip[4];
+    for (uint8_t& b : ip)
+        b = rng.randbits(8);
+    ip[0] = 1 + ip[0] % 223;
+    CNetAddr addr;
+    addr.SetRaw(NET_IPV4, ip);
+    return addr;
+}
+
+static void MakeAddresses(std::vector<CNetAddr>& vSources, std::vector<std::vector<CAddress> >& vAddrs)
+{
+    FastRandomContext rng(true);
+    vSources.resize(NUM_SOURCES);
+    vAddrs.resize(NUM_SOURCES);
+    const int64_t nNow = GetAdjustedTime();
+    for (size_t i = 0; i < NUM_SOURCES; i++) {
+        vSources[i] = RandomIPv4(rng);
+        for (size_t j = 0; j < NUM_ADDRESSES / NUM_SOURCES; j++) {
+            CAddress addr(CService(RandomIPv4(rng), 8333), NODE_NETWORK);
+            addr.nTime = nNow - rng.randrange(7 * 24 * 60 * 60);
+            vAddrs[i].push_back(addr);
+        }
+    }
+}
+
+static CAddrMan& FilledAddrMan()
+{
+    static CAddrMan addrman;
+    if (addrman.size() == 0) {
+        std::vector<CNetAddr> vSources;
+        std::vector<std::vector<CAddress> > vAddrs;
+        MakeAddresses(vSources, vAddrs);
+        for (size_t i = 0; i < NUM_SOURCES; i++)
+            addrman.Add(vAddrs[i], vSources[i]);
+        // some of them have been connected to
+        for (size_t i = 0; i < NUM_SOURCES; i++)
+            addrman.Good(vAddrs[i][0]);
+    }
+    return addrman;
+}
+
+static void AddrManAdd(benchmark::State& state)
+{
+    std::vector<CNetAddr> vSources;
+    std::vector<std::vector<CAddress> > vAddrs;
+    MakeAddresses(vSources, vAddrs);
+
+    while (state.KeepRunning()) {
+        CAddrMan addrman;
+        for (size_t i = 0; i < NUM_SOURCES; i++)
+            addrman.Add(vAddrs[i], vSources[i]);
+    }
+}
+
+static void AddrManSelect(benchmark::State& state)
+{
+    CAddrMan& addrman = FilledAddrMan();
+    while (state.KeepRunning()) {
+        CAddrInfo addr = addrman.Select();
+        assert(addr.GetPort() == 8333);
+    }
+}
+
+static void AddrManGetAddr(benchmark::State& state)
+{
+    CAddrMan& addrman = FilledAddrMan();
+    while (state.KeepRunning()) {
+        std::vector<CAddress> vAddr = addrman.GetAddr();
+        assert(!vAddr.empty());
+    }
+}
+
+// Periodic peers.dat flush after 1000 addresses changed: full snapshot ...
+static void AddrManFlushSnapshot(benchmark::State& state)
+{
+    CAddrMan& addrman = FilledAddrMan();
+    std::vector<CAddress> vAddr = addrman.GetAddr();
+    int64_t nTime = GetAdjustedTime();
+    while (state.KeepRunning()) {
+        nTime += 60 * 60;
+        for (size_t i = 0; i < 1000 && i < vAddr.size(); i++)
+            addrman.Connected(vAddr[i], nTime);
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << addrman;
+    }
+}
+
+// ... and the change journal
+static void AddrManFlushJournal(benchmark::State& state)
+{
+    CAddrMan& addrman = FilledAddrMan();
+    std::vector<CAddress> vAddr = addrman.GetAddr();
+    int64_t nTime = GetAdjustedTime();
+    while (state.KeepRunning()) {
+        nTime += 60 * 60;
+        for (size_t i = 0; i < 1000 && i < vAddr.size(); i++)
+            addrman.Connected(vAddr[i], nTime);
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        addrman.SerializeChanges(ss);
+    }
+}
+
+BENCHMARK(AddrManAdd);
+BENCHMARK(AddrManSelect);
+BENCHMARK(AddrManGetAddr);
+BENCHMARK(AddrManFlushSnapshot);
+BENCHMARK(AddrManFlushJournal);
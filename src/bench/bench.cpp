@@ -104,3 +104,9 @@ bool benchmark::State::KeepRunning()
 
     return false;
 }
+
+void benchmark::State::ReportCounter(const std::string& counterName, double value)
+{
+    std::cout << std::fixed << std::setprecision(1) << name << "." << counterName << "," << value << "\n";
+    std::cout.copyfmt(std::ios(nullptr));
+}
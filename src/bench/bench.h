@@ -72,6 +72,8 @@ namespace benchmark {
             maxCycles(std::numeric_limits<uint64_t>::min()) {
         }
         bool KeepRunning();
+        /** Report a figure other than time, e.g. allocations per iteration, as a row of its own: name.counter,value */
+        void ReportCounter(const std::string& counterName, double value);
     };
 
     typedef std::function<void(State&)> BenchFunction;
@@ -0,0 +1,94 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chain.h"
+#include "clientversion.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "streams.h"
+#include "version.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <tuple>
+
+// Heap allocations are counted while fCountAllocs is set, which is only inside
+// the measured loop body; the other benches only pay for the flag check.
+static std::atomic<bool> fCountAllocs(false);
+static std::atomic<uint64_t> nAllocs(0);
+
+void* operator new(size_t n)
+{
+    if (fCountAllocs.load(std::memory_order_relaxed))
+        nAllocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(n ? n : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+static const int BLOCK_TXS = 400;
+
+static CBlock MakeBlock()
+{
+    CBlock block;
+    block.nVersion = 4;
+    block.hashPrevBlock = GetRandHash();
+    for (int i = 0; i < BLOCK_TXS; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(i == 0 ? 1 : 2);
+        for (CTxIn& in : tx.vin) {
+            in.prevout = COutPoint(GetRandHash(), 0);
+            in.scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+        }
+        tx.vout.resize(2);
+        for (CTxOut& out : tx.vout) {
+            out.nValue = 1 * COIN;
+            out.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x11) << OP_EQUALVERIFY << OP_CHECKSIG;
+        }
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    return block;
+}
+
+// The transaction handling of connecting a block: read from disk, passed
+// along and kept by the callers, each transaction queued for the wallets.
+static void ConnectBlockAllocs(benchmark::State& state)
+{
+    CDataStream ssBlock(SER_DISK, CLIENT_VERSION);
+    ssBlock << MakeBlock();
+    CBlockIndex index;
+
+    uint64_t nBlocks = 0;
+    nAllocs = 0;
+    while (state.KeepRunning()) {
+        fCountAllocs = true;
+        {
+            CDataStream ss(ssBlock.begin(), ssBlock.end(), SER_DISK, CLIENT_VERSION);
+            CBlock block;
+            ss >> block;
+            const CBlock blockKept(block);
+
+            std::vector<std::tuple<CTransactionRef, CBlockIndex*, int>> txChanged;
+            txChanged.reserve(blockKept.vtx.size());
+            for (unsigned int i = 0; i < blockKept.vtx.size(); i++)
+                txChanged.emplace_back(blockKept.vtx[i], &index, i);
+        }
+        fCountAllocs = false;
+        nBlocks++;
+    }
+
+    if (nBlocks)
+        state.ReportCounter("allocs_per_block", (double)nAllocs / nBlocks);
+}
+
+BENCHMARK(ConnectBlockAllocs);
@@ -0,0 +1,60 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "base58.h"
+#include "chainparams.h"
+#include "main.h"
+#include "random.h"
+
+// The burn address check of one spent output, as ConnectBlock and
+// AcceptToMemoryPool run it for every input. The GetTransaction disk read
+// the check used to start with is left out, only the lookup is compared.
+static std::vector<CScript> MakeSpentScripts()
+{
+    SelectParams(CBaseChainParams::MAIN);
+    std::vector<CScript> vScripts;
+    for (int i = 0; i < 1000; i++) {
+        uint160 hash;
+        GetRandBytes(hash.begin(), hash.size());
+        vScripts.push_back(GetScriptForDestination(CKeyID(hash)));
+    }
+    return vScripts;
+}
+
+static void BurnAddressString(benchmark::State& state)
+{
+    const std::vector<CScript> vScripts = MakeSpentScripts();
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const int nHeight = 1000000;
+    int nBurned = 0;
+    while (state.KeepRunning()) {
+        for (const CScript& script : vScripts) {
+            CTxDestination source;
+            if (ExtractDestination(script, source)) {
+                const std::string addr = EncodeDestination(source);
+                if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
+                    consensus.mBurnAddresses.at(addr) < nHeight)
+                    nBurned++;
+            }
+        }
+    }
+    assert(nBurned == 0);
+}
+
+static void BurnAddressScript(benchmark::State& state)
+{
+    const std::vector<CScript> vScripts = MakeSpentScripts();
+    const int nHeight = 1000000;
+    int nBurned = 0;
+    while (state.KeepRunning()) {
+        for (const CScript& script : vScripts)
+            nBurned += IsBurnScript(script, nHeight);
+    }
+    assert(nBurned == 0);
+}
+
+BENCHMARK(BurnAddressString);
+BENCHMARK(BurnAddressScript);
@@ -33,14 +33,52 @@ static void SHA1(benchmark::State& state)
         CSHA1().Write(begin_ptr(in), in.size()).Finalize(hash);
 }
 
-static void SHA256(benchmark::State& state)
+static void SHA256(benchmark::State& state, SHA256Implementation impl)
 {
+    SHA256AutoDetect(impl);
     uint8_t hash[CSHA256::OUTPUT_SIZE];
     std::vector<uint8_t> in(BUFFER_SIZE,0);
     while (state.KeepRunning())
         CSHA256().Write(begin_ptr(in), in.size()).Finalize(hash);
+    SHA256AutoDetect();
 }
 
+static void SHA256_standard(benchmark::State& state) { SHA256(state, SHA256_STANDARD); }
+static void SHA256_shani(benchmark::State& state) { SHA256(state, SHA256_USE_SHANI); }
+
+static void SHA256_32b(benchmark::State& state, SHA256Implementation impl)
+{
+    SHA256AutoDetect(impl);
+    std::vector<uint8_t> in(32,0);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000000; i++) {
+            CSHA256().Write(begin_ptr(in), in.size()).Finalize(&in[0]);
+        }
+    }
+    SHA256AutoDetect();
+}
+
+/* A merkle level of a block with 2048 transactions, hashed in one batch */
+static void SHA256D64_1024(benchmark::State& state, SHA256Implementation impl)
+{
+    SHA256AutoDetect(impl);
+    std::vector<uint8_t> in(64 * 1024);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 10; i++) {
+            SHA256D64(begin_ptr(in), begin_ptr(in), 1024);
+        }
+    }
+    SHA256AutoDetect();
+}
+
+static void SHA256_32b_standard(benchmark::State& state) { SHA256_32b(state, SHA256_STANDARD); }
+static void SHA256_32b_shani(benchmark::State& state) { SHA256_32b(state, SHA256_USE_SHANI); }
+static void SHA256D64_1024_standard(benchmark::State& state) { SHA256D64_1024(state, SHA256_STANDARD); }
+static void SHA256D64_1024_sse41(benchmark::State& state) { SHA256D64_1024(state, SHA256_USE_SSE41); }
+static void SHA256D64_1024_avx2(benchmark::State& state) { SHA256D64_1024(state, SHA256_USE_AVX2); }
+static void SHA256D64_1024_shani(benchmark::State& state) { SHA256D64_1024(state, SHA256_USE_SHANI); }
+static void SHA256D64_1024_all(benchmark::State& state) { SHA256D64_1024(state, SHA256_USE_ALL); }
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -73,7 +111,15 @@ static void FastRandom_1bit(benchmark::State& state)
 
 BENCHMARK(RIPEMD160);
 BENCHMARK(SHA1);
-BENCHMARK(SHA256);
+BENCHMARK(SHA256_standard);
+BENCHMARK(SHA256_shani);
+BENCHMARK(SHA256_32b_standard);
+BENCHMARK(SHA256_32b_shani);
+BENCHMARK(SHA256D64_1024_standard);
+BENCHMARK(SHA256D64_1024_sse41);
+BENCHMARK(SHA256D64_1024_avx2);
+BENCHMARK(SHA256D64_1024_shani);
+BENCHMARK(SHA256D64_1024_all);
 BENCHMARK(SHA512);
 
 BENCHMARK(FastRandom_32bit);
@@ -0,0 +1,43 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "logging.h"
+#include "util.h"
+
+// A -debug=net line as the message handler logs it, written to a file the
+// way debug.log is. Measures what the logging call costs the calling thread.
+static void LogNetLines(benchmark::State& state, bool fAsync, uint32_t nRateLimit)
+{
+    const fs::path path = fs::temp_directory_path() / fs::unique_path("bench_log_%%%%-%%%%");
+    {
+        BCLog::Logger logger;
+        logger.m_print_to_file = true;
+        logger.m_file_path = path;
+        logger.SetRateLimit(nRateLimit);
+        if (!logger.OpenDebugLog())
+            return;
+        if (fAsync)
+            logger.StartAsync();
+
+        int nPeer = 0;
+        while (state.KeepRunning()) {
+            if (logger.RateLimitAccept(BCLog::NET))
+                logger.LogPrintStr(strprintf("received: %s (%u bytes) peer=%d\n", "inv", 37, nPeer++), BCLog::NET);
+        }
+        logger.StopAsync();
+        if (logger.GetDroppedLines() > 0)
+            LogPrintf("%s: %u lines dropped\n", __func__, logger.GetDroppedLines());
+    }
+    fs::remove(path);
+}
+
+static void LogSync(benchmark::State& state) { LogNetLines(state, false, 0); }
+static void LogAsync(benchmark::State& state) { LogNetLines(state, true, 0); }
+static void LogAsyncRateLimited(benchmark::State& state) { LogNetLines(state, true, 1000); }
+
+BENCHMARK(LogSync);
+BENCHMARK(LogAsync);
+BENCHMARK(LogAsyncRateLimited);
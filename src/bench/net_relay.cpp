@@ -0,0 +1,171 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "net.h"
+#include "netbase.h"
+#include "netmessagemaker.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "util.h"
+
+#include <atomic>
+#include <limits>
+#include <thread>
+
+#ifndef WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+// Block relay as seen by a well connected node, per block: the announcement,
+// the header, the block itself, followed by transaction invs and a ping.
+static const int BLOCK_TXS = 400;
+static const int TX_INVS_PER_BLOCK = 20;
+
+class RelayBenchConnman : public CConnman
+{
+public:
+    RelayBenchConnman() : CConnman(0x1337, 0x1337) {}
+    using CConnman::SocketSendData;
+};
+
+static CBlock MakeRelayBlock()
+{
+    CBlock block;
+    block.nVersion = 4;
+    block.hashPrevBlock = GetRandHash();
+    block.nTime = 1600000000;
+    for (int i = 0; i < BLOCK_TXS; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(2);
+        for (CTxIn& in : tx.vin) {
+            in.prevout = COutPoint(GetRandHash(), 0);
+            in.scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+        }
+        tx.vout.resize(2);
+        for (CTxOut& out : tx.vout) {
+            out.nValue = 1 * COIN;
+            out.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x11) << OP_EQUALVERIFY << OP_CHECKSIG;
+        }
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    return block;
+}
+
+/** Connected TCP pair over 127.0.0.1 */
+static bool MakeLoopbackPair(SOCKET& hSend, SOCKET& hRecv)
+{
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (hListen == INVALID_SOCKET ||
+        ::bind(hListen, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(hListen, 1) != 0 ||
+        getsockname(hListen, (struct sockaddr*)&addr, &len) != 0) {
+        CloseSocket(hListen);
+        return false;
+    }
+    hSend = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (connect(hSend, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        CloseSocket(hListen);
+        CloseSocket(hSend);
+        return false;
+    }
+    hRecv = accept(hListen, nullptr, nullptr);
+    CloseSocket(hListen);
+    return hRecv != INVALID_SOCKET;
+}
+
+// Push the workload through CConnman::PushMessage on one end of a loopback
+// connection and parse it with CNode::ReceiveMsgBytes on the other, the way
+// the socket handler does. Exercises message serialization, the pooled
+// send/receive buffers, gathered sends and direct receives of large payloads.
+static void NetRelayLoopback(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    SOCKET hSend = INVALID_SOCKET;
+    SOCKET hRecv = INVALID_SOCKET;
+    if (!MakeLoopbackPair(hSend, hRecv)) {
+        LogPrintf("%s: unable to create loopback connection\n", __func__);
+        return;
+    }
+
+    const CBlock block = MakeRelayBlock();
+    std::vector<uint256> vTxHashes;
+    for (const CTransactionRef& tx : block.vtx)
+        vTxHashes.push_back(tx->GetHash());
+
+    RelayBenchConnman connman;
+    CNode sender(0, NODE_NETWORK, 0, hSend, CAddress(), 0, 0, "", false);
+    CNode receiver(1, NODE_NETWORK, 0, hRecv, CAddress(), 0, 0, "", true);
+    const unsigned int nReceiveFloodSize = std::numeric_limits<unsigned int>::max();
+
+    std::atomic<uint64_t> nReceived(0);
+    std::thread reader([&] {
+        char pchBuf[0x10000];
+        while (true) {
+            unsigned int nMaxBytes = 256 * 1024;
+            char* pchDest = receiver.GetDirectRecvBuffer(sizeof(pchBuf), nMaxBytes);
+            if (!pchDest) {
+                pchDest = pchBuf;
+                nMaxBytes = sizeof(pchBuf);
+            }
+            int nBytes = recv(hRecv, pchDest, nMaxBytes, 0);
+            if (nBytes <= 0)
+                break;
+            bool fComplete = false;
+            if (!receiver.ReceiveMsgBytes(pchDest, nBytes, fComplete))
+                break;
+            if (fComplete) {
+                receiver.MarkReceivedMsgsForProcessing(nReceiveFloodSize);
+                std::list<CNetMessage> vMsgs;
+                {
+                    LOCK(receiver.cs_vProcessMsg);
+                    vMsgs.swap(receiver.vProcessMsg);
+                    receiver.nProcessQueueSize = 0;
+                }
+                nReceived += vMsgs.size();
+            }
+        }
+    });
+
+    CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    auto push = [&](CSerializedNetMsg&& msg) {
+        connman.PushMessage(&sender, std::move(msg));
+        // play the socket handler's part when the optimistic send fell short
+        while (true) {
+            LOCK(sender.cs_vSend);
+            if (sender.vSendMsg.empty())
+                break;
+            connman.SocketSendData(&sender);
+        }
+    };
+
+    uint64_t nSent = 0;
+    uint64_t nNonce = 0;
+    while (state.KeepRunning()) {
+        push(msgMaker.Make(NetMsgType::INV, std::vector<CInv>{CInv(MSG_BLOCK, block.GetHash())}));
+        push(msgMaker.Make(NetMsgType::HEADERS, std::vector<CBlockHeader>{block.GetBlockHeader()}));
+        push(msgMaker.Make(NetMsgType::BLOCK, block));
+        for (int i = 0; i < TX_INVS_PER_BLOCK; i++)
+            push(msgMaker.Make(NetMsgType::INV, std::vector<CInv>{CInv(MSG_TX, vTxHashes[i])}));
+        push(msgMaker.Make(NetMsgType::PING, nNonce++));
+        nSent += 4 + TX_INVS_PER_BLOCK;
+        while (nReceived < nSent)
+            std::this_thread::yield();
+    }
+
+    sender.CloseSocketDisconnect();
+    reader.join();
+}
+
+BENCHMARK(NetRelayLoopback);
+#endif // WIN32
@@ -0,0 +1,116 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "fs.h"
+#include "main.h"
+#include "miner.h"
+#include "net.h"
+#include "random.h"
+#include "rewards.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <memory>
+
+// Enough blocks under the tip for the deepest reorg, all PoW: regtest only
+// turns to PoS at height 251 and doesn't check the work.
+static const int REORG_CHAIN_BLOCKS = 120;
+
+/** A regtest node in a temporary datadir, with a chain of blocks */
+class ReorgBenchNode
+{
+public:
+    ReorgBenchNode()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        ClearDatadirCache();
+        pathTemp = GetTempPath() / strprintf("bench_reorg_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        fs::create_directories(pathTemp);
+        mapArgs["-datadir"] = pathTemp.string();
+        pblocktree = new CBlockTreeDB(1 << 20, true);
+        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        pcoinsTip = new CCoinsViewCache(pcoinsdbview.get());
+        InitBlockIndex();
+        CValidationState state;
+        ActivateBestChain(state);
+
+        CConnman connman(0x1337, 0x1337);
+        const CScript scriptPubKey = CScript() << OP_TRUE;
+        unsigned int nExtraNonce = 0;
+        for (int i = 0; i < REORG_CHAIN_BLOCKS; i++) {
+            std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(scriptPubKey, nullptr, false));
+            if (!pblocktemplate)
+                break;
+            CBlock* pblock = &pblocktemplate->block;
+            {
+                LOCK(cs_main);
+                IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
+            }
+            if (!ProcessNewBlock(state, nullptr, pblock, nullptr, &connman))
+                break;
+        }
+    }
+
+    ~ReorgBenchNode()
+    {
+        UnloadBlockIndex();
+        mempool.clear();
+        delete pcoinsTip;
+        pcoinsTip = nullptr;
+        pcoinsdbview.reset();
+        delete pblocktree;
+        pblocktree = nullptr;
+        CRewards::Shutdown();
+        fs::remove_all(pathTemp);
+    }
+
+    /** Disconnects the last nDepth blocks and connects them back */
+    bool Reorg(int nDepth)
+    {
+        CValidationState state;
+        CBlockIndex* pindex;
+        {
+            LOCK(cs_main);
+            if (chainActive.Height() < nDepth)
+                return false;
+            pindex = chainActive[chainActive.Height() - nDepth + 1];
+            if (!InvalidateBlock(state, pindex) || !ReconsiderBlock(state, pindex))
+                return false;
+        }
+        return ActivateBestChain(state);
+    }
+
+private:
+    fs::path pathTemp;
+    std::unique_ptr<CCoinsViewDB> pcoinsdbview;
+};
+
+// One chain for all the depths, the rewards database stays open on it
+static ReorgBenchNode& GetNode()
+{
+    static ReorgBenchNode node;
+    return node;
+}
+
+static void Reorg(benchmark::State& state, int nDepth)
+{
+    ReorgBenchNode& node = GetNode();
+    while (state.KeepRunning()) {
+        if (!node.Reorg(nDepth)) {
+            LogPrintf("%s: %d block reorg failed\n", __func__, nDepth);
+            return;
+        }
+    }
+}
+
+static void Reorg10(benchmark::State& state) { Reorg(state, 10); }
+static void Reorg50(benchmark::State& state) { Reorg(state, 50); }
+static void Reorg100(benchmark::State& state) { Reorg(state, 100); }
+
+BENCHMARK(Reorg10);
+BENCHMARK(Reorg50);
+BENCHMARK(Reorg100);
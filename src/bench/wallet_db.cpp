@@ -0,0 +1,115 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "uint256.h"
+#include "util.h"
+#include "wallet/db.h"
+
+// A wallet with a long history: tx records of a typical size, written the
+// way block processing writes them and read back the way LoadWallet does.
+static const int WALLET_TXS = 50000;
+static const int BLOCK_WALLET_TXS = 20;
+static const size_t TX_RECORD_SIZE = 400;
+
+class BenchWalletDB : public CDB
+{
+public:
+    explicit BenchWalletDB(const std::string& strFilename) : CDB(strFilename, "cr+") {}
+    using CDB::Write;
+    using CDB::GetCursor;
+    using CDB::ReadAtCursor;
+};
+
+class WalletDBBench
+{
+public:
+    explicit WalletDBBench(const std::string& strBackend)
+    {
+        pathTemp = fs::temp_directory_path() / fs::unique_path("bench_wallet_%%%%-%%%%");
+        fs::create_directories(pathTemp);
+        mapArgs["-datadir"] = pathTemp.string();
+        mapArgs["-walletbackend"] = strBackend;
+        ClearDatadirCache();
+        // create the file, so batches have a connection to open on
+        BenchWalletDB db(strFile);
+    }
+
+    ~WalletDBBench()
+    {
+        bitdb.Flush(true);
+        mapArgs.erase("-walletbackend");
+        mapArgs.erase("-datadir");
+        ClearDatadirCache();
+        fs::remove_all(pathTemp);
+    }
+
+    /** One block worth of wallet txs, each through its own handle like CWalletDB in AddToWallet */
+    void WriteBlock(int& nTx)
+    {
+        bitdb.BeginBatch(strFile);
+        for (int i = 0; i < BLOCK_WALLET_TXS; i++, nTx++) {
+            BenchWalletDB db(strFile);
+            db.Write(std::make_pair(std::string("tx"), ArithToUint256(arith_uint256(nTx))), vchRecord);
+        }
+        bitdb.CommitBatch(strFile);
+    }
+
+    void Fill()
+    {
+        int nTx = 0;
+        while (nTx < WALLET_TXS)
+            WriteBlock(nTx);
+        bitdb.CloseDb(strFile);
+    }
+
+    int Load()
+    {
+        BenchWalletDB db(strFile);
+        std::unique_ptr<CDBCursor> pcursor = db.GetCursor();
+        int nRecords = 0;
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        while (pcursor && db.ReadAtCursor(pcursor.get(), ssKey, ssValue) == 0)
+            nRecords++;
+        return nRecords;
+    }
+
+    const std::string strFile = "wallet.dat";
+    const std::vector<unsigned char> vchRecord = std::vector<unsigned char>(TX_RECORD_SIZE, 0x5a);
+
+private:
+    fs::path pathTemp;
+};
+
+static void WalletWriteBlocks(benchmark::State& state, const std::string& strBackend)
+{
+    WalletDBBench bench(strBackend);
+    int nTx = 0;
+    while (state.KeepRunning())
+        bench.WriteBlock(nTx);
+}
+
+static void WalletLoad(benchmark::State& state, const std::string& strBackend)
+{
+    WalletDBBench bench(strBackend);
+    bench.Fill();
+    while (state.KeepRunning()) {
+        if (bench.Load() != WALLET_TXS + 1) // the tx records and the version
+            LogPrintf("%s: unexpected record count\n", __func__);
+        bitdb.CloseDb(bench.strFile);
+    }
+}
+
+static void WalletWriteBlocksBDB(benchmark::State& state) { WalletWriteBlocks(state, WALLET_BACKEND_BDB); }
+static void WalletWriteBlocksSQLite(benchmark::State& state) { WalletWriteBlocks(state, WALLET_BACKEND_SQLITE); }
+static void WalletLoadBDB(benchmark::State& state) { WalletLoad(state, WALLET_BACKEND_BDB); }
+static void WalletLoadSQLite(benchmark::State& state) { WalletLoad(state, WALLET_BACKEND_SQLITE); }
+
+BENCHMARK(WalletWriteBlocksBDB);
+BENCHMARK(WalletWriteBlocksSQLite);
+BENCHMARK(WalletLoadBDB);
+BENCHMARK(WalletLoadSQLite);
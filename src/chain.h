@@ -13,6 +13,7 @@
 
 #include "chainparams.h"
 #include "pow.h"
+#include "prevector.h"
 #include "primitives/block.h"
 #include "timedata.h"
 #include "tinyformat.h"
@@ -211,15 +212,19 @@ public:
     //! Verification status of this block. See enum BlockStatus
     unsigned int nStatus{0};
 
-    // proof-of-stake specific fields
-    // char vector holding the stake modifier bytes. It is empty for PoW blocks.
-    // Modifier V1 is 64 bit while modifier V2 is 256 bit.
-    std::vector<unsigned char> vStakeModifier{};
-    unsigned int nFlags{0};
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    uint32_t nSequenceId{0};
 
     //! Money supply at this block.
     Optional<CAmount> nMoneySupply{0};
 
+    // proof-of-stake specific fields
+    // char vector holding the stake modifier bytes. It is empty for PoW blocks.
+    // Modifier V1 is 64 bit while modifier V2 is 256 bit, both fit inline
+    // without a heap allocation per block.
+    prevector<32, unsigned char> vStakeModifier{};
+    unsigned int nFlags{0};
+
     //! block header
     int nVersion{0};
     uint256 hashMerkleRoot{};
@@ -227,9 +232,6 @@ public:
     unsigned int nBits{0};
     unsigned int nNonce{0};
 
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    uint32_t nSequenceId{0};
-
     CBlockIndex() {}
     CBlockIndex(const CBlock& block);
 
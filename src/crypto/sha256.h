@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -27,4 +28,26 @@ public:
     CSHA256& Reset();
 };
 
+/** Hardware backends SHA256AutoDetect may pick from, when the CPU has them. */
+enum SHA256Implementation : uint8_t {
+    SHA256_STANDARD = 0,
+    SHA256_USE_SSE41 = 1 << 0,
+    SHA256_USE_AVX2 = 1 << 1,
+    SHA256_USE_SHANI = 1 << 2,
+    SHA256_USE_ALL = SHA256_USE_SSE41 | SHA256_USE_AVX2 | SHA256_USE_SHANI,
+};
+
+/** Select the fastest SHA-256 transforms this CPU supports out of those allowed,
+ *  and return a description of them. Not thread safe: call it before hashing starts.
+ */
+std::string SHA256AutoDetect(SHA256Implementation use = SHA256_USE_ALL);
+
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ *  The output may overlap the start of the input, as merkle levels are hashed in place.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -6,9 +6,15 @@
 #include "dbwrapper.h"
 
 #include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
 
 #include <boost/scoped_ptr.hpp>
 
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
 #include <leveldb/filter_policy.h>
@@ -16,14 +22,61 @@
 #include <stdint.h>
 
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static std::mutex cs_dbwrappers;
+static std::condition_variable condDBWrappers;
+static std::set<CDBWrapper*> setDBWrappers;
+
+CDBOptions::CDBOptions(size_t nCacheSize)
+{
+    nBlockCacheSize = nCacheSize / 2;
+    nWriteBufferSize = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
+    nMaxFileSize = leveldb::Options().max_file_size;
+    nBloomBits = 10;
+    nMaxOpenFiles = 64;
+}
+
+void CDBOptions::ApplyArgs(const std::string& strName)
+{
+    for (const std::string& strOption : mapMultiArgs["-dboption"]) {
+        // <name>:<key>=<value>, sizes in MiB
+        size_t nColon = strOption.find(':');
+        size_t nEquals = strOption.find('=');
+        if (nColon == std::string::npos || nEquals == std::string::npos || nEquals < nColon) {
+            LogPrintf("Ignoring malformed -dboption=%s\n", strOption);
+            continue;
+        }
+        if (strOption.substr(0, nColon) != strName)
+            continue;
+        const std::string strKey = strOption.substr(nColon + 1, nEquals - nColon - 1);
+        int64_t nValue;
+        if (!ParseInt64(strOption.substr(nEquals + 1), &nValue) || nValue < 0) {
+            LogPrintf("Ignoring -dboption=%s: invalid value\n", strOption);
+            continue;
+        }
+        if (strKey == "blockcache")
+            nBlockCacheSize = (size_t)nValue << 20;
+        else if (strKey == "writebuffer")
+            nWriteBufferSize = (size_t)nValue << 20;
+        else if (strKey == "maxfilesize")
+            nMaxFileSize = (size_t)nValue << 20;
+        else if (strKey == "bloombits")
+            nBloomBits = (int)nValue;
+        else if (strKey == "maxopenfiles")
+            nMaxOpenFiles = (int)nValue;
+        else
+            LogPrintf("Ignoring -dboption=%s: unknown key\n", strOption);
+    }
+}
+
+static leveldb::Options GetLevelDBOptions(const CDBOptions& dbOptions)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(dbOptions.nBlockCacheSize);
+    options.write_buffer_size = dbOptions.nWriteBufferSize;
+    options.max_file_size = dbOptions.nMaxFileSize;
+    options.filter_policy = dbOptions.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(dbOptions.nBloomBits) : NULL;
     options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.max_open_files = dbOptions.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -32,14 +85,21 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, const std::string& name) :
+    strName(name.empty() ? path.filename().string() : name),
+    dbOptions(nCacheSize),
+    nBatchesWritten(0),
+    nBytesWritten(0),
+    fCompacting(false),
+    nRegistryUsers(0)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    dbOptions.ApplyArgs(strName);
+    options = GetLevelDBOptions(dbOptions);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -56,10 +116,27 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    LogPrint(BCLog::LEVELDB, "LevelDB %s: block cache %.1fMiB, write buffer %.1fMiB, max file size %.1fMiB, bloom filter %d bits/key\n",
+             strName, dbOptions.nBlockCacheSize * (1.0 / 1024 / 1024), dbOptions.nWriteBufferSize * (1.0 / 1024 / 1024),
+             dbOptions.nMaxFileSize * (1.0 / 1024 / 1024), dbOptions.nBloomBits);
+
+    std::lock_guard<std::mutex> lock(cs_dbwrappers);
+    setDBWrappers.insert(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        std::unique_lock<std::mutex> lock(cs_dbwrappers);
+        setDBWrappers.erase(this);
+        // a ForEachDBWrapper() call may still be using it
+        condDBWrappers.wait(lock, [this] { return nRegistryUsers == 0; });
+    }
+    if (threadCompact.joinable()) {
+        if (fCompacting)
+            LogPrintf("Waiting for the compaction of LevelDB %s to finish\n", strName);
+        threadCompact.join();
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
@@ -72,11 +149,96 @@ CDBWrapper::~CDBWrapper()
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
+    const int64_t nStart = GetTimeMicros();
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    batchWriteTime.Add(GetTimeMicros() - nStart);
+    nBatchesWritten++;
+    nBytesWritten += batch.SizeEstimate();
     return true;
 }
 
+std::string CDBWrapper::GetProperty(const std::string& strProperty) const
+{
+    std::string strValue;
+    if (!pdb->GetProperty(strProperty, &strValue))
+        return "";
+    return strValue;
+}
+
+size_t CDBWrapper::DynamicMemoryUsage() const
+{
+    int64_t nUsage = 0;
+    if (!ParseInt64(GetProperty("leveldb.approximate-memory-usage"), &nUsage))
+        return 0;
+    return (size_t)nUsage;
+}
+
+uint64_t CDBWrapper::EstimateTotalSize() const
+{
+    // every key is prefixed with a type byte below 0xff
+    static const char chLast[] = "\xff\xff\xff\xff\xff\xff\xff\xff";
+    leveldb::Range range(leveldb::Slice(), leveldb::Slice(chLast, sizeof(chLast) - 1));
+    uint64_t nSize = 0;
+    pdb->GetApproximateSizes(&range, 1, &nSize);
+    return nSize;
+}
+
+bool CDBWrapper::Compact(bool fBackground)
+{
+    bool fExpected = false;
+    if (!fCompacting.compare_exchange_strong(fExpected, true))
+        return false;
+
+    auto compact = [this]() {
+        LogPrintf("Compacting LevelDB %s\n", strName);
+        const int64_t nStart = GetTimeMillis();
+        pdb->CompactRange(NULL, NULL);
+        LogPrintf("Compacted LevelDB %s in %dms\n", strName, GetTimeMillis() - nStart);
+        fCompacting = false;
+    };
+
+    if (!fBackground) {
+        compact();
+        return true;
+    }
+    // the previous background run has finished, reap its thread
+    if (threadCompact.joinable())
+        threadCompact.join();
+    threadCompact = std::thread(&TraceThread<std::function<void()> >, "dbcompact", std::function<void()>(compact));
+    return true;
+}
+
+void ForEachDBWrapper(std::function<void(CDBWrapper&)> func)
+{
+    // Copy the registry, so that a long func (a foreground compaction) does
+    // not hold up opening databases or other registry users
+    std::vector<CDBWrapper*> vDBWrappers;
+    {
+        std::lock_guard<std::mutex> lock(cs_dbwrappers);
+        for (CDBWrapper* pdbw : setDBWrappers) {
+            pdbw->nRegistryUsers++;
+            vDBWrappers.push_back(pdbw);
+        }
+    }
+
+    // none of them can be closed until func is done with all of them
+    auto release = [&vDBWrappers]() {
+        std::lock_guard<std::mutex> lock(cs_dbwrappers);
+        for (CDBWrapper* pdbw : vDBWrappers)
+            pdbw->nRegistryUsers--;
+        condDBWrappers.notify_all();
+    };
+    try {
+        for (CDBWrapper* pdbw : vDBWrappers)
+            func(*pdbw);
+    } catch (...) {
+        release();
+        throw;
+    }
+    release();
+}
+
 bool CDBWrapper::IsEmpty()
 {
     boost::scoped_ptr<CDBIterator> it(NewIterator());
@@ -11,8 +11,12 @@
 #include "serialize.h"
 #include "streams.h"
 #include "util.h"
+#include "util/histogram.h"
 #include "version.h"
 
+#include <atomic>
+#include <functional>
+#include <thread>
 
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
@@ -30,6 +34,25 @@ public:
 
 class CDBWrapper;
 
+/**
+ * LevelDB tuning of a single database. Defaults are derived from the cache
+ * size the database is opened with and can be overridden per database with
+ * -dboption=<name>:<key>=<value>.
+ */
+struct CDBOptions
+{
+    size_t nBlockCacheSize;  //!< LRU cache for uncompressed blocks (bytes)
+    size_t nWriteBufferSize; //!< memtable size, up to two may be held in memory (bytes)
+    size_t nMaxFileSize;     //!< target size of a table file (bytes)
+    int nBloomBits;          //!< bloom filter bits per key, 0 disables the filter
+    int nMaxOpenFiles;       //!< table files kept open
+
+    explicit CDBOptions(size_t nCacheSize);
+
+    /** Apply -dboption overrides for the database called strName */
+    void ApplyArgs(const std::string& strName);
+};
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -171,6 +194,12 @@ public:
         return piter->value().size();
     }
 
+    /** The serialized value, to deserialize it elsewhere */
+    CDataStream GetValueStream() {
+        leveldb::Slice slValue = piter->value();
+        return CDataStream(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+    }
+
 };
 
 class CDBWrapper
@@ -197,16 +226,58 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! name used for -dboption and getdbstats
+    std::string strName;
+
+    //! tuning the database was opened with
+    CDBOptions dbOptions;
+
+    //! WriteBatch latency and volume
+    CLatencyHistogram batchWriteTime;
+    std::atomic<uint64_t> nBatchesWritten;
+    std::atomic<uint64_t> nBytesWritten;
+
+    //! background CompactRange() run by Compact(true)
+    std::thread threadCompact;
+    std::atomic<bool> fCompacting;
+
+    //! ForEachDBWrapper() calls using this database, guarded by the registry lock
+    int nRegistryUsers;
+
+    friend void ForEachDBWrapper(std::function<void(CDBWrapper&)> func);
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
      * @param[in] nCacheSize  Configures various leveldb cache settings.
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
+     * @param[in] name        Name for -dboption and statistics, defaults to the directory name.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, const std::string& name = "");
     ~CDBWrapper();
 
+    const std::string& GetName() const { return strName; }
+    const CDBOptions& GetOptions() const { return dbOptions; }
+    const CLatencyHistogram& GetBatchWriteTime() const { return batchWriteTime; }
+    uint64_t GetBatchesWritten() const { return nBatchesWritten; }
+    uint64_t GetBytesWritten() const { return nBytesWritten; }
+
+    /** Value of a LevelDB property such as "leveldb.stats", empty if unknown */
+    std::string GetProperty(const std::string& strProperty) const;
+    /** Approximate memory used by the memtables and block cache */
+    size_t DynamicMemoryUsage() const;
+    /** Approximate on-disk size of the whole key space */
+    uint64_t EstimateTotalSize() const;
+
+    /**
+     * Compact the whole key space. With fBackground the compaction runs on
+     * its own thread and this returns immediately. Returns false if a
+     * compaction is already running.
+     */
+    bool Compact(bool fBackground);
+    bool IsCompacting() const { return fCompacting; }
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
@@ -310,4 +381,10 @@ public:
 
 };
 
+/**
+ * Call func for every open database, which can't be closed meanwhile. The
+ * registry is only locked while listing them, so func may take long.
+ */
+void ForEachDBWrapper(std::function<void(CDBWrapper&)> func);
+
 #endif // BITCOIN_DBWRAPPER_H
@@ -129,6 +129,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 
         // Set the URI
         jreq.URI = req->GetURI();
+        jreq.nQueueWaitMicros = req->GetQueueWaitMicros();
 
         std::string strReply;
         // singleton request
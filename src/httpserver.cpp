@@ -46,11 +46,12 @@ class HTTPWorkItem : public HTTPClosure
 {
 public:
     HTTPWorkItem(HTTPRequest* req, const std::string &path, const HTTPRequestHandler& func):
-        req(req), path(path), func(func)
+        req(req), path(path), func(func), nTimeQueued(GetTimeMicros())
     {
     }
     void operator()()
     {
+        req->SetQueueWaitMicros(GetTimeMicros() - nTimeQueued);
         func(req.get(), path);
     }
 
@@ -59,6 +60,7 @@ public:
 private:
     std::string path;
     HTTPRequestHandler func;
+    int64_t nTimeQueued;
 };
 
 /** Simple work queue for distributing work over multiple threads.
@@ -558,7 +560,8 @@ void HTTPEvent::trigger(struct timeval* tv)
         evtimer_add(ev, tv); // trigger after timeval passed
 }
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       nQueueWaitMicros(0)
 {
 }
 HTTPRequest::~HTTPRequest()
@@ -615,12 +618,22 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  * this cannot be done from worker threads.
  */
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
+{
+    WriteReply(nStatus, strReply.data(), strReply.size());
+}
+
+void HTTPRequest::WriteReply(int nStatus, const std::vector<unsigned char>& vchReply)
+{
+    WriteReply(nStatus, vchReply.data(), vchReply.size());
+}
+
+void HTTPRequest::WriteReply(int nStatus, const void* data, size_t size)
 {
     assert(!replySent && req);
     // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
-    evbuffer_add(evb, strReply.data(), strReply.size());
+    evbuffer_add(evb, data, size);
     HTTPEvent* ev = new HTTPEvent(eventBase, true,
         std::bind(evhttp_send_reply, req, nStatus, (const char*)NULL, (struct evbuffer *)NULL));
     ev->trigger(0);
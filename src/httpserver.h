@@ -9,6 +9,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -60,6 +61,9 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    int64_t nQueueWaitMicros;
+
+    void WriteReply(int nStatus, const void* data, size_t size);
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -115,6 +119,18 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write HTTP reply with a binary body, avoiding an intermediate string copy.
+     * Same calling rules as the string version apply.
+     */
+    void WriteReply(int nStatus, const std::vector<unsigned char>& vchReply);
+
+    /** Time (in microseconds) the request spent in the work queue before a
+     * worker thread picked it up.
+     */
+    int64_t GetQueueWaitMicros() const { return nQueueWaitMicros; }
+    void SetQueueWaitMicros(int64_t nMicros) { nQueueWaitMicros = nMicros; }
 };
 
 /** Event handler closure.
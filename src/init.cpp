@@ -23,6 +23,7 @@
 #include "bootstrap.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
+#include "crypto/sha256.h"
 #include "consensus/upgrades.h"
 #include "fs.h"
 #include "httpserver.h"
@@ -79,7 +80,9 @@
 #include <boost/foreach.hpp>
 
 #if ENABLE_ZMQ
+#include "zmq/zmqabstractnotifier.h"
 #include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqrpc.h"
 #endif
 
 
@@ -91,10 +94,6 @@ volatile bool fRestartRequested = false; // true: restart false: shutdown
 
 std::unique_ptr<CConnman> g_connman;
 
-#if ENABLE_ZMQ
-static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
-#endif
-
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
 // accessing block files, don't count towards to fd_set size limit
@@ -249,6 +248,12 @@ void PrepareShutdown()
             //record that client took the proper shutdown procedure
             pblocktree->WriteFlag("shutdown", true);
         }
+
+        // Deliver the notifications still queued for the scheduler thread,
+        // the SetBestChain of the flush above included, before the chain
+        // state and the listeners go away
+        GetMainSignals().FlushBackgroundCallbacks();
+
         delete pcoinsTip;
         pcoinsTip = NULL;
         delete pcoinscatcher;
@@ -266,15 +271,16 @@ void PrepareShutdown()
 #endif
 
 #if ENABLE_ZMQ
-    if (pzmqNotificationInterface) {
-        UnregisterValidationInterface(pzmqNotificationInterface);
-        delete pzmqNotificationInterface;
-        pzmqNotificationInterface = NULL;
+    if (g_zmq_notification_interface) {
+        UnregisterValidationInterface(g_zmq_notification_interface);
+        delete g_zmq_notification_interface;
+        g_zmq_notification_interface = NULL;
     }
 #endif
 
     // Disconnect all slots
     UnregisterAllValidationInterfaces();
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
 
 #ifndef WIN32
     try {
@@ -309,6 +315,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    g_logger->StopAsync();
 }
 
 /**
@@ -382,6 +389,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-blocksizenotify=<cmd>", _("Execute command when the best block changes and its size is over (%s in cmd is replaced by block hash, %d with the block size)"));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
+    strUsage += HelpMessageOpt("-checkblocksbackground=<n>", strprintf(_("How many blocks to read and check again, with their undo data, in the background once the node is running (default: %u, -1 = all)"), DEFAULT_CHECKBLOCKS_BACKGROUND));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), PIVX_CONF_FILENAME));
     if (mode == HMM_BITCOIND) {
 #if !defined(WIN32)
@@ -392,6 +400,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf(_("Specify location of debug log file: this can be an absolute path or a path relative to the data directory (default: %s)"), DEFAULT_DEBUGLOGFILE));
     strUsage += HelpMessageOpt("-disablesystemnotifications", strprintf(_("Disable OS notifications for incoming transactions (default: %u)"), 0));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dboption=<db>:<key>=<n>", _("Override the LevelDB tuning derived from -dbcache for one database (chainstate, blockindex, sporks). "
+                                                              "Keys: blockcache, writebuffer, maxfilesize (MiB), bloombits, maxopenfiles. Can be specified multiple times"));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf(_("Set the Maximum reorg depth (default: %u)"), DEFAULT_MAX_REORG_DEPTH));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
@@ -426,6 +436,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-maxpeeruploadrate=<n>", strprintf(_("Limit the rate at which old blocks are served to each non-whitelisted peer to <n> KB/s, 0 = unlimited. Announcements and new blocks are not limited (default: %u)"), DEFAULT_MAX_PEER_UPLOAD_RATE));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -434,6 +445,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), AvailableSocketEventsModes(), DefaultSocketEventsMode()));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -456,6 +468,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubsequence=<address>", _("Enable publish hash block and tx sequence in <address>"));
+    strUsage += HelpMessageOpt("-zmqpub<type>hwm=<n>", strprintf(_("Set publish outbound message high water mark for the <type> notifier (default: %d)"), CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM));
+    strUsage += HelpMessageOpt("-zmqqueuesize=<n>", strprintf(_("Maximum number of notifications waiting to be published before new ones are dropped (default: %u)"), DEFAULT_ZMQ_QUEUE_SIZE));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -469,6 +484,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-deprecatedrpc=<method>", _("Allows deprecated RPC method(s) to be used"));
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", _("Randomly drop 1 of every <n> network messages"));
         strUsage += HelpMessageOpt("-fuzzmessagestest=<n>", _("Randomly fuzz 1 of every <n> network messages"));
+        strUsage += HelpMessageOpt("-lockprofile", strprintf("Record wait and hold times of every lock site, see getlockstats (default: %u)", DEFAULT_LOCKPROFILE));
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf(_("Stop running after importing blocks from disk (default: %u)"), DEFAULT_STOPAFTERBLOCKIMPORT));
         strUsage += HelpMessageOpt("-limitancestorcount=<n>", strprintf(_("Do not accept transactions if number of in-mempool ancestors is <n> or more (default: %u)"), DEFAULT_ANCESTOR_LIMIT));
         strUsage += HelpMessageOpt("-limitancestorsize=<n>", strprintf(_("Do not accept transactions whose size with all in-mempool ancestors exceeds <n> kilobytes (default: %u)"), DEFAULT_ANCESTOR_SIZE_LIMIT));
@@ -484,6 +500,9 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-nodebug", "Turn off debugging messages, same as -debug=0");
 
     strUsage += HelpMessageOpt("-help-debug", _("Show all debugging options (usage: --help -help-debug)"));
+    strUsage += HelpMessageOpt("-debugratelimit=<n>", strprintf(_("Log at most <n> lines per second of each debug category, 0 for no limit (default: %u)"), DEFAULT_DEBUGRATELIMIT));
+    strUsage += HelpMessageOpt("-logasync", strprintf(_("Write the debug log from a background thread; debug lines are dropped if it can't keep up (default: %u)"), DEFAULT_LOGASYNC));
+    strUsage += HelpMessageOpt("-logfsync=<policy>", strprintf(_("When to fsync the debug log: never, periodic (every %d seconds) or always (default: %s)"), LOG_FSYNC_INTERVAL, DEFAULT_LOGFSYNC));
     strUsage += HelpMessageOpt("-logips", strprintf(_("Include IP addresses in debug output (default: %u)"), DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), DEFAULT_LOGTIMESTAMPS));
     strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
@@ -680,6 +699,18 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
     }
 }
 
+/** Check the last blocks again while the node is serving: -checkblocksbackground */
+static void ThreadVerifyBlocks(int nCheckDepth)
+{
+    util::ThreadRename("pivx-verifyblk");
+
+    if (!CVerifyDB(true).VerifyDB(pcoinsTip, 2, nCheckDepth)) {
+        uiInterface.ThreadSafeMessageBox(_("Corrupted block database detected") + "\n" + _("Restart with -reindex to rebuild the block database."),
+            "", CClientUIInterface::MSG_ERROR);
+        StartShutdown();
+    }
+}
+
 /** Sanity checks
  *  Ensure that the wallet is running in a usable environment with all
  *  necessary library support.
@@ -903,6 +934,7 @@ void InitLogging()
     g_logger->m_print_to_console = GetBoolArg("-printtoconsole", !GetBoolArg("-daemon", false));
     g_logger->m_log_timestamps = GetBoolArg("-logtimestamps", DEFAULT_LOGTIMESTAMPS);
     g_logger->m_log_time_micros = GetBoolArg("-logtimemicros", DEFAULT_LOGTIMEMICROS);
+    g_logger->SetRateLimit(std::max<int64_t>(0, GetArg("-debugratelimit", DEFAULT_DEBUGRATELIMIT)));
 
     fLogIPs = GetBoolArg("-logips", DEFAULT_LOGIPS);
 
@@ -933,8 +965,15 @@ bool AppInit2()
     int nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     int nMaxConnections = std::max(nUserMaxConnections, 4 * MAX_OUTBOUND_CONNECTIONS);
 
+    std::string strSocketEventsMode = GetArg("-socketevents", DefaultSocketEventsMode());
+    if (!IsSocketEventsModeSupported(strSocketEventsMode))
+        return UIError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), strSocketEventsMode, AvailableSocketEventsModes()));
+
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    // (select() cannot watch descriptors at or above FD_SETSIZE, epoll has no such limit)
+    if (strSocketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS));
+    nMaxConnections = std::max(nMaxConnections, 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return UIError(_("Not enough file descriptors available."));
@@ -994,6 +1033,7 @@ bool AppInit2()
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", Params().DefaultConsistencyChecks());
+    g_lock_profiling = GetBoolArg("-lockprofile", DEFAULT_LOCKPROFILE);
     Checkpoints::fEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
     // -mempoollimit limits
@@ -1027,6 +1067,10 @@ bool AppInit2()
     }
 #endif
 
+#if ENABLE_ZMQ
+    zmqRegisterRPCCommands();
+#endif
+
     nConnectTimeout = GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0)
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1070,6 +1114,8 @@ bool AppInit2()
     fReindex = GetBoolArg("-reindex", false);
 
     // Initialize elliptic curve code
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1093,12 +1139,16 @@ bool AppInit2()
 #ifndef WIN32
     CreatePidFile(GetPidFile(), getpid());
 #endif
+    if (!BCLog::GetLogFsync(g_logger->m_fsync, GetArg("-logfsync", DEFAULT_LOGFSYNC)))
+        return UIError(strprintf(_("Unknown -logfsync policy: '%s'"), GetArg("-logfsync", "")));
     if (g_logger->m_print_to_file) {
         if (GetBoolArg("-shrinkdebugfile", g_logger->DefaultShrinkDebugFile()))
             g_logger->ShrinkDebugFile();
         if (!g_logger->OpenDebugLog())
             return UIError(strprintf("Could not open debug log file %s", g_logger->m_file_path.string()));
     }
+    if (GetBoolArg("-logasync", DEFAULT_LOGASYNC))
+        g_logger->StartAsync();
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
@@ -1128,6 +1178,10 @@ bool AppInit2()
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
+    // Validation interface notifications that don't need to be synchronous
+    // are delivered in order on the scheduler thread
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
     /* Start the RPC server already.  It will be started in "warmup" mode
      * and not really process calls already (but it will signify connections
      * that the server is there and will be ready later).  Warmup mode will
@@ -1413,10 +1467,10 @@ bool AppInit2()
         connman.AddOneShot(strDest);
 
 #if ENABLE_ZMQ
-    pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
+    g_zmq_notification_interface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
 
-    if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+    if (g_zmq_notification_interface) {
+        RegisterValidationInterface(g_zmq_notification_interface);
     }
 #endif
 
@@ -1759,7 +1813,9 @@ bool AppInit2()
     connOptions.nBestHeight = chainActive.Height();
     connOptions.uiInterface = &uiInterface;
     connOptions.nSendBufferMaxSize = 1000*GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
+    connOptions.nMaxPeerUploadRate = 1000 * std::max<int64_t>(0, GetArg("-maxpeeruploadrate", DEFAULT_MAX_PEER_UPLOAD_RATE));
     connOptions.nReceiveFloodSize = 1000*GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.strSocketEventsMode = strSocketEventsMode;
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return UIError(strNodeError);
@@ -1775,6 +1831,10 @@ bool AppInit2()
     SetRPCWarmupFinished();
     uiInterface.InitMessage(_("Done loading"));
 
+    const int nCheckBlocksBackground = GetArg("-checkblocksbackground", DEFAULT_CHECKBLOCKS_BACKGROUND);
+    if (nCheckBlocksBackground != 0)
+        threadGroup.create_thread(boost::bind(&ThreadVerifyBlocks, std::max(0, nCheckBlocksBackground)));
+
 #ifdef ENABLE_WALLET
     if (pwalletMain) {
         pwalletMain->postInitProcess(threadGroup);
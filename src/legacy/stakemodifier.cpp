@@ -90,7 +90,7 @@ static bool SelectBlockFromCandidates(
 
 // The stake modifier used to hash for a stake kernel is chosen as the stake
 // modifier about a selection interval later than the coin generating the kernel
-bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
+bool GetOldModifierByWalk(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
 {
     int64_t nStakeModifierTime = pindexFrom->GetBlockTime();
     const CBlockIndex* pindex = pindexFrom;
@@ -111,6 +111,125 @@ bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
     return true;
 }
 
+namespace {
+
+/*
+ * The blocks of chainActive that generated a v1 modifier, in height order.
+ * The walk above stops at the first of them after pindexFrom whose time is
+ * at least a selection interval past it; block times are not monotonic, so
+ * that one is found with a max-time tree over the list instead of a binary
+ * search on time. Synced with chainActive lazily, under cs_main.
+ */
+class COldModifierIndex
+{
+private:
+    std::vector<const CBlockIndex*> vBlocks;
+    // Max block time per subtree of vBlocks: node n has children 2n and 2n+1,
+    // leaves start at nLeaves. Unused leaves are 0.
+    std::vector<int64_t> vMaxTime;
+    size_t nLeaves{0};
+    // Last block of chainActive that was scanned
+    const CBlockIndex* pindexScanned{nullptr};
+
+    void SetLeaf(size_t nPos, int64_t nTime)
+    {
+        size_t n = nLeaves + nPos;
+        vMaxTime[n] = nTime;
+        for (n /= 2; n > 0; n /= 2)
+            vMaxTime[n] = std::max(vMaxTime[2 * n], vMaxTime[2 * n + 1]);
+    }
+
+    void Push(const CBlockIndex* pindex)
+    {
+        if (vBlocks.size() == nLeaves) {
+            nLeaves = std::max<size_t>(64, 2 * nLeaves);
+            vMaxTime.assign(2 * nLeaves, 0);
+            for (size_t i = 0; i < vBlocks.size(); i++)
+                vMaxTime[nLeaves + i] = vBlocks[i]->GetBlockTime();
+            for (size_t n = nLeaves - 1; n > 0; n--)
+                vMaxTime[n] = std::max(vMaxTime[2 * n], vMaxTime[2 * n + 1]);
+        }
+        vBlocks.push_back(pindex);
+        SetLeaf(vBlocks.size() - 1, pindex->GetBlockTime());
+    }
+
+    // First position at or after nStart whose block time is at least nTime
+    size_t FindTime(size_t nNode, size_t nBegin, size_t nEnd, size_t nStart, int64_t nTime) const
+    {
+        if (nEnd <= nStart || vMaxTime[nNode] < nTime)
+            return vBlocks.size();
+        if (nEnd - nBegin == 1)
+            return nBegin;
+        const size_t nMid = (nBegin + nEnd) / 2;
+        const size_t nPos = FindTime(2 * nNode, nBegin, nMid, nStart, nTime);
+        return nPos < vBlocks.size() ? nPos : FindTime(2 * nNode + 1, nMid, nEnd, nStart, nTime);
+    }
+
+public:
+    void Reset()
+    {
+        vBlocks.clear();
+        vMaxTime.clear();
+        nLeaves = 0;
+        pindexScanned = nullptr;
+    }
+
+    void Sync()
+    {
+        AssertLockHeld(cs_main);
+        if (pindexScanned && !chainActive.Contains(pindexScanned)) {
+            // reorg: drop what is past the fork
+            pindexScanned = chainActive.FindFork(pindexScanned);
+            const int nHeightFork = pindexScanned ? pindexScanned->nHeight : -1;
+            while (!vBlocks.empty() && vBlocks.back()->nHeight > nHeightFork) {
+                SetLeaf(vBlocks.size() - 1, 0);
+                vBlocks.pop_back();
+            }
+        }
+        for (int nHeight = pindexScanned ? pindexScanned->nHeight + 1 : 0; nHeight <= chainActive.Height(); nHeight++) {
+            const CBlockIndex* pindex = chainActive[nHeight];
+            if (pindex->GeneratedStakeModifier())
+                Push(pindex);
+        }
+        pindexScanned = chainActive.Tip();
+    }
+
+    const CBlockIndex* Find(const CBlockIndex* pindexFrom) const
+    {
+        std::vector<const CBlockIndex*>::const_iterator it = std::upper_bound(vBlocks.begin(), vBlocks.end(), pindexFrom->nHeight,
+            [](int nHeight, const CBlockIndex* pindex) { return nHeight < pindex->nHeight; });
+        const size_t nPos = FindTime(1, 0, nLeaves, it - vBlocks.begin(), pindexFrom->GetBlockTime() + OLD_MODIFIER_INTERVAL);
+        return nPos < vBlocks.size() ? vBlocks[nPos] : nullptr;
+    }
+};
+
+COldModifierIndex oldModifierIndex;
+
+} // namespace
+
+void UpdateOldModifierIndex()
+{
+    LOCK(cs_main);
+    oldModifierIndex.Sync();
+}
+
+void ResetOldModifierIndex()
+{
+    LOCK(cs_main);
+    oldModifierIndex.Reset();
+}
+
+bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
+{
+    LOCK(cs_main);
+    oldModifierIndex.Sync();
+    const CBlockIndex* pindex = oldModifierIndex.Find(pindexFrom);
+    if (!pindex)
+        return error("%s : no modifier after block %s in the active chain", __func__, pindexFrom->GetBlockHash().GetHex());
+    nStakeModifier = pindex->GetStakeModifierV1();
+    return true;
+}
+
 bool GetOldStakeModifier(CStakeInput* stake, uint64_t& nStakeModifier)
 {
     CBlockIndex* pindexFrom = stake->GetIndexFrom();
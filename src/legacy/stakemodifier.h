@@ -14,6 +14,14 @@
 
 // Old Modifier - Only for IBD
 bool GetOldStakeModifier(CStakeInput* stake, uint64_t& nStakeModifier);
+/** The v1 modifier a kernel from pindexFrom hashes with, looked up in the index of modifier generations */
+bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier);
+/** The same, found by walking chainActive forward from pindexFrom */
+bool GetOldModifierByWalk(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier);
+/** Bring the index of modifier generations in step with chainActive */
+void UpdateOldModifierIndex();
+/** Forget the index, before the block index it points into is unloaded */
+void ResetOldModifierIndex();
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 
 #endif // PIVX_LEGACY_MODIFIER_H
@@ -7,8 +7,12 @@
 
 #include "chainparamsbase.h"
 #include "logging.h"
+#include "util.h"
+#include "util/threadnames.h"
 #include "utiltime.h"
 
+#include <chrono>
+
 
 const char * const DEFAULT_DEBUGLOGFILE = "debug.log";
 
@@ -35,6 +39,94 @@ static int FileWriteStr(const std::string &str, FILE *fp)
     return fwrite(str.data(), 1, str.size(), fp);
 }
 
+/**
+ * Bounded multi-producer single-consumer queue of log lines. Each cell
+ * carries a sequence number telling producers and the consumer whose turn
+ * it is, so pushing is one compare-and-swap on the enqueue position and
+ * popping takes no atomic read-modify-write at all.
+ */
+class BCLog::LogRing
+{
+public:
+    explicit LogRing(size_t nLines)
+    {
+        size_t nSize = 1;
+        while (nSize < nLines)
+            nSize <<= 1;
+        nMask = nSize - 1;
+        cells.reset(new Cell[nSize]);
+        for (size_t i = 0; i < nSize; i++)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    /** False when full. nTime is the timestamp to prefix, or -1 for none */
+    bool Push(std::string&& str, int64_t nTime)
+    {
+        Cell* cell;
+        size_t pos = nEnqueue.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & nMask];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (nEnqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = nEnqueue.load(std::memory_order_relaxed);
+            }
+        }
+        cell->str = std::move(str);
+        cell->nTime = nTime;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Single consumer only. False when empty */
+    bool Pop(std::string& str, int64_t& nTime)
+    {
+        const size_t pos = nDequeue.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & nMask];
+        if (cell.seq.load(std::memory_order_acquire) != pos + 1)
+            return false;
+        str.swap(cell.str);
+        cell.str.clear();
+        nTime = cell.nTime;
+        cell.seq.store(pos + nMask + 1, std::memory_order_release);
+        nDequeue.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t Pending() const
+    {
+        return nEnqueue.load(std::memory_order_relaxed) - nDequeue.load(std::memory_order_relaxed);
+    }
+
+    size_t Capacity() const { return nMask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        std::string str;
+        int64_t nTime;
+    };
+    std::unique_ptr<Cell[]> cells;
+    size_t nMask;
+    // producers and the consumer each get their own cache line
+    alignas(64) std::atomic<size_t> nEnqueue{0};
+    alignas(64) std::atomic<size_t> nDequeue{0};
+};
+
+BCLog::Logger::Logger() {}
+
+BCLog::Logger::~Logger()
+{
+    StopAsync();
+    if (m_fileout)
+        fclose(m_fileout);
+}
+
 bool BCLog::Logger::OpenDebugLog()
 {
     std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
@@ -55,6 +147,19 @@ bool BCLog::Logger::OpenDebugLog()
     return true;
 }
 
+bool BCLog::GetLogFsync(BCLog::LogFsync& policy, const std::string& str)
+{
+    if (str == "never")
+        policy = LogFsync::NEVER;
+    else if (str == "periodic")
+        policy = LogFsync::PERIODIC;
+    else if (str == "always")
+        policy = LogFsync::ALWAYS;
+    else
+        return false;
+    return true;
+}
+
 void BCLog::Logger::EnableCategory(BCLog::LogFlags flag)
 {
     m_categories |= flag;
@@ -172,56 +277,210 @@ std::vector<CLogCategoryActive> ListActiveLogCategories()
     return ret;
 }
 
-std::string BCLog::Logger::LogTimestampStr(const std::string &str)
+static const char* LogCategoryName(BCLog::LogFlags category)
 {
-    std::string strStamped;
+    for (const CLogCategoryDesc& category_desc : LogCategories) {
+        if (category_desc.flag != BCLog::NONE && (category_desc.flag & category))
+            return category_desc.category.c_str();
+    }
+    return "?";
+}
+
+bool BCLog::Logger::RateLimitAccept(BCLog::LogFlags category)
+{
+    const uint32_t nLimit = m_rate_limit.load(std::memory_order_relaxed);
+    if (nLimit == 0)
+        return true;
+
+    int nIndex = 0;
+    while (nIndex < 31 && !(category & (1U << nIndex)))
+        nIndex++;
+    CategoryRate& rate = m_rates[nIndex];
+
+    const int64_t nSecond = GetTimeMillis() / 1000;
+    if (rate.second.load(std::memory_order_relaxed) != nSecond && rate.second.exchange(nSecond) != nSecond) {
+        // first line of a new second: start counting again and report what the last one cost
+        rate.lines = 0;
+        const uint64_t nSuppressed = rate.suppressed.exchange(0);
+        if (nSuppressed > 0)
+            LogPrintStr(strprintf("Suppressed %u %s debug lines over -debugratelimit=%u\n", nSuppressed, LogCategoryName(category), nLimit));
+    }
+    if (++rate.lines <= nLimit)
+        return true;
+    ++rate.suppressed;
+    ++m_suppressed;
+    return false;
+}
 
+std::string BCLog::Logger::LogTimestampStr(const std::string &str)
+{
     if (!m_log_timestamps)
         return str;
 
-    if (m_started_new_line)
-        strStamped =  DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()) + ' ' + str;
-    else
-        strStamped = str;
+    // atomic, so lines queued concurrently in async mode don't need a lock here
+    const bool fNewLine = !str.empty() && str[str.size()-1] == '\n';
+    if (m_started_new_line.exchange(fNewLine))
+        return DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()) + ' ' + str;
+    return str;
+}
 
-    if (!str.empty() && str[str.size()-1] == '\n')
-        m_started_new_line = true;
-    else
-        m_started_new_line = false;
+int BCLog::Logger::WriteToFile(const std::string& str)
+{
+    // buffer if we haven't opened the log yet
+    if (m_fileout == NULL) {
+        m_msgs_before_open.push_back(str);
+        return str.length();
+    }
+
+    // reopen the log file, if requested
+    if (m_reopen_file) {
+        m_reopen_file = false;
+        if (fsbridge::freopen(m_file_path,"a",m_fileout) != NULL)
+            setbuf(m_fileout, NULL); // unbuffered
+    }
 
-    return strStamped;
+    int ret = FileWriteStr(str, m_fileout);
+    if (m_fsync == LogFsync::ALWAYS) {
+        FileCommit(m_fileout);
+    } else if (m_fsync == LogFsync::PERIODIC) {
+        const int64_t nNow = GetTimeMillis() / 1000;
+        if (nNow - m_last_fsync >= LOG_FSYNC_INTERVAL) {
+            FileCommit(m_fileout);
+            m_last_fsync = nNow;
+        }
+    }
+    return ret;
 }
 
-int BCLog::Logger::LogPrintStr(const std::string &str)
+int BCLog::Logger::LogPrintStr(const std::string &str, BCLog::LogFlags category)
 {
     int ret = 0; // Returns total number of characters written
-    if (m_print_to_console) {
+    if (m_async.load(std::memory_order_acquire) && (m_print_to_console || m_print_to_file)) {
+        // formatting the timestamp is left to the writer
+        int64_t nTime = -1;
+        if (!m_print_to_console && m_log_timestamps) {
+            const bool fNewLine = !str.empty() && str[str.size()-1] == '\n';
+            if (m_started_new_line.exchange(fNewLine))
+                nTime = GetTime();
+        }
+        std::string strLine = str;
+        ret = strLine.size();
+        while (!m_ring->Push(std::move(strLine), nTime)) {
+            if (category != BCLog::NONE) {
+                ++m_dropped;
+                return 0;
+            }
+            // only debug lines may be lost: wait for the writer to make room
+            m_writer_cv.notify_one();
+            std::this_thread::yield();
+        }
+        if (m_ring->Pending() > m_ring->Capacity() / 2)
+            m_writer_cv.notify_one();
+    } else if (m_print_to_console) {
         // print to console
         ret = fwrite(str.data(), 1, str.size(), stdout);
         fflush(stdout);
     } else if (m_print_to_file) {
         std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
+        ret = WriteToFile(LogTimestampStr(str));
+    }
 
-        std::string strTimestamped = LogTimestampStr(str);
-
-        // buffer if we haven't opened the log yet
-        if (m_fileout == NULL) {
-            ret = strTimestamped.length();
-            m_msgs_before_open.push_back(strTimestamped);
+    return ret;
+}
 
-        } else {
-            // reopen the log file, if requested
-            if (m_reopen_file) {
-                m_reopen_file = false;
-                if (fsbridge::freopen(m_file_path,"a",m_fileout) != NULL)
-                    setbuf(m_fileout, NULL); // unbuffered
+void BCLog::Logger::WriterThread()
+{
+    util::ThreadRename("pivx-logger");
+
+    // a line pushed with room to spare doesn't wake the writer, so it also
+    // looks every so often
+    static const std::chrono::milliseconds WRITER_INTERVAL(50);
+    // upper bound for a single write
+    static const size_t MAX_BATCH_BYTES = 1 << 20;
+
+    std::string strBatch;
+    std::string strLine;
+    int64_t nTime;
+    int64_t nStampTime = -1;
+    std::string strStamp;
+    while (true) {
+        strBatch.clear();
+        while (strBatch.size() < MAX_BATCH_BYTES && m_ring->Pop(strLine, nTime)) {
+            if (nTime >= 0) {
+                // lines come in bursts, most of them within the same second
+                if (nTime != nStampTime) {
+                    strStamp = DateTimeStrFormat("%Y-%m-%d %H:%M:%S ", nTime);
+                    nStampTime = nTime;
+                }
+                strBatch += strStamp;
             }
+            strBatch += strLine;
+        }
+
+        const uint64_t nDropped = m_dropped.load();
+        if (nDropped != m_dropped_reported) {
+            strBatch += strprintf("%sLog buffer full, dropped %u debug lines (%u in total)\n",
+                m_log_timestamps && !m_print_to_console ? DateTimeStrFormat("%Y-%m-%d %H:%M:%S ", GetTime()) : "",
+                nDropped - m_dropped_reported, nDropped);
+            m_dropped_reported = nDropped;
+        }
 
-            ret = FileWriteStr(strTimestamped, m_fileout);
+        if (!strBatch.empty()) {
+            if (m_print_to_console) {
+                fwrite(strBatch.data(), 1, strBatch.size(), stdout);
+                fflush(stdout);
+            } else {
+                std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
+                WriteToFile(strBatch);
+            }
+            continue;
         }
+
+        std::unique_lock<std::mutex> lock(m_writer_mutex);
+        if (m_stop_writer)
+            break;
+        m_writer_cv.wait_for(lock, WRITER_INTERVAL);
     }
+}
 
-    return ret;
+void BCLog::Logger::StartAsync(size_t nLines)
+{
+    if (m_async)
+        return;
+    m_ring.reset(new LogRing(nLines));
+    m_stop_writer = false;
+    m_writer = std::thread(&BCLog::Logger::WriterThread, this);
+    m_async.store(true, std::memory_order_release);
+}
+
+void BCLog::Logger::StopAsync()
+{
+    if (!m_async)
+        return;
+    // new lines are written directly again; the writer drains the rest and exits
+    m_async.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        m_stop_writer = true;
+    }
+    m_writer_cv.notify_one();
+    m_writer.join();
+
+    // a caller may have pushed after the writer's last look
+    std::string strLine;
+    int64_t nTime;
+    while (m_ring->Pop(strLine, nTime)) {
+        if (nTime >= 0)
+            strLine = DateTimeStrFormat("%Y-%m-%d %H:%M:%S ", nTime) + strLine;
+        if (m_print_to_console) {
+            fwrite(strLine.data(), 1, strLine.size(), stdout);
+        } else {
+            std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
+            WriteToFile(strLine);
+        }
+    }
+    if (m_print_to_console)
+        fflush(stdout);
 }
 
 void BCLog::Logger::ShrinkDebugFile()
@@ -16,15 +16,25 @@
 #include "tinyformat.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+static const bool DEFAULT_LOGASYNC      = false;
+static const unsigned int DEFAULT_DEBUGRATELIMIT = 0;
+static const char* const DEFAULT_LOGFSYNC = "never";
+//! Seconds between fsyncs of the debug log with -logfsync=periodic
+static const int64_t LOG_FSYNC_INTERVAL = 5;
+//! Lines the asynchronous log buffer holds before debug lines are dropped
+static const size_t LOG_ASYNC_BUFFER_LINES = 16384;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -65,12 +75,50 @@ namespace BCLog {
         ALL         = ~(uint32_t)0,
     };
 
+    /** When the debug log is flushed to disk with fsync */
+    enum class LogFsync {
+        NEVER,      //!< leave it to the OS
+        PERIODIC,   //!< at most every LOG_FSYNC_INTERVAL seconds
+        ALWAYS,     //!< after every write
+    };
+
+    /** Return true if str names a fsync policy and set it */
+    bool GetLogFsync(LogFsync& policy, const std::string& str);
+
+    class LogRing;
+
     class Logger
     {
     private:
         FILE* m_fileout = nullptr;
         std::mutex m_file_mutex;
         std::list<std::string> m_msgs_before_open;
+        int64_t m_last_fsync = 0;
+
+        /**
+         * Asynchronous mode: callers format their line and push it to m_ring,
+         * a bounded lock-free queue, and m_writer writes whatever has queued
+         * up in a single write. Debug category lines are dropped when the
+         * queue is full, other lines wait for room.
+         */
+        std::unique_ptr<LogRing> m_ring;
+        std::thread m_writer;
+        std::atomic<bool> m_async{false};
+        std::atomic<bool> m_stop_writer{false};
+        std::mutex m_writer_mutex;
+        std::condition_variable m_writer_cv;
+        std::atomic<uint64_t> m_dropped{0};
+        uint64_t m_dropped_reported = 0;
+
+        /** Per category lines in the current second, for -debugratelimit */
+        struct CategoryRate {
+            std::atomic<int64_t> second{0};
+            std::atomic<uint32_t> lines{0};
+            std::atomic<uint64_t> suppressed{0};
+        };
+        CategoryRate m_rates[32];
+        std::atomic<uint32_t> m_rate_limit{DEFAULT_DEBUGRATELIMIT};
+        std::atomic<uint64_t> m_suppressed{0};
 
         /**
          * m_started_new_line is a state variable that will suppress printing of
@@ -84,18 +132,45 @@ namespace BCLog {
 
         std::string LogTimestampStr(const std::string& str);
 
+        /** Write to the debug log file, or buffer if it isn't open yet. Requires m_file_mutex */
+        int WriteToFile(const std::string& str);
+        void WriterThread();
+
     public:
+        Logger();
+        ~Logger();
+
         bool m_print_to_console = false;
         bool m_print_to_file = false;
 
         bool m_log_timestamps = DEFAULT_LOGTIMESTAMPS;
         bool m_log_time_micros = DEFAULT_LOGTIMEMICROS;
+        LogFsync m_fsync = LogFsync::NEVER;
 
         fs::path m_file_path;
         std::atomic<bool> m_reopen_file{false};
 
-        /** Send a string to the log output */
-        int LogPrintStr(const std::string &str);
+        /** Send a string to the log output. Lines of a debug category may be dropped in async mode */
+        int LogPrintStr(const std::string &str, LogFlags category = NONE);
+
+        /** Move writing to a background thread. Call after OpenDebugLog() */
+        void StartAsync(size_t nLines = LOG_ASYNC_BUFFER_LINES);
+        /** Write out everything queued and go back to writing from the calling thread */
+        void StopAsync();
+        bool IsAsync() const { return m_async.load(std::memory_order_relaxed); }
+
+        /**
+         * Limit every debug category to nLines per second, 0 for no limit.
+         * Lines over the limit are counted and reported once the second is over.
+         */
+        void SetRateLimit(uint32_t nLines) { m_rate_limit = nLines; }
+        /** Whether a line of this category fits under the rate limit */
+        bool RateLimitAccept(LogFlags category);
+
+        /** Lines dropped because the async buffer was full */
+        uint64_t GetDroppedLines() const { return m_dropped.load(); }
+        /** Lines suppressed by the rate limit */
+        uint64_t GetSuppressedLines() const { return m_suppressed.load(); }
 
         /** Returns whether logs will be written to any output */
         bool Enabled() const { return m_print_to_console || m_print_to_file; }
@@ -141,7 +216,7 @@ template<typename... Args> std::string FormatStringFromLogArgs(const char *fmt,
 // unconditionally log to debug.log! It should not be the case that an inbound
 // peer can fill up a user's disk with debug.log entries.
 
-#define LogPrintf(...) do {                                                         \
+#define LogPrintCategory_(category, ...) do {                                        \
     if(g_logger->Enabled()) {                                                       \
         std::string _log_msg_; /* Unlikely name to avoid shadowing variables */     \
         try {                                                                       \
@@ -152,13 +227,15 @@ template<typename... Args> std::string FormatStringFromLogArgs(const char *fmt,
                         "\" while formatting log message: " +                       \
                         FormatStringFromLogArgs(__VA_ARGS__);                       \
         }                                                                           \
-        g_logger->LogPrintStr(_log_msg_);                                           \
+        g_logger->LogPrintStr(_log_msg_, (category));                               \
     }                                                                               \
 } while(0)
 
+#define LogPrintf(...) LogPrintCategory_(BCLog::NONE, __VA_ARGS__)
+
 #define LogPrint(category, ...) do {                                                \
-    if (LogAcceptCategory((category))) {                                            \
-        LogPrintf(__VA_ARGS__);                                                     \
+    if (LogAcceptCategory((category)) && g_logger->RateLimitAccept((category))) {   \
+        LogPrintCategory_((category), __VA_ARGS__);                                 \
     }                                                                               \
 } while(0)
 
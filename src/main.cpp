@@ -24,6 +24,7 @@
 #include "fs.h"
 #include "init.h"
 #include "kernel.h"
+#include "legacy/stakemodifier.h"
 #include "masternode-payments.h"
 #include "masternodeman.h"
 #include "merkleblock.h"
@@ -51,7 +52,11 @@
 #include <boost/thread.hpp>
 #include <boost/foreach.hpp>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <queue>
+#include <thread>
+#include <type_traits>
 #include <regex>
 
 
@@ -160,6 +165,53 @@ int nSyncStarted = 0;
 /** All pairs A->B, where A (or one if its ancestors) misses transactions, but B has transactions. */
 std::multimap<CBlockIndex*, CBlockIndex*> mapBlocksUnlinked;
 
+/**
+ * Block index entries are only freed all at once, when the index is unloaded,
+ * so they are carved out of large chunks instead of being allocated one by
+ * one. That saves the allocator overhead on each of them and keeps entries
+ * loaded together next to each other in memory.
+ */
+class CBlockIndexArena
+{
+public:
+    static const size_t CHUNK_SIZE = 4096;
+
+    ~CBlockIndexArena() { Clear(); }
+
+    template <typename... Args>
+    CBlockIndex* New(Args&&... args)
+    {
+        if (vChunks.empty() || nUsed == CHUNK_SIZE) {
+            vChunks.emplace_back(new Storage[CHUNK_SIZE]);
+            nUsed = 0;
+        }
+        CBlockIndex* pindex = new (&vChunks.back()[nUsed]) CBlockIndex(std::forward<Args>(args)...);
+        nUsed++;
+        return pindex;
+    }
+
+    /** Destroy every entry; pointers to them must be gone by now */
+    void Clear()
+    {
+        for (size_t i = 0; i < vChunks.size(); i++) {
+            const size_t nCount = i + 1 == vChunks.size() ? nUsed : CHUNK_SIZE;
+            for (size_t j = 0; j < nCount; j++)
+                reinterpret_cast<CBlockIndex*>(&vChunks[i][j])->~CBlockIndex();
+        }
+        vChunks.clear();
+        nUsed = 0;
+    }
+
+private:
+    typedef std::aligned_storage<sizeof(CBlockIndex), alignof(CBlockIndex)>::type Storage;
+
+    std::vector<std::unique_ptr<Storage[]> > vChunks;
+    //! entries taken from the last chunk
+    size_t nUsed = 0;
+};
+
+CBlockIndexArena blockIndexArena GUARDED_BY(cs_main);
+
 RecursiveMutex cs_LastBlockFile;
 std::vector<CBlockFileInfo> vinfoBlockFile;
 int nLastBlockFile = 0;
@@ -667,6 +719,24 @@ CBlockIndex* GetChainTip()
     return mapBlockIndex.at(p->GetBlockHash());
 }
 
+static std::shared_ptr<const CChainTipSnapshot> g_tip_snapshot;
+
+/** Publish an immutable snapshot of the new tip (cs_main must be held by the writer) */
+static void PublishChainTipSnapshot(const CBlockIndex* pindex)
+{
+    std::shared_ptr<const CChainTipSnapshot> snapshot;
+    if (pindex) {
+        snapshot = std::make_shared<const CChainTipSnapshot>(
+                CChainTipSnapshot{pindex, pindex->nHeight, pindex->GetBlockHash(), pindex->GetBlockTime()});
+    }
+    std::atomic_store(&g_tip_snapshot, snapshot);
+}
+
+std::shared_ptr<const CChainTipSnapshot> GetChainTipSnapshot()
+{
+    return std::atomic_load(&g_tip_snapshot);
+}
+
 CCoinsViewCache* pcoinsTip = NULL;
 CBlockTreeDB* pblocktree = NULL;
 CSporkDB* pSporkDB = NULL;
@@ -751,6 +821,45 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRE
     return nEvicted;
 }
 
+/** The burn addresses of a chain as destinations, with their activation heights */
+typedef std::map<CTxDestination, int> BurnDestinations;
+
+static const BurnDestinations& GetBurnDestinations(const CChainParams& params)
+{
+    static Mutex cs_burn;
+    static std::map<const CChainParams*, BurnDestinations> mapByChain;
+
+    LOCK(cs_burn);
+    auto it = mapByChain.find(&params);
+    if (it == mapByChain.end()) {
+        BurnDestinations mapBurn;
+        for (const auto& p : params.GetConsensus().mBurnAddresses) {
+            // only what the address string check would match: the encoding must round-trip
+            const CTxDestination dest = DecodeDestination(p.first);
+            if (IsValidDestination(dest) && EncodeDestination(dest) == p.first)
+                mapBurn.emplace(dest, p.second);
+        }
+        it = mapByChain.emplace(&params, std::move(mapBurn)).first;
+    }
+    return it->second;
+}
+
+bool IsBurnScript(const CScript& scriptPubKey, int nHeight, CTxDestination* pdestRet)
+{
+    const BurnDestinations& mapBurn = GetBurnDestinations(Params());
+    if (mapBurn.empty())
+        return false;
+    CTxDestination dest;
+    if (!ExtractDestination(scriptPubKey, dest))
+        return false;
+    auto it = mapBurn.find(dest);
+    if (it == mapBurn.end() || it->second >= nHeight)
+        return false;
+    if (pdestRet)
+        *pdestRet = dest;
+    return true;
+}
+
 bool CheckFinalTx(const CTransaction& tx, int flags)
 {
     AssertLockHeld(cs_main);
@@ -865,24 +974,6 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
         return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-in-mempool");
     }
 
-    // ----------- burn address scanning -----------
-    if (!consensus.mBurnAddresses.empty()) {
-        for (unsigned int i = 0; i < tx.vin.size(); ++i) {
-            uint256 hashBlock;
-            CTransaction txPrev;
-            if (GetTransaction(tx.vin[i].prevout.hash, txPrev, hashBlock, true)) { // get the vin's previous transaction
-                CTxDestination source;
-                if (ExtractDestination(txPrev.vout[tx.vin[i].prevout.n].scriptPubKey, source)) { // extract the destination of the previous transaction's vout[n]
-                    const std::string addr = EncodeDestination(source);
-                    if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
-                        consensus.mBurnAddresses.at(addr) < chainHeight) {
-                        return state.DoS(0, false, REJECT_INVALID, "bad-txns-invalid-outputs");
-                    }
-                }
-            }
-        }
-    }
-
     // Check for conflicts with in-memory transactions
     {
         LOCK(pool.cs); // protect pool.mapNextTx
@@ -931,6 +1022,12 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
             }
         }
 
+        // ----------- burn address scanning -----------
+        for (const CTxIn& txin : tx.vin) {
+            if (IsBurnScript(view.AccessCoin(txin.prevout).out.scriptPubKey, chainHeight))
+                return state.DoS(0, false, REJECT_INVALID, "bad-txns-invalid-outputs");
+        }
+
         // Bring the best block into scope
         view.GetBestBlock();
 
@@ -1067,6 +1164,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
 
         // Store transaction in memory
         pool.addUnchecked(hash, entry, setAncestors, !IsInitialBlockDownload());
+        GetMainSignals().TransactionAddedToMempool(tx, pool.GetAndIncrementSequence());
 
         // trim mempool and check if tx was trimmed
         if (!fOverrideMempoolLimit) {
@@ -1305,8 +1403,9 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
 {
     CBlockIndex* pindexSlow = blockIndex;
 
-    LOCK(cs_main);
-
+    // cs_main is only needed to resolve the containing block through the coins
+    // view; the mempool and the block tree db have their own locking and the
+    // disk reads themselves are done without holding it.
     if (!blockIndex) {
         if (mempool.lookup(hash, txOut)) {
             return true;
@@ -1337,6 +1436,7 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
         }
 
         if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
+            LOCK(cs_main);
             const Coin& coin = AccessByTxid(*pcoinsTip, hash);
             if (!coin.IsSpent()) pindexSlow = chainActive[coin.nHeight];
         }
@@ -1345,9 +1445,9 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
     if (pindexSlow) {
         CBlock block;
         if (ReadBlockFromDisk(block, pindexSlow)) {
-            for (const CTransaction& tx : block.vtx) {
-                if (tx.GetHash() == hash) {
-                    txOut = tx;
+            for (const CTransactionRef& ptx : block.vtx) {
+                if (ptx->GetHash() == hash) {
+                    txOut = *ptx;
                     hashBlock = pindexSlow->GetBlockHash();
                     return true;
                 }
@@ -1422,6 +1522,47 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
 }
 
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos)
+{
+    // The block data is preceded by the network magic and the serialized size
+    if (pos.nPos < MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("%s : invalid block position (file %d, pos %u)", __func__, pos.nFile, pos.nPos);
+    CDiskBlockPos hpos = pos;
+    hpos.nPos -= MESSAGE_START_SIZE + sizeof(unsigned int);
+
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s : OpenBlockFile failed (file %d, pos %u)", __func__, pos.nFile, pos.nPos);
+
+    try {
+        CMessageHeader::MessageStartChars blk_start;
+        unsigned int blk_size;
+        filein >> FLATDATA(blk_start) >> blk_size;
+
+        if (memcmp(blk_start, Params().MessageStart(), MESSAGE_START_SIZE))
+            return error("%s : block magic mismatch (file %d, pos %u)", __func__, pos.nFile, pos.nPos);
+        if (blk_size > MAX_SIZE)
+            return error("%s : block data larger than maximum deserialization size (file %d, pos %u)", __func__, pos.nFile, pos.nPos);
+
+        block.resize(blk_size);
+        filein.read((char*)block.data(), blk_size);
+    } catch (const std::exception& e) {
+        return error("%s : Read from block file failed - %s", __func__, e.what());
+    }
+
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex)
+{
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = pindex->GetBlockPos();
+    }
+    return ReadRawBlockFromDisk(block, pos);
+}
+
 double ConvertBitsToDouble(unsigned int nBits)
 {
     int nShift = (nBits >> 24) & 0xff;
@@ -1640,6 +1781,8 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache &inputs, int nHeight)
 
 bool CScriptCheck::operator()()
 {
+    if (pblockSig)
+        return CheckBlockSignature(*pblockSig, fEnableP2PKH);
     const CScript& scriptSig = ptxTo->vin[nIn].scriptSig;
     return VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, amount, cacheStore, *precomTxData), &error);
 }
@@ -1767,8 +1910,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
     return true;
 }
 
-/** Abort with a message */
-static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
+bool AbortNode(const std::string& strMessage, const std::string& userMessage)
 {
     strMiscWarning = strMessage;
     LogPrintf("*** %s\n", strMessage);
@@ -1839,6 +1981,141 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     return true;
 }
 
+/** Reads blocks and their undo data on a few threads ahead of the caller
+ *  walking through them, for CVerifyDB and DisconnectBlocks. Disk reads and
+ *  deserialization, which hashes every transaction, then overlap with the
+ *  work that needs cs_main. Without threads the blocks are read by Get. */
+class CBlockReadAhead
+{
+public:
+    struct Entry {
+        CBlock block;
+        CBlockUndo undo;
+        bool fHaveData = true;
+        bool fRead = false;
+        bool fHaveUndo = false;
+        bool fUndoOk = true;
+        bool fReady = false;
+    };
+
+    /** fLockMainIn: the caller doesn't hold cs_main, so the readers take it
+     *  to look at the block index, whose files may be pruned meanwhile */
+    CBlockReadAhead(const std::vector<CBlockIndex*>& vIndexIn, bool fReadUndoIn, int nThreads, bool fLockMainIn = false) :
+        vIndex(vIndexIn), fReadUndo(fReadUndoIn), fLockMain(fLockMainIn), vEntries(std::min<size_t>(BLOCK_READ_AHEAD, std::max<size_t>(1, vIndexIn.size())))
+    {
+        for (int i = 0; i < nThreads; i++)
+            vThreads.emplace_back(&CBlockReadAhead::ThreadRead, this);
+    }
+
+    ~CBlockReadAhead()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fStop = true;
+        }
+        condRead.notify_all();
+        for (std::thread& thread : vThreads)
+            thread.join();
+    }
+
+    /** Wait for the i-th block, which stays valid until Release(i) */
+    Entry& Get(size_t i)
+    {
+        Entry& entry = vEntries[i % vEntries.size()];
+        if (vThreads.empty()) {
+            Read(i, entry);
+            return entry;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        condReady.wait(lock, [&entry] { return entry.fReady; });
+        return entry;
+    }
+
+    /** Done with the i-th block: its slot can take the next one ahead */
+    void Release(size_t i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Entry& entry = vEntries[i % vEntries.size()];
+            entry.block.SetNull();
+            entry.undo.vtxundo.clear();
+            entry.fReady = false;
+            nReleased = i + 1;
+        }
+        condRead.notify_all();
+    }
+
+private:
+    void Read(size_t i, Entry& entry)
+    {
+        const CBlockIndex* pindex = vIndex[i];
+        CDiskBlockPos posBlock;
+        CDiskBlockPos posUndo;
+        {
+            std::unique_ptr<DebugLock<RecursiveMutex> > lockMain;
+            if (fLockMain)
+                lockMain.reset(new DebugLock<RecursiveMutex>(cs_main, "cs_main", __FILE__, __LINE__));
+            entry.fHaveData = pindex->nStatus & BLOCK_HAVE_DATA;
+            if (entry.fHaveData)
+                posBlock = pindex->GetBlockPos();
+            if (pindex->nStatus & BLOCK_HAVE_UNDO)
+                posUndo = pindex->GetUndoPos();
+        }
+        entry.fRead = entry.fHaveData && ReadBlockFromDisk(entry.block, posBlock);
+        if (entry.fRead && entry.block.GetHash() != pindex->GetBlockHash())
+            entry.fRead = error("%s : block %s doesn't match index", __func__, pindex->GetBlockHash().ToString());
+        entry.fHaveUndo = !posUndo.IsNull();
+        entry.fUndoOk = true;
+        if (entry.fRead && fReadUndo && entry.fHaveUndo)
+            entry.fUndoOk = UndoReadFromDisk(entry.undo, posUndo, pindex->pprev->GetBlockHash());
+        if (fLockMain && (!entry.fRead || !entry.fUndoOk)) {
+            // a file pruned while we were reading it is not corruption
+            LOCK(cs_main);
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+                entry.fHaveData = false;
+            if (!(pindex->nStatus & BLOCK_HAVE_UNDO)) {
+                entry.fHaveUndo = false;
+                entry.fUndoOk = true;
+            }
+        }
+    }
+
+    void ThreadRead()
+    {
+        while (true) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condRead.wait(lock, [this] { return fStop || nNext == vIndex.size() || nNext < nReleased + vEntries.size(); });
+                if (fStop || nNext == vIndex.size())
+                    return;
+                i = nNext++;
+            }
+            // the slot is ours until it is marked ready
+            Entry& entry = vEntries[i % vEntries.size()];
+            Read(i, entry);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                entry.fReady = true;
+            }
+            condReady.notify_all();
+        }
+    }
+
+    const std::vector<CBlockIndex*>& vIndex;
+    const bool fReadUndo;
+    const bool fLockMain;
+    std::vector<std::thread> vThreads;
+
+    std::mutex mutex;
+    std::condition_variable condRead;
+    std::condition_variable condReady;
+    std::vector<Entry> vEntries;
+    size_t nNext = 0;
+    size_t nReleased = 0;
+    bool fStop = false;
+};
+
 } // anon namespace
 
 enum DisconnectResult
@@ -1880,9 +2157,11 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 }
 
 
-/** Undo the effects of this block (with given index) on the UTXO set represented by coins.
- *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewCache& view)
+/** Undo the effects of this block (with given index), read along with its undo
+ *  data by CBlockReadAhead, on the UTXO set represented by coins. The undo
+ *  data is used up. When UNCLEAN or FAILED is returned, view is left in an
+ *  indeterminate state. */
+DisconnectResult DisconnectBlock(CBlockReadAhead::Entry& entry, const CBlockIndex* pindex, CCoinsViewCache& view)
 {
     AssertLockHeld(cs_main);
 
@@ -1892,20 +2171,20 @@ DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewC
 
     bool fClean = true;
 
-    CBlockUndo blockUndo;
     CAmount nValueOut = 0;
     CAmount nValueIn = 0;
     CAmount nUnspendableValue = 0;
 
-    CDiskBlockPos pos = pindex->GetUndoPos();
-    if (pos.IsNull()) {
+    if (!entry.fHaveUndo) {
         error("%s: no undo data available", __func__);
         return DISCONNECT_FAILED;
     }
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
+    if (!entry.fUndoOk) {
         error("%s: failure reading undo data", __func__);
         return DISCONNECT_FAILED;
     }
+    const CBlock& block = entry.block;
+    CBlockUndo& blockUndo = entry.undo;
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
         error("%s: block and undo data inconsistent", __func__);
@@ -1914,7 +2193,7 @@ DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewC
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
-        const CTransaction& tx = block.vtx[i];
+        const CTransaction& tx = *block.vtx[i];
 
         nValueOut += tx.GetValueOut();
         nUnspendableValue += tx.GetUnspendableValueOut();
@@ -1959,14 +2238,6 @@ DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewC
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if(!IsInitialBlockDownload()) {
-        // Dynamic rewards management
-        if(!CRewards::DisconnectBlock(pindex)) return DISCONNECT_UNCLEAN;
-
-        // Masternode management
-        if(!mnodeman.DisconnectBlock(pindex, block)) return DISCONNECT_UNCLEAN;
-    }
-
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -2085,7 +2356,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<PrecomputedTransactionData> precomTxData;
     precomTxData.reserve(block.vtx.size()); // Required so that pointers to individual precomTxData don't get invalidated
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
-        const CTransaction& tx = block.vtx[i];
+        const CTransaction& tx = *block.vtx[i];
 
         nInputs += tx.vin.size();
         nSigOps += GetLegacySigOpCount(tx);
@@ -2097,6 +2368,18 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 return state.DoS(100, error("ConnectBlock() : inputs missing/spent"),
                     REJECT_INVALID, "bad-txns-inputs-missingorspent");
 
+            // ----------- burn address scanning -----------
+            // Outputs created earlier in this block are exempt, as they were when
+            // the spent tx was looked up through the tx index, which does not hold
+            // them yet. Spending those is only refused by mempool policy.
+            for (const CTxIn& txin : tx.vin) {
+                const Coin& coin = view.AccessCoin(txin.prevout);
+                CTxDestination source;
+                if (coin.nHeight != (unsigned int)pindex->nHeight && IsBurnScript(coin.out.scriptPubKey, pindex->nHeight, &source))
+                    return state.DoS(100, error("%s : Burned address %s tried to send a transaction %s (rejecting it).", __func__, EncodeDestination(source), txin.prevout.hash.ToString()),
+                        REJECT_INVALID, "bad-txns-banned");
+            }
+
             // Add in sigops done by pay-to-script-hash inputs;
             // this is to prevent a "rogue miner" from creating
             // an incredibly-expensive-to-validate block.
@@ -2130,14 +2413,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         // ----------- burn address scanning -----------
         if(nHeight > nLastCheckpointHeight) {
             for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                CTxDestination source;
-                if (tx.vout[i].scriptPubKey.IsNormalPaymentScript() && ExtractDestination(tx.vout[i].scriptPubKey, source)) {
-                    const std::string addr = EncodeDestination(source);
-                    if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
-                        consensus.mBurnAddresses.at(addr) < nHeight) {
-                        nUnspendableValue += tx.vout[i].nValue;
-                    }
-                }
+                if (tx.vout[i].scriptPubKey.IsNormalPaymentScript() && IsBurnScript(tx.vout[i].scriptPubKey, nHeight))
+                    nUnspendableValue += tx.vout[i].nValue;
             }
         }
 
@@ -2217,16 +2494,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             Coin coin;
             if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
                 // ----------- burn address scanning -----------
-                CTxDestination source;
-                if (ExtractDestination(coin.out.scriptPubKey, source)) {
-                    const std::string addr = EncodeDestination(source);
-                    if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
-                        consensus.mBurnAddresses.at(addr) < nHeight) 
-                    {
-                        nUnspendableValue += coin.out.nValue;
-                        pcursor->Next();
-                        continue;
-                    }
+                if (IsBurnScript(coin.out.scriptPubKey, nHeight)) {
+                    nUnspendableValue += coin.out.nValue;
+                    pcursor->Next();
+                    continue;
                 }
             }
             pcursor->Next();
@@ -2243,7 +2514,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     // Watch for changes to the previous coinbase transaction.
     static uint256 hashPrevBestCoinBase;
     GetMainSignals().UpdatedTransaction(hashPrevBestCoinBase);
-    hashPrevBestCoinBase = block.vtx[0].GetHash();
+    hashPrevBestCoinBase = block.vtx[0]->GetHash();
 
     int64_t nTime4 = GetTimeMicros();
     nTimeCallbacks += nTime4 - nTime3;
@@ -2343,6 +2614,10 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
+            // The dynamic rewards of the blocks in the chainstate must be on disk
+            // first, a restart can't compute the one of the tip's epoch again.
+            if (!CRewards::Flush())
+                return AbortNode(state, "Failed to write to the dynamic rewards database");
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
@@ -2370,6 +2645,7 @@ void FlushStateToDisk()
 void static UpdateTip(CBlockIndex* pindexNew)
 {
     chainActive.SetTip(pindexNew);
+    PublishChainTipSnapshot(pindexNew);
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -2409,54 +2685,101 @@ void static UpdateTip(CBlockIndex* pindexNew)
     }
 }
 
+/**
+ * Disconnect chainActive's tip down to pindexFork. The blocks and their undo
+ * data are read ahead, the coins of up to BLOCK_READ_AHEAD blocks restored in
+ * one cache flushed at once, and the masternode and rewards rollbacks done
+ * once for all of them. You probably want to call mempool.removeForReorg and
+ * manually re-limit mempool size after this, with cs_main held.
+ */
+static bool DisconnectBlocks(CValidationState& state, const CBlockIndex* pindexFork)
+{
+    AssertLockHeld(cs_main);
+
+    while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
+        // tip first
+        std::vector<CBlockIndex*> vDisconnect;
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex != pindexFork && vDisconnect.size() < (size_t)BLOCK_READ_AHEAD; pindex = pindex->pprev)
+            vDisconnect.push_back(pindex);
+        CBlockIndex* pindexNewTip = vDisconnect.back()->pprev;
+
+        // Apply the blocks atomically to the chain state.
+        int64_t nStart = GetTimeMicros();
+        std::vector<CBlock> vBlocks(vDisconnect.size());
+        {
+            const int nThreads = vDisconnect.size() > 1 ? std::max(1, std::min(GetNumCores() - 1, MAX_SCRIPTCHECK_THREADS)) : 0;
+            CBlockReadAhead reader(vDisconnect, true, nThreads);
+            CCoinsViewCache view(pcoinsTip);
+            for (size_t i = 0; i < vDisconnect.size(); i++) {
+                CBlockReadAhead::Entry& entry = reader.Get(i);
+                if (!entry.fRead)
+                    return AbortNode(state, "Failed to read block");
+                if (DisconnectBlock(entry, vDisconnect[i], view) != DISCONNECT_OK)
+                    return error("%s : DisconnectBlock %s failed", __func__, vDisconnect[i]->GetBlockHash().ToString());
+                vBlocks[i] = entry.block;
+                reader.Release(i);
+            }
+            assert(view.Flush());
+        }
+        LogPrint(BCLog::BENCH, "- Disconnect %u blocks: %.2fms\n", (unsigned)vDisconnect.size(), (GetTimeMicros() - nStart) * 0.001);
+        // Write the chain state to disk, if necessary.
+        if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
+            return false;
+        // The side state follows the coins only once they are written: past
+        // this point the blocks are gone and a failed rollback can't be undone
+        if (!IsInitialBlockDownload()) {
+            // Dynamic rewards management
+            if (!CRewards::DisconnectBlocks(vDisconnect.back()->nHeight))
+                return AbortNode(state, strprintf("Rewards rollback to %d failed", pindexNewTip->nHeight));
+
+            // Masternode management
+            if (!mnodeman.DisconnectBlocks(vDisconnect, vBlocks))
+                return AbortNode(state, strprintf("Masternode rollback to %d failed", pindexNewTip->nHeight));
+        }
+        for (size_t i = 0; i < vDisconnect.size(); i++)
+            GetMainSignals().BlockDisconnected(vBlocks[i], vDisconnect[i]);
+        // Resurrect mempool transactions from the disconnected blocks, the
+        // oldest first so that parents go back before their children.
+        std::vector<uint256> vHashUpdate;
+        for (auto it = vBlocks.rbegin(); it != vBlocks.rend(); ++it) {
+            for (const CTransactionRef& ptx : it->vtx) {
+                const CTransaction& tx = *ptx;
+                // ignore validation errors in resurrected transactions
+                std::list<CTransaction> removed;
+                CValidationState stateDummy;
+                if (tx.IsCoinBase() || tx.IsCoinStake() || !AcceptToMemoryPool(mempool, stateDummy, tx, false, nullptr, true)) {
+                    mempool.remove(tx, removed, true, MemPoolRemovalReason::REORG);
+                } else if (mempool.exists(tx.GetHash())) {
+                    vHashUpdate.push_back(tx.GetHash());
+                }
+            }
+        }
+        // AcceptToMemoryPool/addUnchecked all assume that new mempool entries have
+        // no in-mempool children, which is generally not true when adding
+        // previously-confirmed transactions back to the mempool.
+        // UpdateTransactionsFromBlock finds descendants of any transactions in these
+        // blocks that were added back and cleans up the mempool state.
+        mempool.UpdateTransactionsFromBlock(vHashUpdate);
+
+        // Update chainActive and related variables.
+        UpdateTip(pindexNewTip);
+        // Let wallets know transactions went from 1-confirmed to
+        // 0-confirmed or conflicted:
+        for (const CBlock& block : vBlocks) {
+            for (const CTransactionRef& ptx : block.vtx) {
+                GetMainSignals().SyncTransaction(*ptx, pindexNewTip, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+            }
+        }
+    }
+    return true;
+}
+
 /** Disconnect chainActive's tip. You probably want to call mempool.removeForReorg and manually re-limit mempool size after this, with cs_main held. */
 bool static DisconnectTip(CValidationState& state)
 {
     CBlockIndex* pindexDelete = chainActive.Tip();
     assert(pindexDelete);
-    // Read block from disk.
-    CBlock block;
-    if (!ReadBlockFromDisk(block, pindexDelete))
-        return AbortNode(state, "Failed to read block");
-    // Apply the block atomically to the chain state.
-    int64_t nStart = GetTimeMicros();
-    {
-        CCoinsViewCache view(pcoinsTip);
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
-            return error("DisconnectTip() : DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
-        assert(view.Flush());
-    }
-    LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
-    // Write the chain state to disk, if necessary.
-    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
-        return false;
-    // Resurrect mempool transactions from the disconnected block.
-    std::vector<uint256> vHashUpdate;
-    for (const CTransaction& tx : block.vtx) {
-        // ignore validation errors in resurrected transactions
-        std::list<CTransaction> removed;
-        CValidationState stateDummy;
-        if (tx.IsCoinBase() || tx.IsCoinStake() || !AcceptToMemoryPool(mempool, stateDummy, tx, false, nullptr, true)) {
-            mempool.remove(tx, removed, true);
-        } else if (mempool.exists(tx.GetHash())) {
-            vHashUpdate.push_back(tx.GetHash());
-        }
-    }
-    // AcceptToMemoryPool/addUnchecked all assume that new mempool entries have
-    // no in-mempool children, which is generally not true when adding
-    // previously-confirmed transactions back to the mempool.
-    // UpdateTransactionsFromBlock finds descendants of any transactions in this
-    // block that were added back and cleans up the mempool state.
-    mempool.UpdateTransactionsFromBlock(vHashUpdate);
-
-    // Update chainActive and related variables.
-    UpdateTip(pindexDelete->pprev);
-    // Let wallets know transactions went from 1-confirmed to
-    // 0-confirmed or conflicted:
-    for (const CTransaction& tx : block.vtx) {
-        GetMainSignals().SyncTransaction(tx, pindexDelete->pprev, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
-    }
-    return true;
+    return DisconnectBlocks(state, pindexDelete->pprev);
 }
 
 static int64_t nTimeReadFromDisk = 0;
@@ -2469,7 +2792,7 @@ static int64_t nTimePostConnect = 0;
  * Connect a new block to chainActive. pblock is either NULL or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
  */
-bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const CBlock* pblock, bool fAlreadyChecked, std::list<CTransaction> &txConflicted, std::vector<std::tuple<CTransaction,CBlockIndex*,int>> &txChanged)
+bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const CBlock* pblock, bool fAlreadyChecked, std::list<CTransaction> &txConflicted, std::vector<std::tuple<CTransactionRef,CBlockIndex*,int>> &txChanged)
 {
     assert(pindexNew->pprev == chainActive.Tip());
 
@@ -2523,6 +2846,7 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const CB
 
     // Update chainActive & related variables.
     UpdateTip(pindexNew);
+    GetMainSignals().BlockConnected(*pblock, pindexNew);
 
     for(unsigned int i=0; i < pblock->vtx.size(); i++) {
         txChanged.emplace_back(pblock->vtx[i], pindexNew, i);
@@ -2543,8 +2867,9 @@ bool DisconnectBlocks(int nBlocks)
     CValidationState state;
 
     LogPrintf("%s: Got command to replay %d blocks\n", __func__, nBlocks);
-    for (int i = 0; i <= nBlocks; i++)
-        DisconnectTip(state);
+    // the tip and nBlocks below it, at once
+    if (chainActive.Tip())
+        DisconnectBlocks(state, chainActive[std::max(0, chainActive.Height() - nBlocks - 1)]);
 
     return true;
 }
@@ -2656,7 +2981,7 @@ static void PruneBlockIndexCandidates()
  * Try to make some progress towards making pindexMostWork the active block.
  * pblock is either NULL or a pointer to a CBlock corresponding to pindexMostWork.
  */
-static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMostWork, const CBlock* pblock, bool fAlreadyChecked, std::list<CTransaction>& txConflicted, std::vector<std::tuple<CTransaction,CBlockIndex*,int>>& txChanged)
+static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMostWork, const CBlock* pblock, bool fAlreadyChecked, std::list<CTransaction>& txConflicted, std::vector<std::tuple<CTransactionRef,CBlockIndex*,int>>& txChanged)
 {
     AssertLockHeld(cs_main);
     if (pblock == NULL)
@@ -2666,12 +2991,9 @@ static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMo
     const CBlockIndex* pindexFork = chainActive.FindFork(pindexMostWork);
 
     // Disconnect active blocks which are no longer in the best chain.
-    bool fBlocksDisconnected = false;
-    while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
-        if (!DisconnectTip(state))
-            return false;
-        fBlocksDisconnected = true;
-    }
+    bool fBlocksDisconnected = chainActive.Tip() && chainActive.Tip() != pindexFork;
+    if (!DisconnectBlocks(state, pindexFork))
+        return false;
 
     // Build list of new blocks to connect.
     std::vector<CBlockIndex*> vpindexToConnect;
@@ -2746,7 +3068,7 @@ bool ActivateBestChain(CValidationState& state, const CBlock* pblock, bool fAlre
 
     CBlockIndex* pindexNewTip = nullptr;
     CBlockIndex* pindexMostWork = nullptr;
-    std::vector<std::tuple<CTransaction,CBlockIndex*,int>> txChanged;
+    std::vector<std::tuple<CTransactionRef,CBlockIndex*,int>> txChanged;
     if (pblock)
         txChanged.reserve(pblock->vtx.size());
     do {
@@ -2778,13 +3100,16 @@ bool ActivateBestChain(CValidationState& state, const CBlock* pblock, bool fAlre
             fInitialDownload = IsInitialBlockDownload();
 
             // throw all transactions though the signal-interface
+            int64_t nTimeNotify = GetTimeMicros();
             for (const CTransaction &tx : txConflicted) {
                 GetMainSignals().SyncTransaction(tx, pindexNewTip, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
             }
             // ... and about transactions that got confirmed:
             for(unsigned int i = 0; i < txChanged.size(); i++) {
-                GetMainSignals().SyncTransaction(std::get<0>(txChanged[i]), std::get<1>(txChanged[i]), std::get<2>(txChanged[i]));
+                GetMainSignals().SyncTransaction(*std::get<0>(txChanged[i]), std::get<1>(txChanged[i]), std::get<2>(txChanged[i]));
             }
+            LogPrint(BCLog::BENCH, "- Notify transactions: %.2fms (%u callbacks pending)\n",
+                     (GetTimeMicros() - nTimeNotify) * 0.001, GetMainSignals().CallbacksPending());
 
             break;
         }
@@ -2847,14 +3172,15 @@ bool InvalidateBlock(CValidationState& state, CBlockIndex* pindex)
     setDirtyBlockIndex.insert(pindex);
     setBlockIndexCandidates.erase(pindex);
 
-    while (chainActive.Contains(pindex)) {
-        CBlockIndex* pindexWalk = chainActive.Tip();
-        pindexWalk->nStatus |= BLOCK_FAILED_CHILD;
-        setDirtyBlockIndex.insert(pindexWalk);
-        setBlockIndexCandidates.erase(pindexWalk);
+    if (chainActive.Contains(pindex)) {
+        for (CBlockIndex* pindexWalk = chainActive.Tip(); pindexWalk != pindex->pprev; pindexWalk = pindexWalk->pprev) {
+            pindexWalk->nStatus |= BLOCK_FAILED_CHILD;
+            setDirtyBlockIndex.insert(pindexWalk);
+            setBlockIndexCandidates.erase(pindexWalk);
+        }
         // ActivateBestChain considers blocks already in chainActive
         // unconditionally valid already, so force disconnect away from it.
-        if (!DisconnectTip(state)) {
+        if (!DisconnectBlocks(state, pindex->pprev)) {
             mempool.removeForReorg(pcoinsTip, chainActive.Tip()->nHeight + 1, STANDARD_LOCKTIME_VERIFY_FLAGS);
             return false;
         }
@@ -2920,8 +3246,7 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.New(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -2942,7 +3267,7 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
 
         } else {
             // compute and set new V2 stake modifier (hash of prevout and prevModifier)
-            pindexNew->SetNewStakeModifier(block.vtx[1].vin[0].prevout.hash);
+            pindexNew->SetNewStakeModifier(block.vtx[1]->vin[0].prevout.hash);
         }
     }
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
@@ -3089,7 +3414,7 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool f
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig, bool fCheckPayee)
 {
     AssertLockHeld(cs_main);
 
@@ -3128,75 +3453,78 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
         return state.DoS(100, false, REJECT_INVALID, "bad-blk-length", false, "size limits failed");
 
     // First transaction must be coinbase, the rest must not be
-    if (block.vtx.empty() || !block.vtx[0].IsCoinBase())
+    if (block.vtx.empty() || !block.vtx[0]->IsCoinBase())
         return state.DoS(100, false, REJECT_INVALID, "bad-cb-missing", false, "first tx is not coinbase");
     for (unsigned int i = 1; i < block.vtx.size(); i++)
-        if (block.vtx[i].IsCoinBase())
+        if (block.vtx[i]->IsCoinBase())
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-multiple", false, "more than one coinbase");
 
     if (IsPoS) {
         // Coinbase output should be empty if proof-of-stake block
-        if (block.vtx[0].vout.size() != 1 || !block.vtx[0].vout[0].IsEmpty())
+        if (block.vtx[0]->vout.size() != 1 || !block.vtx[0]->vout[0].IsEmpty())
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-pos", false, "coinbase output not empty for proof-of-stake block");
 
         // Second transaction must be coinstake, the rest must not be
-        if (block.vtx.empty() || !block.vtx[1].IsCoinStake())
+        if (block.vtx.empty() || !block.vtx[1]->IsCoinStake())
             return state.DoS(100, false, REJECT_INVALID, "bad-cs-missing", false, "second tx is not coinstake");
         for (unsigned int i = 2; i < block.vtx.size(); i++)
-            if (block.vtx[i].IsCoinStake())
+            if (block.vtx[i]->IsCoinStake())
                 return state.DoS(100, false, REJECT_INVALID, "bad-cs-multiple", false, "more than one coinstake");
     }
 
-    // masternode payments / budgets
-    CBlockIndex* pindexPrev = chainActive.Tip();
-    int nHeight = 0;
-    if (pindexPrev != nullptr && block.hashPrevBlock != UINT256_ZERO) {
-        if (pindexPrev->GetBlockHash() != block.hashPrevBlock) {
-            //out of order
-            pindexPrev = LookupBlockIndex(block.hashPrevBlock);
-            if (!pindexPrev) {
-                return state.Error("blk-out-of-order");
+    // masternode payments / budgets, which depend on the current masternode
+    // list and don't apply when re-checking blocks already on disk
+    if (fCheckPayee) {
+        CBlockIndex* pindexPrev = chainActive.Tip();
+        int nHeight = 0;
+        if (pindexPrev != nullptr && block.hashPrevBlock != UINT256_ZERO) {
+            if (pindexPrev->GetBlockHash() != block.hashPrevBlock) {
+                //out of order
+                pindexPrev = LookupBlockIndex(block.hashPrevBlock);
+                if (!pindexPrev) {
+                    return state.Error("blk-out-of-order");
+                }
             }
-        }
-        nHeight = pindexPrev->nHeight + 1;
-
-        // It is entirely possible that we don't have enough data and this could fail
-        // (i.e. the block could indeed be valid). Store the block for later consideration
-        // but issue an initial reject message.
-        // The case also exists that the sending peer could not have enough data to see
-        // that this block is invalid, so don't issue an outright ban.
-        if (!IsInitialBlockDownload()) {
-            // check masternode payment
-            if (!IsBlockPayeeValid(block, pindexPrev)) {
-                mapRejectedBlocks.insert(std::make_pair(block.GetHash(), GetTime()));
-                return state.DoS(0, false, REJECT_INVALID, "bad-cb-payee", false, "Couldn't find masternode payment");
+            nHeight = pindexPrev->nHeight + 1;
+
+            // It is entirely possible that we don't have enough data and this could fail
+            // (i.e. the block could indeed be valid). Store the block for later consideration
+            // but issue an initial reject message.
+            // The case also exists that the sending peer could not have enough data to see
+            // that this block is invalid, so don't issue an outright ban.
+            if (!IsInitialBlockDownload()) {
+                // check masternode payment
+                if (!IsBlockPayeeValid(block, pindexPrev)) {
+                    mapRejectedBlocks.insert(std::make_pair(block.GetHash(), GetTime()));
+                    return state.DoS(0, false, REJECT_INVALID, "bad-cb-payee", false, "Couldn't find masternode payment");
+                }
+            } else {
+                LogPrintf("%s: Masternode/Budget payment checks skipped on sync\n", __func__);
             }
-        } else {
-            LogPrintf("%s: Masternode/Budget payment checks skipped on sync\n", __func__);
         }
     }
 
     // Check transactions
-    for (const CTransaction& tx : block.vtx) {
+    for (const CTransactionRef& tx : block.vtx) {
         if (!CheckTransaction(
-                tx,
+                *tx,
                 state
         ))
             return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
-                                             strprintf("Transaction check failed (tx hash %s) %s", tx.GetHash().ToString(), state.GetDebugMessage()));
+                                             strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
 
     }
 
     unsigned int nSigOps = 0;
-    for (const CTransaction& tx : block.vtx) {
-        nSigOps += GetLegacySigOpCount(tx);
+    for (const CTransactionRef& tx : block.vtx) {
+        nSigOps += GetLegacySigOpCount(*tx);
     }
     unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_LEGACY;
     if (nSigOps > nMaxBlockSigOps)
         return state.DoS(100, error("%s : out-of-bounds SigOpCount", __func__),
             REJECT_INVALID, "bad-blk-sigops", true);
 
-    if (fCheckPOW && fCheckMerkleRoot && fCheckSig)
+    if (fCheckPOW && fCheckMerkleRoot && fCheckSig && fCheckPayee)
         block.fChecked = true;
 
     return true;
@@ -3339,37 +3667,14 @@ bool IsTransactionInChain(const uint256& txId, int& nHeightTx)
 bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIndex* const pindexPrev)
 {
     const int nHeight = pindexPrev == nullptr ? 0 : pindexPrev->nHeight + 1;
-    const Consensus::Params& consensus = Params().GetConsensus();
 
     // Check that all transactions are finalized
-    for (const CTransaction& tx : block.vtx) {
-        if (!IsFinalTx(tx, nHeight, block.GetBlockTime())) {
+    for (const CTransactionRef& tx : block.vtx) {
+        if (!IsFinalTx(*tx, nHeight, block.GetBlockTime())) {
             return state.DoS(10, false, REJECT_INVALID, "bad-txns-nonfinal", false, "non-final transaction");
         }
     }
 
-    // ----------- burn address scanning -----------
-    if (!consensus.mBurnAddresses.empty()) {
-        for (const CTransaction& tx : block.vtx) {
-            if (!tx.IsCoinBase()) {
-                for (unsigned int i = 0; i < tx.vin.size(); ++i) {
-                    uint256 hashBlock;
-                    CTransaction txPrev;
-                    if (GetTransaction(tx.vin[i].prevout.hash, txPrev, hashBlock, true)) { // get the vin's previous transaction
-                        CTxDestination source;
-                        if (ExtractDestination(txPrev.vout[tx.vin[i].prevout.n].scriptPubKey, source)) { // extract the destination of the previous transaction's vout[n]
-                            const std::string addr = EncodeDestination(source);
-                            if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
-                                consensus.mBurnAddresses.at(addr) < nHeight) {
-                                return state.DoS(100, error("%s : Burned address %s tried to send a transaction %s (rejecting it).", __func__, addr.c_str(), txPrev.GetHash().ToString().c_str()), REJECT_INVALID, "bad-txns-banned");
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-
     // // Enforce block.nVersion=2 rule that the coinbase starts with serialized block height
     // if (pindexPrev) { // pindexPrev is only null on the first block which is a version 1 block.
     //     CScript expect = CScript() << nHeight;
@@ -3463,6 +3768,9 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
     return true;
 }
 
+static int64_t nTimeProofOfStake = 0;
+static int64_t nBlocksProofOfStake = 0;
+
 bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppindex, CDiskBlockPos* dbp, bool fAlreadyCheckedBlock)
 {
     AssertLockHeld(cs_main);
@@ -3506,9 +3814,15 @@ bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppi
 
     bool isPoS = block.IsProofOfStake();
     if (isPoS) {
+        const int64_t nTimeStart = GetTimeMicros();
         std::string strError;
         if (!CheckProofOfStake(block, strError, pindexPrev))
             return state.DoS(100, error("%s: proof of stake check failed (%s)", __func__, strError));
+        const int64_t nTimeCheck = GetTimeMicros() - nTimeStart;
+        nTimeProofOfStake += nTimeCheck;
+        nBlocksProofOfStake++;
+        LogPrint(BCLog::BENCH, "- Proof of stake: %.2fms [%.2fs, %.1f blocks/s]\n", nTimeCheck * 0.001, nTimeProofOfStake * 0.000001,
+                 nTimeProofOfStake ? nBlocksProofOfStake * 1000000.0 / nTimeProofOfStake : 0.0);
     }
 
     if (!AcceptBlockHeader(block, state, &pindex))
@@ -3539,7 +3853,7 @@ bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppi
         bool isBlockFromFork = pindexPrev != nullptr && chainActive.Tip() != pindexPrev;
 
         // Coin stake
-        const CTransaction &stakeTxIn = block.vtx[1];
+        const CTransaction &stakeTxIn = *block.vtx[1];
 
         // Inputs
         std::vector<CTxIn> pivInputs;
@@ -3552,9 +3866,9 @@ bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppi
 
         // Check for serial double spent on the same block, TODO: Move this to the proper method..
 
-        for (const CTransaction& tx : block.vtx) {
-            for (const CTxIn& in: tx.vin) {
-                if(tx.IsCoinStake()) continue;
+        for (const CTransactionRef& tx : block.vtx) {
+            for (const CTxIn& in: tx->vin) {
+                if(tx->IsCoinStake()) continue;
                 if(hasPIVInputs) {
                     // Check if coinstake input is double spent inside the same block
                     for (const CTxIn& pivIn : pivInputs)
@@ -3589,9 +3903,9 @@ bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppi
                 }
 
                 // Loop through every tx of this block
-                for (const CTransaction& t : bl.vtx) {
+                for (const CTransactionRef& t : bl.vtx) {
                     // Loop through every input of this tx
-                    for (const CTxIn& in: t.vin) {
+                    for (const CTxIn& in: t->vin) {
 
                         // Loop through every input of the staking tx
                         if (hasPIVInputs) {
@@ -3692,6 +4006,9 @@ void CBlockIndex::BuildSkip()
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
 }
 
+static int64_t nTimeBlockChecks = 0;
+static int64_t nBlocksChecked = 0;
+
 bool ProcessNewBlock(CValidationState& state, CNode* pfrom, const CBlock* pblock, CDiskBlockPos* dbp, CConnman* connman)
 {
     AssertLockNotHeld(cs_main);
@@ -3707,14 +4024,27 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, const CBlock* pblock
         const auto& params = Params();
         const auto& consensus = params.GetConsensus();
 
-        // check block
-        checked = CheckBlock(*pblock, state);
-
         // For now, we need the tip to know whether p2pkh block signatures are accepted or not.
         // After 5.0, this can be removed and replaced by the enforcement block time.
         newHeight = chainActive.Height() + 1;
         const bool enableP2PKH = consensus.NetworkUpgradeActive(newHeight, Consensus::UPGRADE_P2PKH_BLOCK_SIGNATURES);
-        if (!CheckBlockSignature(*pblock, enableP2PKH))
+
+        // check block, and its signature on the script check threads meanwhile
+        const int64_t nTimeStart = GetTimeMicros();
+        bool fSignatureOk;
+        {
+            std::vector<CScriptCheck> vChecks(1, CScriptCheck(*pblock, enableP2PKH));
+            CCheckQueueControl<CScriptCheck> control(nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+            control.Add(vChecks);
+            checked = CheckBlock(*pblock, state);
+            fSignatureOk = nScriptCheckThreads ? control.Wait() : vChecks[0]();
+        }
+        const int64_t nTimeCheck = GetTimeMicros() - nTimeStart;
+        nTimeBlockChecks += nTimeCheck;
+        nBlocksChecked++;
+        LogPrint(BCLog::BENCH, "- Block and signature checks: %.2fms (%d threads) [%.2fs, %.1f blocks/s]\n", nTimeCheck * 0.001,
+                 std::max(1, nScriptCheckThreads), nTimeBlockChecks * 0.000001, nTimeBlockChecks ? nBlocksChecked * 1000000.0 / nTimeBlockChecks : 0.0);
+        if (!fSignatureOk)
             return error("%s : bad proof-of-stake block signature", __func__);
 
         if (pblock->GetHash() != consensus.hashGenesisBlock && pfrom != NULL) {
@@ -3865,9 +4195,7 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw std::runtime_error("LoadBlockIndex() : new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.New();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
 
     pindexNew->phashBlock = &((*mi).first);
@@ -3877,12 +4205,16 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
 
 bool static LoadBlockIndexDB(std::string& strError)
 {
-    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
+    int64_t nTimeStart = GetTimeMillis();
+    const int nThreads = std::max(0, std::min(GetNumCores() - 1, MAX_BLOCK_INDEX_LOAD_THREADS));
+    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex, nThreads))
         return false;
+    const int64_t nTimeGuts = GetTimeMillis() - nTimeStart;
 
     boost::this_thread::interruption_point();
 
     // Calculate nChainWork
+    nTimeStart = GetTimeMillis();
     std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
     vSortedByHeight.reserve(mapBlockIndex.size());
     for (const std::pair<const uint256, CBlockIndex*>& item : mapBlockIndex) {
@@ -3918,7 +4250,10 @@ bool static LoadBlockIndexDB(std::string& strError)
             pindexBestHeader = pindex;
     }
 
+    const int64_t nTimeChainWork = GetTimeMillis() - nTimeStart;
+
     // Load block file info
+    nTimeStart = GetTimeMillis();
     pblocktree->ReadLastBlockFile(nLastBlockFile);
     vinfoBlockFile.resize(nLastBlockFile + 1);
     LogPrintf("%s: last block file = %i\n", __func__, nLastBlockFile);
@@ -3951,6 +4286,8 @@ bool static LoadBlockIndexDB(std::string& strError)
         }
     }
 
+    const int64_t nTimeFiles = GetTimeMillis() - nTimeStart;
+
     //Check if the shutdown procedure was followed on last client exit
     bool fLastShutdownWasPrepared = true;
     pblocktree->ReadFlag("shutdown", fLastShutdownWasPrepared);
@@ -3968,13 +4305,20 @@ bool static LoadBlockIndexDB(std::string& strError)
     // If this is written true before the next client init, then we know the shutdown process failed
     pblocktree->WriteFlag("shutdown", false);
 
+    LogPrintf("%s: %u entries: loaded in %dms, chain work in %dms, block files in %dms\n", __func__,
+        mapBlockIndex.size(), nTimeGuts, nTimeChainWork, nTimeFiles);
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
         return true;
+    nTimeStart = GetTimeMillis();
     chainActive.SetTip(it->second);
+    PublishChainTipSnapshot(it->second);
+    UpdateOldModifierIndex();
 
     PruneBlockIndexCandidates();
+    LogPrintf("%s: active chain set up in %dms\n", __func__, GetTimeMillis() - nTimeStart);
 
     const CBlockIndex* pChainTip = chainActive.Tip();
     LogPrintf("LoadBlockIndexDB(): hashBestChain=%s height=%d date=%s progress=%f\n",
@@ -3985,95 +4329,183 @@ bool static LoadBlockIndexDB(std::string& strError)
     return true;
 }
 
-CVerifyDB::CVerifyDB()
+namespace {
+
+/** Progress of a CVerifyDB run, with an estimate of the time left from the
+ *  rate so far, for the splash screen and the log */
+class CVerifyDBProgress
 {
-    uiInterface.ShowProgress(_("Verifying blocks..."), 0);
+public:
+    explicit CVerifyDBProgress(bool fShowIn) : fShow(fShowIn), nStart(GetTimeMillis()), nLastLog(nStart) {}
+
+    void Update(double dDone)
+    {
+        const int nPercent = std::max(1, std::min(99, (int)(dDone * 100)));
+        const int64_t nNow = GetTimeMillis();
+        // the first percent is too noisy to estimate from
+        const int64_t nLeft = dDone >= 0.01 ? (int64_t)((nNow - nStart) * (1 - dDone) / dDone / 1000) : -1;
+        if (nPercent == nLastPercent && nLeft / 5 == nLastLeft / 5)
+            return;
+        nLastPercent = nPercent;
+        nLastLeft = nLeft;
+
+        const std::string strLeft = nLeft >= 0 ? strprintf(_("about %s left"), FormatLeft(nLeft)) : "";
+        if (fShow)
+            uiInterface.ShowProgress(strLeft.empty() ? _("Verifying blocks...") : strprintf("%s (%s) ", _("Verifying blocks..."), strLeft), nPercent);
+        if (nNow - nLastLog >= 10 * 1000) {
+            LogPrintf("Verifying blocks... %d%%%s\n", nPercent, strLeft.empty() ? "" : ", " + strLeft);
+            nLastLog = nNow;
+        }
+    }
+
+    int64_t GetElapsedMillis() const { return GetTimeMillis() - nStart; }
+
+private:
+    static std::string FormatLeft(int64_t nSeconds)
+    {
+        if (nSeconds < 120)
+            return strprintf(_("%d seconds"), nSeconds);
+        return strprintf(_("%d minutes"), (nSeconds + 30) / 60);
+    }
+
+    const bool fShow;
+    const int64_t nStart;
+    int64_t nLastLog;
+    int nLastPercent = 0;
+    int64_t nLastLeft = -1;
+};
+
+} // anon namespace
+
+CVerifyDB::CVerifyDB(bool fBackgroundIn) : fBackground(fBackgroundIn)
+{
+    if (!fBackground)
+        uiInterface.ShowProgress(_("Verifying blocks..."), 0);
 }
 
 CVerifyDB::~CVerifyDB()
 {
-    uiInterface.ShowProgress("", 100);
+    if (!fBackground)
+        uiInterface.ShowProgress("", 100);
 }
 
 bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth)
 {
-    LOCK(cs_main);
-    if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL)
-        return true;
+    // Disconnecting and reconnecting blocks needs the chain to hold still for
+    // the whole run. Reading and checking them doesn't, so the background
+    // check only takes cs_main to look at the block index and skips blocks
+    // whose data is gone. Neither checks old blocks against the current
+    // masternode list, which they can fail without being corrupt.
+    std::unique_ptr<DebugLock<RecursiveMutex> > lockMain;
+    if (fBackground)
+        nCheckLevel = std::min(2, nCheckLevel);
+    else
+        lockMain.reset(new DebugLock<RecursiveMutex>(cs_main, "cs_main", __FILE__, __LINE__));
 
-    const int chainHeight = chainActive.Height();
-    // Verify blocks in the best chain
-    if (nCheckDepth <= 0)
-        nCheckDepth = 1000000000; // suffices until the year 19000
-    if (nCheckDepth > chainHeight)
-        nCheckDepth = chainHeight;
+    std::vector<CBlockIndex*> vIndex;
+    int chainHeight;
+    {
+        LOCK(cs_main);
+        if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL)
+            return true;
+
+        chainHeight = chainActive.Height();
+        // Verify blocks in the best chain
+        if (nCheckDepth <= 0)
+            nCheckDepth = 1000000000; // suffices until the year 19000
+        if (nCheckDepth > chainHeight)
+            nCheckDepth = chainHeight;
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev && pindex->nHeight >= chainHeight - nCheckDepth; pindex = pindex->pprev)
+            vIndex.push_back(pindex);
+    }
     nCheckLevel = std::max(0, std::min(4, nCheckLevel));
-    LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+    const int nThreads = std::max(1, std::min(GetNumCores() - 1, MAX_SCRIPTCHECK_THREADS));
+    LogPrintf("Verifying last %i blocks at level %i%s, reading ahead on %d threads\n", nCheckDepth, nCheckLevel, fBackground ? " in the background" : "", nThreads);
+    CVerifyDBProgress progress(!fBackground);
     CCoinsViewCache coins(coinsview);
-    CBlockIndex* pindexState = chainActive.Tip();
+    CBlockIndex* pindexState = vIndex.front();
     CBlockIndex* pindexFailure = NULL;
     int nGoodTransactions = 0;
+    size_t nSkipped = 0;
     CValidationState state;
-    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
-        boost::this_thread::interruption_point();
-        uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainHeight - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
-        if (pindex->nHeight < chainHeight - nCheckDepth)
-            break;
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex))
-            return error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state))
-            return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            CDiskBlockPos pos = pindex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
-                    return error("%s: *** found bad undo data at %d, hash=%s\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
+    {
+        // checks up to level 2 run off the reader threads
+        CBlockReadAhead reader(vIndex, nCheckLevel >= 2, nThreads, fBackground);
+        for (size_t i = 0; i < vIndex.size(); i++) {
+            CBlockIndex* pindex = vIndex[i];
+            boost::this_thread::interruption_point();
+            progress.Update((double)(i + 1) / vIndex.size() * (nCheckLevel >= 4 ? 0.5 : 1));
+            CBlockReadAhead::Entry& entry = reader.Get(i);
+            CBlock& block = entry.block;
+            if (fBackground && !entry.fHaveData) {
+                nSkipped++;
+                reader.Release(i);
+                continue;
             }
-        }
-        // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
-            DisconnectResult res = DisconnectBlock(block, pindex, coins);
-            if (res == DISCONNECT_FAILED) {
-                return error("%s: *** irrecoverable inconsistency in block data at %d, hash=%s", __func__,
-                             pindex->nHeight, pindex->GetBlockHash().ToString());
+            // check level 0: read from disk
+            if (!entry.fRead)
+                return error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
+            // check level 1: verify block validity
+            if (nCheckLevel >= 1) {
+                LOCK(cs_main);
+                if (!CheckBlock(block, state, true, true, true, false))
+                    return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
             }
-            pindexState = pindex->pprev;
-            if (res == DISCONNECT_UNCLEAN) {
-                nGoodTransactions = 0;
-                pindexFailure = pindex;
-            } else {
-                nGoodTransactions += block.vtx.size();
+            // check level 2: verify undo validity
+            if (nCheckLevel >= 2 && !entry.fUndoOk)
+                return error("%s: *** found bad undo data at %d, hash=%s\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
+            // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
+            if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
+                DisconnectResult res = DisconnectBlock(entry, pindex, coins);
+                if (res == DISCONNECT_FAILED) {
+                    return error("%s: *** irrecoverable inconsistency in block data at %d, hash=%s", __func__,
+                                 pindex->nHeight, pindex->GetBlockHash().ToString());
+                }
+                pindexState = pindex->pprev;
+                if (res == DISCONNECT_UNCLEAN) {
+                    nGoodTransactions = 0;
+                    pindexFailure = pindex;
+                } else {
+                    nGoodTransactions += block.vtx.size();
+                }
             }
+            reader.Release(i);
+            if (ShutdownRequested())
+                return true;
         }
-        if (ShutdownRequested())
-            return true;
     }
     if (pindexFailure)
         return error("%s: *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", __func__, chainHeight - pindexFailure->nHeight + 1, nGoodTransactions);
 
     // check level 4: try reconnecting blocks
     if (nCheckLevel >= 4) {
-        CBlockIndex* pindex = pindexState;
-        while (pindex != chainActive.Tip()) {
+        std::vector<CBlockIndex*> vReconnect;
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex != pindexState; pindex = pindex->pprev)
+            vReconnect.push_back(pindex);
+        std::reverse(vReconnect.begin(), vReconnect.end());
+        CBlockReadAhead reader(vReconnect, false, nThreads);
+        for (size_t i = 0; i < vReconnect.size(); i++) {
+            CBlockIndex* pindex = vReconnect[i];
             boost::this_thread::interruption_point();
-            uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(chainHeight - pindex->nHeight)) / (double)nCheckDepth * 50))));
-            pindex = chainActive.Next(pindex);
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex))
+            progress.Update(0.5 + (double)(i + 1) / vIndex.size() * 0.5);
+            CBlockReadAhead::Entry& entry = reader.Get(i);
+            if (!entry.fRead)
                 return error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!ConnectBlock(block, state, pindex, coins, false))
+            if (!ConnectBlock(entry.block, state, pindex, coins, false))
                 return error("%s: *** found unconnectable block at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
+            reader.Release(i);
         }
     }
 
-    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", chainHeight - pindexState->nHeight, nGoodTransactions);
+    if (nCheckLevel >= 3)
+        LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", chainHeight - pindexState->nHeight, nGoodTransactions);
+    LogPrintf("Verified last %i blocks in %.2fs\n", vIndex.size() - nSkipped, progress.GetElapsedMillis() * 0.001);
+    if (nSkipped)
+        LogPrintf("Skipped %u blocks whose data is no longer on disk\n", nSkipped);
 
-    ResyncSupply();
+    // the supply is resynced at startup, which is not where the background check runs
+    if (!fBackground)
+        ResyncSupply();
 
     return true;
 }
@@ -4245,8 +4677,8 @@ bool RewindBlockIndex(std::string param)
     for (auto pindex : vBlocks) {
         auto ret = mapBlockIndex.find(*pindex->phashBlock);
         if (ret != mapBlockIndex.end()) {
+            // the entry itself stays in the arena until the index is unloaded
             mapBlockIndex.erase(ret);
-            delete pindex;
         }
     }
 
@@ -4266,6 +4698,8 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    ResetOldModifierIndex();
+    PublishChainTipSnapshot(nullptr);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -4285,10 +4719,8 @@ void UnloadBlockIndex()
     mapNodeState.clear();
     recentRejects.reset(nullptr);
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
 }
 
 bool LoadBlockIndex(std::string& strError)
@@ -4698,11 +5130,27 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman& connma
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/** The send class of all replies to a getdata: bulk if it only asks for blocks
+ *  deep in the active chain, as a peer doing initial download does, relay
+ *  otherwise. One class for all of them keeps the replies in request order. */
+static SendClass GetDataSendClass(const std::vector<CInv>& vInv)
+{
+    LOCK(cs_main);
+    for (const CInv& inv : vInv) {
+        if (inv.type != MSG_BLOCK && inv.type != MSG_FILTERED_BLOCK)
+            return SEND_CLASS_RELAY;
+        CBlockIndex* pindex = LookupBlockIndex(inv.hash);
+        if (pindex && (!chainActive.Contains(pindex) || chainActive.Height() - pindex->nHeight < BULK_SEND_BLOCK_DEPTH))
+            return SEND_CLASS_RELAY;
+    }
+    return vInv.empty() ? SEND_CLASS_RELAY : SEND_CLASS_BULK;
+}
+
 void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& interruptMsgProc)
 {
     AssertLockNotHeld(cs_main);
 
-    std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
+    std::deque<std::pair<CInv, SendClass> >::iterator it = pfrom->vRecvGetData.begin();
     std::vector<CInv> vNotFound;
     CNetMsgMaker msgMaker(pfrom->GetSendVersion());
     LOCK(cs_main);
@@ -4712,7 +5160,8 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
         if (pfrom->fPauseSend)
             break;
 
-        const CInv& inv = *it;
+        const CInv& inv = it->first;
+        const SendClass sendClass = it->second;
         {
             if (interruptMsgProc)
                 return;
@@ -4742,7 +5191,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                     if (!ReadBlockFromDisk(block, (*mi).second))
                         assert(!"cannot load block from disk");
                     if (inv.type == MSG_BLOCK)
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
+                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block), sendClass);
                     else // MSG_FILTERED_BLOCK)
                     {
                         bool send = false;
@@ -4755,7 +5204,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                             }
                         }
                         if (send) {
-                            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
+                            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock), sendClass);
                             // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
                             // This avoids hurting performance by pointlessly requiring a round-trip
                             // Note that there is currently no way for a node to request any single transactions we didnt send here -
@@ -4764,7 +5213,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                             // however we MUST always provide at least what the remote peer needs
                             typedef std::pair<unsigned int, uint256> PairType;
                             for (PairType& pair : merkleBlock.vMatchedTxn)
-                                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, block.vtx[pair.first]));
+                                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, *block.vtx[pair.first]), sendClass);
                         }
                         // else
                         // no response
@@ -4777,7 +5226,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                         // wait for other stuff first.
                         std::vector<CInv> vInv;
                         vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv));
+                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv), sendClass);
                         pfrom->hashContinue.SetNull();
                     }
                 }
@@ -4788,7 +5237,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                     LOCK(cs_mapRelay);
                     std::map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
                     if (mi != mapRelay.end()) {
-                        connman.PushMessage(pfrom, msgMaker.Make(inv.GetCommand(), (*mi).second));
+                        connman.PushMessage(pfrom, msgMaker.Make(inv.GetCommand(), (*mi).second), sendClass);
                         pushed = true;
                     }
                 }
@@ -4799,7 +5248,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
                         ss << tx;
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, ss));
+                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, ss), sendClass);
                         pushed = true;
                     }
                 }
@@ -4808,7 +5257,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
                         ss << mapSporks[inv.hash];
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, ss));
+                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, ss), sendClass);
                         pushed = true;
                     }
                 }
@@ -4817,7 +5266,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
                         ss << mnodeman.mapSeenMasternodeBroadcast[inv.hash];
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNBROADCAST, ss));
+                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNBROADCAST, ss), sendClass);
                         pushed = true;
                     }
                 }
@@ -4827,7 +5276,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
                         ss << mnodeman.mapSeenMasternodePing[inv.hash];
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, ss));
+                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, ss), sendClass);
                         pushed = true;
                     }
                 }
@@ -4852,7 +5301,7 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
         // do that because they want to know about (and store and rebroadcast and
         // risk analyze) the dependencies of transactions relevant to them, without
         // having to download the entire memory pool.
-        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::NOTFOUND, vNotFound));
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::NOTFOUND, vNotFound), SEND_CLASS_RELAY);
     }
 }
 
@@ -5175,7 +5624,9 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         if (vInv.size() > 0)
             LogPrint(BCLog::NET, "received getdata for: %s peer=%d\n", vInv[0].ToString(), pfrom->id);
 
-        pfrom->vRecvGetData.insert(pfrom->vRecvGetData.end(), vInv.begin(), vInv.end());
+        const SendClass sendClass = GetDataSendClass(vInv);
+        for (const CInv& inv : vInv)
+            pfrom->vRecvGetData.emplace_back(inv, sendClass);
         ProcessGetData(pfrom, connman, interruptMsgProc);
     }
 
@@ -6066,10 +6517,8 @@ public:
     ~CMainCleanup()
     {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
 
         // orphan transactions
         mapOrphanTransactions.clear();
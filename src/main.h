@@ -38,6 +38,7 @@
 #include <atomic>
 #include <exception>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -85,6 +86,10 @@ static const unsigned int MAX_STANDARD_TX_SIZE = 150000;
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 /** Default for -checkblocks */
 static const signed int DEFAULT_CHECKBLOCKS = 10;
+/** Default for -checkblocksbackground, 0 = off */
+static const signed int DEFAULT_CHECKBLOCKS_BACKGROUND = 0;
+/** Blocks read ahead of the one being verified or disconnected */
+static const int BLOCK_READ_AHEAD = 128;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -194,6 +199,8 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals);
 bool ProcessNewBlock(CValidationState& state, CNode* pfrom, const CBlock* pblock, CDiskBlockPos* dbp, CConnman* connman);
 /** Check whether enough disk space is available for an incoming block */
 bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
+/** Log and show a fatal error, then shut down. Always returns false. */
+bool AbortNode(const std::string& strMessage, const std::string& userMessage = "");
 /** Open a block file (blk?????.dat) */
 FILE* OpenBlockFile(const CDiskBlockPos& pos, bool fReadOnly = false);
 /** Open an undo file (rev?????.dat) */
@@ -286,6 +293,14 @@ CAmount GetMinRelayFee(const CTransaction& tx, const CTxMemPool& pool, unsigned
  */
 bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = NULL);
 
+/**
+ * Whether an output pays to a burn address of the active chain that is in
+ * force at nHeight (activation height < nHeight). The burn addresses are
+ * decoded once, checking a script costs an ExtractDestination and a lookup.
+ * The destination is returned in pdestRet when it is a burn address.
+ */
+bool IsBurnScript(const CScript& scriptPubKey, int nHeight, CTxDestination* pdestRet = nullptr);
+
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
 
@@ -305,6 +320,9 @@ bool CheckFinalTx(const CTransaction& tx, int flags = -1);
 /**
  * Closure representing one script verification
  * Note that this stores references to the spending transaction
+ *
+ * It can also stand for the verification of a block signature, so that
+ * runs on the script check threads too (see ProcessNewBlock).
  */
 class CScriptCheck
 {
@@ -317,9 +335,11 @@ private:
     bool cacheStore;
     ScriptError error;
     PrecomputedTransactionData *precomTxData;
+    const CBlock* pblockSig;
+    bool fEnableP2PKH;
 
 public:
-    CScriptCheck() : amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
+    CScriptCheck() : amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), pblockSig(nullptr), fEnableP2PKH(false) {}
     CScriptCheck(const CScript& scriptPubKeyIn, const CAmount amountIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* cachedHashesIn) :
         scriptPubKey(scriptPubKeyIn),
         amount(amountIn),
@@ -328,7 +348,20 @@ public:
         nFlags(nFlagsIn),
         cacheStore(cacheIn),
         error(SCRIPT_ERR_UNKNOWN_ERROR),
-        precomTxData(cachedHashesIn) {}
+        precomTxData(cachedHashesIn),
+        pblockSig(nullptr),
+        fEnableP2PKH(false) {}
+    //! Check the signature of a block, see CheckBlockSignature
+    CScriptCheck(const CBlock& blockIn, bool fEnableP2PKHIn) :
+        amount(0),
+        ptxTo(0),
+        nIn(0),
+        nFlags(0),
+        cacheStore(false),
+        error(SCRIPT_ERR_UNKNOWN_ERROR),
+        precomTxData(nullptr),
+        pblockSig(&blockIn),
+        fEnableP2PKH(fEnableP2PKHIn) {}
 
     bool operator()();
 
@@ -342,6 +375,8 @@ public:
         std::swap(cacheStore, check.cacheStore);
         std::swap(error, check.error);
         std::swap(precomTxData, check.precomTxData);
+        std::swap(pblockSig, check.pblockSig);
+        std::swap(fEnableP2PKH, check.fEnableP2PKH);
     }
 
     ScriptError GetScriptError() const { return error; }
@@ -352,6 +387,9 @@ public:
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/** Read the serialized block bytes as stored on disk, without deserializing or checking them */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos);
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex);
 
 
 /** Functions for validating blocks and updating the block tree */
@@ -371,7 +409,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true);
-bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true);
+bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true, bool fCheckPayee = true);
 bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev);
 
 /** Context-dependent validity checks */
@@ -390,9 +428,16 @@ bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBloc
 class CVerifyDB
 {
 public:
-    CVerifyDB();
+    /** A background check runs while the node is serving: it stops at check
+     *  level 2, only holds cs_main to look at the index and check each block,
+     *  skips blocks that are no longer on disk and reports to the log instead
+     *  of the UI */
+    explicit CVerifyDB(bool fBackgroundIn = false);
     ~CVerifyDB();
     bool VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth);
+
+private:
+    const bool fBackground;
 };
 
 // Resync the supply with the txout set
@@ -437,6 +482,23 @@ extern CSporkDB* pSporkDB;
  */
 CBlockIndex* GetChainTip();
 
+/**
+ * Immutable view of the active chain tip. A new snapshot is published every
+ * time the tip changes, so read-only callers (RPC, REST) can inspect the tip
+ * without taking cs_main. Block index entries are never freed while the node
+ * is running, so pindex stays valid after the snapshot is superseded.
+ */
+struct CChainTipSnapshot
+{
+    const CBlockIndex* pindex;
+    int nHeight;
+    uint256 hash;
+    int64_t nTime;
+};
+
+/** Return the latest published chain tip snapshot (null before the block index is loaded) */
+std::shared_ptr<const CChainTipSnapshot> GetChainTipSnapshot();
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -145,7 +145,7 @@ bool CMasternodePayments::IsTransactionValid(const CBlock& block, const CBlockIn
     const auto nPrevBlockTime = pindexPrev->nTime;
     const auto nBlockHeight = nPrevBlockHeight + 1;
 
-    const auto& txNew = block.vtx[block.IsProofOfStake() ? 1 : 0];
+    const auto& txNew = *block.vtx[block.IsProofOfStake() ? 1 : 0];
 
     auto requiredMasternodePayment = CMasternode::GetMasternodePayment(nBlockHeight);
     auto found = false;
@@ -1005,7 +1005,7 @@ bool CMasternodeMan::ConnectBlock(const CBlockIndex* pindex, const CBlock& block
 
     for (const auto& tx : block.vtx) {
         // remove the collaterals that were spent
-        for (const auto& in : tx.vin) {
+        for (const auto& in : tx->vin) {
             if(mapCOutPointCollaterals.find(in.prevout) != mapCOutPointCollaterals.end()) 
             {
                 const auto& outPoint = in.prevout;
@@ -1036,10 +1036,10 @@ bool CMasternodeMan::ConnectBlock(const CBlockIndex* pindex, const CBlock& block
 
         // add the collaterals that were created
         auto n = 0;
-        for (const auto& out : tx.vout) {
+        for (const auto& out : tx->vout) {
             if (out.nValue == nCollateralAmount || out.nValue == nNextWeekCollateralAmount) {
                 const auto& nCollateral = out.nValue;
-                const auto& outPoint = COutPoint(tx.GetHash(), n);
+                const auto& outPoint = COutPoint(tx->GetHash(), n);
                 const auto coin = Coin(out, nHeight, n == 0, n == 1);
                 
                 mapScriptCollaterals[out.scriptPubKey] = coin;
@@ -1070,7 +1070,7 @@ bool CMasternodeMan::ConnectBlock(const CBlockIndex* pindex, const CBlock& block
     return true;
 }
 
-bool CMasternodeMan::DisconnectBlock(const CBlockIndex* pindex, const CBlock& block)
+bool CMasternodeMan::DisconnectBlocks(const std::vector<CBlockIndex*>& vpindex, const std::vector<CBlock>& vblocks)
 {
     LOCK(cs_collaterals);
 
@@ -1081,68 +1081,77 @@ bool CMasternodeMan::DisconnectBlock(const CBlockIndex* pindex, const CBlock& bl
     }
     lastProcess = now;
 
-    const auto nHeight = pindex->nHeight;
+    if (vpindex.empty())
+        return true;
+
+    // going below what the mappings cover: they are all redone at the next
+    // connect block, so none of these blocks needs undoing
+    if (vpindex.back()->nHeight < initiatedAt) {
+        initiatedAt = -1;
+        return true;
+    }
+
     const auto& params = Params();
     const auto& consensus = params.GetConsensus();
     const auto nBlocksPerWeek = WEEK_IN_SECONDS / consensus.nTargetSpacing;
 
-    if(nHeight < initiatedAt) {
-        initiatedAt = -1; // redo all the mappings at next connect block
-        return true;
-    }
+    for (size_t i = 0; i < vpindex.size(); i++) {
+        const auto nHeight = vpindex[i]->nHeight;
+        const auto& block = vblocks[i];
 
-    // get the current masternode collateral, and the next week collateral
-    auto nCollateralAmount = CMasternode::GetMasternodeNodeCollateral(nHeight);
-    auto nNextWeekCollateralAmount = CMasternode::GetMasternodeNodeCollateral(nHeight + nBlocksPerWeek);
+        // get the current masternode collateral, and the next week collateral
+        auto nCollateralAmount = CMasternode::GetMasternodeNodeCollateral(nHeight);
+        auto nNextWeekCollateralAmount = CMasternode::GetMasternodeNodeCollateral(nHeight + nBlocksPerWeek);
 
-    for (const auto& tx : block.vtx) {
-        // remove the collaterals that were created
-        auto n = 0;
-        for (const auto& out : tx.vout) {
-            if (out.nValue == nCollateralAmount || out.nValue == nNextWeekCollateralAmount) {
-                const auto& nCollateral = out.nValue;
-                const auto& outPoint = COutPoint(tx.GetHash(), n);
+        for (const auto& tx : block.vtx) {
+            // remove the collaterals that were created
+            auto n = 0;
+            for (const auto& out : tx->vout) {
+                if (out.nValue == nCollateralAmount || out.nValue == nNextWeekCollateralAmount) {
+                    const auto& nCollateral = out.nValue;
+                    const auto& outPoint = COutPoint(tx->GetHash(), n);
 
-                mapScriptCollaterals.erase(out.scriptPubKey);
-                mapCOutPointCollaterals.erase(outPoint);
+                    mapScriptCollaterals.erase(out.scriptPubKey);
+                    mapCOutPointCollaterals.erase(outPoint);
 
-                if (mapCAmountCollaterals.find(nCollateral) != mapCAmountCollaterals.end()) {
-                    mapCAmountCollaterals[nCollateral].erase(outPoint);
+                    if (mapCAmountCollaterals.find(nCollateral) != mapCAmountCollaterals.end()) {
+                        mapCAmountCollaterals[nCollateral].erase(outPoint);
+                    }
                 }
+                n++;
             }
-            n++;
         }
-    }
 
-    // restore the collaterals that were remove at this height
-    if(mapRemovedCollaterals.find(nHeight) != mapRemovedCollaterals.end()) {
-        for (const auto& kv : mapRemovedCollaterals[nHeight]) {
-            const auto& outPoint = kv.first;
-            const auto& coin = kv.second;
+        // restore the collaterals that were remove at this height
+        if(mapRemovedCollaterals.find(nHeight) != mapRemovedCollaterals.end()) {
+            for (const auto& kv : mapRemovedCollaterals[nHeight]) {
+                const auto& outPoint = kv.first;
+                const auto& coin = kv.second;
 
-            mapScriptCollaterals[coin.out.scriptPubKey] = coin;
-            mapCOutPointCollaterals[outPoint] = coin;
+                mapScriptCollaterals[coin.out.scriptPubKey] = coin;
+                mapCOutPointCollaterals[outPoint] = coin;
 
-            const auto& nCollateral = coin.out.nValue;
-            if (mapCAmountCollaterals.find(nCollateral) == mapCAmountCollaterals.end()) {
-                mapCAmountCollaterals[nCollateral] = boost::unordered_set<COutPoint, COutPointCheapHasher>(); // add an empty set
+                const auto& nCollateral = coin.out.nValue;
+                if (mapCAmountCollaterals.find(nCollateral) == mapCAmountCollaterals.end()) {
+                    mapCAmountCollaterals[nCollateral] = boost::unordered_set<COutPoint, COutPointCheapHasher>(); // add an empty set
+                }
+                mapCAmountCollaterals[nCollateral].insert(outPoint);
             }
-            mapCAmountCollaterals[nCollateral].insert(outPoint);
+            mapRemovedCollaterals.erase(nHeight);
         }
-        mapRemovedCollaterals.erase(nHeight);
-    }
 
-    // remove the paidpayees that were registered
-    if(mapPaidPayeesHeight.find(nHeight) != mapPaidPayeesHeight.end()) {
-        const auto& script = mapPaidPayeesHeight[nHeight];
+        // remove the paidpayees that were registered
+        if(mapPaidPayeesHeight.find(nHeight) != mapPaidPayeesHeight.end()) {
+            const auto& script = mapPaidPayeesHeight[nHeight];
 
-        mapPaidPayeesBlocks[script].pop_back();
+            mapPaidPayeesBlocks[script].pop_back();
 
-        if(mapPaidPayeesBlocks[script].empty()) {
-            mapPaidPayeesBlocks.erase(script);
-        }
+            if(mapPaidPayeesBlocks[script].empty()) {
+                mapPaidPayeesBlocks.erase(script);
+            }
 
-        mapPaidPayeesHeight.erase(nHeight);
+            mapPaidPayeesHeight.erase(nHeight);
+        }
     }
 
     return true;
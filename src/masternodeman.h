@@ -249,7 +249,8 @@ public:
     bool Init();
     void Shutdown();
     bool ConnectBlock(const CBlockIndex* pindex, const CBlock& block);
-    bool DisconnectBlock(const CBlockIndex* pindex, const CBlock& block);
+    /// Undo the collateral and payee mappings of disconnected blocks, given tip first
+    bool DisconnectBlocks(const std::vector<CBlockIndex*>& vpindex, const std::vector<CBlock>& vblocks);
 
     const CBlockIndex* GetLastPaidBlockSlow(const CScript& script, const CBlockIndex* pindexPrev);
     const CBlockIndex* GetLastPaidBlock(const CScript& script, const CBlockIndex* pindex);
@@ -118,7 +118,7 @@ bool CreateCoinbaseTx(CBlock* pblock, const CScript& scriptPubKeyIn, CBlockIndex
         txNew.vout[0].nValue = CRewards::GetBlockValue(pindexPrev->nHeight + 1);
     }
 
-    pblock->vtx.emplace_back(txNew);
+    pblock->vtx.emplace_back(MakeTransactionRef(txNew));
     return true;
 }
 
@@ -139,8 +139,8 @@ bool SolveProofOfStake(CBlock* pblock, CBlockIndex* pindexPrev, CWallet* pwallet
     emptyTx.vin[0].scriptSig = CScript() << pindexPrev->nHeight + 1 << OP_0;
     emptyTx.vout.resize(1);
     emptyTx.vout[0].SetEmpty();
-    pblock->vtx.emplace_back(emptyTx);
-    pblock->vtx.emplace_back(txCoinStake);
+    pblock->vtx.emplace_back(MakeTransactionRef(emptyTx));
+    pblock->vtx.emplace_back(MakeTransactionRef(txCoinStake));
     return true;
 }
 
@@ -356,8 +356,8 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
 
             UpdateCoins(tx, view, nHeight);
 
-            // Added
-            pblock->vtx.push_back(tx);
+            // Added, sharing the mempool's copy
+            pblock->vtx.push_back(mempool.mapTx.find(hash)->GetSharedTx());
             pblocktemplate->vTxFees.push_back(nTxFees);
             pblocktemplate->vTxSigOps.push_back(nTxSigOps);
             nBlockSize += nTxSize;
@@ -386,7 +386,9 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
 
         if (!fProofOfStake) {
             // Coinbase can get the fees.
-            pblock->vtx[0].vout[0].nValue += nFees;
+            CMutableTransaction txCoinbase(*pblock->vtx[0]);
+            txCoinbase.vout[0].nValue += nFees;
+            pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
             pblocktemplate->vTxFees[0] = -nFees;
         }
 
@@ -401,7 +403,7 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
         pblock->nBits = GetNextWorkRequired(pindexPrev, pblock);
         pblock->nNonce = 0;
 
-        pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
+        pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(*pblock->vtx[0]);
 
         if (fProofOfStake) {
             pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
@@ -433,11 +435,11 @@ void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int&
     }
     ++nExtraNonce;
     unsigned int nHeight = pindexPrev->nHeight + 1; // Height first in coinbase required for block.version=2
-    CMutableTransaction txCoinbase(pblock->vtx[0]);
+    CMutableTransaction txCoinbase(*pblock->vtx[0]);
     txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
-    pblock->vtx[0] = txCoinbase;
+    pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
 
@@ -473,7 +475,7 @@ CBlockTemplate* CreateNewBlockWithKey(CReserveKey& reservekey, CWallet* pwallet)
 bool ProcessBlockFound(CBlock* pblock, CWallet& wallet, Optional<CReserveKey>& reservekey)
 {
     LogPrintf("%s\n", pblock->ToString());
-    LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0].vout[0].nValue));
+    LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0]->vout[0].nValue));
 
     // Found a solution
     {
@@ -624,7 +626,8 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
                 continue;
             }
 
-            // update fStakeableCoins
+            // update fStakeableCoins, once the wallet has seen the current tip
+            EnsureWalletIsAvailable();
             CheckForCoins(pwallet, &availableCoins);
             if (!fStakeableCoins) {                    // if there is no coins to stake then
                 SleepUntilNexSlot();                   // sleep a time slot and try again
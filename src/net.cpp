@@ -31,6 +31,8 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef USE_UPNP
@@ -74,6 +76,16 @@ const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
 static const uint64_t RANDOMIZER_ID_LOCALHOSTNONCE = 0xd93e69e2bbfa5735ULL; // SHA256("localhostnonce")[0:8]
+/** Payload bytes allocated ahead of what a peer has actually sent */
+static const unsigned int RECV_ALLOC_AHEAD = 256 * 1024;
+/** Queued send buffers gathered into one sendmsg() call */
+#if defined(IOV_MAX) && IOV_MAX < 64
+static const int SEND_IOV_MAX = IOV_MAX;
+#else
+static const int SEND_IOV_MAX = 64;
+#endif
+/** Maximum time the socket handler waits for events, bounds how quickly paused peers are resumed */
+static const int SOCKET_POLL_TIMEOUT_MS = 50;
 //
 // Global state variables
 //
@@ -424,8 +436,8 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char* pszDest, bool fCo
     bool proxyConnectionFailed = false;
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed, sHostIp) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed, sHostIp)) {
-        if (!IsSelectableSocket(hSocket)) {
-            LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
+        if (!socketEvents->IsUsableSocket(hSocket) || !socketEvents->Add(hSocket, false)) {
+            LogPrintf("Cannot create connection: socket not usable with -socketevents=%s (fd >= FD_SETSIZE ?)\n", socketEvents->GetName());
             CloseSocket(hSocket);
             return NULL;
         }
@@ -714,7 +726,13 @@ void CNode::copyStats(CNodeStats& stats)
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
         X(nSendBytes);
+        for (int i = 0; i < SEND_CLASS_MAX; i++) {
+            stats.nSendQueueMsgs[i] = vSendQueue[i].size();
+            stats.nSendQueueBytes[i] = nSendQueueBytes[i];
+            stats.nSendClassBytes[i] = nSendClassBytes[i];
+        }
     }
+    stats.fSendThrottled = nSendThrottledUntil != 0;
     {
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgCmd);
@@ -754,7 +772,7 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
             vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+            vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -794,6 +812,40 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+void CNode::MarkReceivedMsgsForProcessing(unsigned int nReceiveFloodSize)
+{
+    size_t nSizeAdded = 0;
+    auto it(vRecvMsg.begin());
+    for (; it != vRecvMsg.end(); ++it) {
+        if (!it->complete())
+            break;
+        nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+    }
+    {
+        LOCK(cs_vProcessMsg);
+        vProcessMsg.splice(vProcessMsg.end(), vRecvMsg, vRecvMsg.begin(), it);
+        nProcessQueueSize += nSizeAdded;
+        fPauseRecv = nProcessQueueSize > nReceiveFloodSize;
+    }
+}
+
+char* CNode::GetDirectRecvBuffer(unsigned int nMinBytes, unsigned int& nMaxBytes)
+{
+    LOCK(cs_vRecv);
+    if (vRecvMsg.empty())
+        return nullptr;
+    CNetMessage& msg = vRecvMsg.back();
+    if (!msg.in_data || msg.complete())
+        return nullptr;
+    const unsigned int nRemaining = msg.hdr.nMessageSize - msg.nDataPos;
+    if (nRemaining < nMinBytes)
+        return nullptr;
+    nMaxBytes = std::min(nRemaining, nMaxBytes);
+    if (msg.vRecv.size() < msg.nDataPos + nMaxBytes)
+        msg.vRecv.resize(msg.nDataPos + nMaxBytes);
+    return &msg.vRecv[msg.nDataPos];
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -820,31 +872,45 @@ int CNode::GetSendVersion() const
     return nSendVersion;
 }
 
+CNetMessage::~CNetMessage()
+{
+    // hand the payload buffer back for the next message
+    CSerializeData buf;
+    vRecv.swap_data(buf);
+    NetRecvBufferPool().Put(std::move(buf));
+}
+
 int CNetMessage::readHeader(const char* pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
-    unsigned int nRemaining = 24 - nHdrPos;
+    unsigned int nRemaining = CMessageHeader::HEADER_SIZE - nHdrPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
     memcpy(&hdrbuf[nHdrPos], pch, nCopy);
     nHdrPos += nCopy;
 
     // if header incomplete, exit
-    if (nHdrPos < 24)
+    if (nHdrPos < CMessageHeader::HEADER_SIZE)
         return nCopy;
 
-    // deserialize to CMessageHeader
-    try {
-        hdrbuf >> hdr;
-    } catch (const std::exception&) {
-        return -1;
-    }
+    // deserialize to CMessageHeader, same layout as its serialization
+    const char* p = hdrbuf;
+    memcpy(hdr.pchMessageStart, p, MESSAGE_START_SIZE);
+    p += MESSAGE_START_SIZE;
+    memcpy(hdr.pchCommand, p, CMessageHeader::COMMAND_SIZE);
+    p += CMessageHeader::COMMAND_SIZE;
+    hdr.nMessageSize = ReadLE32((const unsigned char*)p);
+    p += sizeof(hdr.nMessageSize);
+    memcpy(hdr.pchChecksum, p, CMessageHeader::CHECKSUM_SIZE);
 
     // reject messages larger than MAX_SIZE
     if (hdr.nMessageSize > MAX_SIZE)
         return -1;
 
-    // switch state to reading message data
+    // switch state to reading message data, into a recycled buffer
+    // sized like the first chunk readData() will allocate
+    CSerializeData buf = NetRecvBufferPool().Get(std::min(hdr.nMessageSize, RECV_ALLOC_AHEAD));
+    vRecv.swap_data(buf);
     in_data = true;
 
     return nCopy;
@@ -857,44 +923,174 @@ int CNetMessage::readData(const char* pch, unsigned int nBytes)
 
     if (vRecv.size() < nDataPos + nCopy) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + RECV_ALLOC_AHEAD));
     }
 
-    memcpy(&vRecv[nDataPos], pch, nCopy);
+    // data received through GetDirectRecvBuffer() is already in place
+    if (pch != &vRecv[nDataPos])
+        memcpy(&vRecv[nDataPos], pch, nCopy);
     nDataPos += nCopy;
 
     return nCopy;
 }
 
+const char* GetSendClassName(SendClass sendClass)
+{
+    switch (sendClass) {
+    case SEND_CLASS_CONTROL: return "control";
+    case SEND_CLASS_RELAY: return "relay";
+    case SEND_CLASS_BULK: return "bulk";
+    default: return "unknown";
+    }
+}
+
+SendClass GetSendClass(const std::string& strCommand)
+{
+    // Replies to getdata pass the class chosen for the getdata explicitly
+    if (strCommand == NetMsgType::BLOCK || strCommand == NetMsgType::MERKLEBLOCK || strCommand == NetMsgType::TX)
+        return SEND_CLASS_RELAY;
+    return SEND_CLASS_CONTROL;
+}
+
+void CNode::QueueSendMessage(SendClass sendClass, std::vector<unsigned char>&& header, std::vector<unsigned char>&& data)
+{
+    AssertLockHeld(cs_vSend);
+    std::deque<QueuedSendMessage>& queue = vSendQueue[sendClass];
+    // A class that was idle doesn't get credit for the time it had nothing to send
+    if (queue.empty())
+        nSendPass[sendClass] = std::max(nSendPass[sendClass], nSendVirtualTime);
+    nSendQueueBytes[sendClass] += header.size() + data.size();
+    queue.emplace_back();
+    queue.back().header.swap(header);
+    queue.back().data.swap(data);
+}
+
+void CNode::ScheduleSendMessages(int64_t nTimeMicros, uint64_t nBulkBytesPerSec)
+{
+    AssertLockHeld(cs_vSend);
+    bool fBulkAllowed = true;
+    if (nBulkBytesPerSec && !vSendQueue[SEND_CLASS_BULK].empty()) {
+        // refill the token bucket, allowing bursts of up to one second
+        const int64_t nRate = nBulkBytesPerSec;
+        if (nBulkSendTokensTime == 0)
+            nBulkSendTokens = nRate;
+        else if (nTimeMicros > nBulkSendTokensTime)
+            nBulkSendTokens = std::min(nRate, nBulkSendTokens + (nTimeMicros - nBulkSendTokensTime) * nRate / 1000000);
+        nBulkSendTokensTime = nTimeMicros;
+        fBulkAllowed = nBulkSendTokens > 0;
+    }
+    nSendThrottledUntil = 0;
+
+    while (nSendMsgSize - nSendOffset < MAX_SEND_COMMIT_BYTES) {
+        // least served class first, ties going to the more urgent one
+        int nClass = -1;
+        for (int i = 0; i < SEND_CLASS_MAX; i++) {
+            if (vSendQueue[i].empty() || (i == SEND_CLASS_BULK && !fBulkAllowed))
+                continue;
+            if (nClass == -1 || nSendPass[i] < nSendPass[nClass])
+                nClass = i;
+        }
+        if (nClass == -1)
+            break;
+
+        std::deque<QueuedSendMessage>& queue = vSendQueue[nClass];
+        QueuedSendMessage& msg = queue.front();
+        const size_t nSize = msg.header.size() + msg.data.size();
+        nSendPass[nClass] += nSize * SEND_CLASS_WEIGHT[SEND_CLASS_CONTROL] / SEND_CLASS_WEIGHT[nClass];
+        nSendVirtualTime = nSendPass[nClass];
+        nSendQueueBytes[nClass] -= nSize;
+        nSendClassBytes[nClass] += nSize;
+        nSendMsgSize += nSize;
+        vSendMsg.push_back(std::move(msg.header));
+        if (!msg.data.empty())
+            vSendMsg.push_back(std::move(msg.data));
+        queue.pop_front();
+
+        if (nClass == SEND_CLASS_BULK && nBulkBytesPerSec) {
+            nBulkSendTokens -= nSize;
+            fBulkAllowed = nBulkSendTokens > 0;
+        }
+    }
+
+    if (!fBulkAllowed && !vSendQueue[SEND_CLASS_BULK].empty()) {
+        // when the bucket will have refilled enough to send again
+        nSendThrottledUntil = nTimeMicros + (1 - nBulkSendTokens) * 1000000 / (int64_t)nBulkBytesPerSec + 1;
+    }
+}
+
 
 // requires LOCK(cs_vSend)
 size_t CConnman::SocketSendData(CNode* pnode)
 {
-    auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
+    const uint64_t nBulkRate = pnode->fWhitelisted ? 0 : nMaxPeerUploadRate;
 
-    while (it != pnode->vSendMsg.end()) {
-        const auto& data = *it;
-        assert(data.size() > pnode->nSendOffset);
+    while (true) {
+        // Top up the socket's send list from the class queues
+        pnode->ScheduleSendMessages(GetTimeMicros(), nBulkRate);
+        if (pnode->vSendMsg.empty())
+            break;
+
+        // Hand as many queued buffers (header and payload of several
+        // messages) as possible to the kernel in a single call
+        size_t nAttempt = 0;
         int nBytes = 0;
+#ifdef WIN32
+        const auto& data = pnode->vSendMsg.front();
+        assert(data.size() > pnode->nSendOffset);
+        nAttempt = data.size() - pnode->nSendOffset;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, nAttempt, MSG_NOSIGNAL | MSG_DONTWAIT);
         }
+#else
+        struct iovec iov[SEND_IOV_MAX];
+        int nIov = 0;
+        for (auto itIov = pnode->vSendMsg.begin(); itIov != pnode->vSendMsg.end() && nIov < SEND_IOV_MAX; ++itIov, ++nIov) {
+            const size_t nOffset = (nIov == 0) ? pnode->nSendOffset : 0;
+            assert(itIov->size() > nOffset);
+            iov[nIov].iov_base = const_cast<unsigned char*>(itIov->data()) + nOffset;
+            iov[nIov].iov_len = itIov->size() - nOffset;
+            nAttempt += iov[nIov].iov_len;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nIov;
+        {
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                break;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+#endif
         if (nBytes > 0) {
             pnode->nLastSend = GetTime();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            nSendCalls++;
+            // drop the buffers this call completed, recycling them
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                std::vector<unsigned char>& data = pnode->vSendMsg.front();
+                const size_t nRemaining = data.size() - pnode->nSendOffset;
+                if (nLeft < nRemaining) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemaining;
                 pnode->nSendOffset = 0;
                 pnode->nSendSize -= data.size();
+                pnode->nSendMsgSize -= data.size();
                 pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+                nSendBuffers++;
+                NetSendBufferPool().Put(std::move(data));
+                pnode->vSendMsg.pop_front();
+            }
+            if ((size_t)nBytes < nAttempt) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -911,11 +1107,10 @@ size_t CConnman::SocketSendData(CNode* pnode)
         }
     }
 
-    if (it == pnode->vSendMsg.end()) {
+    if (pnode->vSendMsg.empty()) {
         assert(pnode->nSendOffset == 0);
-        assert(pnode->nSendSize == 0);
+        assert(pnode->nSendMsgSize == 0);
     }
-    pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return nSentSize;
 }
 
@@ -1118,8 +1313,8 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket)) {
-        LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
+    if (!socketEvents->IsUsableSocket(hSocket)) {
+        LogPrintf("connection from %s dropped: socket not usable with -socketevents=%s\n", addr.ToString(), socketEvents->GetName());
         CloseSocket(hSocket);
         return;
     }
@@ -1158,6 +1353,11 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     NodeId id = GetNewNodeId();
     uint64_t nonce = GetDeterministicRandomizer(RANDOMIZER_ID_LOCALHOSTNONCE).Write(id).Finalize();
 
+    if (!socketEvents->Add(hSocket, false)) {
+        CloseSocket(hSocket);
+        return;
+    }
+
     CNode* pnode = new CNode(id, nLocalServices, GetBestHeight(), hSocket, addr, CalculateKeyedNetGroup(addr), nonce, "", true);
     pnode->AddRef();
     pnode->fWhitelisted = whitelisted;
@@ -1174,6 +1374,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    bool fMoreWork = false;
     while (!interruptNet) {
         //
         // Disconnect nodes
@@ -1251,39 +1452,28 @@ void CConnman::ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
+        // Level-triggered backends (select) are handed the interest list every round:
+        // * If there is data to send, select() for sending data. As this only
+        //   happens when optimistic write failed, we choose to first drain the
+        //   write buffer in this case before receiving more. This avoids
+        //   needlessly queueing received data, if the remote peer is not themselves
+        //   receiving data. This means properly utilizing TCP flow control signalling.
+        // * Otherwise, if there is space left in the receive buffer, select() for
+        //   receiving data.
+        // * Hand off all complete messages to the processor, to be handled without
+        //   blocking here.
+        // Edge-triggered backends (epoll) watch every socket from the moment it is
+        // registered, so nothing is rebuilt here; the same policy is applied when
+        // servicing the readiness remembered in each node below.
+        //
+        const bool fEdgeTriggered = socketEvents->IsEdgeTriggered();
+        std::vector<SocketInterest> vInterest;
+        if (!fEdgeTriggered) {
+            for (const ListenSocket& hListenSocket : vhListenSocket)
+                vInterest.emplace_back(hListenSocket.socket, true, false);
 
-        {
             LOCK(cs_vNodes);
             for (CNode* pnode : vNodes) {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
                 bool select_recv = !pnode->fPauseRecv;
                 bool select_send;
                 {
@@ -1295,43 +1485,36 @@ void CConnman::ThreadSocketHandler()
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+                vInterest.emplace_back(pnode->hSocket, !select_send && select_recv, select_send);
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        // Don't block if a node still has unread data from an earlier round
+        const int nTimeoutMs = fMoreWork ? 0 : SOCKET_POLL_TIMEOUT_MS;
+        SocketReadySet ready;
+        int nReady = socketEvents->Wait(vInterest, nTimeoutMs, ready);
         if (interruptNet)
             return;
 
-        if (nSelect == SOCKET_ERROR) {
-            if (have_fds) {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
+        if (nReady == SOCKET_ERROR) {
+            ready.send.clear();
+            ready.error.clear();
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_POLL_TIMEOUT_MS)))
                 return;
+        } else if (nReady == 0) {
+            nSocketTimeouts++;
+        } else {
+            nSocketWakeups++;
         }
+        const int64_t nRoundStart = GetTimeMicros();
+        UpdateWakeupRate(nRoundStart);
+        fMoreWork = false;
 
         //
         // Accept new connections
         //
         for (const ListenSocket& hListenSocket : vhListenSocket) {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv)) {
+            if (hListenSocket.socket != INVALID_SOCKET && ready.recv.count(hListenSocket.socket)) {
                 AcceptConnection(hListenSocket);
             }
         }
@@ -1353,48 +1536,58 @@ void CConnman::ThreadSocketHandler()
             //
             // Receive
             //
-            bool recvSet = false;
             bool sendSet = false;
             bool errorSet = false;
             {
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                // select reports the current state, epoll only reports changes
+                if (!fEdgeTriggered)
+                    pnode->fHasRecvData = false;
+                if (ready.recv.count(pnode->hSocket))
+                    pnode->fHasRecvData = true;
+                sendSet = ready.send.count(pnode->hSocket) > 0;
+                errorSet = ready.error.count(pnode->hSocket) > 0;
             }
-            if (recvSet || errorSet) {
+            bool fRecvAllowed = pnode->fHasRecvData && !pnode->fPauseRecv;
+            if (fRecvAllowed && fEdgeTriggered) {
+                LOCK(pnode->cs_vSend);
+                fRecvAllowed = pnode->vSendMsg.empty();
+            }
+            bool fReadFull = false;
+            if (fRecvAllowed || errorSet) {
                 {
                     {
                         // typical socket buffer is 8K-64K
                         char pchBuf[0x10000];
+                        // Large message bodies are received straight into their own buffer,
+                        // small messages are batched through pchBuf
+                        unsigned int nMaxBytes = RECV_ALLOC_AHEAD;
+                        char* pchDest = pnode->GetDirectRecvBuffer(sizeof(pchBuf), nMaxBytes);
+                        if (!pchDest) {
+                            pchDest = pchBuf;
+                            nMaxBytes = sizeof(pchBuf);
+                        }
                         int nBytes = 0;
                         {
                             LOCK(pnode->cs_hSocket);
                             if (pnode->hSocket == INVALID_SOCKET)
                                 continue;
-                            nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+                            nBytes = recv(pnode->hSocket, pchDest, nMaxBytes, MSG_DONTWAIT);
                         }
+                        // A short read drained the kernel buffer; a full one may have left more behind
+                        pnode->fHasRecvData = (nBytes == (int)nMaxBytes);
+                        fReadFull = pnode->fHasRecvData;
                         if (nBytes > 0) {
+                            if (pchDest != pchBuf)
+                                nRecvDirectBytes += nBytes;
                             bool notify = false;
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+                            if (!pnode->ReceiveMsgBytes(pchDest, nBytes, notify))
                                 pnode->CloseSocketDisconnect();
                             RecordBytesRecv(nBytes);
                             if (notify) {
-                                size_t nSizeAdded = 0;
-                                auto it(pnode->vRecvMsg.begin());
-                                for (; it != pnode->vRecvMsg.end(); ++it) {
-                                    if (!it->complete())
-                                        break;
-                                    nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                                }
-                                {
-                                    LOCK(pnode->cs_vProcessMsg);
-                                    pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                                    pnode->nProcessQueueSize += nSizeAdded;
-                                    pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                                }
+                                pnode->MarkReceivedMsgsForProcessing(nReceiveFloodSize);
                                 WakeMessageHandler();
                             }
                         } else if (nBytes == 0) {
@@ -1414,11 +1607,23 @@ void CConnman::ThreadSocketHandler()
                     }
                 }
             }
+            // Only a full read of this pass may have left data behind; data that
+            // couldn't be read (pending send, paused) waits for the next event
+            if (fReadFull && !pnode->fPauseRecv)
+                fMoreWork = true;
 
             //
             // Send
             //
-            if (sendSet) {
+            // Only reached when the optimistic write in PushMessage() left data
+            // queued: select was asked for write interest because the queue was
+            // non-empty, epoll reports the socket once its send buffer drains.
+            //
+            // Bulk messages held back by -maxpeeruploadrate are retried once the
+            // rate allows, as no readiness event will report that.
+            //
+            const int64_t nThrottledUntil = pnode->nSendThrottledUntil;
+            if (sendSet || (nThrottledUntil != 0 && nThrottledUntil <= GetTimeMicros())) {
                 LOCK(pnode->cs_vSend);
                 size_t nBytes = SocketSendData(pnode);
                 if (nBytes)
@@ -1450,9 +1655,47 @@ void CConnman::ThreadSocketHandler()
             for (CNode* pnode : vNodesCopy)
                 pnode->Release();
         }
+        socketLoopTime.Add(GetTimeMicros() - nRoundStart);
     }
 }
 
+void CConnman::UpdateWakeupRate(int64_t nNow)
+{
+    static const int64_t RATE_WINDOW_USEC = 10 * 1000000;
+    if (nRateWindowStart == 0) {
+        nRateWindowStart = nNow;
+        nRateWindowWakeups = nSocketWakeups;
+        return;
+    }
+    if (nNow - nRateWindowStart < RATE_WINDOW_USEC)
+        return;
+    const uint64_t nWakeups = nSocketWakeups;
+    dSocketWakeupRate = (nWakeups - nRateWindowWakeups) * 1000000.0 / (nNow - nRateWindowStart);
+    nRateWindowStart = nNow;
+    nRateWindowWakeups = nWakeups;
+}
+
+CConnman::SocketEventsStats CConnman::GetSocketEventsStats() const
+{
+    SocketEventsStats stats;
+    stats.strMode = socketEvents ? socketEvents->GetName() : "";
+    stats.nWakeups = nSocketWakeups;
+    stats.nTimeouts = nSocketTimeouts;
+    stats.dWakeupsPerSec = dSocketWakeupRate;
+    return stats;
+}
+
+CConnman::NetBufferStats CConnman::GetNetBufferStats() const
+{
+    NetBufferStats stats;
+    stats.recvPool = NetRecvBufferPool().GetStats();
+    stats.sendPool = NetSendBufferPool().GetStats();
+    stats.nRecvDirectBytes = nRecvDirectBytes;
+    stats.nSendCalls = nSendCalls;
+    stats.nSendBuffers = nSendBuffers;
+    return stats;
+}
+
 void CConnman::WakeMessageHandler()
 {
     {
@@ -1671,12 +1914,13 @@ void CConnman::ThreadDNSAddressSeed()
 void CConnman::DumpAddresses()
 {
     int64_t nStart = GetTimeMillis();
+    size_t nChanged = addrman.GetChangeCount();
 
     CAddrDB adb;
-    adb.Write(addrman);
+    adb.Flush(addrman);
 
-    LogPrint(BCLog::NET, "Flushed %d addresses to peers.dat  %dms\n",
-        addrman.size(), GetTimeMillis() - nStart);
+    LogPrint(BCLog::NET, "Flushed %d addresses (%d changed) to peers.dat  %dms\n",
+        addrman.size(), nChanged, GetTimeMillis() - nStart);
 }
 
 void CConnman::DumpData()
@@ -2152,12 +2396,21 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     nLastNodeId = 0;
     nSendBufferMaxSize = 0;
     nReceiveFloodSize = 0;
+    nMaxPeerUploadRate = 0;
     semOutbound = NULL;
     nMaxConnections = 0;
     nMaxOutbound = 0;
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
+    nSocketWakeups = 0;
+    nSocketTimeouts = 0;
+    dSocketWakeupRate = 0;
+    nRateWindowStart = 0;
+    nRateWindowWakeups = 0;
+    nRecvDirectBytes = 0;
+    nSendCalls = 0;
+    nSendBuffers = 0;
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2178,6 +2431,7 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
 
     nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
     nReceiveFloodSize = connOptions.nReceiveFloodSize;
+    nMaxPeerUploadRate = connOptions.nMaxPeerUploadRate;
 
     SetBestHeight(connOptions.nBestHeight);
 
@@ -2237,6 +2491,17 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
         GetNodeSignals().InitializeNode(pnodeLocalHost, *this);
     }
 
+    socketEvents = MakeSocketEvents(connOptions.strSocketEventsMode, strNodeError);
+    if (!socketEvents)
+        return false;
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        if (!socketEvents->Add(hListenSocket.socket, true)) {
+            strNodeError = strprintf(_("Unable to watch listening socket with -socketevents=%s"), socketEvents->GetName());
+            return false;
+        }
+    }
+    LogPrintf("Using %s for socket events\n", socketEvents->GetName());
+
     //
     // Start threads
     //
@@ -2354,6 +2619,7 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+    socketEvents.reset();
     delete semOutbound;
     semOutbound = NULL;
     if(pnodeLocalHost)
@@ -2574,6 +2840,16 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
+    nSendMsgSize = 0;
+    for (int i = 0; i < SEND_CLASS_MAX; i++) {
+        nSendQueueBytes[i] = 0;
+        nSendClassBytes[i] = 0;
+        nSendPass[i] = 0;
+    }
+    nSendVirtualTime = 0;
+    nBulkSendTokens = 0;
+    nBulkSendTokensTime = 0;
+    nSendThrottledUntil = 0;
     hashContinue = UINT256_ZERO;
     nStartingHeight = -1;
     filterInventoryKnown.reset();
@@ -2590,6 +2866,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
     fPauseRecv = false;
     fPauseSend = false;
+    fHasRecvData = false;
     nProcessQueueSize = 0;
 
     for (const std::string &msg : getAllNetMessageTypes())
@@ -2646,13 +2923,18 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 }
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    const SendClass sendClass = GetSendClass(msg.command);
+    PushMessage(pnode, std::move(msg), sendClass);
+}
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, SendClass sendClass)
 {
     size_t nMessageSize = msg.data.size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->id);
 
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
+    std::vector<unsigned char> serializedHeader = NetSendBufferPool().Get(CMessageHeader::HEADER_SIZE);
     uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
@@ -2670,9 +2952,7 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->QueueSendMessage(sendClass, std::move(serializedHeader), std::move(msg.data));
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
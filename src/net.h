@@ -16,6 +16,8 @@
 #include "hash.h"
 #include "limitedmap.h"
 #include "netaddress.h"
+#include "netbufferpool.h"
+#include "netevents.h"
 #include "protocol.h"
 #include "random.h"
 #include "streams.h"
@@ -23,6 +25,7 @@
 #include "uint256.h"
 #include "utilstrencodings.h"
 #include "threadinterrupt.h"
+#include "util/histogram.h"
 
 #include <atomic>
 #include <deque>
@@ -89,6 +92,39 @@ static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 static const bool DEFAULT_FORCEDNSSEED = true;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -maxpeeruploadrate default (KB/s, 0 = unlimited) */
+static const unsigned int DEFAULT_MAX_PEER_UPLOAD_RATE = 0;
+/** A getdata for blocks only, all this many blocks or more below the tip, is answered as bulk (initial download) traffic */
+static const int BULK_SEND_BLOCK_DEPTH = 10;
+/**
+ * Queued messages are moved to the socket's send list only while less than
+ * this much of it is still unsent, so a newly queued control message never
+ * waits behind more than one large message.
+ */
+static const size_t MAX_SEND_COMMIT_BYTES = 64 * 1024;
+
+/**
+ * Outbound message classes. Each peer keeps a queue per class and drains them
+ * by weighted fair queueing, so announcements and new blocks don't wait behind
+ * a backlog of blocks served to a peer doing initial download.
+ *
+ * All replies to one getdata go out in the class chosen when it is received,
+ * so the peer gets them in the order it asked for them.
+ */
+enum SendClass {
+    SEND_CLASS_CONTROL = 0, //!< handshake, pings, inventory, headers and other unsolicited messages
+    SEND_CLASS_RELAY,       //!< getdata replies: blocks near the tip, transactions, sporks and masternode data
+    SEND_CLASS_BULK,        //!< getdata replies with old blocks only, for initial download, subject to -maxpeeruploadrate
+    SEND_CLASS_MAX
+};
+
+/** Relative share of the upload bandwidth each class gets while all are backlogged */
+static const unsigned int SEND_CLASS_WEIGHT[SEND_CLASS_MAX] = {16, 4, 1};
+
+/** Name of a send class, as reported by getpeerinfo */
+const char* GetSendClassName(SendClass sendClass);
+/** Default class of an outbound message */
+SendClass GetSendClass(const std::string& strCommand);
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
@@ -145,6 +181,25 @@ public:
         CClientUIInterface* uiInterface = nullptr;
         unsigned int nSendBufferMaxSize = 0;
         unsigned int nReceiveFloodSize = 0;
+        uint64_t nMaxPeerUploadRate = 0;
+        std::string strSocketEventsMode = DefaultSocketEventsMode();
+    };
+
+    /** Counters of the socket handler event loop */
+    struct SocketEventsStats {
+        std::string strMode;
+        uint64_t nWakeups;
+        uint64_t nTimeouts;
+        double dWakeupsPerSec;
+    };
+
+    /** Buffer pool and copy-avoidance counters of the message I/O paths */
+    struct NetBufferStats {
+        BufferPoolStats recvPool;
+        BufferPoolStats sendPool;
+        uint64_t nRecvDirectBytes; //!< payload bytes recv()d straight into message buffers
+        uint64_t nSendCalls;       //!< send()/sendmsg() calls that wrote data
+        uint64_t nSendBuffers;     //!< queued buffers completed by those calls
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -158,6 +213,7 @@ public:
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, CSerializedNetMsg&& msg, SendClass sendClass);
 
     template<typename Callable>
     bool ForEachNodeContinueIf(Callable&& func)
@@ -277,6 +333,16 @@ public:
     CSipHasher GetDeterministicRandomizer(uint64_t id);
 
     unsigned int GetReceiveFloodSize() const;
+
+    SocketEventsStats GetSocketEventsStats() const;
+    /** Time spent servicing sockets after each wakeup of the socket handler */
+    const CLatencyHistogram& GetSocketLoopTime() const { return socketLoopTime; }
+    NetBufferStats GetNetBufferStats() const;
+protected:
+    // Exposed to subclasses so tests and benchmarks can drive the send path
+    // without running the socket handler thread
+    size_t SocketSendData(CNode *pnode);
+
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -292,6 +358,7 @@ private:
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
+    void UpdateWakeupRate(int64_t nNow);
 
     void WakeMessageHandler();
 
@@ -310,7 +377,6 @@ private:
 
     NodeId GetNewNodeId();
 
-    size_t SocketSendData(CNode *pnode);
     //!check is the banlist has unwritten changes
     bool BannedSetIsDirty();
     //!set the "dirty" flag for the banlist
@@ -341,6 +407,7 @@ private:
 
     unsigned int nSendBufferMaxSize;
     unsigned int nReceiveFloodSize;
+    uint64_t nMaxPeerUploadRate; // bytes per second of bulk traffic per peer, 0 = unlimited
 
     std::vector<ListenSocket> vhListenSocket;
     banmap_t setBanned;
@@ -382,6 +449,20 @@ private:
 
     CThreadInterrupt interruptNet;
 
+    /** Readiness backend of the socket handler thread, see -socketevents */
+    std::unique_ptr<CSocketEvents> socketEvents;
+    CLatencyHistogram socketLoopTime;
+    std::atomic<uint64_t> nSocketWakeups;
+    std::atomic<uint64_t> nSocketTimeouts;
+    //! wakeups/sec over the last completed rate window, updated by the socket handler
+    std::atomic<double> dSocketWakeupRate;
+    int64_t nRateWindowStart;
+    uint64_t nRateWindowWakeups;
+
+    std::atomic<uint64_t> nRecvDirectBytes;
+    std::atomic<uint64_t> nSendCalls;
+    std::atomic<uint64_t> nSendBuffers;
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
@@ -496,6 +577,10 @@ public:
     double dPingTime;
     double dPingWait;
     std::string addrLocal;
+    size_t nSendQueueMsgs[SEND_CLASS_MAX];
+    size_t nSendQueueBytes[SEND_CLASS_MAX];
+    uint64_t nSendClassBytes[SEND_CLASS_MAX];
+    bool fSendThrottled;
 };
 
 
@@ -504,22 +589,28 @@ class CNetMessage
 public:
     bool in_data; // parsing header (false) or data (true)
 
-    CDataStream hdrbuf; // partially received header
+    char hdrbuf[CMessageHeader::HEADER_SIZE]; // partially received header
     CMessageHeader hdr; // complete header
     unsigned int nHdrPos;
 
-    CDataStream vRecv; // received message data
+    CDataStream vRecv; // received message data, in a buffer from NetRecvBufferPool()
     unsigned int nDataPos;
 
     int64_t nTime; // time (in microseconds) of message receipt.
 
-    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
-        hdrbuf.resize(24);
+    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
     }
+    ~CNetMessage();
+
+    // Messages are only ever moved between the receive and process queues
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
+    CNetMessage(const CNetMessage&) = delete;
+    CNetMessage& operator=(const CNetMessage&) = delete;
 
     bool complete() const
     {
@@ -530,7 +621,6 @@ public:
 
     void SetVersion(int nVersionIn)
     {
-        hdrbuf.SetVersion(nVersionIn);
         vRecv.SetVersion(nVersionIn);
     }
 
@@ -548,10 +638,11 @@ public:
     std::atomic<ServiceFlags> nServices;
     ServiceFlags nServicesExpected;
     SOCKET hSocket;
-    size_t nSendSize;   // total size of all vSendMsg entries
+    size_t nSendSize;   // total size of all queued messages, in vSendMsg and vSendQueue
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    std::deque<std::vector<unsigned char>> vSendMsg; // buffers being written to the socket, in order
+    size_t nSendMsgSize;                             // total size of all vSendMsg entries
     RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
@@ -562,7 +653,8 @@ public:
 
     RecursiveMutex cs_sendProcessing;
 
-    std::deque<CInv> vRecvGetData;
+    //! requested items not served yet, with the send class chosen for the getdata they came in
+    std::deque<std::pair<CInv, SendClass> > vRecvGetData;
     uint64_t nRecvBytes;
     std::atomic<int> nRecvVersion;
 
@@ -600,6 +692,13 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Receive readiness remembered across socket handler rounds, needed with
+    // edge-triggered event backends that report new data only once. Only
+    // touched by the socket handler thread.
+    bool fHasRecvData;
+    // Time (in usec) at which bulk messages held back by -maxpeeruploadrate
+    // may be sent again, or 0 if none are held back.
+    std::atomic<int64_t> nSendThrottledUntil;
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
@@ -641,10 +740,34 @@ public:
     CNode(NodeId id, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const std::string& addrNameIn = "", bool fInboundIn = false);
     ~CNode();
 
+    /** Add a serialized message to the queue of its class. requires LOCK(cs_vSend) */
+    void QueueSendMessage(SendClass sendClass, std::vector<unsigned char>&& header, std::vector<unsigned char>&& data);
+    /**
+     * Move queued messages to vSendMsg, picking the class with the least
+     * weighted service so far, until MAX_SEND_COMMIT_BYTES are pending or the
+     * queues are empty. Bulk messages are held back while the peer is over
+     * nBulkBytesPerSec (0 = unlimited). requires LOCK(cs_vSend)
+     */
+    void ScheduleSendMessages(int64_t nTimeMicros, uint64_t nBulkBytesPerSec);
+
 private:
     CNode(const CNode&);
     void operator=(const CNode&);
 
+    /** A serialized message waiting in one of the class queues */
+    struct QueuedSendMessage {
+        std::vector<unsigned char> header;
+        std::vector<unsigned char> data;
+    };
+    // Per-class outbound queues and their fair queueing state, guarded by cs_vSend
+    std::deque<QueuedSendMessage> vSendQueue[SEND_CLASS_MAX];
+    size_t nSendQueueBytes[SEND_CLASS_MAX];
+    uint64_t nSendClassBytes[SEND_CLASS_MAX]; // bytes moved to vSendMsg per class
+    uint64_t nSendPass[SEND_CLASS_MAX];       // weighted bytes served per class
+    uint64_t nSendVirtualTime;                // pass of the last scheduled class after serving it
+    int64_t nBulkSendTokens;                  // -maxpeeruploadrate token bucket, in bytes
+    int64_t nBulkSendTokensTime;
+
 
     const uint64_t nLocalHostNonce;
     // Services offered to this peer
@@ -687,6 +810,15 @@ public:
     }
 
     bool ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete);
+    /**
+     * If the message being received still expects at least nMinBytes of
+     * payload, make room for up to nMaxBytes of it and return where they go,
+     * so the socket handler can recv() straight into the message. The bytes
+     * must then be passed to ReceiveMsgBytes() at that same address.
+     */
+    char* GetDirectRecvBuffer(unsigned int nMinBytes, unsigned int& nMaxBytes);
+    /** Move the complete messages received so far to vProcessMsg (zero-copy splice) */
+    void MarkReceivedMsgsForProcessing(unsigned int nReceiveFloodSize);
 
     void SetRecvVersion(int nVersionIn)
     {
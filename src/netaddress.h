@@ -91,6 +91,7 @@ public:
     }
 
     friend class CSubNet;
+    friend class CNetAddrHasher;
 };
 
 class CSubNet
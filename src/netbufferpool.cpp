@@ -0,0 +1,17 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netbufferpool.h"
+
+CBufferPool<CSerializeData>& NetRecvBufferPool()
+{
+    static CBufferPool<CSerializeData> pool(DEFAULT_NET_BUFFER_POOL_BYTES);
+    return pool;
+}
+
+CBufferPool<std::vector<unsigned char> >& NetSendBufferPool()
+{
+    static CBufferPool<std::vector<unsigned char> > pool(DEFAULT_NET_BUFFER_POOL_BYTES);
+    return pool;
+}
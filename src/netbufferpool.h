@@ -0,0 +1,165 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NETBUFFERPOOL_H
+#define BITCOIN_NETBUFFERPOOL_H
+
+#include "allocators.h"
+
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/** Allocation counters of a CBufferPool */
+struct BufferPoolStats {
+    uint64_t nAllocated; //!< buffers handed out that had to be freshly allocated
+    uint64_t nReused;    //!< buffers handed out from the free lists
+    uint64_t nReturned;  //!< buffers given back and kept for reuse
+    uint64_t nDiscarded; //!< buffers given back but freed (too large or pool full)
+    size_t nPooled;      //!< buffers currently held in the free lists
+    size_t nPooledBytes; //!< capacity of the buffers currently held
+};
+
+/**
+ * Free lists of byte buffers, in power-of-two capacity classes from
+ * MIN_CLASS_BYTES to MAX_CLASS_BYTES, shared by all peers.
+ *
+ * Get() returns an empty buffer whose capacity is at least the requested
+ * size, Put() recycles a buffer once its contents are no longer needed.
+ * Buffers too large for the top class (big blocks) are never kept, and the
+ * pool holds at most nMaxPooledBytes so an idle node doesn't sit on the
+ * memory of a past burst. Safe to use from any thread.
+ */
+template <typename Buffer>
+class CBufferPool
+{
+public:
+    static const int MIN_CLASS = 8;  // 256 bytes
+    static const int MAX_CLASS = 20; // 1 MiB
+    static const size_t MIN_CLASS_BYTES = (size_t)1 << MIN_CLASS;
+    static const size_t MAX_CLASS_BYTES = (size_t)1 << MAX_CLASS;
+
+    explicit CBufferPool(size_t nMaxPooledBytesIn) : nMaxPooledBytes(nMaxPooledBytesIn)
+    {
+        nAllocated = 0;
+        nReused = 0;
+        nReturned = 0;
+        nDiscarded = 0;
+        nPooled = 0;
+        nPooledBytes = 0;
+    }
+
+    Buffer Get(size_t nSize)
+    {
+        Buffer buf;
+        if (nSize <= MAX_CLASS_BYTES) {
+            const int nClass = ClassForSize(nSize);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::vector<Buffer>& vFree = vFreeLists[nClass - MIN_CLASS];
+                if (!vFree.empty()) {
+                    buf.swap(vFree.back());
+                    vFree.pop_back();
+                    nPooled--;
+                    nPooledBytes -= buf.capacity();
+                }
+            }
+            if (buf.capacity()) {
+                nReused.fetch_add(1, std::memory_order_relaxed);
+                return buf;
+            }
+            nSize = (size_t)1 << nClass;
+        }
+        buf.reserve(nSize);
+        nAllocated.fetch_add(1, std::memory_order_relaxed);
+        return buf;
+    }
+
+    void Put(Buffer&& buf)
+    {
+        const size_t nCapacity = buf.capacity();
+        if (nCapacity == 0)
+            return;
+        if (nCapacity >= MIN_CLASS_BYTES && nCapacity < 2 * MAX_CLASS_BYTES) {
+            // a buffer with capacity in [2^c, 2^(c+1)) can serve requests of class c
+            const int nLog = FloorLog2(nCapacity);
+            const int nClass = nLog > MAX_CLASS ? MAX_CLASS : nLog;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (nPooledBytes + nCapacity <= nMaxPooledBytes) {
+                buf.clear();
+                vFreeLists[nClass - MIN_CLASS].emplace_back();
+                vFreeLists[nClass - MIN_CLASS].back().swap(buf);
+                nPooled++;
+                nPooledBytes += nCapacity;
+                nReturned.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        nDiscarded.fetch_add(1, std::memory_order_relaxed);
+        Buffer().swap(buf);
+    }
+
+    BufferPoolStats GetStats() const
+    {
+        BufferPoolStats stats;
+        stats.nAllocated = nAllocated.load(std::memory_order_relaxed);
+        stats.nReused = nReused.load(std::memory_order_relaxed);
+        stats.nReturned = nReturned.load(std::memory_order_relaxed);
+        stats.nDiscarded = nDiscarded.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.nPooled = nPooled;
+        stats.nPooledBytes = nPooledBytes;
+        return stats;
+    }
+
+    /** Free all pooled buffers */
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::vector<Buffer>& vFree : vFreeLists)
+            std::vector<Buffer>().swap(vFree);
+        nPooled = 0;
+        nPooledBytes = 0;
+    }
+
+private:
+    static int FloorLog2(size_t n)
+    {
+        int nLog = 0;
+        while (n >>= 1)
+            nLog++;
+        return nLog;
+    }
+
+    /** Smallest class whose buffers hold at least nSize bytes */
+    static int ClassForSize(size_t nSize)
+    {
+        int nClass = MIN_CLASS;
+        while (((size_t)1 << nClass) < nSize)
+            nClass++;
+        return nClass;
+    }
+
+    const size_t nMaxPooledBytes;
+    mutable std::mutex mutex;
+    std::vector<Buffer> vFreeLists[MAX_CLASS - MIN_CLASS + 1];
+    size_t nPooled;
+    size_t nPooledBytes;
+    std::atomic<uint64_t> nAllocated;
+    std::atomic<uint64_t> nReused;
+    std::atomic<uint64_t> nReturned;
+    std::atomic<uint64_t> nDiscarded;
+};
+
+/** Default cap on the memory kept by each of the network buffer pools */
+static const size_t DEFAULT_NET_BUFFER_POOL_BYTES = 32 * 1024 * 1024;
+
+/** Pool for the payload of received messages (CNetMessage::vRecv) */
+CBufferPool<CSerializeData>& NetRecvBufferPool();
+/** Pool for queued outbound message headers and payloads (CNode::vSendMsg) */
+CBufferPool<std::vector<unsigned char> >& NetSendBufferPool();
+
+#endif // BITCOIN_NETBUFFERPOOL_H
@@ -0,0 +1,192 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#include "netevents.h"
+
+#include "netbase.h"
+#include "util.h"
+
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
+/** select() backend: portable, level-triggered, limited to FD_SETSIZE descriptors */
+class CSocketEventsSelect : public CSocketEvents
+{
+public:
+    const char* GetName() const override { return SOCKETEVENTS_SELECT; }
+    bool IsEdgeTriggered() const override { return false; }
+    bool IsUsableSocket(SOCKET hSocket) const override { return IsSelectableSocket(hSocket); }
+    bool Add(SOCKET hSocket, bool fListen) override { return IsSelectableSocket(hSocket); }
+
+    int Wait(const std::vector<SocketInterest>& vInterest, int nTimeoutMs, SocketReadySet& ready) override
+    {
+        ready.clear();
+
+        struct timeval timeout = MillisToTimeval(nTimeoutMs);
+
+        fd_set fdsetRecv;
+        fd_set fdsetSend;
+        fd_set fdsetError;
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        SOCKET hSocketMax = 0;
+
+        for (const SocketInterest& si : vInterest) {
+            if (si.fRecv)
+                FD_SET(si.socket, &fdsetRecv);
+            if (si.fSend)
+                FD_SET(si.socket, &fdsetSend);
+            FD_SET(si.socket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, si.socket);
+        }
+
+        int nSelect = select(vInterest.empty() ? 0 : hSocketMax + 1,
+                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        if (nSelect == SOCKET_ERROR) {
+            if (!vInterest.empty()) {
+                int nErr = WSAGetLastError();
+                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+                // Let the caller probe every socket for receive, as before
+                for (const SocketInterest& si : vInterest)
+                    ready.recv.insert(si.socket);
+            }
+            return SOCKET_ERROR;
+        }
+
+        for (const SocketInterest& si : vInterest) {
+            if (FD_ISSET(si.socket, &fdsetRecv))
+                ready.recv.insert(si.socket);
+            if (FD_ISSET(si.socket, &fdsetSend))
+                ready.send.insert(si.socket);
+            if (FD_ISSET(si.socket, &fdsetError))
+                ready.error.insert(si.socket);
+        }
+        return nSelect;
+    }
+};
+
+#ifdef HAVE_EPOLL
+/**
+ * epoll backend: peer sockets are registered once, edge-triggered, for both
+ * directions. Write readiness is only reported when the kernel send buffer
+ * drains after a send hit EAGAIN, so sockets with an empty send queue cost
+ * nothing per round. The descriptor count is only limited by RLIMIT_NOFILE.
+ */
+class CSocketEventsEpoll : public CSocketEvents
+{
+public:
+    static const int MAX_EVENTS = 256;
+
+    CSocketEventsEpoll() : hEpoll(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~CSocketEventsEpoll() override
+    {
+        if (hEpoll != -1)
+            close(hEpoll);
+    }
+
+    bool IsValid() const { return hEpoll != -1; }
+
+    const char* GetName() const override { return SOCKETEVENTS_EPOLL; }
+    bool IsEdgeTriggered() const override { return true; }
+    bool IsUsableSocket(SOCKET hSocket) const override { return hSocket != INVALID_SOCKET; }
+
+    bool Add(SOCKET hSocket, bool fListen) override
+    {
+        struct epoll_event event;
+        event.data.fd = hSocket;
+        event.events = fListen ? EPOLLIN : (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+        if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hSocket, &event) != 0) {
+            LogPrintf("%s: epoll_ctl failed for socket %d: %s\n", __func__, hSocket, NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+        return true;
+    }
+
+    int Wait(const std::vector<SocketInterest>& vInterest, int nTimeoutMs, SocketReadySet& ready) override
+    {
+        ready.clear();
+
+        struct epoll_event events[MAX_EVENTS];
+        int nEvents = epoll_wait(hEpoll, events, MAX_EVENTS, nTimeoutMs);
+        if (nEvents < 0) {
+            int nErr = WSAGetLastError();
+            if (nErr == WSAEINTR)
+                return 0;
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            return SOCKET_ERROR;
+        }
+
+        for (int i = 0; i < nEvents; i++) {
+            const SOCKET hSocket = events[i].data.fd;
+            if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                ready.error.insert(hSocket);
+            if (events[i].events & EPOLLIN)
+                ready.recv.insert(hSocket);
+            if (events[i].events & EPOLLOUT)
+                ready.send.insert(hSocket);
+        }
+        return nEvents;
+    }
+
+private:
+    const int hEpoll;
+};
+#endif // HAVE_EPOLL
+
+std::string DefaultSocketEventsMode()
+{
+#ifdef HAVE_EPOLL
+    return SOCKETEVENTS_EPOLL;
+#else
+    return SOCKETEVENTS_SELECT;
+#endif
+}
+
+bool IsSocketEventsModeSupported(const std::string& strMode)
+{
+#ifdef HAVE_EPOLL
+    if (strMode == SOCKETEVENTS_EPOLL)
+        return true;
+#endif
+    return strMode == SOCKETEVENTS_SELECT;
+}
+
+std::string AvailableSocketEventsModes()
+{
+#ifdef HAVE_EPOLL
+    return strprintf("%s, %s", SOCKETEVENTS_SELECT, SOCKETEVENTS_EPOLL);
+#else
+    return SOCKETEVENTS_SELECT;
+#endif
+}
+
+std::unique_ptr<CSocketEvents> MakeSocketEvents(const std::string& strMode, std::string& strError)
+{
+    if (!IsSocketEventsModeSupported(strMode)) {
+        strError = strprintf("Unsupported socket events mode '%s' (available: %s)", strMode, AvailableSocketEventsModes());
+        return nullptr;
+    }
+    if (strMode == SOCKETEVENTS_SELECT)
+        return std::unique_ptr<CSocketEvents>(new CSocketEventsSelect());
+#ifdef HAVE_EPOLL
+    if (strMode == SOCKETEVENTS_EPOLL) {
+        std::unique_ptr<CSocketEventsEpoll> events(new CSocketEventsEpoll());
+        if (!events->IsValid()) {
+            strError = strprintf("epoll_create1 failed: %s", NetworkErrorString(WSAGetLastError()));
+            return nullptr;
+        }
+        return std::move(events);
+    }
+#endif
+    return nullptr;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NETEVENTS_H
+#define BITCOIN_NETEVENTS_H
+
+#include "compat.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+/** Socket event backends selectable with -socketevents */
+static const char* const SOCKETEVENTS_SELECT = "select";
+static const char* const SOCKETEVENTS_EPOLL = "epoll";
+
+/** Interest of the caller in a single socket for one Wait() round */
+struct SocketInterest {
+    SOCKET socket;
+    bool fRecv;
+    bool fSend;
+
+    SocketInterest(SOCKET socket_, bool fRecv_, bool fSend_) : socket(socket_), fRecv(fRecv_), fSend(fSend_) {}
+};
+
+/** Sockets reported ready by a Wait() round */
+struct SocketReadySet {
+    std::set<SOCKET> recv;
+    std::set<SOCKET> send;
+    std::set<SOCKET> error;
+
+    void clear()
+    {
+        recv.clear();
+        send.clear();
+        error.clear();
+    }
+    bool empty() const { return recv.empty() && send.empty() && error.empty(); }
+};
+
+/**
+ * Readiness notification for the socket handler thread.
+ *
+ * Level-triggered backends (select) are handed the full interest list on every
+ * Wait() and report every socket that is currently ready. Edge-triggered
+ * backends (epoll) keep sockets registered from Add() until they are closed,
+ * ignore the interest list and only report a socket when its state changes, so
+ * the caller has to remember readiness until it has consumed it (read until
+ * the socket would block, or send until the kernel buffer is full).
+ */
+class CSocketEvents
+{
+public:
+    virtual ~CSocketEvents() {}
+
+    virtual const char* GetName() const = 0;
+    virtual bool IsEdgeTriggered() const = 0;
+
+    /** Whether this backend can watch the given descriptor at all */
+    virtual bool IsUsableSocket(SOCKET hSocket) const = 0;
+
+    /**
+     * Start watching a socket. Listening sockets are watched level-triggered
+     * because AcceptConnection() only accepts one connection per round.
+     * Sockets are forgotten implicitly when they are closed.
+     */
+    virtual bool Add(SOCKET hSocket, bool fListen) = 0;
+
+    /**
+     * Wait at most nTimeoutMs for readiness. vInterest is only used by
+     * level-triggered backends and may be left empty otherwise.
+     * @return number of ready sockets, 0 on timeout, SOCKET_ERROR on failure
+     */
+    virtual int Wait(const std::vector<SocketInterest>& vInterest, int nTimeoutMs, SocketReadySet& ready) = 0;
+};
+
+/** Name of the preferred backend on this platform */
+std::string DefaultSocketEventsMode();
+
+/** Whether MakeSocketEvents() knows the given backend on this platform */
+bool IsSocketEventsModeSupported(const std::string& strMode);
+
+/** Comma separated list of backends available on this platform, for help messages */
+std::string AvailableSocketEventsModes();
+
+/** Create the backend with the given name, or return nullptr and set strError */
+std::unique_ptr<CSocketEvents> MakeSocketEvents(const std::string& strMode, std::string& strError);
+
+#endif // BITCOIN_NETEVENTS_H
@@ -8,6 +8,7 @@
 #define BITCOIN_NETMESSAGEMAKER_H
 
 #include "net.h"
+#include "netbufferpool.h"
 #include "serialize.h"
 
 class CNetMsgMaker
@@ -20,6 +21,10 @@ public:
     {
         CSerializedNetMsg msg;
         msg.command = std::move(sCommand);
+        // size the payload up front so it fits in one recycled buffer
+        CSizeComputer sizer(SER_NETWORK, nFlags | nVersion);
+        ::SerializeMany(sizer, args...);
+        msg.data = NetSendBufferPool().Get(sizer.size());
         CVectorWriter{ SER_NETWORK, nFlags | nVersion, msg.data, 0, std::forward<Args>(args)... };
         return msg;
     }
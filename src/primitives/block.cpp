@@ -37,7 +37,7 @@ uint256 CBlockHeader::GetHash() const
 
 CScript CBlock::GetPaidPayee(CAmount nAmount) const
 {
-    const auto& tx = vtx[IsProofOfWork() ? 0 : 1];
+    const auto& tx = *vtx[IsProofOfWork() ? 0 : 1];
 
     for (auto it = tx.vout.rbegin(); it != tx.vout.rend(); ++it)
     {
@@ -64,7 +64,7 @@ std::string CBlock::ToString() const
         vtx.size());
     for (unsigned int i = 0; i < vtx.size(); i++)
     {
-        s << "  " << vtx[i].ToString() << "\n";
+        s << "  " << vtx[i]->ToString() << "\n";
     }
     return s.str();
 }
@@ -15,6 +15,7 @@
 #include "uint256.h"
 
 #include <list>
+#include <memory>
 
 class CTransaction;
 
@@ -251,6 +252,10 @@ public:
 
     /** Convert a CMutableTransaction into a CTransaction. */
     CTransaction(const CMutableTransaction &tx);
+    CTransaction(CMutableTransaction &&tx);
+
+    CTransaction(const CTransaction& tx) = default;
+    CTransaction(CTransaction&& tx) = default;
 
     CTransaction& operator=(const CTransaction& tx);
 
@@ -313,6 +318,10 @@ public:
     size_t DynamicMemoryUsage() const;
 };
 
+typedef std::shared_ptr<const CTransaction> CTransactionRef;
+static inline CTransactionRef MakeTransactionRef() { return std::make_shared<const CTransaction>(); }
+template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
+
 /** A mutable version of CTransaction. */
 struct CMutableTransaction
 {
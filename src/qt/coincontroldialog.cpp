@@ -761,7 +761,8 @@ void CoinControlDialog::updateView()
 
     nSelectableInputs = 0;
     std::map<QString, std::vector<COutput>> mapCoins;
-    model->listCoins(mapCoins);
+    if (!model->listCoins(mapCoins))
+        inform(tr("The wallet is still updating to the latest block, the list may be incomplete"));
 
     for (PAIRTYPE(QString, std::vector<COutput>) coins : mapCoins) {
         CCoinControlWidgetItem* itemWalletAddress = new CCoinControlWidgetItem();
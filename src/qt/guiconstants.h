@@ -11,6 +11,9 @@
 /* Milliseconds between model updates */
 static const int MODEL_UPDATE_DELAY = 1000;
 
+/* Longest the GUI thread waits for the wallet to catch up with the chain, in milliseconds */
+static const int WALLET_UPDATE_WAIT = 200;
+
 /* AskPassphraseDialog -- Maximum passphrase length */
 static const int MAX_PASSPHRASE_SIZE = 1024;
 
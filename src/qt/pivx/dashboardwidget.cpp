@@ -13,6 +13,7 @@
 #include "clientmodel.h"
 #include "optionsmodel.h"
 #include "utiltime.h"
+#include <limits>
 #include <vector>
 #include <QPainter>	
 #include <QPainter>
@@ -217,12 +218,7 @@ void DashboardWidget::loadWalletModel()
         // Notification pop-up for new transaction
         connect(txModel, &TransactionTableModel::rowsInserted, this, &DashboardWidget::processNewTransaction);
 #ifdef USE_QTCHARTS
-        // chart filter
-        stakesFilter = new TransactionFilterProxy();
-        stakesFilter->setDynamicSortFilter(true);
-        stakesFilter->setOnlyStakesandMN(true);
-        stakesFilter->setSourceModel(txModel);
-        hasStakes = stakesFilter->rowCount() > 0;
+        updateRewardCount();
 
         onHideChartsChanged(walletModel->getOptionsModel()->isHideCharts());
         connect(walletModel->getOptionsModel(), &OptionsModel::hideChartsChanged, this, &DashboardWidget::onHideChartsChanged);
@@ -237,9 +233,7 @@ void DashboardWidget::onTxArrived(const QString& hash, const bool& isCoinStake)
     showList();
 #ifdef USE_QTCHARTS
     if (isCoinStake) {
-        // Update value if this is our first stake
-        if (!hasStakes)
-            hasStakes = stakesFilter->rowCount() > 0;
+        updateRewardCount();
         tryChartRefresh();
     }
 #endif
@@ -412,7 +406,7 @@ void DashboardWidget::loadChart()
 
 void DashboardWidget::showHideEmptyChart(bool showEmpty, bool loading, bool forceView)
 {
-    if (stakesFilter->rowCount() > SHOW_EMPTY_CHART_VIEW_THRESHOLD || forceView) {
+    if (nRewards > SHOW_EMPTY_CHART_VIEW_THRESHOLD || forceView) {
         ui->layoutChart->setVisible(!showEmpty);
         ui->emptyContainerChart->setVisible(showEmpty);
     }
@@ -497,56 +491,37 @@ void DashboardWidget::changeChartColors()
     if (set1) set1->setBorderColor(backgroundColor);
 }
 
-void DashboardWidget::updateStakeFilter()
+void DashboardWidget::updateRewardCount()
 {
-    if (chartShow != ALL) {
-        bool filterByMonth = false;
-        if (monthFilter != 0 && chartShow == MONTH) {
-            filterByMonth = true;
-        }
-        if (yearFilter != 0) {
-            if (filterByMonth) {
-                QDate monthFirst = QDate(yearFilter, monthFilter, 1);
-                stakesFilter->setDateRange(
-                        QDateTime(monthFirst),
-                        QDateTime(QDate(yearFilter, monthFilter, monthFirst.daysInMonth())).addDays(1).addMSecs(-1)
-                );
-            } else {
-                stakesFilter->setDateRange(
-                        QDateTime(QDate(yearFilter, 1, 1)),
-                        QDateTime(QDate(yearFilter, 12, 31)).addDays(1).addMSecs(-1)
-                );
-            }
-        } else if (filterByMonth) {
-            QDate currentDate = QDate::currentDate();
-            QDate monthFirst = QDate(currentDate.year(), monthFilter, 1);
-            stakesFilter->setDateRange(
-                    QDateTime(monthFirst),
-                    QDateTime(QDate(currentDate.year(), monthFilter, monthFirst.daysInMonth())).addDays(1).addMSecs(-1)
-            );
-            ui->comboBoxYears->setCurrentText(QString::number(currentDate.year()));
-        } else {
-            stakesFilter->clearDateRange();
-        }
-    } else {
-        stakesFilter->clearDateRange();
-    }
+    nRewards = 0;
+    for (const auto& it : walletModel->getRewardHistory(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()))
+        nRewards += it.second.nStakes + it.second.nMasternodeRewards;
+    hasStakes = nRewards > 0;
 }
 
 // pair FLS
 const QMap<int, QMap<QString, qint64>> DashboardWidget::getAmountBy()
 {
-    updateStakeFilter();
-    const int size = stakesFilter->rowCount();
-    QMap<int, QMap<QString, qint64>> amountBy;
-    // Get all of the stakes
-    for (int i = 0; i < size; ++i) {
-        QModelIndex modelIndex = stakesFilter->index(i, TransactionTableModel::ToAddress);
-        qint64 amount = llabs(modelIndex.data(TransactionTableModel::AmountRole).toLongLong());
-        QDate date = modelIndex.data(TransactionTableModel::DateRole).toDateTime().date();
-        bool isPiv = modelIndex.data(TransactionTableModel::TypeRole).toInt() == TransactionRecord::StakeMint;
-		bool isMN = modelIndex.data(TransactionTableModel::TypeRole).toInt() == TransactionRecord::MNReward;
+    // The wallet keeps the rewards summed up per day, only the days of the
+    // range shown are read. Day numbers are days since 1970-01-01 (UTC).
+    const QDate epoch(1970, 1, 1);
+    int nDayFrom = std::numeric_limits<int>::min();
+    int nDayTo = std::numeric_limits<int>::max();
+    if (chartShow != ALL) {
+        const int year = (yearFilter != 0) ? yearFilter : QDate::currentDate().year();
+        QDate dateFrom(year, 1, 1);
+        QDate dateTo(year, 12, 31);
+        if (chartShow == MONTH && monthFilter != 0) {
+            dateFrom = QDate(year, monthFilter, 1);
+            dateTo = QDate(year, monthFilter, dateFrom.daysInMonth());
+        }
+        nDayFrom = epoch.daysTo(dateFrom);
+        nDayTo = epoch.daysTo(dateTo);
+    }
 
+    QMap<int, QMap<QString, qint64>> amountBy;
+    for (const auto& it : walletModel->getRewardHistory(nDayFrom, nDayTo)) {
+        const QDate date = epoch.addDays(it.first);
         int time = 0;
         switch (chartShow) {
             case YEAR: {
@@ -565,23 +540,11 @@ const QMap<int, QMap<QString, qint64>> DashboardWidget::getAmountBy()
                 inform(tr("Error loading chart, invalid show option"));
                 return amountBy;
         }
-        if (amountBy.contains(time)) {
-            if (isPiv) {
-                amountBy[time]["piv"] += amount;
-            } else if (isMN) {
-                amountBy[time]["mn"] += amount;
-                hasMNRewards = true;
-            }
-        } else {
-            if (isPiv) {
-                amountBy[time]["piv"] = amount;
-                amountBy[time]["mn"] = 0;
-            } else if (isMN) {
-                amountBy[time]["piv"] = 0;
-                amountBy[time]["mn"] = amount;
-                hasMNRewards = true;
-            }
-        }
+        QMap<QString, qint64>& amounts = amountBy[time];
+        amounts["piv"] += it.second.nStake;
+        amounts["mn"] += it.second.nMasternode;
+        if (it.second.nMasternodeRewards > 0)
+            hasMNRewards = true;
     }
     return amountBy;
 }
@@ -929,7 +892,7 @@ void DashboardWidget::processNewTransaction(const QModelIndex& parent, int start
     if (!walletModel || !clientModel || clientModel->inInitialBlockDownload())
         return;
 
-    if (!txModel || txModel->processingQueuedTransactions())
+    if (!txModel || txModel->processingQueuedTransactions() || txModel->isFetchingHistory())
         return;
 
     QString date = txModel->index(start, TransactionTableModel::Date, parent).data().toString();
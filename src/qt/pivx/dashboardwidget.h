@@ -135,7 +135,6 @@ private:
     std::atomic<bool> isLoading;
 
     // Chart
-    TransactionFilterProxy* stakesFilter = nullptr;
     bool isChartInitialized = false;
     QChartView *chartView = nullptr;
     QBarSeries *series = nullptr;
@@ -155,13 +154,14 @@ private:
 
     ChartData* chartData = nullptr;
     bool hasStakes = false;
+    int nRewards = 0;
     bool fShowCharts = true;
 
     void initChart();
     void showHideEmptyChart(bool show, bool loading, bool forceView = false);
     bool refreshChart();
     void tryChartRefresh();
-    void updateStakeFilter();
+    void updateRewardCount();
     const QMap<int, QMap<QString, qint64>> getAmountBy();
     bool loadChartData(bool withMonthNames);
     void updateAxisX(const QStringList *arg = nullptr);
@@ -59,6 +59,9 @@ namespace GuiTransactionsUtils {
                 } else
                     retStr = parent->translate("Error: The wallet is unlocked for staking only. Fully unlock the wallet to send the transaction.");
                 break;
+            case WalletModel::WalletUpdating:
+                retStr = parent->translate("The wallet is still updating to the latest block, please try again in a moment.");
+                break;
             case WalletModel::InsaneFee:
                 retStr = parent->translate(
                         "A fee %1 times higher than %2 per kB is considered an insanely high fee.").arg(10000).arg(
@@ -27,8 +27,6 @@
 #include <QDebug>
 #include <QIcon>
 #include <QList>
-#include <QtConcurrent/QtConcurrent>
-#include <QFuture>
 
 using namespace boost::placeholders;
 
@@ -58,12 +56,6 @@ struct TxLessThan {
     }
 };
 
-struct ConvertTxToVectorResult
-{
-    QList<TransactionRecord> records;
-    qint64 nFirstLoadedTxTime{0};
-};
-
 // Private implementation
 class TransactionTablePriv
 {
@@ -85,127 +77,77 @@ public:
     mutable RecursiveMutex cs_cachedWallet;
 
     /**
-     * Time of the oldest transaction loaded into the model.
-     * It can or not be the first tx in the wallet, the model only loads the last 20k txs.
+     * History is loaded newest first, a page at a time as the view scrolls.
+     * posHistory is the oldest transaction loaded so far, the next page
+     * continues from there. Only used from the GUI thread.
      */
-    qint64 nFirstLoadedTxTime{0};
+    CWallet::TxTimeKey posHistory{CWallet::TxHistoryBegin()};
+    bool fHistoryMore{true};
+    /** Transactions loaded, up to the wallet's nLoadedRecordsMaxCount */
+    int nLoadedTxs{0};
 
     /* Query entire wallet anew from core.
      */
     void refreshWallet()
     {
         qDebug() << "TransactionTablePriv::refreshWallet";
-        
+
         {
             LOCK(cs_cachedWallet);
             cachedWallet.clear();
         }
+        posHistory = CWallet::TxHistoryBegin();
+        fHistoryMore = true;
+        nLoadedTxs = 0;
+        fetchHistory(false);
+    }
 
-        std::vector<CWalletTx> walletTxes = wallet->getWalletTxs();
-
-        // Divide the work between multiple threads to speedup the process if the vector is larger than 4k txes
-        std::size_t txesSize = walletTxes.size();
-        if (txesSize > SINGLE_THREAD_MAX_TXES_SIZE) {
-
-            // First check if the amount of txs exceeds the UI limit
-            if (txesSize > wallet->nLoadedRecordsMaxCount) {
-                // Sort the txs by date just to be really really sure that them are ordered.
-                // (this extra calculation should be removed in the future if can ensure that
-                // txs are stored in order in the db, which is what should be happening)
-                sort(walletTxes.begin(), walletTxes.end(),
-                        [](const CWalletTx & a, const CWalletTx & b) -> bool {
-                         return a.GetTxTime() > b.GetTxTime();
-                     });
-
-                // Only latest ones.
-                walletTxes = std::vector<CWalletTx>(walletTxes.begin(), walletTxes.begin() + wallet->nLoadedRecordsMaxCount);
-                txesSize = walletTxes.size();
-            };
-
-            // Simple way to get the processors count
-            std::size_t threadsCount = (QThreadPool::globalInstance()->maxThreadCount() / 2 ) + 1;
-
-            // Size of the tx subsets
-            std::size_t const subsetSize = txesSize / (threadsCount + 1);
-            std::size_t totalSumSize = 0;
-            QList<QFuture<ConvertTxToVectorResult>> tasks;
-
-            // Subsets + run task
-            for (std::size_t i = 0; i < threadsCount; ++i) {
-                tasks.append(
-                        QtConcurrent::run(
-                                convertTxToRecords,
-                                this,
-                                wallet,
-                                std::vector<CWalletTx>(walletTxes.begin() + totalSumSize, walletTxes.begin() + totalSumSize + subsetSize)
-                        )
-                 );
-                totalSumSize += subsetSize;
-            }
-
-            // Now take the remaining ones and do the work here
-            std::size_t const remainingSize = txesSize - totalSumSize;
-            auto res = convertTxToRecords(this, wallet,
-                                              std::vector<CWalletTx>(walletTxes.end() - remainingSize, walletTxes.end())
-            );
-            
-            {
-                LOCK(cs_cachedWallet);
-                cachedWallet.append(res.records);
-            }
-
-            nFirstLoadedTxTime = res.nFirstLoadedTxTime;
-
-            for (auto &future : tasks) {
-                future.waitForFinished();
-                ConvertTxToVectorResult convertRes = future.result();
-                
-                {
-                    LOCK(cs_cachedWallet);
-                    cachedWallet.append(convertRes.records);
-                }
-
-                if (nFirstLoadedTxTime > convertRes.nFirstLoadedTxTime) {
-                    nFirstLoadedTxTime = convertRes.nFirstLoadedTxTime;
-                }
-            }
-
-            // Now that all records have been cached, sort them by tx hash
-            {
-                LOCK(cs_cachedWallet);
-                std::sort(cachedWallet.begin(), cachedWallet.end(), TxLessThan());
-            }
-
-        } else {
-            // Single thread flow
-            ConvertTxToVectorResult convertRes = convertTxToRecords(this, wallet, walletTxes);
-            
-            {
-                LOCK(cs_cachedWallet);
-                cachedWallet.append(convertRes.records);   
-            }
-
-            nFirstLoadedTxTime = convertRes.nFirstLoadedTxTime;
-        }
+    bool canFetchHistory() const
+    {
+        return fHistoryMore;
     }
 
-    static ConvertTxToVectorResult convertTxToRecords(TransactionTablePriv* tablePriv, const CWallet* wallet, const std::vector<CWalletTx>& walletTxes) {
-        ConvertTxToVectorResult res;
+    /* Decompose the next page of history and merge it into the cache, keeping
+       it sorted by hash. fNotify: tell the views about the new rows. */
+    void fetchHistory(bool fNotify)
+    {
+        if (!fHistoryMore)
+            return;
 
-        for (const auto &tx : walletTxes) {
-            QList<TransactionRecord> records = TransactionRecord::decomposeTransaction(wallet, tx);
+        QList<TransactionRecord> page;
+        {
+            LOCK2(cs_main, wallet->cs_wallet);
+            const int nCount = std::min(TX_HISTORY_PAGE_SIZE, wallet->nLoadedRecordsMaxCount - nLoadedTxs);
+            const std::vector<const CWalletTx*> vpwtx = wallet->GetTxHistoryPage(posHistory, std::max(0, nCount));
+            nLoadedTxs += vpwtx.size();
+            fHistoryMore = nCount > 0 && (int)vpwtx.size() == nCount && nLoadedTxs < wallet->nLoadedRecordsMaxCount;
 
-            if (!records.isEmpty()) {
-                qint64 time = records.first().time;
-                if (res.nFirstLoadedTxTime == 0 || res.nFirstLoadedTxTime > time) {
-                    res.nFirstLoadedTxTime = time;
-                }
+            LOCK(cs_cachedWallet);
+            for (const CWalletTx* pwtx : vpwtx) {
+                // a transaction whose time changed may have been loaded already
+                if (std::binary_search(cachedWallet.begin(), cachedWallet.end(), pwtx->GetHash(), TxLessThan()))
+                    continue;
+                page.append(TransactionRecord::decomposeTransaction(wallet, *pwtx));
             }
-
-            res.records.append(records);
         }
+        std::sort(page.begin(), page.end(), TxLessThan());
 
-        return res;
+        LOCK(cs_cachedWallet);
+        int i = 0;
+        while (i < page.size()) {
+            const int nPos = std::lower_bound(cachedWallet.begin(), cachedWallet.end(), page[i].hash, TxLessThan()) - cachedWallet.begin();
+            // the following records that belong at the same position go in with it
+            int j = i + 1;
+            while (j < page.size() && (nPos == cachedWallet.size() || !TxLessThan()(cachedWallet[nPos], page[j].hash)))
+                j++;
+            if (fNotify)
+                parent->beginInsertRows(QModelIndex(), nPos, nPos + (j - i) - 1);
+            for (int k = i; k < j; k++)
+                cachedWallet.insert(nPos + (k - i), page[k]);
+            if (fNotify)
+                parent->endInsertRows();
+            i = j;
+        }
     }
 
     /* Update our model of the wallet incrementally, to synchronize our model of the wallet
@@ -260,15 +202,9 @@ public:
                     }
                     const CWalletTx& wtx = mi->second;
 
-                    {
-                        LOCK(cs_cachedWallet);
-                           
-                        // As old transactions are still getting updated (+20k range),
-                        // do not add them if we deliberately didn't load them at startup.
-                        if (cachedWallet.size() >= wallet->nLoadedRecordsMaxCount && wtx.GetTxTime() < nFirstLoadedTxTime) {
-                            return;
-                        }
-                    }
+                    // Older than the loaded history: paging brings it in when the view gets there
+                    if (fHistoryMore && CWallet::TxTimeKey(wtx.GetTxTime(), hash) < posHistory)
+                        return;
 
                     // Added -- insert at the right position
                     QList<TransactionRecord> toInsert =
@@ -357,7 +293,8 @@ TransactionTableModel::TransactionTableModel(CWallet* wallet, WalletModel* paren
                                                                                      wallet(wallet),
                                                                                      walletModel(parent),
                                                                                      priv(new TransactionTablePriv(wallet, this)),
-                                                                                     fProcessingQueuedTransactions(false)
+                                                                                     fProcessingQueuedTransactions(false),
+                                                                                     fFetchingHistory(false)
 {
     columns << QString() << QString() << tr("Date") << tr("Type") << tr("Address") << BitcoinUnits::getAmountColumnTitle(walletModel->getOptionsModel()->getDisplayUnit());
     priv->refreshWallet();
@@ -402,6 +339,20 @@ void TransactionTableModel::updateConfirmations()
     Q_EMIT dataChanged(index(0, ToAddress), index(priv->size() - 1, ToAddress));
 }
 
+bool TransactionTableModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && priv->canFetchHistory();
+}
+
+void TransactionTableModel::fetchMore(const QModelIndex& parent)
+{
+    if (parent.isValid())
+        return;
+    fFetchingHistory = true;
+    priv->fetchHistory(true);
+    fFetchingHistory = false;
+}
+
 int TransactionTableModel::rowCount(const QModelIndex& parent) const
 {
     Q_UNUSED(parent);
@@ -12,7 +12,8 @@
 #include <QAbstractTableModel>
 #include <QStringList>
 
-#define SINGLE_THREAD_MAX_TXES_SIZE 4000
+/** Wallet transactions loaded per fetchMore() */
+#define TX_HISTORY_PAGE_SIZE 500
 
 class TransactionRecord;
 class TransactionTablePriv;
@@ -77,7 +78,12 @@ public:
     QVariant data(const QModelIndex& index, int role) const;
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
     QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const;
+    /** Older history is loaded a page at a time as the views scroll down */
+    bool canFetchMore(const QModelIndex& parent) const;
+    void fetchMore(const QModelIndex& parent);
     bool processingQueuedTransactions() { return fProcessingQueuedTransactions; }
+    /** True while rows of older history are being inserted, rather than new transactions */
+    bool isFetchingHistory() const { return fFetchingHistory; }
 
 Q_SIGNALS:
     void txArrived(const QString& hash, const bool& isCoinStake);
@@ -88,6 +94,7 @@ private:
     QStringList columns;
     TransactionTablePriv* priv;
     bool fProcessingQueuedTransactions;
+    bool fFetchingHistory;
 
     void subscribeToCoreSignals();
     void unsubscribeFromCoreSignals();
@@ -295,6 +295,12 @@ WalletModel::SendCoinsReturn WalletModel::prepareTransaction(WalletModelTransact
         return StakingOnlyUnlocked;
     }
 
+    // pick coins from a wallet that has seen the current tip, without
+    // holding up the GUI while it catches up
+    if (!EnsureWalletIsAvailable(WALLET_UPDATE_WAIT)) {
+        return WalletUpdating;
+    }
+
     QSet<QString> setAddress; // Used to detect duplicates
     int nAddresses = 0;
 
@@ -442,6 +448,11 @@ const CWalletTx* WalletModel::getTx(uint256 id)
     return wallet->GetWalletTx(id);
 }
 
+std::map<int, CRewardDay> WalletModel::getRewardHistory(int nDayFrom, int nDayTo) const
+{
+    return wallet->GetRewardHistory(nDayFrom, nDayTo);
+}
+
 OptionsModel* WalletModel::getOptionsModel()
 {
     return optionsModel;
@@ -778,8 +789,9 @@ bool WalletModel::isSpent(const COutPoint& outpoint) const
 }
 
 // AvailableCoins + LockedCoins grouped by wallet address (put change in one group with wallet address)
-void WalletModel::listCoins(std::map<QString, std::vector<COutput> >& mapCoins) const
+bool WalletModel::listCoins(std::map<QString, std::vector<COutput> >& mapCoins) const
 {
+    const bool fUpToDate = EnsureWalletIsAvailable(WALLET_UPDATE_WAIT);
     std::vector<COutput> vCoins;
     wallet->AvailableCoins(&vCoins);
 
@@ -812,6 +824,8 @@ void WalletModel::listCoins(std::map<QString, std::vector<COutput> >& mapCoins)
             continue;
         mapCoins[QString::fromStdString(EncodeDestination(address))].push_back(out);
     }
+
+    return fUpToDate;
 }
 
 bool WalletModel::isLockedCoin(uint256 hash, unsigned int n) const
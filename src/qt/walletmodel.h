@@ -118,7 +118,8 @@ public:
         TransactionCommitFailed,
         StakingOnlyUnlocked,
         InsaneFee,
-        CannotCreateInternalAddress
+        CannotCreateInternalAddress,
+        WalletUpdating
     };
 
     enum EncryptionStatus {
@@ -173,6 +174,8 @@ public:
     void setWalletCustomFee(bool fUseCustomFee, const CAmount& nFee = DEFAULT_TRANSACTION_FEE);
 
     const CWalletTx* getTx(uint256 id);
+    // staking and masternode rewards per day, see CWallet::GetRewardHistory
+    std::map<int, CRewardDay> getRewardHistory(int nDayFrom, int nDayTo) const;
 
     // prepare transaction for getting txfee before sending coins
     SendCoinsReturn prepareTransaction(WalletModelTransaction& transaction, const CCoinControl* coinControl = NULL);
@@ -238,7 +241,8 @@ public:
     void getOutputs(const std::vector<COutPoint>& vOutpoints, std::vector<COutput>& vOutputs);
     bool getMNCollateralCandidate(COutPoint& outPoint);
     bool isSpent(const COutPoint& outpoint) const;
-    void listCoins(std::map<QString, std::vector<COutput> >& mapCoins) const;
+    // false if the wallet is still catching up with the chain: the list may miss the latest blocks
+    bool listCoins(std::map<QString, std::vector<COutput> >& mapCoins) const;
 
     bool isLockedCoin(uint256 hash, unsigned int n) const;
     void lockCoin(COutPoint& output);
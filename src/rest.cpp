@@ -23,7 +23,10 @@
 #include <univalue.h>
 
 
-static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once through the URI
+static const size_t MAX_GETUTXOS_BATCH_OUTPOINTS = 1000; //allow a max of 1000 outpoints to be queried at once through the request body
+static const long MAX_REST_BLOCKRANGE_COUNT = 500; //allow a max of 500 blocks to be fetched at once
+static const size_t MAX_REST_BLOCKRANGE_SIZE = 16 * 1024 * 1024; //stop adding blocks to a range once it holds 16MB of them
 
 enum RetFormat {
     RF_UNDEF,
@@ -208,40 +211,44 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CBlock block;
     CBlockIndex* pblockindex = NULL;
     {
         LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        BlockMap::iterator it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end())
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
-        pblockindex = mapBlockIndex[hash];
+        pblockindex = it->second;
         if (!(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
-
-        if (!ReadBlockFromDisk(block, pblockindex))
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
-
     switch (rf) {
     case RF_BINARY: {
-        std::string binaryBlock = ssBlock.str();
+        // The on-disk serialization is the network one: stream it as is
+        std::vector<unsigned char> rawBlock;
+        if (!ReadRawBlockFromDisk(rawBlock, pblockindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
         req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryBlock);
+        req->WriteReply(HTTP_OK, rawBlock);
         return true;
     }
 
     case RF_HEX: {
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        std::vector<unsigned char> rawBlock;
+        if (!ReadRawBlockFromDisk(rawBlock, pblockindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        std::string strHex = HexStr(rawBlock.begin(), rawBlock.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
     case RF_JSON: {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pblockindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        LOCK(cs_main);
         UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
         std::string strJSON = objBlock.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
@@ -268,6 +275,159 @@ static bool rest_block_notxdetails(HTTPRequest* req, const std::string& strURIPa
     return rest_block(req, strURIPart, false);
 }
 
+static bool rest_blockrange(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No start height or count specified. Use /rest/blockrange/<start>/<count>.<ext>.");
+
+    int32_t nStart;
+    if (!ParseInt32(path[0], &nStart) || nStart < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start height: " + path[0]);
+
+    long count = strtol(path[1].c_str(), NULL, 10);
+    if (count < 1 || count > MAX_REST_BLOCKRANGE_COUNT)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[1]);
+
+    // Only hold cs_main while collecting the index entries; blocks are read afterwards
+    std::vector<const CBlockIndex*> blocks;
+    blocks.reserve(count);
+    {
+        LOCK(cs_main);
+        if (nStart > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range: " + path[0]);
+        for (const CBlockIndex* pindex = chainActive[nStart]; pindex && (long)blocks.size() < count; pindex = chainActive.Next(pindex)) {
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA) && pindex->nTx > 0)
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            blocks.push_back(pindex);
+        }
+    }
+
+    // The reply is built in memory: the range ends early, after at least one
+    // block, rather than going over MAX_REST_BLOCKRANGE_SIZE
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        // Concatenation of the serialized blocks, copied straight from the block files
+        std::vector<unsigned char> rawBlocks;
+        std::string strHex;
+        std::vector<unsigned char> rawBlock;
+        size_t nSize = 0;
+        for (const CBlockIndex* pindex : blocks) {
+            if (!ReadRawBlockFromDisk(rawBlock, pindex))
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not found");
+            if (nSize > 0 && nSize + rawBlock.size() > MAX_REST_BLOCKRANGE_SIZE)
+                break;
+            nSize += rawBlock.size();
+            if (rf == RF_BINARY)
+                rawBlocks.insert(rawBlocks.end(), rawBlock.begin(), rawBlock.end());
+            else
+                strHex += HexStr(rawBlock.begin(), rawBlock.end());
+        }
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, rawBlocks);
+        } else {
+            strHex += "\n";
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, strHex);
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        std::vector<CBlock> vBlocks;
+        vBlocks.reserve(blocks.size());
+        size_t nSize = 0;
+        for (const CBlockIndex* pindex : blocks) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex))
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not found");
+            const size_t nBlockSize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+            if (nSize > 0 && nSize + nBlockSize > MAX_REST_BLOCKRANGE_SIZE)
+                break;
+            nSize += nBlockSize;
+            vBlocks.push_back(std::move(block));
+        }
+        UniValue jsonBlocks(UniValue::VARR);
+        {
+            LOCK(cs_main);
+            for (size_t i = 0; i < vBlocks.size(); i++)
+                jsonBlocks.push_back(blockToJSON(vBlocks[i], blocks[i], false));
+        }
+        std::string strJSON = jsonBlocks.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_blockhash_by_height(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    int32_t nHeight;
+    if (!ParseInt32(params[0], &nHeight) || nHeight < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + params[0]);
+
+    uint256 hash;
+    {
+        LOCK(cs_main);
+        if (nHeight > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+        hash = chainActive[nHeight]->GetBlockHash();
+    }
+
+    switch (rf) {
+    case RF_BINARY: {
+        CDataStream ssHash(SER_NETWORK, PROTOCOL_VERSION);
+        ssHash << hash;
+        std::string binaryHash = ssHash.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryHash);
+        return true;
+    }
+
+    case RF_HEX: {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, hash.GetHex() + "\n");
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue resp(UniValue::VOBJ);
+        resp.push_back(Pair("blockhash", hash.GetHex()));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, resp.write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
 static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -466,7 +626,7 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
                     return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Combination of URI scheme inputs and raw post data is not allowed");
 
                 CDataStream oss(SER_NETWORK, PROTOCOL_VERSION);
-                oss << strRequestMutable;
+                oss.write(strRequestMutable.data(), strRequestMutable.size());
                 oss >> fCheckMemPool;
                 oss >> vOutPoints;
             }
@@ -487,9 +647,11 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     }
     }
 
-    // limit max outpoints
-    if (vOutPoints.size() > MAX_GETUTXOS_OUTPOINTS)
+    // limit max outpoints; requests posted in the body are not bound by URI length
+    if (fInputParsed && vOutPoints.size() > MAX_GETUTXOS_OUTPOINTS)
         return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, strprintf("Error: max outpoints exceeded (max: %d, tried: %d)", MAX_GETUTXOS_OUTPOINTS, vOutPoints.size()));
+    if (!fInputParsed && vOutPoints.size() > MAX_GETUTXOS_BATCH_OUTPOINTS)
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Error: max outpoints exceeded (max: %d, tried: %d)", MAX_GETUTXOS_BATCH_OUTPOINTS, vOutPoints.size()));
 
     // check spentness and form a bitmap (as well as a JSON capable human-readble string representation)
     std::vector<unsigned char> bitmap;
@@ -516,7 +678,7 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
                 outs.emplace_back(std::move(coin));
             }
 
-            hits.push_back(hit);
+            hits[i] = hit;
             bitmapStringRepresentation.append(hit ? "1" : "0"); // form a binary string representation (human-readable for json output)
         }
     }
@@ -594,6 +756,8 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/blockrange/", rest_blockrange},
+      {"/rest/blockhashbyheight/", rest_blockhash_by_height},
       {"/rest/getutxos", rest_getutxos},
 };
 
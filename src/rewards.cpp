@@ -17,17 +17,156 @@
 #include "utiltime.h"
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstdio>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
-#include <boost/unordered_map.hpp>
+#include <thread>
 
-boost::unordered_map<int, CAmount> mDynamicRewards;
+/** The dynamic rewards by epoch height, sorted by height. A published table
+ *  is never modified: the writers (cs_main) publish a modified copy and
+ *  GetBlockValue reads whichever is current without taking any lock. */
+typedef std::vector<std::pair<int, CAmount>> RewardsTable;
+
+static std::shared_ptr<const RewardsTable> g_rewards_table = std::make_shared<const RewardsTable>();
 
 sqlite3* db = nullptr;
 sqlite3_stmt* insertStmt = nullptr;
 sqlite3_stmt* deleteStmt = nullptr;
 bool initiated = false;
 
+/** A change to the file database, the block connection path only queues it */
+struct RewardsWrite
+{
+    int nHeight;
+    CAmount nAmount;
+    uint256 hash;           // epoch block the amount was computed on
+    bool fErase;            // deletes from nHeight up instead
+};
+
+static std::vector<RewardsWrite> g_write_queue;
+static std::mutex g_write_mutex;
+static std::condition_variable g_write_cv;
+static std::condition_variable g_written_cv; // a batch was written, see CRewards::Flush
+static std::thread g_writer;
+static bool g_write_stop = false;
+static bool g_write_running = false;
+static bool g_write_busy = false;           // the writer holds a batch it hasn't committed yet
+static bool g_write_failed = false;
+
+static std::shared_ptr<const RewardsTable> GetRewardsTable()
+{
+    return std::atomic_load(&g_rewards_table);
+}
+
+static void PublishRewardsTable(RewardsTable&& table)
+{
+    std::atomic_store(&g_rewards_table, std::make_shared<const RewardsTable>(std::move(table)));
+}
+
+// First entry at nHeight or above
+template <typename Iterator>
+static Iterator LowerBound(Iterator begin, Iterator end, int nHeight)
+{
+    return std::lower_bound(begin, end, nHeight,
+            [](const std::pair<int, CAmount>& entry, int n) { return entry.first < n; });
+}
+
+static RewardsTable::const_iterator FindReward(const RewardsTable& table, int nEpochHeight)
+{
+    auto it = LowerBound(table.begin(), table.end(), nEpochHeight);
+    return (it != table.end() && it->first == nEpochHeight) ? it : table.end();
+}
+
+static void QueueRewardsWrite(const RewardsWrite& write)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_write_mutex);
+        g_write_queue.push_back(write);
+    }
+    g_write_cv.notify_one();
+}
+
+// Applies the queued changes in order, each batch in one transaction: the file
+// always holds the table as of some point of the block connection path, which
+// Init reconciles with the chain tip.
+static bool WriteRewards(const std::vector<RewardsWrite>& vWrites)
+{
+    auto ok = sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    for (auto it = vWrites.begin(); ok && it != vWrites.end(); ++it) {
+        auto stmt = it->fErase ? deleteStmt : insertStmt;
+        sqlite3_bind_int(stmt, 1, it->nHeight);
+        if (!it->fErase) {
+            const auto strHash = it->hash.GetHex();
+            sqlite3_bind_int64(stmt, 2, it->nAmount);
+            sqlite3_bind_text(stmt, 3, strHash.c_str(), strHash.size(), SQLITE_TRANSIENT);
+        }
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+
+    if (ok) ok = sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    if (!ok) {
+        LogPrintf("CRewards::%s: SQL error: %s\n", __func__, sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+
+    return ok;
+}
+
+static void RewardsWriterThread()
+{
+    std::unique_lock<std::mutex> lock(g_write_mutex);
+    while (true) {
+        g_write_cv.wait(lock, [] { return g_write_stop || !g_write_queue.empty(); });
+        if (g_write_queue.empty())
+            break; // stopping, and all written
+
+        std::vector<RewardsWrite> vWrites;
+        vWrites.swap(g_write_queue);
+        g_write_busy = true;
+        lock.unlock();
+        const auto ok = WriteRewards(vWrites);
+        if (!ok) {
+            // the file is missing changes the chainstate may be flushed with
+            AbortNode("Failed to write to the dynamic rewards database");
+        }
+        lock.lock();
+        g_write_busy = false;
+        g_write_failed |= !ok;
+        g_written_cv.notify_all();
+    }
+}
+
+// The amount the coinstake (or coinbase) of the first block of the epoch paid
+static bool ReadEpochReward(const CBlockIndex* pindex, CAmount& nAmount)
+{
+    CBlock block;
+    if (!pindex || !ReadBlockFromDisk(block, pindex))
+        return false;
+
+    const auto& tx = *block.vtx[block.IsProofOfWork() ? 0 : 1];
+
+    nAmount = 0;
+    for (const CTxIn& in : tx.vin) {
+        const auto& outpoint = in.prevout;
+
+        CTransaction txPrev; uint256 hash;
+        if(GetTransaction(outpoint.hash, txPrev, hash, true)) {
+            nAmount -= txPrev.vout[outpoint.n].nValue;
+        }
+    }
+
+    nAmount += tx.GetValueOut();
+
+    return true;
+}
+
 bool CRewards::Init()
 {
     if(initiated) return true;
@@ -71,31 +210,30 @@ bool CRewards::Init()
             }
 
             if(ok) { // Create and/or open the database
-                // the wallet sometimes restarts
-                // and the restart starts by spawnning a new wallet instance
-                // before the current instance closes
-                // so let's try to open it several times before giving up
-                for (auto attempt = 1; attempt <= DB_OPEN_ATTEMPTS; attempt++) { 
-                    oss << "Opening database: " << filename << std::endl;
-                    auto rc = sqlite3_open(filename.c_str(), &db);
-
-                    if (rc) { // NOK
-                        if(attempt < DB_OPEN_ATTEMPTS) {
-                            MilliSleep(DB_OPEN_WAITING_TIME);
-                        } else {
-                            oss << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
-                            ok = false;
-                            break; // giving up
-                        }
-                    } else {
-                        break; // all good
-                    }
+                oss << "Opening database: " << filename << std::endl;
+                auto rc = sqlite3_open(filename.c_str(), &db);
+                if (rc) {
+                    oss << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
+                    ok = false;
+                } else {
+                    // the wallet sometimes restarts and the new instance
+                    // starts before the current one closes: only wait when
+                    // the file is actually locked
+                    sqlite3_busy_timeout(db, DB_BUSY_TIMEOUT);
+                }
+            }
+
+            if(ok) { // Write-ahead log: commits don't rewrite the file, a crash keeps the last one
+                auto rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL", NULL, NULL, NULL);
+                if (rc != SQLITE_OK) {
+                    oss << "SQL error PRAGMA journal_mode: " << sqlite3_errmsg(db) << std::endl;
+                    ok = false;
                 }
             }
 
             if(ok) { // database is open and working
                 // Create the rewards table if not exists
-                const auto create_table_query = "CREATE TABLE IF NOT EXISTS rewards (height INT PRIMARY KEY, amount INTEGER)";
+                const auto create_table_query = "CREATE TABLE IF NOT EXISTS rewards (height INT PRIMARY KEY, amount INTEGER, hash TEXT)";
                 auto rc = sqlite3_exec(db, create_table_query, NULL, NULL, NULL);
 
                 if (rc != SQLITE_OK) {
@@ -104,8 +242,20 @@ bool CRewards::Init()
                 }
             }
 
+            if(ok) { // Databases from before the epoch block hash was kept
+                sqlite3_stmt* stmt = nullptr;
+                if (sqlite3_prepare_v2(db, "SELECT hash FROM rewards LIMIT 0", -1, &stmt, nullptr) != SQLITE_OK) {
+                    auto rc = sqlite3_exec(db, "ALTER TABLE rewards ADD COLUMN hash TEXT", NULL, NULL, NULL);
+                    if (rc != SQLITE_OK) {
+                        oss << "SQL error ALTER TABLE: " << sqlite3_errmsg(db) << std::endl;
+                        ok = false;
+                    }
+                }
+                sqlite3_finalize(stmt);
+            }
+
             if(ok) { // Create insert statement
-                const std::string insertSql = "INSERT OR REPLACE INTO rewards (height, amount) VALUES (?, ?)";
+                const std::string insertSql = "INSERT OR REPLACE INTO rewards (height, amount, hash) VALUES (?, ?, ?)";
                 auto rc = sqlite3_prepare_v2(db, insertSql.c_str(), insertSql.length(), &insertStmt, nullptr);
                 if (rc != SQLITE_OK) {
                     oss << "SQL error INSERT OR REPLACE: " << sqlite3_errmsg(db) << std::endl;
@@ -122,18 +272,45 @@ bool CRewards::Init()
                 }
             }
 
-            if(ok) { // Loads the database into the in-memory map
-                const char* sql = "SELECT height, amount FROM rewards";
-                auto rc = sqlite3_exec(db, sql, [](void* data, int argc, char** argv, char** /* azColName */) -> int {
-                    int height = std::stoi(argv[0]);
-                    CAmount amount = std::stoll(argv[1]);
-                    mDynamicRewards[height] = amount;
-                    return 0;
-                }, nullptr, nullptr);
+            std::map<int, CAmount> mRewards;
+            std::vector<RewardsWrite> vWrites;
+
+            if(ok) { // Loads the database, checking it against the chain tip
+                // The file lags the chain by whatever the writer had queued,
+                // and the chainstate by whatever it hadn't flushed, when the
+                // node stopped: entries past the tip or computed on a block
+                // that is no longer active are dropped, the ones still under
+                // the tip are filled back from the blocks below.
+                const auto nCurrentHeight = chainActive.Height();
+                auto nEraseHeight = std::numeric_limits<int>::max();
+                auto nStale = 0;
+
+                sqlite3_stmt* stmt = nullptr;
+                auto rc = sqlite3_prepare_v2(db, "SELECT height, amount, hash FROM rewards", -1, &stmt, nullptr);
+                while (rc == SQLITE_OK && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                    const auto height = sqlite3_column_int(stmt, 0);
+                    const auto amount = static_cast<CAmount>(sqlite3_column_int64(stmt, 1));
+                    const auto hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+
+                    if (height > nCurrentHeight ||
+                        (hash && uint256S(hash) != chainActive[height]->GetBlockHash())) {
+                        nEraseHeight = std::min(nEraseHeight, height);
+                        nStale++;
+                        continue;
+                    }
+                    mRewards[height] = amount;
+                }
+                if (rc == SQLITE_DONE) rc = SQLITE_OK;
+                sqlite3_finalize(stmt);
 
                 if (rc != SQLITE_OK) {
                     oss << "SQL error SELECT: " << sqlite3_errmsg(db) << std::endl;
                     ok = false;
+                } else if (nStale > 0) {
+                    oss << "Dropped " << nStale << " entries not on the active chain" << std::endl;
+                    // the ones under the tip are overwritten by the gap filling
+                    mRewards.erase(mRewards.lower_bound(nEraseHeight), mRewards.end());
+                    vWrites.push_back({nEraseHeight, 0, uint256(), true});
                 }
             }
 
@@ -144,53 +321,42 @@ bool CRewards::Init()
 
                 for(
                     int nEpochHeight = GetDynamicRewardsEpochHeight(nFeatureStartHeight) + nRewardAdjustmentInterval; 
-                    nEpochHeight <= nCurrentHeight; 
+                    nEpochHeight < nCurrentHeight; 
                     nEpochHeight += nRewardAdjustmentInterval
                 ) {
-                    if (mDynamicRewards.find(nEpochHeight) == mDynamicRewards.end()) { // missing entry
-                        const auto& pIndex = chainActive[nEpochHeight + 1];            // gets the first block index of that epoch
-
-                        CBlock block;
-                        if (ReadBlockFromDisk(block, pIndex)) {
-                            const auto& tx = block.vtx[block.IsProofOfWork() ? 0 : 1];
-
-                            CAmount nSubsidy = 0;
-
-                            CBlock inBlock;
-                            for (const CTxIn& in : tx.vin) {
-                                const auto& outpoint = in.prevout;
-
-                                CTransaction tx; uint256 hash;
-                                if(GetTransaction(outpoint.hash, tx, hash, true)) {
-                                    nSubsidy -= tx.vout[outpoint.n].nValue;
-                                }
-                            }
-
-                            nSubsidy += tx.GetValueOut();
-
-                            mDynamicRewards[nEpochHeight] = nSubsidy;
-
-                            sqlite3_bind_int(insertStmt, 1, nEpochHeight); // on the file database
-                            sqlite3_bind_int64(insertStmt, 2, nSubsidy);
-                            auto rc = sqlite3_step(insertStmt);
-                            if (rc != SQLITE_DONE) {
-                                oss << "SQL error INSERT OR REPLACE: " << sqlite3_errmsg(db) << std::endl;
-                                ok = false;
-                            }
-                            sqlite3_reset(insertStmt);
+                    if (mRewards.find(nEpochHeight) == mRewards.end()) { // missing entry
+                        CAmount nSubsidy = 0;
+                        // gets the first block index of that epoch
+                        if (ReadEpochReward(chainActive[nEpochHeight + 1], nSubsidy)) {
+                            mRewards[nEpochHeight] = nSubsidy;
+                            vWrites.push_back({nEpochHeight, nSubsidy, chainActive[nEpochHeight]->GetBlockHash(), false});
                         }
                     }
                 }
             }
 
-            if(ok && mDynamicRewards.size() > 0) { // Printing the map
-                oss << "Dynamic Rewards:" << std::endl;
+            if(ok) { // Publish the table and start writing behind the block connection path
+                PublishRewardsTable(RewardsTable(mRewards.begin(), mRewards.end()));
+                if (!WriteRewards(vWrites)) {
+                    oss << "Failed to write the filled entries" << std::endl;
+                    ok = false;
+                }
+            }
 
-                // Copy elements to std::map, which is ordered by key
-                std::map<int, CAmount> orderedRewards(mDynamicRewards.begin(), mDynamicRewards.end());
+            if(ok) {
+                {
+                    std::lock_guard<std::mutex> lock(g_write_mutex);
+                    g_write_stop = false;
+                    g_write_running = true;
+                    g_write_failed = false;
+                }
+                g_writer = std::thread(&TraceThread<void (*)()>, "rewards", &RewardsWriterThread);
+            }
+
+            if(ok && mRewards.size() > 0) { // Printing the table
+                oss << "Dynamic Rewards:" << std::endl;
 
-                // Iterate the ordered map
-                for (const auto& pair : orderedRewards) {
+                for (const auto& pair : mRewards) {
                     oss << "Height: " << pair.first << ", Amount: " << FormatMoney(pair.second) << std::endl;
                 }
             }
@@ -220,9 +386,37 @@ bool CRewards::Init()
 
 void CRewards::Shutdown()
 {
+    // Writes whatever is still queued before closing
+    if (g_writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(g_write_mutex);
+            g_write_stop = true;
+        }
+        g_write_cv.notify_one();
+        g_writer.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_write_mutex);
+        g_write_running = false;
+    }
+    g_written_cv.notify_all();
+
     if(insertStmt != nullptr) sqlite3_finalize(insertStmt);
     if(deleteStmt != nullptr) sqlite3_finalize(deleteStmt);
     if(db != nullptr) sqlite3_close(db);
+    insertStmt = nullptr;
+    deleteStmt = nullptr;
+    db = nullptr;
+    initiated = false;
+
+    PublishRewardsTable(RewardsTable());
+}
+
+bool CRewards::Flush()
+{
+    std::unique_lock<std::mutex> lock(g_write_mutex);
+    g_written_cv.wait(lock, [] { return !g_write_running || g_write_failed || (g_write_queue.empty() && !g_write_busy); });
+    return !g_write_failed;
 }
 
 int CRewards::GetDynamicRewardsEpoch(int nHeight)
@@ -285,15 +479,9 @@ bool CRewards::ConnectBlock(const CBlockIndex* pindex, CAmount nSubsidy)
                 Coin coin;
                 if (pcursor->GetKey(key) && pcursor->GetValue(coin) && !coin.IsSpent()) {
                     // ----------- burn address scanning -----------
-                    CTxDestination source;
-                    if (ExtractDestination(coin.out.scriptPubKey, source)) {
-                        const std::string addr = EncodeDestination(source);
-                        if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
-                            consensus.mBurnAddresses.at(addr) < nHeight
-                        ) {
-                            pcursor->Next(); // Skip
-                            continue;
-                        }
+                    if (IsBurnScript(coin.out.scriptPubKey, nHeight)) {
+                        pcursor->Next(); // Skip
+                        continue;
                     }
 
                     // ----------- masternode collaterals scanning ----------- 
@@ -382,24 +570,27 @@ bool CRewards::ConnectBlock(const CBlockIndex* pindex, CAmount nSubsidy)
             oss << "Adjustment at height " << nHeight << ": " << FormatMoney(nSubsidy) << " => " << FormatMoney(nNewSubsidy) << std::endl;
         }
 
+        auto pTable = GetRewardsTable();
+
         if ( // just in case, if there is no data get the reward value from the blocks of the epoch
             nHeight != nEpochHeight && 
-            mDynamicRewards.find(nEpochHeight) == mDynamicRewards.end()
+            FindReward(*pTable, nEpochHeight) == pTable->end()
         ) {
             nNewSubsidy = nSubsidy;
         }
 
         if(ok && nNewSubsidy > 0) { // store it
-            mDynamicRewards[nEpochHeight] = nNewSubsidy; // on the in-memory map
-
-            sqlite3_bind_int(insertStmt, 1, nEpochHeight); // on the file database
-            sqlite3_bind_int64(insertStmt, 2, nNewSubsidy);
-            auto rc = sqlite3_step(insertStmt);
-            if (rc != SQLITE_DONE) {
-                oss << "SQL error: " << sqlite3_errmsg(db) << std::endl;
-                ok = false;
+            RewardsTable table(*pTable); // on the in-memory table
+            auto it = LowerBound(table.begin(), table.end(), nEpochHeight);
+            if (it != table.end() && it->first == nEpochHeight) {
+                it->second = nNewSubsidy;
+            } else {
+                table.emplace(it, nEpochHeight, nNewSubsidy);
             }
-            sqlite3_reset(insertStmt);
+            PublishRewardsTable(std::move(table));
+
+            // on the file database, behind the block connection
+            QueueRewardsWrite({nEpochHeight, nNewSubsidy, pindex->GetAncestor(nEpochHeight)->GetBlockHash(), false});
         }
     }
 
@@ -415,31 +606,20 @@ bool CRewards::ConnectBlock(const CBlockIndex* pindex, CAmount nSubsidy)
     return ok;
 }
 
-bool CRewards::DisconnectBlock(const CBlockIndex* pindex)
+// Undoes the blocks from nHeight up, all of them with one delete
+bool CRewards::DisconnectBlocks(int nHeight)
 {
-    auto& consensus = Params().GetConsensus();
-    const auto nHeight = pindex->nHeight;
     std::ostringstream oss;
     auto ok = true;
     
     try
     {
-        if (consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_DYNAMIC_REWARDS) &&
-            IsDynamicRewardsEpochHeight(nHeight)
-        ) {
-            auto it = mDynamicRewards.find(nHeight);
-            if (it != mDynamicRewards.end()) {
-                // delete it
-                mDynamicRewards.erase(it); // on the in-memory map
-
-                sqlite3_bind_int(deleteStmt, 1, nHeight); // on the file database
-                auto rc = sqlite3_step(deleteStmt);
-                if (rc != SQLITE_DONE) {
-                    oss << "SQL error: " << sqlite3_errmsg(db) << std::endl;
-                    ok = false;
-                }
-                sqlite3_reset(deleteStmt);
-            }
+        auto pTable = GetRewardsTable();
+        auto it = LowerBound(pTable->begin(), pTable->end(), nHeight);
+
+        if (it != pTable->end()) {
+            PublishRewardsTable(RewardsTable(pTable->begin(), it)); // on the in-memory table
+            QueueRewardsWrite({nHeight, 0, uint256(), true}); // on the file database, behind
         }
     } 
     catch(const std::exception& e)
@@ -559,8 +739,9 @@ CAmount CRewards::GetBlockValue(int nHeight)
 
         // find and return the dynamic reward
         const auto nEpochHeight = GetDynamicRewardsEpochHeight(nHeight);
-        auto it = mDynamicRewards.find(nEpochHeight);
-        if (it != mDynamicRewards.end()) {
+        const auto pTable = GetRewardsTable();
+        auto it = FindReward(*pTable, nEpochHeight);
+        if (it != pTable->end()) {
             return std::min(nSubsidy, it->second);
         }
     }
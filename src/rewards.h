@@ -39,16 +39,18 @@ class CRewards
 private:
     static const int64_t    TOT_SPLY_TRGT_EMISSION  = 50000;    // 5% total supply
     static const int64_t    CIRC_SPLY_TRGT_EMISSION = 100000;   // 10% circulating supply
-    static const int        DB_OPEN_ATTEMPTS        =     3;    // number of attempts
-    static const int        DB_OPEN_WAITING_TIME    = 10000;    // ms
+    static const int        DB_BUSY_TIMEOUT         = 30000;    // ms, waiting on a locked database
 public:
     static bool Init();
     static void Shutdown();
+    /** Wait until every queued change is committed to the file database,
+     *  false if one of them failed. The chainstate is only flushed after. */
+    static bool Flush();
     static int GetDynamicRewardsEpoch(int nHeight);
     static int GetDynamicRewardsEpochHeight(int nHeight);
     static bool IsDynamicRewardsEpochHeight(int nHeight);
     static bool ConnectBlock(const CBlockIndex* pindex, CAmount nSubsidy);
-    static bool DisconnectBlock(const CBlockIndex* pindex);
+    static bool DisconnectBlocks(int nHeight);
     static CAmount GetBlockValue(int nHeight);
 };
 
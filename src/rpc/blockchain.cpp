@@ -116,7 +116,8 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
     UniValue txs(UniValue::VARR);
-    for (const CTransaction& tx : block.vtx) {
+    for (const CTransactionRef& ptx : block.vtx) {
+        const CTransaction& tx = *ptx;
         if (txDetails) {
             UniValue objTx(UniValue::VOBJ);
             TxToJSON(tx, UINT256_ZERO, objTx);
@@ -169,8 +170,9 @@ UniValue getblockcount(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + HelpExampleRpc("getblockcount", ""));
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    // Served from the published tip snapshot, no cs_main needed
+    std::shared_ptr<const CChainTipSnapshot> tip = GetChainTipSnapshot();
+    return tip ? tip->nHeight : -1;
 }
 
 UniValue getbestblockhash(const JSONRPCRequest& request)
@@ -186,8 +188,11 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
             "\nExamples\n" +
             HelpExampleCli("getbestblockhash", "") + HelpExampleRpc("getbestblockhash", ""));
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    // Served from the published tip snapshot, no cs_main needed
+    std::shared_ptr<const CChainTipSnapshot> tip = GetChainTipSnapshot();
+    if (!tip)
+        throw JSONRPCError(RPC_IN_WARMUP, "Block index not loaded");
+    return tip->hash.GetHex();
 }
 
 void RPCNotifyBlockChange(bool fInitialDownload, const CBlockIndex* pindex)
@@ -511,8 +516,6 @@ UniValue getblock(const JSONRPCRequest& request)
             HelpExampleCli("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\"") +
             HelpExampleRpc("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\""));
 
-    LOCK(cs_main);
-
     std::string strHash = request.params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -520,12 +523,20 @@ UniValue getblock(const JSONRPCRequest& request)
     if (request.params.size() > 1)
         fVerbose = request.params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    CBlockIndex* pblockindex = nullptr;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = it->second;
+        if (!(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+    }
 
+    // Block index entries are never freed while running and the block data
+    // position is immutable once stored, so read from disk without cs_main.
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
     if (!ReadBlockFromDisk(block, pblockindex))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
@@ -536,6 +547,7 @@ UniValue getblock(const JSONRPCRequest& request)
         return strHex;
     }
 
+    LOCK(cs_main);
     return blockToJSON(block, pblockindex);
 }
 
@@ -624,7 +636,6 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
 //! Calculate statistics about the unspent transaction output set
 static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
 {
-    const Consensus::Params& consensus = Params().GetConsensus();
     std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
@@ -642,15 +653,9 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
         Coin coin;
         if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
             // ----------- burn address scanning -----------
-            CTxDestination source;
-            if (ExtractDestination(coin.out.scriptPubKey, source)) {
-                const std::string addr = EncodeDestination(source);
-                if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
-                    consensus.mBurnAddresses.at(addr) < stats.nHeight)
-                {
-                    pcursor->Next();
-                    continue;
-                }
+            if (IsBurnScript(coin.out.scriptPubKey, stats.nHeight)) {
+                pcursor->Next();
+                continue;
             }
             if (!outputs.empty() && key.hash != prevkey) {
                 ApplyStats(stats, ss, prevkey, outputs);
@@ -748,6 +753,116 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getdbstats ( \"name\" )\n"
+            "\nReturns LevelDB statistics for the open databases (chainstate, blockindex, sporks).\n"
+
+            "\nArguments:\n"
+            "1. \"name\"       (string, optional) Only report this database\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {\n"
+            "    \"options\": {                 (object) Tuning the database was opened with\n"
+            "      \"block_cache\": n,          (numeric) Block cache size in bytes\n"
+            "      \"write_buffer\": n,         (numeric) Write buffer size in bytes\n"
+            "      \"max_file_size\": n,        (numeric) Table file size in bytes\n"
+            "      \"bloom_bits\": n,           (numeric) Bloom filter bits per key\n"
+            "      \"max_open_files\": n        (numeric) Table files kept open\n"
+            "    },\n"
+            "    \"disk_size\": n,              (numeric) Approximate size on disk in bytes\n"
+            "    \"memory_usage\": n,           (numeric) Approximate memtable and block cache usage in bytes\n"
+            "    \"batches_written\": n,        (numeric) Batches written since startup\n"
+            "    \"bytes_written\": n,          (numeric) Approximate bytes written in batches since startup\n"
+            "    \"batch_write\": {...},        (object) Batch write latency histogram\n"
+            "    \"compacting\": true|false,    (boolean) Whether a compactdb run is in progress\n"
+            "    \"stats\": \"...\"              (string) LevelDB per-level statistics (leveldb.stats)\n"
+            "  }, ...\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getdbstats", "") + HelpExampleCli("getdbstats", "\"chainstate\"") + HelpExampleRpc("getdbstats", "\"chainstate\""));
+
+    const std::string strFilter = request.params.size() > 0 ? request.params[0].get_str() : "";
+
+    UniValue ret(UniValue::VOBJ);
+    ForEachDBWrapper([&ret, &strFilter](CDBWrapper& db) {
+        if (!strFilter.empty() && db.GetName() != strFilter)
+            return;
+        const CDBOptions& opts = db.GetOptions();
+        UniValue options(UniValue::VOBJ);
+        options.push_back(Pair("block_cache", (uint64_t)opts.nBlockCacheSize));
+        options.push_back(Pair("write_buffer", (uint64_t)opts.nWriteBufferSize));
+        options.push_back(Pair("max_file_size", (uint64_t)opts.nMaxFileSize));
+        options.push_back(Pair("bloom_bits", opts.nBloomBits));
+        options.push_back(Pair("max_open_files", opts.nMaxOpenFiles));
+
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("options", options));
+        obj.push_back(Pair("disk_size", db.EstimateTotalSize()));
+        obj.push_back(Pair("memory_usage", (uint64_t)db.DynamicMemoryUsage()));
+        obj.push_back(Pair("batches_written", db.GetBatchesWritten()));
+        obj.push_back(Pair("bytes_written", db.GetBytesWritten()));
+        obj.push_back(Pair("batch_write", HistogramToJSON(db.GetBatchWriteTime())));
+        obj.push_back(Pair("compacting", db.IsCompacting()));
+        obj.push_back(Pair("stats", db.GetProperty("leveldb.stats")));
+        ret.push_back(Pair(db.GetName(), obj));
+    });
+    if (!strFilter.empty() && ret.empty())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown database: " + strFilter);
+    return ret;
+}
+
+UniValue compactdb(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "compactdb \"name\" ( background )\n"
+            "\nCompact the whole key space of a LevelDB database, dropping overwritten and deleted entries.\n"
+            "This can take a long time on the chainstate, the node keeps working meanwhile.\n"
+
+            "\nArguments:\n"
+            "1. \"name\"       (string, required) The database, as listed by getdbstats\n"
+            "2. background     (boolean, optional, default=true) Return immediately and compact on a separate thread\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": \"name\",        (string) The database\n"
+            "  \"background\": true|false, (boolean) Whether the compaction is running in the background\n"
+            "  \"disk_size\": n           (numeric) Approximate size on disk in bytes after a foreground compaction, or when it was started\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("compactdb", "\"chainstate\"") + HelpExampleRpc("compactdb", "\"chainstate\", false"));
+
+    const std::string strName = request.params[0].get_str();
+    const bool fBackground = request.params.size() > 1 ? request.params[1].get_bool() : true;
+
+    bool fFound = false;
+    bool fStarted = false;
+    uint64_t nDiskSize = 0;
+    ForEachDBWrapper([&](CDBWrapper& db) {
+        if (db.GetName() != strName)
+            return;
+        fFound = true;
+        fStarted = db.Compact(fBackground);
+        nDiskSize = db.EstimateTotalSize();
+    });
+    if (!fFound)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown database: " + strName);
+    if (!fStarted)
+        throw JSONRPCError(RPC_MISC_ERROR, "A compaction of " + strName + " is already running");
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("name", strName));
+    ret.push_back(Pair("background", fBackground));
+    ret.push_back(Pair("disk_size", nDiskSize));
+    return ret;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -1384,7 +1499,8 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
         nTxCount = block.IsProofOfStake() ? nTxCount + ntx - 2 : nTxCount + ntx - 1;
 
         // loop through each tx in block and save size and fee
-        for (const CTransaction& tx : block.vtx) {
+        for (const CTransactionRef& ptx : block.vtx) {
+            const CTransaction& tx = *ptx;
             if (tx.IsCoinBase() || tx.IsCoinStake())
                 continue;
 
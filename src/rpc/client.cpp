@@ -58,6 +58,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"listreceivedbylabel", 0},
         {"listreceivedbylabel", 1},
         {"listreceivedbylabel", 2},
+        {"getrewardhistory", 1},
+        {"getrewardhistory", 2},
         {"getbalance", 1},
         {"getbalance", 2},
         {"getbalance", 3},
@@ -96,6 +98,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"listunspent", 3},
         {"logging", 0},
         {"logging", 1},
+        {"getlockstats", 0},
+        {"getlockstats", 1},
+        {"getlockstats", 2},
         {"getblock", 1},
         {"getblockheader", 1},
         {"gettransaction", 1},
@@ -122,6 +127,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"verifychain", 1},
         {"keypoolrefill", 0},
         {"getrawmempool", 0},
+        {"getrpcinfo", 0},
+        {"compactdb", 1},
         {"estimatefee", 0},
         {"estimatesmartfee", 0},
         {"prioritisetransaction", 1},
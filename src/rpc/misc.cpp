@@ -678,6 +678,95 @@ UniValue logging(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue LockHistogramToJSON(const uint64_t* vHist)
+{
+    UniValue result(UniValue::VOBJ);
+    for (int i = 0; i < LOCK_PROFILE_BUCKETS; i++) {
+        const int64_t nLimit = LockProfileBucketLimit(i);
+        result.pushKV(nLimit ? strprintf("<%dus", nLimit / 1000) : strprintf(">=%dus", LockProfileBucketLimit(i - 1) / 1000), vHist[i]);
+    }
+    return result;
+}
+
+UniValue getlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 3) {
+        throw std::runtime_error(
+            "getlockstats ( count reset enable )\n"
+            "Returns the most contended lock sites recorded by the lock profiler.\n"
+            "Profiling is off unless the node was started with -lockprofile or it is turned on here.\n"
+            "Hold times include time spent waiting on a condition variable with the lock.\n"
+            "\nArguments:\n"
+            "1. count     (numeric, optional, default=20) Number of sites to return, 0 for all\n"
+            "2. reset     (boolean, optional, default=false) Clear the counters after reading them\n"
+            "3. enable    (boolean, optional) Turn lock profiling on or off\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\": true|false,       (boolean) whether lock profiling is on\n"
+            "  \"since\": ttt,                (numeric) time the counters were last reset\n"
+            "  \"sites\": [                   (array) sites by total wait time, then total hold time\n"
+            "    {\n"
+            "      \"site\": \"file:line\",     (string) where the lock is taken\n"
+            "      \"lock\": \"name\",          (string) the lock\n"
+            "      \"locks\": n,              (numeric) times it was taken\n"
+            "      \"contended\": n,          (numeric) times it had to wait\n"
+            "      \"wait_us\": n,            (numeric) total wait in microseconds\n"
+            "      \"max_wait_us\": n,        (numeric) longest wait in microseconds\n"
+            "      \"hold_us\": n,            (numeric) total hold time in microseconds\n"
+            "      \"max_hold_us\": n,        (numeric) longest hold in microseconds\n"
+            "      \"wait_histogram\": {...}, (object) waits per bucket, including the uncontended ones\n"
+            "      \"hold_histogram\": {...}  (object) holds per bucket\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "10 true")
+            + HelpExampleRpc("getlockstats", "0, false, true"));
+    }
+
+    const int nCount = request.params.size() > 0 ? request.params[0].get_int() : 20;
+    if (nCount < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count must not be negative");
+    const bool fReset = request.params.size() > 1 && request.params[1].get_bool();
+    if (request.params.size() > 2)
+        g_lock_profiling = request.params[2].get_bool();
+
+    const int64_t nSince = GetLockProfileResetTime();
+    std::vector<LockSiteProfile> vProfile = GetLockProfile();
+    if (fReset)
+        ResetLockProfile();
+    std::sort(vProfile.begin(), vProfile.end(), [](const LockSiteProfile& a, const LockSiteProfile& b) {
+        if (a.nWaitNanos != b.nWaitNanos)
+            return a.nWaitNanos > b.nWaitNanos;
+        return a.nHoldNanos > b.nHoldNanos;
+    });
+    if (nCount > 0 && (size_t)nCount < vProfile.size())
+        vProfile.resize(nCount);
+
+    UniValue sites(UniValue::VARR);
+    for (const LockSiteProfile& profile : vProfile) {
+        UniValue site(UniValue::VOBJ);
+        site.pushKV("site", strprintf("%s:%d", profile.strFile, profile.nLine));
+        site.pushKV("lock", profile.strName);
+        site.pushKV("locks", profile.nLocks);
+        site.pushKV("contended", profile.nContended);
+        site.pushKV("wait_us", profile.nWaitNanos / 1000);
+        site.pushKV("max_wait_us", profile.nMaxWaitNanos / 1000);
+        site.pushKV("hold_us", profile.nHoldNanos / 1000);
+        site.pushKV("max_hold_us", profile.nMaxHoldNanos / 1000);
+        site.pushKV("wait_histogram", LockHistogramToJSON(profile.vWaitHist));
+        site.pushKV("hold_histogram", LockHistogramToJSON(profile.vHoldHist));
+        sites.push_back(site);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("enabled", g_lock_profiling.load());
+    result.pushKV("since", nSince);
+    result.pushKV("sites", sites);
+    return result;
+}
+
 #ifdef ENABLE_WALLET
 UniValue getstakingstatus(const JSONRPCRequest& request)
 {
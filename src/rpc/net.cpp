@@ -136,6 +136,15 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "       \"addr\": n,             (numeric) The total bytes received aggregated by message type\n"
             "       ...\n"
             "    }\n"
+            "    \"sendqueue\": {            (json object) Outbound queues by message class (control, relay, bulk)\n"
+            "       \"control\": {\n"
+            "         \"msgs\": n,            (numeric) Messages waiting in the queue\n"
+            "         \"bytes\": n,           (numeric) Bytes waiting in the queue\n"
+            "         \"bytessent\": n        (numeric) Total bytes of this class handed to the socket\n"
+            "       },\n"
+            "       ...\n"
+            "    }\n"
+            "    \"sendthrottled\": true|false, (boolean) Whether bulk messages are held back by -maxpeeruploadrate\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -202,6 +211,17 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
         }
         obj.pushKV("bytesrecv_per_msg", recvPerMsgCmd);
 
+        UniValue sendQueue(UniValue::VOBJ);
+        for (int i = 0; i < SEND_CLASS_MAX; i++) {
+            UniValue queue(UniValue::VOBJ);
+            queue.pushKV("msgs", (uint64_t)stats.nSendQueueMsgs[i]);
+            queue.pushKV("bytes", (uint64_t)stats.nSendQueueBytes[i]);
+            queue.pushKV("bytessent", stats.nSendClassBytes[i]);
+            sendQueue.pushKV(GetSendClassName((SendClass)i), queue);
+        }
+        obj.pushKV("sendqueue", sendQueue);
+        obj.pushKV("sendthrottled", stats.fSendThrottled);
+
         ret.push_back(obj);
     }
 
@@ -395,6 +415,18 @@ static UniValue GetNetworksInfo()
     return networks;
 }
 
+static UniValue BufferPoolStatsToJSON(const BufferPoolStats& stats)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("allocated", stats.nAllocated));
+    obj.push_back(Pair("reused", stats.nReused));
+    obj.push_back(Pair("returned", stats.nReturned));
+    obj.push_back(Pair("discarded", stats.nDiscarded));
+    obj.push_back(Pair("pooled", (uint64_t)stats.nPooled));
+    obj.push_back(Pair("pooled_bytes", (uint64_t)stats.nPooledBytes));
+    return obj;
+}
+
 UniValue getnetworkinfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -410,6 +442,27 @@ UniValue getnetworkinfo(const JSONRPCRequest& request)
             "  \"localservices\": \"xxxxxxxxxxxxxxxx\", (string) the services we offer to the network\n"
             "  \"timeoffset\": xxxxx,                   (numeric) the time offset\n"
             "  \"connections\": xxxxx,                  (numeric) the number of connections\n"
+            "  \"socketevents\": {                      (object) socket handler event loop\n"
+            "    \"mode\": \"xxx\",                     (string) backend in use (select or epoll, see -socketevents)\n"
+            "    \"wakeups\": xxxxx,                    (numeric) rounds woken up by socket readiness\n"
+            "    \"timeouts\": xxxxx,                   (numeric) rounds that timed out without readiness\n"
+            "    \"wakeups_per_sec\": x.xx,             (numeric) wakeup rate over the last 10 second window\n"
+            "    \"loop\": {...}                        (object) time spent servicing sockets per round, in microseconds\n"
+            "  },\n"
+            "  \"buffers\": {                           (object) message buffer pools and copy avoidance\n"
+            "    \"recv\": {                            (object) pool for received payloads (same fields for \"send\")\n"
+            "      \"allocated\": xxxxx,                (numeric) buffers that had to be freshly allocated\n"
+            "      \"reused\": xxxxx,                   (numeric) buffers taken from the pool\n"
+            "      \"returned\": xxxxx,                 (numeric) buffers given back and kept\n"
+            "      \"discarded\": xxxxx,                (numeric) buffers given back but freed\n"
+            "      \"pooled\": xxxxx,                   (numeric) buffers currently pooled\n"
+            "      \"pooled_bytes\": xxxxx              (numeric) capacity of the pooled buffers\n"
+            "    },\n"
+            "    \"send\": {...},\n"
+            "    \"recv_direct_bytes\": xxxxx,          (numeric) payload bytes received without an intermediate copy\n"
+            "    \"send_calls\": xxxxx,                 (numeric) socket send calls that wrote data\n"
+            "    \"send_buffers\": xxxxx                (numeric) queued buffers completed by those calls\n"
+            "  },\n"
             "  \"networks\": [                          (array) information per network\n"
             "  {\n"
             "    \"name\": \"xxx\",                     (string) network (ipv4, ipv6 or onion)\n"
@@ -443,6 +496,25 @@ UniValue getnetworkinfo(const JSONRPCRequest& request)
     obj.push_back(Pair("timeoffset", GetTimeOffset()));
     if(g_connman)
         obj.push_back(Pair("connections",   (int)g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL)));
+    if (g_connman) {
+        const CConnman::SocketEventsStats stats = g_connman->GetSocketEventsStats();
+        UniValue socketEvents(UniValue::VOBJ);
+        socketEvents.push_back(Pair("mode", stats.strMode));
+        socketEvents.push_back(Pair("wakeups", stats.nWakeups));
+        socketEvents.push_back(Pair("timeouts", stats.nTimeouts));
+        socketEvents.push_back(Pair("wakeups_per_sec", stats.dWakeupsPerSec));
+        socketEvents.push_back(Pair("loop", HistogramToJSON(g_connman->GetSocketLoopTime())));
+        obj.push_back(Pair("socketevents", socketEvents));
+
+        const CConnman::NetBufferStats bufStats = g_connman->GetNetBufferStats();
+        UniValue buffers(UniValue::VOBJ);
+        buffers.push_back(Pair("recv", BufferPoolStatsToJSON(bufStats.recvPool)));
+        buffers.push_back(Pair("send", BufferPoolStatsToJSON(bufStats.sendPool)));
+        buffers.push_back(Pair("recv_direct_bytes", bufStats.nRecvDirectBytes));
+        buffers.push_back(Pair("send_calls", bufStats.nSendCalls));
+        buffers.push_back(Pair("send_buffers", bufStats.nSendBuffers));
+        obj.push_back(Pair("buffers", buffers));
+    }
     obj.push_back(Pair("networks", GetNetworksInfo()));
     obj.push_back(Pair("relayfee", ValueFromAmount(::minRelayTxFee.GetFeePerK())));
     UniValue localAddresses(UniValue::VARR);
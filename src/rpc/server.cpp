@@ -16,6 +16,7 @@
 #include "sync.h"
 #include "guiinterface.h"
 #include "util.h"
+#include "util/histogram.h"
 #include "utilstrencodings.h"
 
 #ifdef ENABLE_WALLET
@@ -45,6 +46,51 @@ static RPCTimerInterface* timerInterface = NULL;
  * @note Can be changed to std::unique_ptr when C++11 */
 static std::map<std::string, boost::shared_ptr<RPCTimerBase> > deadlineTimers;
 
+/** Per-method execution statistics, reported by getrpcinfo */
+struct CRPCMethodStats
+{
+    CLatencyHistogram execTime;
+    CLatencyHistogram queueWait;
+    std::atomic<uint64_t> nErrors{0};
+    std::atomic<int> nActive{0};
+};
+static Mutex cs_rpcStats;
+static std::map<std::string, std::unique_ptr<CRPCMethodStats> > mapRPCStats;
+static std::atomic<int> nRPCActive{0};
+
+static CRPCMethodStats& GetRPCMethodStats(const std::string& strMethod)
+{
+    LOCK(cs_rpcStats);
+    std::unique_ptr<CRPCMethodStats>& stats = mapRPCStats[strMethod];
+    if (!stats) stats.reset(new CRPCMethodStats());
+    return *stats;
+}
+
+/** RAII object recording execution time and concurrency of one RPC call */
+class CRPCCommandTimer
+{
+public:
+    CRPCCommandTimer(CRPCMethodStats& statsIn, int64_t nQueueWaitMicros) : stats(statsIn), nStart(GetTimeMicros()), fFailed(true)
+    {
+        stats.queueWait.Add(nQueueWaitMicros);
+        stats.nActive++;
+        nRPCActive++;
+    }
+    ~CRPCCommandTimer()
+    {
+        stats.execTime.Add(GetTimeMicros() - nStart);
+        if (fFailed) stats.nErrors++;
+        stats.nActive--;
+        nRPCActive--;
+    }
+    void Succeeded() { fFailed = false; }
+
+private:
+    CRPCMethodStats& stats;
+    int64_t nStart;
+    bool fFailed;
+};
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -261,6 +307,73 @@ UniValue help(const JSONRPCRequest& jsonRequest)
 }
 
 
+UniValue HistogramToJSON(const CLatencyHistogram& hist)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("count", hist.Count()));
+    obj.push_back(Pair("mean_us", hist.MeanMicros()));
+    obj.push_back(Pair("p50_us", hist.Percentile(50)));
+    obj.push_back(Pair("p95_us", hist.Percentile(95)));
+    obj.push_back(Pair("p99_us", hist.Percentile(99)));
+    obj.push_back(Pair("max_us", hist.MaxMicros()));
+    UniValue buckets(UniValue::VOBJ);
+    for (const auto& b : hist.GetBuckets())
+        buckets.push_back(Pair(strprintf("%d", b.first), b.second));
+    obj.push_back(Pair("buckets", buckets));
+    return obj;
+}
+
+UniValue getrpcinfo(const JSONRPCRequest& jsonRequest)
+{
+    if (jsonRequest.fHelp || jsonRequest.params.size() > 1)
+        throw std::runtime_error(
+            "getrpcinfo ( reset )\n"
+            "\nReturns details about the RPC server: active calls and per-method\n"
+            "execution time and work queue wait histograms (in microseconds).\n"
+            "\nArguments:\n"
+            "1. reset         (boolean, optional, default=false) Clear the collected statistics after reporting them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"active_commands\": n,        (numeric) Number of RPC calls currently executing\n"
+            "  \"methods\": {\n"
+            "    \"method\": {\n"
+            "      \"active\": n,             (numeric) Calls of this method currently executing\n"
+            "      \"errors\": n,             (numeric) Calls that returned an error\n"
+            "      \"exec\": {...},           (object) Execution time histogram\n"
+            "      \"queue_wait\": {...}      (object) Time spent waiting for a worker thread\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrpcinfo", "") + HelpExampleRpc("getrpcinfo", ""));
+
+    const bool fReset = jsonRequest.params.size() > 0 && jsonRequest.params[0].get_bool();
+
+    UniValue methods(UniValue::VOBJ);
+    {
+        LOCK(cs_rpcStats);
+        for (const auto& entry : mapRPCStats) {
+            CRPCMethodStats& stats = *entry.second;
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("active", stats.nActive.load()));
+            obj.push_back(Pair("errors", stats.nErrors.load()));
+            obj.push_back(Pair("exec", HistogramToJSON(stats.execTime)));
+            obj.push_back(Pair("queue_wait", HistogramToJSON(stats.queueWait)));
+            methods.push_back(Pair(entry.first, obj));
+            if (fReset) {
+                stats.execTime.Reset();
+                stats.queueWait.Reset();
+                stats.nErrors = 0;
+            }
+        }
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("active_commands", nRPCActive.load()));
+    ret.push_back(Pair("methods", methods));
+    return ret;
+}
+
 UniValue stop(const JSONRPCRequest& jsonRequest)
 {
     // Accept the deprecated and ignored 'detach' boolean argument
@@ -284,6 +397,7 @@ static const CRPCCommand vRPCCommands[] =
         //  --------------------- ------------------------  -----------------------  ----------
         /* Overall control/query calls */
         {"control", "getinfo", &getinfo, true }, /* uses wallet if enabled */
+        {"control", "getrpcinfo", &getrpcinfo, true },
         {"control", "help", &help, true },
         {"control", "stop", &stop, true },
 
@@ -316,6 +430,8 @@ static const CRPCCommand vRPCCommands[] =
         {"blockchain", "getrawmempool", &getrawmempool, true },
         {"blockchain", "gettxout", &gettxout, true },
         {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true },
+        {"blockchain", "getdbstats", &getdbstats, true },
+        {"blockchain", "compactdb", &compactdb, true },
         {"blockchain", "invalidateblock", &invalidateblock, true },
         {"blockchain", "reconsiderblock", &reconsiderblock, true },
         {"blockchain", "verifychain", &verifychain, true },
@@ -349,6 +465,7 @@ static const CRPCCommand vRPCCommands[] =
         /* Utility functions */
         {"util", "createmultisig", &createmultisig, true },
         {"util", "logging", &logging, true },
+        {"util", "getlockstats", &getlockstats, true },
         {"util", "validateaddress", &validateaddress, true }, /* uses wallet if enabled */
         {"util", "verifymessage", &verifymessage, true },
         {"util", "estimatefee", &estimatefee, true },
@@ -554,9 +671,18 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 
     g_rpcSignals.PreCommand(*pcmd);
 
+#ifdef ENABLE_WALLET
+    // make sure the wallet has caught up with everything validation did before this call
+    if (pcmd->category == "wallet")
+        EnsureWalletIsAvailable();
+#endif
+
+    CRPCCommandTimer timer(GetRPCMethodStats(pcmd->name), request.nQueueWaitMicros);
     try {
         // Execute
-        return pcmd->actor(request);
+        UniValue result = pcmd->actor(request);
+        timer.Succeeded();
+        return result;
     } catch (const std::exception& e) {
         throw JSONRPCError(RPC_MISC_ERROR, e.what());
     }
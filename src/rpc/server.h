@@ -30,6 +30,7 @@ namespace RPCServer
 }
 
 class CBlockIndex;
+class CLatencyHistogram;
 class CNetAddr;
 
 class JSONRPCRequest
@@ -41,8 +42,10 @@ public:
     bool fHelp;
     std::string URI;
     std::string authUser;
+    //! Time the request waited in the HTTP work queue, if dispatched through it
+    int64_t nQueueWaitMicros;
 
-    JSONRPCRequest() { id = NullUniValue; params = NullUniValue; fHelp = false; }
+    JSONRPCRequest() { id = NullUniValue; params = NullUniValue; fHelp = false; nQueueWaitMicros = 0; }
     void parse(const UniValue& valRequest);
 };
 
@@ -184,6 +187,7 @@ extern double GetDifficulty(const CBlockIndex* blockindex = NULL);
 extern std::string HelpRequiringPassphrase();
 extern std::string HelpExampleCli(std::string methodname, std::string args);
 extern std::string HelpExampleRpc(std::string methodname, std::string args);
+extern UniValue HistogramToJSON(const CLatencyHistogram& hist);
 
 extern void EnsureWalletIsUnlocked(bool fAllowAnonOnly = false);
 // Ensure the wallet's existence.
@@ -242,6 +246,8 @@ extern UniValue getblockheader(const JSONRPCRequest& request);
 extern UniValue getfeeinfo(const JSONRPCRequest& request);
 extern UniValue gettxoutsetinfo(const JSONRPCRequest& request);
 extern UniValue gettxout(const JSONRPCRequest& request);
+extern UniValue getdbstats(const JSONRPCRequest& request);
+extern UniValue compactdb(const JSONRPCRequest& request);
 extern UniValue verifychain(const JSONRPCRequest& request);
 extern UniValue getchaintips(const JSONRPCRequest& request);
 extern UniValue invalidateblock(const JSONRPCRequest& request);
@@ -269,6 +275,7 @@ extern UniValue mnping(const JSONRPCRequest& request);
 
 extern UniValue getinfo(const JSONRPCRequest& request); // in rpc/misc.cpp
 extern UniValue logging(const JSONRPCRequest& request);
+extern UniValue getlockstats(const JSONRPCRequest& request);
 extern UniValue mnsync(const JSONRPCRequest& request);
 extern UniValue spork(const JSONRPCRequest& request);
 extern UniValue validateaddress(const JSONRPCRequest& request);
@@ -12,18 +12,28 @@
 
 bool CPivStake::InitFromTxIn(const CTxIn& txin)
 {
-    // Find the previous transaction in database
+    // The stake is normally unspent in the UTXO set of the tip the block
+    // builds on: the coin has the value and the height of its origin, so
+    // nothing needs to be read from disk.
+    prevoutFrom = txin.prevout;
+    if (SetIndexFromCoins())
+        return true;
+
+    // Spent at the tip, e.g. checking a fork block during a reorg: find the
+    // previous transaction in database
     uint256 hashBlock;
     CTransaction txPrev;
     if (!GetTransaction(txin.prevout.hash, txPrev, hashBlock, true))
         return error("%s : INFO: read txPrev failed, tx id prev: %s", __func__, txin.prevout.hash.GetHex());
+    if (txin.prevout.n >= txPrev.vout.size())
+        return error("%s : prevout %s out of range", __func__, txin.prevout.ToString());
     SetPrevout(txPrev, txin.prevout.n);
 
     // Find the index of the block of the previous transaction
-    if (mapBlockIndex.count(hashBlock)) {
-        CBlockIndex* pindex = mapBlockIndex.at(hashBlock);
-        if (chainActive.Contains(pindex)) pindexFrom = pindex;
-    }
+    LOCK(cs_main);
+    BlockMap::const_iterator mi = mapBlockIndex.find(hashBlock);
+    if (mi != mapBlockIndex.end() && chainActive.Contains(mi->second))
+        pindexFrom = mi->second;
     // Check that the input is in the active chain
     if (!pindexFrom)
         return error("%s : Failed to find the block index for stake origin", __func__);
@@ -32,45 +42,48 @@ bool CPivStake::InitFromTxIn(const CTxIn& txin)
     return true;
 }
 
-bool CPivStake::SetPrevout(CTransaction txPrev, unsigned int n)
+bool CPivStake::SetIndexFromCoins()
 {
-    this->txFrom = txPrev;
-    this->nPosition = n;
+    LOCK(cs_main);
+    const Coin& coin = pcoinsTip->AccessCoin(prevoutFrom);
+    if (coin.IsSpent() || coin.nHeight > chainActive.Height())
+        return false;
+    outFrom = coin.out;
+    pindexFrom = chainActive[coin.nHeight];
     return true;
 }
 
-bool CPivStake::GetTxFrom(CTransaction& tx) const
+bool CPivStake::SetPrevout(const CTransaction& txPrev, unsigned int n)
 {
-    if (txFrom.IsNull())
-        return false;
-    tx = txFrom;
+    prevoutFrom = COutPoint(txPrev.GetHash(), n);
+    outFrom = txPrev.vout[n];
     return true;
 }
 
 bool CPivStake::GetTxOutFrom(CTxOut& out) const
 {
-    if (txFrom.IsNull() || nPosition >= txFrom.vout.size())
+    if (outFrom.IsNull())
         return false;
-    out = txFrom.vout[nPosition];
+    out = outFrom;
     return true;
 }
 
 bool CPivStake::CreateTxIn(CWallet* pwallet, CTxIn& txIn, uint256 hashTxOut)
 {
-    txIn = CTxIn(txFrom.GetHash(), nPosition);
+    txIn = CTxIn(prevoutFrom);
     return true;
 }
 
 CAmount CPivStake::GetValue() const
 {
-    return txFrom.vout[nPosition].nValue;
+    return outFrom.nValue;
 }
 
 bool CPivStake::CreateTxOuts(CWallet* pwallet, std::vector<CTxOut>& vout, CAmount nTotal, const bool onlyP2PK)
 {
     std::vector<valtype> vSolutions;
     txnouttype whichType;
-    CScript scriptPubKeyKernel = txFrom.vout[nPosition].scriptPubKey;
+    CScript scriptPubKeyKernel = outFrom.scriptPubKey;
     if (!Solver(scriptPubKeyKernel, whichType, vSolutions))
         return error("%s: failed to parse kernel", __func__);
 
@@ -119,26 +132,25 @@ CDataStream CPivStake::GetUniqueness() const
 {
     //The unique identifier for a FLS stake is the outpoint
     CDataStream ss(SER_NETWORK, 0);
-    ss << nPosition << txFrom.GetHash();
+    ss << prevoutFrom.n << prevoutFrom.hash;
     return ss;
 }
 
 //The block that the UTXO was added to the chain
 CBlockIndex* CPivStake::GetIndexFrom()
 {
-    if (pindexFrom)
+    if (pindexFrom || SetIndexFromCoins())
         return pindexFrom;
     uint256 hashBlock = UINT256_ZERO;
     CTransaction tx;
-    if (GetTransaction(txFrom.GetHash(), tx, hashBlock, true)) {
+    if (GetTransaction(prevoutFrom.hash, tx, hashBlock, true)) {
         // If the index is in the chain, then set it as the "index from"
-        if (mapBlockIndex.count(hashBlock)) {
-            CBlockIndex* pindex = mapBlockIndex.at(hashBlock);
-            if (chainActive.Contains(pindex))
-                pindexFrom = pindex;
-        }
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hashBlock);
+        if (mi != mapBlockIndex.end() && chainActive.Contains(mi->second))
+            pindexFrom = mi->second;
     } else {
-        LogPrintf("%s : failed to find tx %s\n", __func__, txFrom.GetHash().GetHex());
+        LogPrintf("%s : failed to find tx %s\n", __func__, prevoutFrom.hash.GetHex());
     }
 
     return pindexFrom;
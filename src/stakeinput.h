@@ -24,7 +24,6 @@ public:
     virtual bool InitFromTxIn(const CTxIn& txin) = 0;
     virtual CBlockIndex* GetIndexFrom() = 0;
     virtual bool CreateTxIn(CWallet* pwallet, CTxIn& txIn, uint256 hashTxOut = UINT256_ZERO) = 0;
-    virtual bool GetTxFrom(CTransaction& tx) const = 0;
     virtual bool GetTxOutFrom(CTxOut& out) const = 0;
     virtual CAmount GetValue() const = 0;
     virtual bool CreateTxOuts(CWallet* pwallet, std::vector<CTxOut>& vout, CAmount nTotal, const bool onlyP2PK) = 0;
@@ -36,17 +35,19 @@ public:
 class CPivStake : public CStakeInput
 {
 private:
-    CTransaction txFrom{CTransaction()};
-    unsigned int nPosition{0};
+    // Only the output is kept, not the whole transaction it comes from
+    COutPoint prevoutFrom;
+    CTxOut outFrom;
+
+    bool SetIndexFromCoins();
 
 public:
     CPivStake() {}
 
     bool InitFromTxIn(const CTxIn& txin) override;
-    bool SetPrevout(CTransaction txPrev, unsigned int n);
+    bool SetPrevout(const CTransaction& txPrev, unsigned int n);
 
     CBlockIndex* GetIndexFrom() override;
-    bool GetTxFrom(CTransaction& tx) const override;
     bool GetTxOutFrom(CTxOut& out) const override;
     CAmount GetValue() const override;
     CDataStream GetUniqueness() const override;
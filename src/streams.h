@@ -295,6 +295,13 @@ public:
         data.insert(data.end(), begin(), end());
         clear();
     }
+
+    /** Exchange the underlying buffer with another one, e.g. to recycle its allocation */
+    void swap_data(vector_type& other)
+    {
+        vch.swap(other);
+        nReadPos = 0;
+    }
 };
 
 /* Minimal stream for overwriting and/or appending to an existing byte vector
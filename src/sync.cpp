@@ -6,8 +6,11 @@
 
 #include "sync.h"
 
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 #include "util.h"
 #include "utilstrencodings.h"
@@ -26,6 +29,259 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<bool> g_lock_profiling{DEFAULT_LOCKPROFILE};
+
+struct LockSiteStats {
+    const char* pszName;
+    const char* pszFile;
+    int nLine;
+    //! ResetLockProfile() generation these counters belong to
+    std::atomic<uint32_t> nGeneration{0};
+    std::atomic<uint64_t> nLocks{0};
+    std::atomic<uint64_t> nContended{0};
+    std::atomic<uint64_t> nWaitNanos{0};
+    std::atomic<uint64_t> nHoldNanos{0};
+    std::atomic<uint64_t> nMaxWaitNanos{0};
+    std::atomic<uint64_t> nMaxHoldNanos{0};
+    std::atomic<uint64_t> vWaitHist[LOCK_PROFILE_BUCKETS];
+    std::atomic<uint64_t> vHoldHist[LOCK_PROFILE_BUCKETS];
+
+    LockSiteStats(const char* pszNameIn, const char* pszFileIn, int nLineIn) : pszName(pszNameIn), pszFile(pszFileIn), nLine(nLineIn)
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        nLocks = nContended = nWaitNanos = nHoldNanos = nMaxWaitNanos = nMaxHoldNanos = 0;
+        for (int i = 0; i < LOCK_PROFILE_BUCKETS; i++)
+            vWaitHist[i] = vHoldHist[i] = 0;
+    }
+};
+
+// Only the owning thread writes a site's counters, so they are updated with
+// a relaxed load and store rather than a locked read-modify-write; readers
+// on other threads may see a slightly stale value.
+static inline void ProfileAdd(std::atomic<uint64_t>& n, uint64_t nAdd)
+{
+    n.store(n.load(std::memory_order_relaxed) + nAdd, std::memory_order_relaxed);
+}
+
+static inline void ProfileMax(std::atomic<uint64_t>& n, uint64_t nValue)
+{
+    if (nValue > n.load(std::memory_order_relaxed))
+        n.store(nValue, std::memory_order_relaxed);
+}
+
+static int ProfileBucket(int64_t nNanos)
+{
+    int nBucket = 0;
+    int64_t nLimit = 1000;
+    while (nNanos >= nLimit && nBucket < LOCK_PROFILE_BUCKETS - 1) {
+        nBucket++;
+        nLimit *= 4;
+    }
+    return nBucket;
+}
+
+int64_t LockProfileBucketLimit(int nBucket)
+{
+    if (nBucket >= LOCK_PROFILE_BUCKETS - 1)
+        return 0;
+    int64_t nLimit = 1000;
+    while (nBucket-- > 0)
+        nLimit *= 4;
+    return nLimit;
+}
+
+struct LockProfileThread;
+
+//! Bumped by ResetLockProfile()
+static std::atomic<uint32_t> g_lock_profile_generation{1};
+
+//! Counters summed over threads, by file and line
+typedef std::map<std::pair<std::string, int>, LockSiteProfile> LockProfileMap;
+
+struct LockProfileRegistry {
+    std::mutex mutex;
+    std::set<LockProfileThread*> setThreads;
+    //! Counters of threads that have exited
+    LockProfileMap mapRetired;
+    int64_t nResetTime = GetTime();
+};
+
+static LockProfileRegistry& GetLockProfileRegistry()
+{
+    // leaked, threads may still exit after static destructors ran
+    static LockProfileRegistry* registry = new LockProfileRegistry();
+    return *registry;
+}
+
+static void AddSiteProfile(LockProfileMap& mapProfile, const LockSiteStats& site);
+
+struct LockSiteKeyHasher {
+    size_t operator()(const std::pair<const char*, int>& key) const
+    {
+        return std::hash<const char*>()(key.first) ^ ((size_t)key.second * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+struct LockProfileThread {
+    //! Held by this thread to add a site, and by readers to walk the sites
+    std::mutex mutex;
+    std::unordered_map<std::pair<const char*, int>, std::unique_ptr<LockSiteStats>, LockSiteKeyHasher> mapSites;
+
+    LockProfileThread()
+    {
+        LockProfileRegistry& registry = GetLockProfileRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.setThreads.insert(this);
+    }
+
+    ~LockProfileThread()
+    {
+        LockProfileRegistry& registry = GetLockProfileRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        const uint32_t nGeneration = g_lock_profile_generation.load();
+        for (const auto& it : mapSites) {
+            if (it.second->nGeneration.load() == nGeneration)
+                AddSiteProfile(registry.mapRetired, *it.second);
+        }
+        registry.setThreads.erase(this);
+    }
+};
+
+// Set once the thread's LockProfileThread is gone, for locks taken by later destructors
+static thread_local bool g_lock_profile_thread_exited = false;
+
+static LockProfileThread* GetLockProfileThread()
+{
+    struct Holder {
+        LockProfileThread thread;
+        ~Holder() { g_lock_profile_thread_exited = true; }
+    };
+    if (g_lock_profile_thread_exited)
+        return nullptr;
+    static thread_local Holder holder;
+    return &holder.thread;
+}
+
+LockSiteStats* LockProfileSite(const char* pszName, const char* pszFile, int nLine)
+{
+    LockProfileThread* thread = GetLockProfileThread();
+    if (!thread)
+        return nullptr;
+    const std::pair<const char*, int> key(pszFile, nLine);
+    auto it = thread->mapSites.find(key);
+    if (it == thread->mapSites.end()) {
+        std::lock_guard<std::mutex> lock(thread->mutex);
+        it = thread->mapSites.emplace(key, std::unique_ptr<LockSiteStats>(new LockSiteStats(pszName, pszFile, nLine))).first;
+    }
+    LockSiteStats* site = it->second.get();
+    const uint32_t nGeneration = g_lock_profile_generation.load(std::memory_order_relaxed);
+    if (site->nGeneration.load(std::memory_order_relaxed) != nGeneration) {
+        // first lock here since a reset
+        site->Clear();
+        site->nGeneration.store(nGeneration, std::memory_order_relaxed);
+    }
+    return site;
+}
+
+void LockProfileAcquired(LockSiteStats* site, bool fContended, int64_t nWaitNanos)
+{
+    if (!site)
+        return;
+    ProfileAdd(site->nLocks, 1);
+    ProfileAdd(site->vWaitHist[ProfileBucket(nWaitNanos)], 1);
+    if (fContended) {
+        ProfileAdd(site->nContended, 1);
+        ProfileAdd(site->nWaitNanos, nWaitNanos);
+        ProfileMax(site->nMaxWaitNanos, nWaitNanos);
+    }
+}
+
+void LockProfileReleased(LockSiteStats* site, int64_t nHoldNanos)
+{
+    if (!site)
+        return;
+    ProfileAdd(site->nHoldNanos, nHoldNanos);
+    ProfileMax(site->nMaxHoldNanos, nHoldNanos);
+    ProfileAdd(site->vHoldHist[ProfileBucket(nHoldNanos)], 1);
+}
+
+static void AddSiteProfile(LockProfileMap& mapProfile, const LockSiteStats& site)
+{
+    // the same site can show up under several file name pointers
+    LockSiteProfile& profile = mapProfile[std::make_pair(std::string(site.pszFile), site.nLine)];
+    profile.strName = site.pszName;
+    profile.nLocks += site.nLocks.load(std::memory_order_relaxed);
+    profile.nContended += site.nContended.load(std::memory_order_relaxed);
+    profile.nWaitNanos += site.nWaitNanos.load(std::memory_order_relaxed);
+    profile.nHoldNanos += site.nHoldNanos.load(std::memory_order_relaxed);
+    profile.nMaxWaitNanos = std::max<uint64_t>(profile.nMaxWaitNanos, site.nMaxWaitNanos.load(std::memory_order_relaxed));
+    profile.nMaxHoldNanos = std::max<uint64_t>(profile.nMaxHoldNanos, site.nMaxHoldNanos.load(std::memory_order_relaxed));
+    for (int i = 0; i < LOCK_PROFILE_BUCKETS; i++) {
+        profile.vWaitHist[i] += site.vWaitHist[i].load(std::memory_order_relaxed);
+        profile.vHoldHist[i] += site.vHoldHist[i].load(std::memory_order_relaxed);
+    }
+}
+
+std::vector<LockSiteProfile> GetLockProfile()
+{
+    LockProfileRegistry& registry = GetLockProfileRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    const uint32_t nGeneration = g_lock_profile_generation.load();
+    LockProfileMap mapProfile;
+    for (LockProfileThread* thread : registry.setThreads) {
+        std::lock_guard<std::mutex> threadLock(thread->mutex);
+        for (const auto& it : thread->mapSites) {
+            if (it.second->nGeneration.load(std::memory_order_relaxed) == nGeneration)
+                AddSiteProfile(mapProfile, *it.second);
+        }
+    }
+
+    std::vector<LockSiteProfile> vProfile;
+    vProfile.reserve(registry.mapRetired.size() + mapProfile.size());
+    for (const auto& it : registry.mapRetired) {
+        LockSiteProfile& retired = mapProfile[it.first];
+        if (retired.nLocks == 0)
+            retired.strName = it.second.strName;
+        retired.nLocks += it.second.nLocks;
+        retired.nContended += it.second.nContended;
+        retired.nWaitNanos += it.second.nWaitNanos;
+        retired.nHoldNanos += it.second.nHoldNanos;
+        retired.nMaxWaitNanos = std::max(retired.nMaxWaitNanos, it.second.nMaxWaitNanos);
+        retired.nMaxHoldNanos = std::max(retired.nMaxHoldNanos, it.second.nMaxHoldNanos);
+        for (int i = 0; i < LOCK_PROFILE_BUCKETS; i++) {
+            retired.vWaitHist[i] += it.second.vWaitHist[i];
+            retired.vHoldHist[i] += it.second.vHoldHist[i];
+        }
+    }
+    for (auto& it : mapProfile) {
+        it.second.strFile = it.first.first;
+        it.second.nLine = it.first.second;
+        vProfile.push_back(std::move(it.second));
+    }
+    return vProfile;
+}
+
+void ResetLockProfile()
+{
+    LockProfileRegistry& registry = GetLockProfileRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    // every thread clears a site's counters the next time it takes that lock
+    ++g_lock_profile_generation;
+    registry.mapRetired.clear();
+    registry.nResetTime = GetTime();
+}
+
+int64_t GetLockProfileResetTime()
+{
+    LockProfileRegistry& registry = GetLockProfileRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return registry.nResetTime;
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -11,9 +11,13 @@
 #include "threadsafety.h"
 #include "util/macros.h"
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 
 /////////////////////////////////////////////////
@@ -116,14 +120,84 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Lock profiling, switched at runtime (-lockprofile, getlockstats). While on,
+ * every LOCK site (file:line) counts its acquisitions, how many had to wait
+ * and histograms of wait and hold time. Counters are kept per thread, so the
+ * only cost is two clock reads and a table lookup per lock; while off it is
+ * a single relaxed load.
+ */
+extern std::atomic<bool> g_lock_profiling;
+
+static const bool DEFAULT_LOCKPROFILE = false;
+//! Histogram buckets: under 1us, then each bucket 4 times wider, the last one open ended
+static const int LOCK_PROFILE_BUCKETS = 12;
+
+/** Per thread counters of a lock site */
+struct LockSiteStats;
+
+/** Counters of a lock site, summed over all threads */
+struct LockSiteProfile {
+    std::string strName;
+    std::string strFile;
+    int nLine = 0;
+    uint64_t nLocks = 0;
+    uint64_t nContended = 0;
+    uint64_t nWaitNanos = 0;
+    uint64_t nHoldNanos = 0;
+    uint64_t nMaxWaitNanos = 0;
+    uint64_t nMaxHoldNanos = 0;
+    uint64_t vWaitHist[LOCK_PROFILE_BUCKETS] = {};
+    uint64_t vHoldHist[LOCK_PROFILE_BUCKETS] = {};
+};
+
+LockSiteStats* LockProfileSite(const char* pszName, const char* pszFile, int nLine);
+void LockProfileAcquired(LockSiteStats* site, bool fContended, int64_t nWaitNanos);
+void LockProfileReleased(LockSiteStats* site, int64_t nHoldNanos);
+/** Upper bound of a histogram bucket in nanoseconds, 0 for the last one */
+int64_t LockProfileBucketLimit(int nBucket);
+/** Counters of every lock site seen since the last reset */
+std::vector<LockSiteProfile> GetLockProfile();
+void ResetLockProfile();
+/** Time of the last reset */
+int64_t GetLockProfileResetTime();
+
+static inline int64_t LockProfileNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock  : public Base
 {
 private:
+    LockSiteStats* m_profile_site = nullptr;
+    int64_t m_profile_locked = 0;
+
+    void EnterProfiled(const char* pszName, const char* pszFile, int nLine)
+    {
+        m_profile_site = LockProfileSite(pszName, pszFile, nLine);
+        const bool fContended = !Base::try_lock();
+        int64_t nWait = 0;
+        if (fContended) {
+            const int64_t nStart = LockProfileNanos();
+            Base::lock();
+            m_profile_locked = LockProfileNanos();
+            nWait = m_profile_locked - nStart;
+        } else {
+            m_profile_locked = LockProfileNanos();
+        }
+        LockProfileAcquired(m_profile_site, fContended, nWait);
+    }
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
+        if (g_lock_profiling.load(std::memory_order_relaxed)) {
+            EnterProfiled(pszName, pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!Base::try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -140,6 +214,11 @@ private:
         Base::try_lock();
         if (!Base::owns_lock())
             LeaveCritical();
+        else if (g_lock_profiling.load(std::memory_order_relaxed)) {
+            m_profile_site = LockProfileSite(pszName, pszFile, nLine);
+            m_profile_locked = LockProfileNanos();
+            LockProfileAcquired(m_profile_site, false, 0);
+        }
         return Base::owns_lock();
     }
 
@@ -165,8 +244,12 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            // hold time includes condition variable waits and reverse_lock scopes
+            if (m_profile_site)
+                LockProfileReleased(m_profile_site, LockProfileNanos() - m_profile_locked);
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -9,6 +9,7 @@
 #include <boost/test/unit_test.hpp>
 #include <crypto/common.h> // for ReadLE64
 
+#include "clientversion.h"
 #include "hash.h"
 #include "netbase.h"
 #include "random.h"
@@ -51,6 +52,21 @@ public:
         CAddrMan::Delete(nId);
     }
 
+    bool IsTried(const CNetAddr& addr)
+    {
+        CAddrInfo* pinfo = Find(addr);
+        return pinfo && pinfo->fInTried;
+    }
+
+    int GetRefCount(const CNetAddr& addr)
+    {
+        CAddrInfo* pinfo = Find(addr);
+        return pinfo ? pinfo->nRefCount : 0;
+    }
+
+    int GetNewCount() const { return nNew; }
+    int GetTriedCount() const { return nTried; }
+
     // Simulates connection failure so that we can test eviction of offline nodes
     void SimConnFail(CService& addr)
     {
@@ -434,6 +450,91 @@ BOOST_AUTO_TEST_CASE(addrman_getaddr)
 }
 
 
+BOOST_AUTO_TEST_CASE(addrman_journal)
+{
+    CAddrManTest addrman;
+    addrman.MakeDeterministic();
+
+    CNetAddr source1 = ResolveIP("252.2.2.2");
+    CNetAddr source2 = ResolveIP("252.3.3.3");
+    for (int i = 1; i < 40; i++)
+        addrman.Add(CAddress(ResolveService(strprintf("250.%d.1.1", i), 8333), NODE_NONE), source1);
+
+    CDataStream ssSnapshot(SER_DISK, CLIENT_VERSION);
+    ssSnapshot << addrman;
+    addrman.ChangesWritten(true);
+    BOOST_CHECK_EQUAL(addrman.GetChangeCount(), 0U);
+
+    // New addresses (possibly evicting others), a move to tried and a service update
+    for (int i = 1; i < 20; i++)
+        addrman.Add(CAddress(ResolveService(strprintf("250.%d.2.1", i), 8333), NODE_NONE), source2);
+    // an address referenced from several new buckets
+    CAddress addrMulti(ResolveService("250.1.3.1", 8333), NODE_NONE);
+    addrMulti.nTime = GetAdjustedTime() - 60 * 60;
+    for (int i = 1; i < 40; i++) {
+        addrMulti.nTime++; // only newer information adds a reference
+        addrman.Add(addrMulti, ResolveIP(strprintf("%d.1.1.1", i)));
+    }
+    BOOST_REQUIRE(addrman.GetRefCount(addrMulti) > 1);
+    CService addrGood = ResolveService("250.5.1.1", 8333);
+    addrman.Good(addrGood);
+    CService addrServices = ResolveService("250.6.1.1", 8333);
+    addrman.SetServices(addrServices, NODE_NETWORK);
+    BOOST_CHECK(addrman.GetChangeCount() >= 21U);
+
+    CDataStream ssChanges(SER_DISK, CLIENT_VERSION);
+    addrman.SerializeChanges(ssChanges);
+    addrman.ChangesWritten(true);
+    BOOST_CHECK_EQUAL(addrman.GetChangeCount(), 0U);
+
+    // snapshot + changes gives the same table
+    CAddrManTest addrman2;
+    ssSnapshot >> addrman2;
+    BOOST_CHECK(addrman2.size() < addrman.size());
+    addrman2.UnserializeChanges(ssChanges);
+    BOOST_CHECK_EQUAL(addrman2.size(), addrman.size());
+    BOOST_CHECK_EQUAL(addrman2.GetNewCount(), addrman.GetNewCount());
+    BOOST_CHECK_EQUAL(addrman2.GetTriedCount(), 1);
+    BOOST_CHECK(addrman2.IsTried(addrGood));
+    CAddrInfo* pinfo = addrman2.Find(addrServices);
+    BOOST_REQUIRE(pinfo != nullptr);
+    BOOST_CHECK_EQUAL(pinfo->nServices, NODE_NETWORK);
+    BOOST_CHECK_EQUAL(addrman2.GetRefCount(addrMulti), addrman.GetRefCount(addrMulti));
+    // applying the journal is not itself a change
+    BOOST_CHECK_EQUAL(addrman2.GetChangeCount(), 0U);
+
+    // deletion records
+    CNetAddr addrDelete = ResolveIP("250.7.1.1");
+    BOOST_REQUIRE(addrman2.Find(addrDelete) != nullptr);
+    CDataStream ssDelete(SER_DISK, CLIENT_VERSION);
+    WriteCompactSize(ssDelete, 1);
+    ssDelete << (unsigned char)ADDRMAN_CHANGE_DELETE << addrDelete;
+    addrman2.UnserializeChanges(ssDelete);
+    BOOST_CHECK(addrman2.Find(addrDelete) == nullptr);
+    BOOST_CHECK_EQUAL(addrman2.size(), addrman.size() - 1);
+
+    // unknown record types are rejected
+    CDataStream ssBad(SER_DISK, CLIENT_VERSION);
+    WriteCompactSize(ssBad, 1);
+    ssBad << (unsigned char)7;
+    BOOST_CHECK_THROW(addrman2.UnserializeChanges(ssBad), std::ios_base::failure);
+
+    // changes stay pending until they are known to be written
+    addrman.Add(CAddress(ResolveService("250.1.4.1", 8333), NODE_NONE), source1);
+    size_t nPending = addrman.GetChangeCount();
+    BOOST_CHECK(nPending > 0);
+    CDataStream ssLost(SER_DISK, CLIENT_VERSION);
+    addrman.SerializeChanges(ssLost);
+    BOOST_CHECK_EQUAL(addrman.GetChangeCount(), 0U);
+    addrman.ChangesWritten(false);
+    BOOST_CHECK_EQUAL(addrman.GetChangeCount(), nPending);
+    CDataStream ssRetry(SER_DISK, CLIENT_VERSION);
+    addrman.SerializeChanges(ssRetry);
+    addrman.ChangesWritten(true);
+    BOOST_CHECK_EQUAL(addrman.GetChangeCount(), 0U);
+    BOOST_CHECK(ssRetry.size() == ssLost.size());
+}
+
 BOOST_AUTO_TEST_CASE(caddrinfo_get_tried_bucket)
 {
     CAddrManTest addrman;
@@ -13,6 +13,7 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_pivx.h"
@@ -270,6 +271,29 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    // every backend this CPU has, on its own, with batch sizes around the 4 and 8 way boundaries
+    const SHA256Implementation impls[] = {SHA256_STANDARD, SHA256_USE_SSE41, SHA256_USE_AVX2, SHA256_USE_SHANI, SHA256_USE_ALL};
+    for (SHA256Implementation impl : impls) {
+        SHA256AutoDetect(impl);
+        for (int i = 0; i <= 32; i++) {
+            std::vector<unsigned char> in = InsecureRandBytes(64 * i);
+            std::vector<unsigned char> out(32 * i), expected(32 * i);
+            for (int j = 0; j < i; j++) {
+                const uint256 hash = Hash(in.begin() + 64 * j, in.begin() + 64 * (j + 1));
+                memcpy(expected.data() + 32 * j, hash.begin(), 32);
+            }
+            SHA256D64(out.data(), in.data(), i);
+            BOOST_CHECK(out == expected);
+            // in place, the way merkle levels are hashed
+            SHA256D64(in.data(), in.data(), i);
+            BOOST_CHECK(std::equal(expected.begin(), expected.end(), in.begin()));
+        }
+    }
+    SHA256AutoDetect();
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
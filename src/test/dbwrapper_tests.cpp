@@ -114,4 +114,50 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_options_and_stats)
+{
+    mapMultiArgs["-dboption"] = {"testdb:writebuffer=2", "testdb:bloombits=0", "otherdb:blockcache=64", "testdb:bogus"};
+    {
+        fs::path ph = fs::temp_directory_path() / fs::unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, "testdb");
+        BOOST_CHECK_EQUAL(dbw.GetName(), "testdb");
+        BOOST_CHECK_EQUAL(dbw.GetOptions().nWriteBufferSize, (size_t)(2 << 20));
+        BOOST_CHECK_EQUAL(dbw.GetOptions().nBloomBits, 0);
+        // not overridden for this database: derived from the cache size
+        BOOST_CHECK_EQUAL(dbw.GetOptions().nBlockCacheSize, (size_t)(1 << 19));
+
+        bool fListed = false;
+        ForEachDBWrapper([&fListed](CDBWrapper& db) { fListed |= db.GetName() == "testdb"; });
+        BOOST_CHECK(fListed);
+
+        // the registry is not locked while func runs
+        bool fNested = false;
+        ForEachDBWrapper([&fNested](CDBWrapper&) {
+            fNested = false;
+            ForEachDBWrapper([&fNested](CDBWrapper& db) { fNested |= db.GetName() == "testdb"; });
+        });
+        BOOST_CHECK(fNested);
+
+        CDBBatch batch;
+        for (int i = 0; i < 100; i++)
+            batch.Write(std::make_pair('k', i), GetRandHash());
+        BOOST_CHECK(dbw.WriteBatch(batch));
+        BOOST_CHECK(dbw.Write('x', GetRandHash()));
+        BOOST_CHECK_EQUAL(dbw.GetBatchesWritten(), 2U);
+        BOOST_CHECK_EQUAL(dbw.GetBatchWriteTime().Count(), 2U);
+        BOOST_CHECK(dbw.GetBytesWritten() > 100 * 32);
+        BOOST_CHECK(!dbw.GetProperty("leveldb.stats").empty());
+        BOOST_CHECK(dbw.GetProperty("leveldb.nosuchproperty").empty());
+
+        BOOST_CHECK(dbw.Compact(false));
+        BOOST_CHECK(!dbw.IsCompacting());
+        BOOST_CHECK(dbw.Compact(true));
+        // the destructor waits for the background compaction
+    }
+    bool fListed = false;
+    ForEachDBWrapper([&fListed](CDBWrapper& db) { fListed |= db.GetName() == "testdb"; });
+    BOOST_CHECK(!fListed);
+    mapMultiArgs.erase("-dboption");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
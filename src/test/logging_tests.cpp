@@ -0,0 +1,96 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "logging.h"
+
+#include "test/test_pivx.h"
+
+#include <fstream>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(logging_tests, BasicTestingSetup)
+
+static std::vector<std::string> ReadLines(const fs::path& path)
+{
+    std::vector<std::string> vLines;
+    std::ifstream file(path.string());
+    std::string strLine;
+    while (std::getline(file, strLine))
+        vLines.push_back(strLine);
+    return vLines;
+}
+
+BOOST_AUTO_TEST_CASE(logging_async)
+{
+    const fs::path path = fs::temp_directory_path() / fs::unique_path();
+    {
+        BCLog::Logger logger;
+        logger.m_print_to_file = true;
+        logger.m_log_timestamps = false;
+        logger.m_file_path = path;
+        logger.LogPrintStr("before open\n");
+        BOOST_REQUIRE(logger.OpenDebugLog());
+        logger.StartAsync(64);
+        BOOST_CHECK(logger.IsAsync());
+
+        // four producers; each one's lines must come out in order
+        std::vector<std::thread> vThreads;
+        for (int t = 0; t < 4; t++) {
+            vThreads.emplace_back([&logger, t] {
+                for (int i = 0; i < 1000; i++)
+                    logger.LogPrintStr(strprintf("%d %d\n", t, i));
+            });
+        }
+        for (std::thread& thread : vThreads)
+            thread.join();
+        logger.StopAsync();
+        BOOST_CHECK(!logger.IsAsync());
+        logger.LogPrintStr("after stop\n");
+        // lines without a category are never dropped
+        BOOST_CHECK_EQUAL(logger.GetDroppedLines(), 0U);
+    }
+
+    const std::vector<std::string> vLines = ReadLines(path);
+    BOOST_REQUIRE_EQUAL(vLines.size(), 4002U);
+    BOOST_CHECK_EQUAL(vLines.front(), "before open");
+    BOOST_CHECK_EQUAL(vLines.back(), "after stop");
+    int vNext[4] = {0, 0, 0, 0};
+    for (size_t i = 1; i < vLines.size() - 1; i++) {
+        int t, n;
+        BOOST_REQUIRE(sscanf(vLines[i].c_str(), "%d %d", &t, &n) == 2);
+        BOOST_REQUIRE(t >= 0 && t < 4);
+        BOOST_CHECK_EQUAL(n, vNext[t]++);
+    }
+    fs::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(logging_ratelimit)
+{
+    BCLog::Logger logger;
+    BOOST_CHECK(logger.RateLimitAccept(BCLog::NET)); // no limit by default
+    logger.SetRateLimit(10);
+    int nAccepted = 0;
+    for (int i = 0; i < 100; i++)
+        nAccepted += logger.RateLimitAccept(BCLog::NET);
+    // a new second may have started halfway through
+    BOOST_CHECK(nAccepted >= 10 && nAccepted <= 20);
+    BOOST_CHECK_EQUAL(logger.GetSuppressedLines(), 100U - nAccepted);
+    // categories are counted separately
+    BOOST_CHECK(logger.RateLimitAccept(BCLog::MASTERNODE));
+    logger.SetRateLimit(0);
+    BOOST_CHECK(logger.RateLimitAccept(BCLog::NET));
+}
+
+BOOST_AUTO_TEST_CASE(logging_fsync_policy)
+{
+    BCLog::LogFsync policy;
+    BOOST_CHECK(BCLog::GetLogFsync(policy, "never") && policy == BCLog::LogFsync::NEVER);
+    BOOST_CHECK(BCLog::GetLogFsync(policy, "periodic") && policy == BCLog::LogFsync::PERIODIC);
+    BOOST_CHECK(BCLog::GetLogFsync(policy, "always") && policy == BCLog::LogFsync::ALWAYS);
+    BOOST_CHECK(!BCLog::GetLogFsync(policy, "sometimes"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
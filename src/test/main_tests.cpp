@@ -5,6 +5,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "blocksignature.h"
 #include "main.h"
 #include "primitives/transaction.h"
@@ -64,8 +65,8 @@ CBlock CreateDummyBlockWithSignature(CKey stakingKey, BlockSignatureType type, b
 
     // Now the block.
     CBlock block;
-    block.vtx.emplace_back(CTransaction()); // dummy first tx
-    block.vtx.emplace_back(txCoinStake);
+    block.vtx.emplace_back(MakeTransactionRef()); // dummy first tx
+    block.vtx.emplace_back(MakeTransactionRef(txCoinStake));
     SignBlockWithKey(block, stakingKey);
 
     return block;
@@ -156,6 +157,21 @@ BOOST_AUTO_TEST_CASE(subsidy_limit_test)
     // BOOST_CHECK(uint8_t(nSum) == uint8_t(4109975100000000ULL));
 }
 
+BOOST_AUTO_TEST_CASE(burn_script_test)
+{
+    // in force from the block after the activation height, like the address string check
+    for (const auto& p : Params().GetConsensus().mBurnAddresses) {
+        const CScript script = GetScriptForDestination(DecodeDestination(p.first));
+        BOOST_CHECK(!IsBurnScript(script, p.second));
+        CTxDestination dest;
+        BOOST_CHECK(IsBurnScript(script, p.second + 1, &dest));
+        BOOST_CHECK_EQUAL(EncodeDestination(dest), p.first);
+    }
+    const CScript scriptOther = GetScriptForDestination(CKeyID(uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"))));
+    BOOST_CHECK(!IsBurnScript(scriptOther, std::numeric_limits<int>::max()));
+    BOOST_CHECK(!IsBurnScript(CScript() << OP_RETURN, std::numeric_limits<int>::max()));
+}
+
 bool ReturnFalse() { return false; }
 bool ReturnTrue() { return true; }
 
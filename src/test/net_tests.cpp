@@ -8,6 +8,8 @@
 #include "hash.h"
 #include "net.h"
 #include "netbase.h"
+#include "netbufferpool.h"
+#include "netevents.h"
 #include "serialize.h"
 #include "streams.h"
 
@@ -177,4 +179,238 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(buffer_pool)
+{
+    typedef std::vector<unsigned char> Buffer;
+    CBufferPool<Buffer> pool(3000);
+
+    Buffer a = pool.Get(24);
+    BOOST_CHECK(a.empty());
+    BOOST_CHECK_EQUAL(a.capacity(), 256U);
+    Buffer b = pool.Get(1000);
+    BOOST_CHECK_EQUAL(b.capacity(), 1024U);
+    BOOST_CHECK_EQUAL(pool.GetStats().nAllocated, 2U);
+
+    a.resize(24, 0xaa);
+    pool.Put(std::move(a));
+    pool.Put(std::move(b));
+    BufferPoolStats stats = pool.GetStats();
+    BOOST_CHECK_EQUAL(stats.nReturned, 2U);
+    BOOST_CHECK_EQUAL(stats.nPooled, 2U);
+    BOOST_CHECK_EQUAL(stats.nPooledBytes, 256U + 1024U);
+
+    // buffers come back empty, from the smallest class that fits
+    Buffer c = pool.Get(100);
+    BOOST_CHECK(c.empty());
+    BOOST_CHECK_EQUAL(c.capacity(), 256U);
+    Buffer d = pool.Get(600);
+    BOOST_CHECK_EQUAL(d.capacity(), 1024U);
+    Buffer e = pool.Get(600);
+    BOOST_CHECK_EQUAL(pool.GetStats().nReused, 2U);
+    BOOST_CHECK_EQUAL(pool.GetStats().nAllocated, 3U);
+
+    // the byte cap and the size limit are honoured
+    pool.Put(std::move(d));
+    pool.Put(std::move(e));
+    Buffer big;
+    big.reserve(2 * 1024 * 1024);
+    pool.Put(std::move(big));
+    pool.Put(Buffer(3000));
+    stats = pool.GetStats();
+    BOOST_CHECK_EQUAL(stats.nPooledBytes, 2048U);
+    BOOST_CHECK_EQUAL(stats.nDiscarded, 2U);
+
+    pool.Clear();
+    BOOST_CHECK_EQUAL(pool.GetStats().nPooled, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(receive_direct_into_message)
+{
+    CAddress addr(CService("127.0.0.1", 7777), NODE_NETWORK);
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", true);
+
+    std::vector<unsigned char> payload(300000);
+    for (size_t i = 0; i < payload.size(); i++)
+        payload[i] = (unsigned char)i;
+    uint256 hash = Hash(payload.begin(), payload.end());
+    CMessageHeader hdr(Params().MessageStart(), "block", payload.size());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader << hdr;
+
+    // nothing is being received yet
+    unsigned int nMaxBytes = 65536;
+    BOOST_CHECK(node.GetDirectRecvBuffer(1, nMaxBytes) == nullptr);
+
+    // the header and the start of the payload go through a copy
+    bool fComplete = false;
+    std::vector<char> vFirst(ssHeader.begin(), ssHeader.end());
+    vFirst.insert(vFirst.end(), payload.begin(), payload.begin() + 1000);
+    BOOST_CHECK(node.ReceiveMsgBytes(vFirst.data(), vFirst.size(), fComplete));
+    BOOST_CHECK(!fComplete);
+
+    // the rest is written straight into the message, in bounded chunks
+    size_t nPos = 1000;
+    while (nPos < payload.size()) {
+        nMaxBytes = 100000;
+        char* pch = node.GetDirectRecvBuffer(1, nMaxBytes);
+        BOOST_REQUIRE(pch != nullptr);
+        BOOST_CHECK_EQUAL(nMaxBytes, std::min<size_t>(100000, payload.size() - nPos));
+        memcpy(pch, &payload[nPos], nMaxBytes);
+        BOOST_CHECK(node.ReceiveMsgBytes(pch, nMaxBytes, fComplete));
+        nPos += nMaxBytes;
+    }
+    BOOST_CHECK(fComplete);
+    BOOST_CHECK(node.GetDirectRecvBuffer(1, nMaxBytes) == nullptr);
+
+    node.MarkReceivedMsgsForProcessing(std::numeric_limits<unsigned int>::max());
+    LOCK(node.cs_vProcessMsg);
+    BOOST_REQUIRE_EQUAL(node.vProcessMsg.size(), 1U);
+    const CNetMessage& msg = node.vProcessMsg.front();
+    BOOST_CHECK_EQUAL(msg.hdr.GetCommand(), "block");
+    BOOST_CHECK(std::equal(payload.begin(), payload.end(), (const unsigned char*)&msg.vRecv[0]));
+    BOOST_CHECK_EQUAL(node.nProcessQueueSize, payload.size() + CMessageHeader::HEADER_SIZE);
+}
+
+static void QueueTestMessage(CNode& node, SendClass sendClass, size_t nSize, unsigned char tag)
+{
+    LOCK(node.cs_vSend);
+    node.QueueSendMessage(sendClass, std::vector<unsigned char>(24, tag), std::vector<unsigned char>(nSize - 24, tag));
+}
+
+/** Schedule and "send" everything committed, returning the header tags in wire order */
+static std::vector<unsigned char> DrainSendQueue(CNode& node, int64_t nTime, uint64_t nBulkRate, size_t nMaxMsgs)
+{
+    std::vector<unsigned char> vTags;
+    LOCK(node.cs_vSend);
+    while (vTags.size() < nMaxMsgs) {
+        node.ScheduleSendMessages(nTime, nBulkRate);
+        if (node.vSendMsg.empty())
+            break;
+        while (!node.vSendMsg.empty() && vTags.size() < nMaxMsgs) {
+            // header and payload of one message
+            vTags.push_back(node.vSendMsg.front()[0]);
+            for (int i = 0; i < 2; i++) {
+                node.nSendMsgSize -= node.vSendMsg.front().size();
+                node.vSendMsg.pop_front();
+            }
+        }
+    }
+    return vTags;
+}
+
+BOOST_AUTO_TEST_CASE(send_classes)
+{
+    CAddress addr(CService("127.0.0.1", 7777), NODE_NETWORK);
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", true);
+
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::INV), SEND_CLASS_CONTROL);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::MNPING), SEND_CLASS_CONTROL);
+    BOOST_CHECK_EQUAL(GetSendClass(NetMsgType::BLOCK), SEND_CLASS_RELAY);
+
+    // an announcement queued behind a backlog of old blocks goes out next
+    for (int i = 0; i < 10; i++)
+        QueueTestMessage(node, SEND_CLASS_BULK, 500000, 'b');
+    std::vector<unsigned char> vTags = DrainSendQueue(node, 1000000, 0, 1);
+    BOOST_CHECK(vTags == std::vector<unsigned char>{'b'});
+    QueueTestMessage(node, SEND_CLASS_CONTROL, 61, 'c');
+    QueueTestMessage(node, SEND_CLASS_RELAY, 100000, 'r');
+    vTags = DrainSendQueue(node, 1000000, 0, 3);
+    BOOST_CHECK(vTags == (std::vector<unsigned char>{'c', 'r', 'b'}));
+    vTags = DrainSendQueue(node, 1000000, 0, 100);
+    BOOST_CHECK_EQUAL(vTags.size(), 8U);
+
+    CNodeStats stats;
+    node.copyStats(stats);
+    BOOST_CHECK_EQUAL(stats.nSendQueueMsgs[SEND_CLASS_BULK], 0U);
+    BOOST_CHECK_EQUAL(stats.nSendClassBytes[SEND_CLASS_BULK], 10U * 500000);
+    BOOST_CHECK_EQUAL(stats.nSendClassBytes[SEND_CLASS_CONTROL], 61U);
+
+    // backlogged classes share the bandwidth by weight
+    for (int i = 0; i < 200; i++) {
+        QueueTestMessage(node, SEND_CLASS_RELAY, 1000, 'r');
+        QueueTestMessage(node, SEND_CLASS_BULK, 1000, 'b');
+    }
+    vTags = DrainSendQueue(node, 1000000, 0, 100);
+    const long nRelay = std::count(vTags.begin(), vTags.end(), 'r');
+    BOOST_CHECK_EQUAL(nRelay, (long)(100 * SEND_CLASS_WEIGHT[SEND_CLASS_RELAY] / (SEND_CLASS_WEIGHT[SEND_CLASS_RELAY] + SEND_CLASS_WEIGHT[SEND_CLASS_BULK])));
+    DrainSendQueue(node, 1000000, 0, 1000);
+
+    // the rate cap holds back bulk messages only
+    for (int i = 0; i < 5; i++)
+        QueueTestMessage(node, SEND_CLASS_BULK, 1000, 'b');
+    QueueTestMessage(node, SEND_CLASS_CONTROL, 100, 'c');
+    vTags = DrainSendQueue(node, 2000000, 2000, 100);
+    // one second of burst allows two, then the peer is throttled
+    BOOST_CHECK(vTags == (std::vector<unsigned char>{'c', 'b', 'b'}));
+    BOOST_CHECK(node.nSendThrottledUntil > 2000000);
+    node.copyStats(stats);
+    BOOST_CHECK(stats.fSendThrottled);
+    BOOST_CHECK_EQUAL(stats.nSendQueueMsgs[SEND_CLASS_BULK], 3U);
+    BOOST_CHECK_EQUAL(stats.nSendQueueBytes[SEND_CLASS_BULK], 3000U);
+    vTags = DrainSendQueue(node, 3000000, 2000, 100);
+    BOOST_CHECK_EQUAL(vTags.size(), 2U);
+    vTags = DrainSendQueue(node, 4000000, 2000, 100);
+    BOOST_CHECK_EQUAL(vTags.size(), 1U);
+    BOOST_CHECK_EQUAL(node.nSendThrottledUntil, 0);
+}
+
+#ifndef WIN32
+static void CheckSocketEvents(const std::string& strMode)
+{
+    std::string strError;
+    std::unique_ptr<CSocketEvents> events = MakeSocketEvents(strMode, strError);
+    BOOST_REQUIRE_MESSAGE(events, strError);
+    BOOST_CHECK_EQUAL(events->GetName(), strMode);
+
+    int pair[2];
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    SOCKET fds[2] = {(SOCKET)pair[0], (SOCKET)pair[1]};
+    BOOST_CHECK(SetSocketNonBlocking(fds[0], true));
+    BOOST_CHECK(events->Add(fds[0], false));
+    const std::vector<SocketInterest> vInterest{SocketInterest(fds[0], true, false)};
+    SocketReadySet ready;
+
+    // nothing to read yet
+    if (events->IsEdgeTriggered()) {
+        // a freshly registered socket reports its initial write readiness once
+        BOOST_CHECK_EQUAL(events->Wait(vInterest, 0, ready), 1);
+        BOOST_CHECK(ready.send.count(fds[0]));
+    }
+    BOOST_CHECK_EQUAL(events->Wait(vInterest, 0, ready), 0);
+    BOOST_CHECK(ready.empty());
+
+    BOOST_REQUIRE_EQUAL(send(fds[1], "ping", 4, 0), 4);
+    BOOST_CHECK_EQUAL(events->Wait(vInterest, 100, ready), 1);
+    BOOST_CHECK(ready.recv.count(fds[0]));
+
+    // level-triggered backends keep reporting unread data, edge-triggered ones don't
+    BOOST_CHECK_EQUAL(events->Wait(vInterest, 0, ready), events->IsEdgeTriggered() ? 0 : 1);
+
+    char buf[4];
+    BOOST_CHECK_EQUAL(recv(fds[0], buf, sizeof(buf), 0), 4);
+    BOOST_CHECK_EQUAL(events->Wait(vInterest, 0, ready), 0);
+
+    // peer hang-up is reported as an error
+    CloseSocket(fds[1]);
+    BOOST_CHECK_EQUAL(events->Wait(vInterest, 100, ready), 1);
+    BOOST_CHECK(ready.recv.count(fds[0]) || ready.error.count(fds[0]));
+    CloseSocket(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE(socket_events)
+{
+    BOOST_CHECK(IsSocketEventsModeSupported(DefaultSocketEventsMode()));
+    BOOST_CHECK(!IsSocketEventsModeSupported("kqueue-ish"));
+    std::string strError;
+    BOOST_CHECK(!MakeSocketEvents("kqueue-ish", strError));
+    BOOST_CHECK(!strError.empty());
+
+    CheckSocketEvents(SOCKETEVENTS_SELECT);
+#ifdef HAVE_EPOLL
+    CheckSocketEvents(SOCKETEVENTS_EPOLL);
+#endif
+}
+#endif // WIN32
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "legacy/stakemodifier.h"
+
+#include "main.h"
+#include "test/test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(stakemodifier_tests, BasicTestingSetup)
+
+/** Blocks with v1 modifiers the way the legacy chain has them: about one a
+ *  minute, times going back and forth, not every block generating one */
+class ModifierChain
+{
+public:
+    explicit ModifierChain(size_t nMaxBlocks)
+    {
+        vIndex.reserve(nMaxBlocks);
+        vHashes.reserve(nMaxBlocks);
+    }
+
+    CBlockIndex* Extend(CBlockIndex* pindexPrev, int nBlocks)
+    {
+        for (int i = 0; i < nBlocks; i++) {
+            vHashes.push_back(InsecureRand256());
+            vIndex.emplace_back();
+            CBlockIndex& index = vIndex.back();
+            index.phashBlock = &vHashes.back();
+            index.pprev = pindexPrev;
+            index.nHeight = pindexPrev ? pindexPrev->nHeight + 1 : 0;
+            index.nTime = pindexPrev ? pindexPrev->nTime + 60 + InsecureRandRange(241) - 120 : 1500000000;
+            index.SetStakeModifier(InsecureRandBits(64), InsecureRandRange(10) < 7);
+            index.BuildSkip();
+            pindexPrev = &index;
+        }
+        return pindexPrev;
+    }
+
+    std::vector<CBlockIndex> vIndex;
+    std::vector<uint256> vHashes;
+};
+
+static void CheckModifiers(const ModifierChain& chain)
+{
+    int nFound = 0;
+    for (const CBlockIndex& index : chain.vIndex) {
+        uint64_t nModifier = 0, nModifierWalk = 0;
+        const bool fFound = GetOldModifier(&index, nModifier);
+        BOOST_CHECK_EQUAL(fFound, GetOldModifierByWalk(&index, nModifierWalk));
+        if (fFound) {
+            BOOST_CHECK_EQUAL(nModifier, nModifierWalk);
+            nFound++;
+        }
+    }
+    // all but the blocks within a selection interval of the tip
+    BOOST_CHECK(nFound > 0);
+}
+
+BOOST_AUTO_TEST_CASE(old_modifier_index)
+{
+    ModifierChain chain(1500);
+    CBlockIndex* pindexTip = chain.Extend(nullptr, 1000);
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(pindexTip);
+    }
+    UpdateOldModifierIndex();
+    CheckModifiers(chain);
+
+    // a longer fork becomes active: the index drops what it had past the fork
+    CBlockIndex* pindexFork = chain.Extend(&chain.vIndex[700], 400);
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(pindexFork);
+    }
+    CheckModifiers(chain);
+
+    // and back
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(pindexTip);
+    }
+    CheckModifiers(chain);
+
+    LOCK(cs_main);
+    chainActive.SetTip(nullptr);
+    ResetOldModifierIndex();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,8 @@
 #include "sync.h"
 #include "test/test_pivx.h"
 
+#include <thread>
+
 #include <boost/test/unit_test.hpp>
 
 namespace {
@@ -50,4 +52,64 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_profile)
+{
+    const bool fPrev = g_lock_profiling;
+    g_lock_profiling = true;
+    ResetLockProfile();
+
+    Mutex mutex;
+    std::atomic<bool> fHeld{false};
+    std::thread holder([&] {
+        LOCK(mutex);
+        fHeld = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    });
+    while (!fHeld)
+        std::this_thread::yield();
+    const int nWaiterLine = __LINE__ + 2;
+    for (int i = 0; i < 3; i++) {
+        LOCK(mutex);
+    }
+    holder.join();
+
+    bool fFoundWaiter = false;
+    bool fFoundHolder = false;
+    for (const LockSiteProfile& profile : GetLockProfile()) {
+        if (profile.strName != "mutex")
+            continue;
+        if (profile.nLine == nWaiterLine) {
+            fFoundWaiter = true;
+            BOOST_CHECK_EQUAL(profile.nLocks, 3U);
+            // the first one waited for the holder's sleep
+            BOOST_CHECK_EQUAL(profile.nContended, 1U);
+            BOOST_CHECK(profile.nMaxWaitNanos >= 10 * 1000 * 1000);
+            uint64_t nWaits = 0;
+            for (int i = 0; i < LOCK_PROFILE_BUCKETS; i++)
+                nWaits += profile.vWaitHist[i];
+            BOOST_CHECK_EQUAL(nWaits, 3U);
+        } else {
+            // the holder thread has exited, its counters are kept
+            fFoundHolder = true;
+            BOOST_CHECK_EQUAL(profile.nLocks, 1U);
+            BOOST_CHECK(profile.nMaxHoldNanos >= 10 * 1000 * 1000);
+        }
+    }
+    BOOST_CHECK(fFoundWaiter);
+    BOOST_CHECK(fFoundHolder);
+
+    ResetLockProfile();
+    for (const LockSiteProfile& profile : GetLockProfile())
+        BOOST_CHECK(profile.strName != "mutex");
+
+    // nothing is recorded while profiling is off
+    g_lock_profiling = false;
+    {
+        LOCK(mutex);
+    }
+    for (const LockSiteProfile& profile : GetLockProfile())
+        BOOST_CHECK(profile.strName != "mutex");
+    g_lock_profiling = fPrev;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 
 #include "test_pivx.h"
 
+#include "crypto/sha256.h"
 #include "main.h"
 #include "random.h"
 #include "script/sigcache.h"
@@ -28,6 +29,7 @@ extern void noui_connect();
 
 BasicTestingSetup::BasicTestingSetup()
 {
+        SHA256AutoDetect();
         RandomInit();
         ECC_Start();
         SetupEnvironment();
@@ -0,0 +1,103 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txdb.h"
+
+#include "clientversion.h"
+#include "random.h"
+#include "test/test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, BasicTestingSetup)
+
+/** A block index of its own, the way LoadBlockIndexDB fills mapBlockIndex */
+class TestBlockIndex
+{
+public:
+    CBlockIndex* Insert(const uint256& hash)
+    {
+        if (hash.IsNull())
+            return nullptr;
+        auto it = mapIndex.find(hash);
+        if (it == mapIndex.end()) {
+            it = mapIndex.emplace(hash, std::unique_ptr<CBlockIndex>(new CBlockIndex())).first;
+            it->second->phashBlock = &it->first;
+        }
+        return it->second.get();
+    }
+
+    std::map<uint256, std::unique_ptr<CBlockIndex> > mapIndex;
+};
+
+static void CheckEntry(const CBlockIndex& index, const CBlockIndex& loaded)
+{
+    BOOST_CHECK(index.GetBlockHash() == loaded.GetBlockHash());
+    BOOST_CHECK_EQUAL(index.pprev ? index.pprev->GetBlockHash().GetHex() : "", loaded.pprev ? loaded.pprev->GetBlockHash().GetHex() : "");
+    BOOST_CHECK_EQUAL(index.nHeight, loaded.nHeight);
+    BOOST_CHECK_EQUAL(index.nFile, loaded.nFile);
+    BOOST_CHECK_EQUAL(index.nDataPos, loaded.nDataPos);
+    BOOST_CHECK_EQUAL(index.nUndoPos, loaded.nUndoPos);
+    BOOST_CHECK_EQUAL(index.nStatus, loaded.nStatus);
+    BOOST_CHECK_EQUAL(index.nTx, loaded.nTx);
+    BOOST_CHECK_EQUAL(index.nFlags, loaded.nFlags);
+    BOOST_CHECK(index.vStakeModifier == loaded.vStakeModifier);
+    BOOST_CHECK(index.nMoneySupply == loaded.nMoneySupply);
+    BOOST_CHECK_EQUAL(index.nVersion, loaded.nVersion);
+    BOOST_CHECK(index.hashMerkleRoot == loaded.hashMerkleRoot);
+    BOOST_CHECK_EQUAL(index.nTime, loaded.nTime);
+    BOOST_CHECK_EQUAL(index.nBits, loaded.nBits);
+    BOOST_CHECK_EQUAL(index.nNonce, loaded.nNonce);
+}
+
+BOOST_AUTO_TEST_CASE(load_block_index_guts)
+{
+    // a few decode batches' worth, the last one partial
+    const int nBlocks = 2500;
+    std::vector<uint256> vHashes(nBlocks);
+    std::vector<CBlockIndex> vIndex(nBlocks);
+    std::vector<const CBlockIndex*> vWrite;
+    for (int i = 0; i < nBlocks; i++) {
+        vHashes[i] = InsecureRand256();
+        CBlockIndex& index = vIndex[i];
+        index.phashBlock = &vHashes[i];
+        index.pprev = i > 0 ? &vIndex[i - 1] : nullptr;
+        index.nHeight = i;
+        index.nStatus = BLOCK_VALID_SCRIPTS | BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO;
+        index.nFile = i / 1000;
+        index.nDataPos = InsecureRand32();
+        index.nUndoPos = InsecureRand32();
+        index.nTx = 1 + InsecureRandRange(100);
+        index.nVersion = 1 + InsecureRandRange(10);
+        index.hashMerkleRoot = InsecureRand256();
+        index.nTime = 1500000000 + 60 * i;
+        index.nBits = InsecureRand32();
+        index.nNonce = InsecureRand32();
+        // only persisted from block version 7
+        const bool fMoneySupply = index.nVersion >= 7 && CLIENT_VERSION >= DBI_SER_VERSION_MS;
+        index.nMoneySupply = fMoneySupply ? Optional<CAmount>(InsecureRandRange(21000000 * COIN)) : Optional<CAmount>(0);
+        // v1 and v2 modifiers both
+        if (InsecureRandBool())
+            index.SetStakeModifier(InsecureRandBits(64), InsecureRandBool());
+        else
+            index.SetStakeModifier(InsecureRand256());
+        vWrite.push_back(&index);
+    }
+
+    CBlockTreeDB db(1 << 20, true);
+    BOOST_CHECK(db.WriteBatchSync({}, 0, vWrite));
+
+    for (int nThreads : {0, 1, 3}) {
+        TestBlockIndex loaded;
+        BOOST_CHECK(db.LoadBlockIndexGuts(std::bind(&TestBlockIndex::Insert, &loaded, std::placeholders::_1), nThreads));
+        BOOST_CHECK_EQUAL(loaded.mapIndex.size(), (size_t)nBlocks);
+        for (const CBlockIndex& index : vIndex) {
+            auto it = loaded.mapIndex.find(index.GetBlockHash());
+            BOOST_REQUIRE(it != loaded.mapIndex.end());
+            CheckEntry(index, *it->second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
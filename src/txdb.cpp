@@ -11,7 +11,11 @@
 #include "pow.h"
 #include "uint256.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <stdint.h>
+#include <thread>
 
 #include <boost/thread.hpp>
 
@@ -105,7 +109,7 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe)
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, "blockindex")
 {
 }
 
@@ -250,54 +254,210 @@ bool CBlockTreeDB::ReadInt(const std::string& name, int& nValue)
     return Read(std::make_pair('I', name), nValue);
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+namespace {
+
+/** Decodes block index records on worker threads, a batch at a time, while
+ *  the cursor moves on. Batches are handed back in the order they came in. */
+class CBlockIndexDecoder
+{
+public:
+    struct Batch {
+        std::vector<uint256> vHash;
+        std::vector<CDataStream> vValue;
+        std::vector<CDiskBlockIndex> vIndex;
+        bool fOk = true;
+        bool fDecoded = false;
+    };
+
+    static const size_t BATCH_SIZE = 1024;
+
+    explicit CBlockIndexDecoder(int nThreadsIn) : nThreads(nThreadsIn)
+    {
+        for (int i = 0; i < nThreads; i++)
+            vThreads.emplace_back(&CBlockIndexDecoder::ThreadDecode, this);
+    }
+
+    ~CBlockIndexDecoder()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fStop = true;
+        }
+        condDecode.notify_all();
+        for (std::thread& thread : vThreads)
+            thread.join();
+    }
+
+    /** Queue a batch; without worker threads it is decoded right away */
+    void Push(std::unique_ptr<Batch> batch)
+    {
+        if (nThreads == 0) {
+            Decode(*batch);
+            batch->fDecoded = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(batch));
+        }
+        condDecode.notify_one();
+    }
+
+    size_t Pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queue.size();
+    }
+
+    /** Wait for the oldest batch to be decoded and take it back */
+    std::unique_ptr<Batch> Pop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condDecoded.wait(lock, [this] { return queue.front()->fDecoded; });
+        std::unique_ptr<Batch> batch = std::move(queue.front());
+        queue.pop_front();
+        if (nNextDecode > 0)
+            nNextDecode--;
+        return batch;
+    }
+
+    /** Time spent decoding, summed over all threads */
+    int64_t GetDecodeMicros() const { return nDecodeMicros; }
+
+private:
+    void Decode(Batch& batch)
+    {
+        const int64_t nStart = GetTimeMicros();
+        batch.vIndex.resize(batch.vValue.size());
+        for (size_t i = 0; i < batch.vValue.size() && batch.fOk; i++) {
+            try {
+                batch.vValue[i] >> batch.vIndex[i];
+            } catch (const std::exception&) {
+                batch.fOk = false;
+            }
+        }
+        batch.vValue.clear();
+        nDecodeMicros += GetTimeMicros() - nStart;
+    }
+
+    void ThreadDecode()
+    {
+        while (true) {
+            Batch* pbatch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condDecode.wait(lock, [this] { return fStop || nNextDecode < queue.size(); });
+                if (fStop)
+                    return;
+                pbatch = queue[nNextDecode++].get();
+            }
+            Decode(*pbatch);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pbatch->fDecoded = true;
+            }
+            condDecoded.notify_all();
+        }
+    }
+
+    const int nThreads;
+    std::vector<std::thread> vThreads;
+    std::atomic<int64_t> nDecodeMicros{0};
+
+    std::mutex mutex;
+    std::condition_variable condDecode;
+    std::condition_variable condDecoded;
+    std::deque<std::unique_ptr<Batch> > queue;
+    //! first batch in the queue no thread has taken yet
+    size_t nNextDecode = 0;
+    bool fStop = false;
+};
+
+} // anon namespace
+
+bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads)
 {
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, UINT256_ZERO));
 
+    CBlockIndexDecoder decoder(nThreads);
+    std::unique_ptr<CBlockIndexDecoder::Batch> batch;
+    size_t nEntries = 0;
+    int64_t nLinkMicros = 0;
+
+    // Link the decoded entries of a batch into mapBlockIndex
+    auto linkBatch = [&](const CBlockIndexDecoder::Batch& batchDecoded) {
+        const int64_t nStart = GetTimeMicros();
+        if (!batchDecoded.fOk)
+            return false;
+        for (size_t i = 0; i < batchDecoded.vIndex.size(); i++) {
+            const CDiskBlockIndex& diskindex = batchDecoded.vIndex[i];
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(batchDecoded.vHash[i]); // use the hash already registered on the key index
+            pindexNew->pprev = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight = diskindex.nHeight;
+            pindexNew->nFile = diskindex.nFile;
+            pindexNew->nDataPos = diskindex.nDataPos;
+            pindexNew->nUndoPos = diskindex.nUndoPos;
+            pindexNew->nVersion = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime = diskindex.nTime;
+            pindexNew->nBits = diskindex.nBits;
+            pindexNew->nNonce = diskindex.nNonce;
+            pindexNew->nStatus = diskindex.nStatus;
+            pindexNew->nTx = diskindex.nTx;
+
+
+            //Proof Of Stake
+            pindexNew->nFlags = diskindex.nFlags;
+            pindexNew->vStakeModifier = diskindex.vStakeModifier;
+
+            // if (!Params().GetConsensus().NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_POS)) {
+            //     if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits))
+            //         return error("LoadBlockIndex() : CheckProofOfWork failed: %s", pindexNew->ToString());
+            // }
+
+            pindexNew->nMoneySupply = diskindex.nMoneySupply;
+        }
+        nEntries += batchDecoded.vIndex.size();
+        nLinkMicros += GetTimeMicros() - nStart;
+        return true;
+    };
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char, uint256> key;
         if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(key.second); // use the hash already registered on the key index
-                pindexNew->pprev = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight = diskindex.nHeight;
-                pindexNew->nFile = diskindex.nFile;
-                pindexNew->nDataPos = diskindex.nDataPos;
-                pindexNew->nUndoPos = diskindex.nUndoPos;
-                pindexNew->nVersion = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime = diskindex.nTime;
-                pindexNew->nBits = diskindex.nBits;
-                pindexNew->nNonce = diskindex.nNonce;
-                pindexNew->nStatus = diskindex.nStatus;
-                pindexNew->nTx = diskindex.nTx;
-
-
-                //Proof Of Stake
-                pindexNew->nFlags = diskindex.nFlags;
-                pindexNew->vStakeModifier = diskindex.vStakeModifier;
-
-                // if (!Params().GetConsensus().NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_POS)) {
-                //     if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits))
-                //         return error("LoadBlockIndex() : CheckProofOfWork failed: %s", pindexNew->ToString());
-                // }
-
-                pindexNew->nMoneySupply = diskindex.nMoneySupply;
-
-                pcursor->Next();
-            } else {
-                return error("%s : failed to read value", __func__);
+            if (!batch) {
+                batch.reset(new CBlockIndexDecoder::Batch());
+                batch->vHash.reserve(CBlockIndexDecoder::BATCH_SIZE);
+                batch->vValue.reserve(CBlockIndexDecoder::BATCH_SIZE);
             }
+            batch->vHash.push_back(key.second);
+            batch->vValue.push_back(pcursor->GetValueStream());
+            if (batch->vHash.size() == CBlockIndexDecoder::BATCH_SIZE) {
+                decoder.Push(std::move(batch));
+                // keep the threads busy, but not the whole index in memory twice
+                while (decoder.Pending() > 2 * (size_t)nThreads) {
+                    if (!linkBatch(*decoder.Pop()))
+                        return error("%s : failed to read value", __func__);
+                }
+            }
+            pcursor->Next();
         } else {
             break;
         }
     }
+    if (batch)
+        decoder.Push(std::move(batch));
+    while (decoder.Pending()) {
+        if (!linkBatch(*decoder.Pop()))
+            return error("%s : failed to read value", __func__);
+    }
+
+    LogPrintf("%s: %u entries, decoded in %dms on %d threads, linked in %dms\n", __func__,
+        nEntries, decoder.GetDecodeMicros() / 1000, std::max(1, nThreads), nLinkMicros / 1000);
 
     return true;
 }
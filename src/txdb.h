@@ -33,6 +33,8 @@ static const int64_t nDefaultDbCache = 100;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! Maximum number of threads decoding the block index at startup
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 8;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -129,7 +131,9 @@ public:
     bool ReadFlag(const std::string& name, bool& fValue);
     bool WriteInt(const std::string& name, int nValue);
     bool ReadInt(const std::string& name, int& nValue);
-    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /** Hand every stored block index entry to insertBlockIndex, which is only
+     *  called from this thread; the values are decoded on nThreads others */
+    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads = 0);
 };
 
 #endif // BITCOIN_TXDB_H
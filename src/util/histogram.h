@@ -0,0 +1,96 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_HISTOGRAM_H
+#define BITCOIN_UTIL_HISTOGRAM_H
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Lock-free latency histogram with power-of-two microsecond buckets.
+ * Bucket i counts samples in [2^(i-1), 2^i) us, bucket 0 counts samples
+ * below 1us and the last bucket absorbs everything above its lower bound.
+ * Samples may be added concurrently from any thread; readers get a
+ * consistent-enough view for reporting (counters are relaxed).
+ */
+class CLatencyHistogram
+{
+public:
+    static const int NUM_BUCKETS = 32;
+
+    CLatencyHistogram() { Reset(); }
+
+    void Add(int64_t nMicros)
+    {
+        if (nMicros < 0) nMicros = 0;
+        int nBucket = 0;
+        uint64_t v = (uint64_t)nMicros;
+        while (v && nBucket < NUM_BUCKETS - 1) {
+            v >>= 1;
+            nBucket++;
+        }
+        buckets[nBucket].fetch_add(1, std::memory_order_relaxed);
+        nCount.fetch_add(1, std::memory_order_relaxed);
+        nTotal.fetch_add((uint64_t)nMicros, std::memory_order_relaxed);
+        uint64_t nPrevMax = nMax.load(std::memory_order_relaxed);
+        while ((uint64_t)nMicros > nPrevMax &&
+               !nMax.compare_exchange_weak(nPrevMax, (uint64_t)nMicros, std::memory_order_relaxed)) {}
+    }
+
+    void Reset()
+    {
+        for (int i = 0; i < NUM_BUCKETS; i++)
+            buckets[i].store(0, std::memory_order_relaxed);
+        nCount.store(0, std::memory_order_relaxed);
+        nTotal.store(0, std::memory_order_relaxed);
+        nMax.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t Count() const { return nCount.load(std::memory_order_relaxed); }
+    uint64_t TotalMicros() const { return nTotal.load(std::memory_order_relaxed); }
+    uint64_t MaxMicros() const { return nMax.load(std::memory_order_relaxed); }
+    uint64_t MeanMicros() const
+    {
+        const uint64_t n = Count();
+        return n ? TotalMicros() / n : 0;
+    }
+
+    /** Upper bound (exclusive, in us) of bucket i */
+    static uint64_t BucketLimit(int i) { return i == 0 ? 1 : ((uint64_t)1 << i); }
+
+    /** Estimate the given percentile (0-100) as the upper bound of the bucket containing it */
+    uint64_t Percentile(double dPct) const
+    {
+        const uint64_t n = Count();
+        if (n == 0) return 0;
+        const uint64_t nTarget = (uint64_t)(n * dPct / 100.0);
+        uint64_t nSeen = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            nSeen += buckets[i].load(std::memory_order_relaxed);
+            if (nSeen > nTarget) return BucketLimit(i);
+        }
+        return MaxMicros();
+    }
+
+    /** Non-empty buckets as (upper bound in us, count) pairs */
+    std::vector<std::pair<uint64_t, uint64_t> > GetBuckets() const
+    {
+        std::vector<std::pair<uint64_t, uint64_t> > ret;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            const uint64_t c = buckets[i].load(std::memory_order_relaxed);
+            if (c) ret.emplace_back(BucketLimit(i), c);
+        }
+        return ret;
+    }
+
+private:
+    std::atomic<uint64_t> buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> nCount;
+    std::atomic<uint64_t> nTotal;
+    std::atomic<uint64_t> nMax;
+};
+
+#endif // BITCOIN_UTIL_HISTOGRAM_H
@@ -7,50 +7,239 @@
 
 #include "validationinterface.h"
 
+#include "main.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "scheduler.h"
+#include "sync.h"
+
+#include <future>
+
 using namespace boost::placeholders;
 
+struct MainSignalsInstance {
+// XX42    boost::signals2::signal<void(const uint256&)> EraseTransaction;
+    boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
+    boost::signals2::signal<void (const CTransaction &, const CBlockIndex *pindex, int posInBlock)> SyncTransaction;
+    boost::signals2::signal<void (const CTransaction &, uint64_t nMempoolSequence)> TransactionAddedToMempool;
+    boost::signals2::signal<void (const CTransaction &, MemPoolRemovalReason, uint64_t nMempoolSequence)> TransactionRemovedFromMempool;
+    boost::signals2::signal<void (const CBlock &, const CBlockIndex *pindex)> BlockConnected;
+    boost::signals2::signal<void (const CBlock &, const CBlockIndex *pindex)> BlockDisconnected;
+    boost::signals2::signal<void (const CTransaction &)> NotifyTransactionLock;
+    boost::signals2::signal<bool (const uint256 &)> UpdatedTransaction;
+    boost::signals2::signal<void (const CBlockLocator &)> SetBestChain;
+    boost::signals2::signal<void (CConnman* connman)> Broadcast;
+    boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
+// XX42    boost::signals2::signal<void (boost::shared_ptr<CReserveScript>&)> ScriptForMining;
+    boost::signals2::signal<void (const uint256 &)> BlockFound;
+
+    // We are not allowed to assume the scheduler only runs in one thread,
+    // but must ensure all callbacks happen in-order, so we end up creating
+    // our own queue here :(
+    std::unique_ptr<SingleThreadedSchedulerClient> m_schedulerClient;
+
+    /** Run func on the background queue, or right away when there is none */
+    void Dispatch(std::function<void ()> func)
+    {
+        if (m_schedulerClient)
+            m_schedulerClient->AddToProcessQueue(std::move(func));
+        else
+            func();
+    }
+};
+
 static CMainSignals g_signals;
 
+CMainSignals::CMainSignals() : m_internals(new MainSignalsInstance()) {}
+
+CMainSignals::~CMainSignals() {}
+
+void CMainSignals::RegisterBackgroundSignalScheduler(CScheduler& scheduler)
+{
+    assert(!m_internals->m_schedulerClient);
+    m_internals->m_schedulerClient.reset(new SingleThreadedSchedulerClient(&scheduler));
+}
+
+void CMainSignals::UnregisterBackgroundSignalScheduler()
+{
+    m_internals->m_schedulerClient.reset();
+}
+
+void CMainSignals::FlushBackgroundCallbacks()
+{
+    if (m_internals->m_schedulerClient)
+        m_internals->m_schedulerClient->EmptyQueue();
+}
+
+size_t CMainSignals::CallbacksPending()
+{
+    return m_internals->m_schedulerClient ? m_internals->m_schedulerClient->CallbacksPending() : 0;
+}
+
 CMainSignals& GetMainSignals()
 {
     return g_signals;
 }
 
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
-// XX42 g_signals.EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
-    g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
-    g_signals.NotifyTransactionLock.connect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
-    g_signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.SetBestChain.connect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
-    g_signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
-    g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-// XX42    g_signals.ScriptForMining.connect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
-    g_signals.BlockFound.connect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
+// XX42 g_signals.m_internals->EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
+    g_signals.m_internals->UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+    g_signals.m_internals->SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
+    g_signals.m_internals->TransactionAddedToMempool.connect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1, _2));
+    g_signals.m_internals->TransactionRemovedFromMempool.connect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2, _3));
+    g_signals.m_internals->BlockConnected.connect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2));
+    g_signals.m_internals->BlockDisconnected.connect(boost::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1, _2));
+    g_signals.m_internals->NotifyTransactionLock.connect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
+    g_signals.m_internals->UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
+    g_signals.m_internals->SetBestChain.connect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
+    g_signals.m_internals->Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
+    g_signals.m_internals->BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
+// XX42    g_signals.m_internals->ScriptForMining.connect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
+    g_signals.m_internals->BlockFound.connect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.BlockFound.disconnect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
-// XX42    g_signals.ScriptForMining.disconnect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
-    g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-    g_signals.Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
-    g_signals.SetBestChain.disconnect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
-    g_signals.UpdatedTransaction.disconnect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.NotifyTransactionLock.disconnect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
-    g_signals.SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
-    g_signals.UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
-// XX42    g_signals.EraseTransaction.disconnect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
+    g_signals.m_internals->BlockFound.disconnect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
+// XX42    g_signals.m_internals->ScriptForMining.disconnect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
+    g_signals.m_internals->BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
+    g_signals.m_internals->Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
+    g_signals.m_internals->SetBestChain.disconnect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
+    g_signals.m_internals->UpdatedTransaction.disconnect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
+    g_signals.m_internals->NotifyTransactionLock.disconnect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
+    g_signals.m_internals->BlockDisconnected.disconnect(boost::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1, _2));
+    g_signals.m_internals->BlockConnected.disconnect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2));
+    g_signals.m_internals->TransactionRemovedFromMempool.disconnect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2, _3));
+    g_signals.m_internals->TransactionAddedToMempool.disconnect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1, _2));
+    g_signals.m_internals->SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
+    g_signals.m_internals->UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+// XX42    g_signals.m_internals->EraseTransaction.disconnect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
 }
 
 void UnregisterAllValidationInterfaces() {
-    g_signals.BlockFound.disconnect_all_slots();
-// XX42    g_signals.ScriptForMining.disconnect_all_slots();
-    g_signals.BlockChecked.disconnect_all_slots();
-    g_signals.Broadcast.disconnect_all_slots();
-    g_signals.SetBestChain.disconnect_all_slots();
-    g_signals.UpdatedTransaction.disconnect_all_slots();
-    g_signals.NotifyTransactionLock.disconnect_all_slots();
-    g_signals.SyncTransaction.disconnect_all_slots();
-    g_signals.UpdatedBlockTip.disconnect_all_slots();
-// XX42    g_signals.EraseTransaction.disconnect_all_slots();
+    g_signals.m_internals->BlockFound.disconnect_all_slots();
+// XX42    g_signals.m_internals->ScriptForMining.disconnect_all_slots();
+    g_signals.m_internals->BlockChecked.disconnect_all_slots();
+    g_signals.m_internals->Broadcast.disconnect_all_slots();
+    g_signals.m_internals->SetBestChain.disconnect_all_slots();
+    g_signals.m_internals->UpdatedTransaction.disconnect_all_slots();
+    g_signals.m_internals->NotifyTransactionLock.disconnect_all_slots();
+    g_signals.m_internals->BlockDisconnected.disconnect_all_slots();
+    g_signals.m_internals->BlockConnected.disconnect_all_slots();
+    g_signals.m_internals->TransactionRemovedFromMempool.disconnect_all_slots();
+    g_signals.m_internals->TransactionAddedToMempool.disconnect_all_slots();
+    g_signals.m_internals->SyncTransaction.disconnect_all_slots();
+    g_signals.m_internals->UpdatedBlockTip.disconnect_all_slots();
+// XX42    g_signals.m_internals->EraseTransaction.disconnect_all_slots();
+}
+
+void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
+    g_signals.m_internals->Dispatch(std::move(func));
+}
+
+void SyncWithValidationInterfaceQueue() {
+    AssertLockNotHeld(cs_main);
+    // Block until the validation queue drains
+    std::promise<void> promise;
+    CallFunctionInValidationInterfaceQueue([&promise] {
+        promise.set_value();
+    });
+    promise.get_future().wait();
+}
+
+bool SyncWithValidationInterfaceQueue(int64_t nTimeoutMillis) {
+    AssertLockNotHeld(cs_main);
+    // The promise outlives a wait that times out
+    auto promise = std::make_shared<std::promise<void> >();
+    CallFunctionInValidationInterfaceQueue([promise] {
+        promise->set_value();
+    });
+    return promise->get_future().wait_for(std::chrono::milliseconds(nTimeoutMillis)) == std::future_status::ready;
+}
+
+// Queued notifications copy their arguments: the caller's transaction and
+// block objects don't outlive the call. Block index entries are never freed
+// while running, so those are passed as-is. Nothing is queued when nobody is
+// listening.
+
+void CMainSignals::UpdatedBlockTip(const CBlockIndex* pindex) {
+    if (m_internals->UpdatedBlockTip.empty()) return;
+    MainSignalsInstance* internals = m_internals.get();
+    m_internals->Dispatch([internals, pindex] {
+        internals->UpdatedBlockTip(pindex);
+    });
+}
+
+void CMainSignals::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock) {
+    if (m_internals->SyncTransaction.empty()) return;
+    MainSignalsInstance* internals = m_internals.get();
+    m_internals->Dispatch([internals, tx, pindex, posInBlock] {
+        internals->SyncTransaction(tx, pindex, posInBlock);
+    });
+}
+
+void CMainSignals::TransactionAddedToMempool(const CTransaction& tx, uint64_t nMempoolSequence) {
+    if (m_internals->TransactionAddedToMempool.empty()) return;
+    MainSignalsInstance* internals = m_internals.get();
+    m_internals->Dispatch([internals, tx, nMempoolSequence] {
+        internals->TransactionAddedToMempool(tx, nMempoolSequence);
+    });
+}
+
+void CMainSignals::TransactionRemovedFromMempool(const CTransaction& tx, MemPoolRemovalReason reason, uint64_t nMempoolSequence) {
+    if (m_internals->TransactionRemovedFromMempool.empty()) return;
+    MainSignalsInstance* internals = m_internals.get();
+    m_internals->Dispatch([internals, tx, reason, nMempoolSequence] {
+        internals->TransactionRemovedFromMempool(tx, reason, nMempoolSequence);
+    });
+}
+
+void CMainSignals::BlockConnected(const CBlock& block, const CBlockIndex* pindex) {
+    if (m_internals->BlockConnected.empty()) return;
+    MainSignalsInstance* internals = m_internals.get();
+    std::shared_ptr<const CBlock> pblock = std::make_shared<const CBlock>(block);
+    m_internals->Dispatch([internals, pblock, pindex] {
+        internals->BlockConnected(*pblock, pindex);
+    });
+}
+
+void CMainSignals::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex) {
+    if (m_internals->BlockDisconnected.empty()) return;
+    MainSignalsInstance* internals = m_internals.get();
+    std::shared_ptr<const CBlock> pblock = std::make_shared<const CBlock>(block);
+    m_internals->Dispatch([internals, pblock, pindex] {
+        internals->BlockDisconnected(*pblock, pindex);
+    });
+}
+
+void CMainSignals::NotifyTransactionLock(const CTransaction& tx) {
+    if (m_internals->NotifyTransactionLock.empty()) return;
+    MainSignalsInstance* internals = m_internals.get();
+    m_internals->Dispatch([internals, tx] {
+        internals->NotifyTransactionLock(tx);
+    });
+}
+
+void CMainSignals::SetBestChain(const CBlockLocator& locator) {
+    if (m_internals->SetBestChain.empty()) return;
+    MainSignalsInstance* internals = m_internals.get();
+    m_internals->Dispatch([internals, locator] {
+        internals->SetBestChain(locator);
+    });
+}
+
+bool CMainSignals::UpdatedTransaction(const uint256& hash) {
+    boost::optional<bool> ret = m_internals->UpdatedTransaction(hash);
+    return ret ? *ret : false;
+}
+
+void CMainSignals::Broadcast(CConnman* connman) {
+    m_internals->Broadcast(connman);
+}
+
+void CMainSignals::BlockChecked(const CBlock& block, const CValidationState& state) {
+    m_internals->BlockChecked(block, state);
+}
+
+void CMainSignals::BlockFound(const uint256& hash) {
+    m_internals->BlockFound(hash);
 }
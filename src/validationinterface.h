@@ -11,15 +11,21 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <functional>
+#include <memory>
+#include <stdint.h>
+
 class CBlock;
 struct CBlockLocator;
 class CBlockIndex;
 class CConnman;
+class CScheduler;
 class CReserveScript;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
 class uint256;
+enum class MemPoolRemovalReason;
 
 // These functions dispatch to one or all registered wallets
 
@@ -29,12 +35,38 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn);
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
+/**
+ * Pushes a function to callback onto the notification queue, guaranteeing any
+ * callbacks generated prior to now are finished when the function is called.
+ *
+ * Be very careful blocking on func to be called if any locks are held -
+ * validation interface clients may not be able to make progress as they often
+ * wait for things like cs_main, so blocking until func is called with cs_main
+ * will result in a deadlock (that DEBUG_LOCKORDER will miss).
+ */
+void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+/**
+ * This is a synonym for the following, which asserts certain locks are not
+ * held:
+ *     std::promise<void> promise;
+ *     CallFunctionInValidationInterfaceQueue([&promise] {
+ *         promise.set_value();
+ *     });
+ *     promise.get_future().wait();
+ */
+void SyncWithValidationInterfaceQueue();
+/** Like SyncWithValidationInterfaceQueue, but gives up after nTimeoutMillis. Returns whether the queue drained. */
+bool SyncWithValidationInterfaceQueue(int64_t nTimeoutMillis);
 
 class CValidationInterface {
 protected:
 // XX42    virtual void EraseFromWallet(const uint256& hash){};
     virtual void UpdatedBlockTip(const CBlockIndex *pindex) {}
     virtual void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock) {}
+    virtual void TransactionAddedToMempool(const CTransaction &tx, uint64_t nMempoolSequence) {}
+    virtual void TransactionRemovedFromMempool(const CTransaction &tx, MemPoolRemovalReason reason, uint64_t nMempoolSequence) {}
+    virtual void BlockConnected(const CBlock &block, const CBlockIndex *pindex) {}
+    virtual void BlockDisconnected(const CBlock &block, const CBlockIndex *pindex) {}
     virtual void NotifyTransactionLock(const CTransaction &tx) {}
     virtual void SetBestChain(const CBlockLocator &locator) {}
     virtual bool UpdatedTransaction(const uint256 &hash) { return false;}
@@ -47,28 +79,70 @@ protected:
     friend void ::UnregisterAllValidationInterfaces();
 };
 
-struct CMainSignals {
-// XX42    boost::signals2::signal<void(const uint256&)> EraseTransaction;
-    /** Notifies listeners of updated block chain tip */
-    boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
+struct MainSignalsInstance;
+class CMainSignals {
+private:
+    std::unique_ptr<MainSignalsInstance> m_internals;
+
+    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::UnregisterValidationInterface(CValidationInterface*);
+    friend void ::UnregisterAllValidationInterfaces();
+    friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+
+public:
+    CMainSignals();
+    ~CMainSignals();
+
+    /** Register a CScheduler to give callbacks which should run in the background (may only be called once) */
+    void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
+    /** Unregister a CScheduler to give callbacks which should run in the background - these callbacks will now be dropped! */
+    void UnregisterBackgroundSignalScheduler();
+    /** Call any remaining callbacks on the calling thread */
+    void FlushBackgroundCallbacks();
+
+    size_t CallbacksPending();
+
     /** A posInBlock value for SyncTransaction which indicates the transaction was conflicted, disconnected, or not in a block */
     static const int SYNC_TRANSACTION_NOT_IN_BLOCK = -1;
+
+    /*
+     * The notifications below are queued and delivered in order on the
+     * background scheduler thread, so listeners must not assume cs_main is
+     * held or that the chain tip still matches the notification. Without a
+     * background scheduler (unit tests, or before it is registered) they are
+     * delivered synchronously.
+     */
+
+    /** Notifies listeners of updated block chain tip */
+    void UpdatedBlockTip(const CBlockIndex *);
     /** Notifies listeners of updated transaction data (transaction, and optionally the block it is found in. */
-    boost::signals2::signal<void (const CTransaction &, const CBlockIndex *pindex, int posInBlock)> SyncTransaction;
+    void SyncTransaction(const CTransaction &, const CBlockIndex *pindex, int posInBlock);
+    /** Notifies listeners of a transaction accepted to the mempool, tagged with the mempool sequence number */
+    void TransactionAddedToMempool(const CTransaction &, uint64_t nMempoolSequence);
+    /**
+     * Notifies listeners of a transaction leaving the mempool for any reason
+     * other than block inclusion (those are covered by BlockConnected).
+     */
+    void TransactionRemovedFromMempool(const CTransaction &, MemPoolRemovalReason, uint64_t nMempoolSequence);
+    /** Notifies listeners of a block being connected to the active chain */
+    void BlockConnected(const CBlock &, const CBlockIndex *pindex);
+    /** Notifies listeners of a block being disconnected from the active chain */
+    void BlockDisconnected(const CBlock &, const CBlockIndex *pindex);
     /** Notifies listeners of an updated transaction lock without new data. */
-    boost::signals2::signal<void (const CTransaction &)> NotifyTransactionLock;
-    /** Notifies listeners of an updated transaction without new data (for now: a coinbase potentially becoming visible). */
-    boost::signals2::signal<bool (const uint256 &)> UpdatedTransaction;
+    void NotifyTransactionLock(const CTransaction &);
     /** Notifies listeners of a new active block chain. */
-    boost::signals2::signal<void (const CBlockLocator &)> SetBestChain;
+    void SetBestChain(const CBlockLocator &);
+
+    /* The notifications below are delivered synchronously. */
+
+    /** Notifies listeners of an updated transaction without new data (for now: a coinbase potentially becoming visible). */
+    bool UpdatedTransaction(const uint256 &);
     /** Tells listeners to broadcast their data. */
-    boost::signals2::signal<void (CConnman* connman)> Broadcast;
+    void Broadcast(CConnman* connman);
     /** Notifies listeners of a block validation result */
-    boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
-    /** Notifies listeners that a key for mining is required (coinbase) */
-// XX42    boost::signals2::signal<void (boost::shared_ptr<CReserveScript>&)> ScriptForMining;
+    void BlockChecked(const CBlock&, const CValidationState&);
     /** Notifies listeners that a block has been successfully mined */
-    boost::signals2::signal<void (const uint256 &)> BlockFound;
+    void BlockFound(const uint256 &);
 };
 
 CMainSignals& GetMainSignals();
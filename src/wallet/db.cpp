@@ -215,13 +215,13 @@ bool CDBEnv::Salvage(std::string strFile, bool fAggressive, std::vector<CDBEnv::
 void CDBEnv::CheckpointLSN(const std::string& strFile)
 {
     dbenv->txn_checkpoint(0, 0, 0);
-    if (fMockDb)
+    if (fMockDb || mapSQLiteDb.count(strFile))
         return;
     dbenv->lsn_reset(strFile.c_str(), 0);
 }
 
 
-CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnCloseIn) : pdb(NULL), activeTxn(NULL)
+CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnCloseIn) : pdb(NULL), psqlite(NULL), activeTxn(NULL), fSQLiteTxn(false)
 {
     int ret;
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
@@ -239,6 +239,25 @@ CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnClose
         if (!bitdb.Open(GetDataDir()))
             throw std::runtime_error("CDB : Failed to open database environment.");
 
+        if (bitdb.IsSQLite(strFilename, fCreate)) {
+            std::unique_ptr<CSQLiteDatabase>& db = bitdb.mapSQLiteDb[strFilename];
+            if (!db)
+                db.reset(new CSQLiteDatabase(GetDataDir() / strFilename));
+            std::string strError;
+            if (!db->Open(fCreate, strError))
+                throw std::runtime_error(strprintf("CDB : %s", strError));
+            strFile = strFilename;
+            ++bitdb.mapFileUseCount[strFile];
+            psqlite = db.get();
+            if (fCreate && !Exists(std::string("version"))) {
+                bool fTmp = fReadOnly;
+                fReadOnly = false;
+                WriteVersion(CLIENT_VERSION);
+                fReadOnly = fTmp;
+            }
+            return;
+        }
+
         strFile = strFilename;
         ++bitdb.mapFileUseCount[strFile];
         pdb = bitdb.mapDb[strFile];
@@ -286,6 +305,13 @@ void CDB::Flush()
     if (activeTxn)
         return;
 
+    if (psqlite) {
+        // commits are already in the log; move them into the database file
+        if (!fSQLiteTxn)
+            psqlite->Checkpoint(false);
+        return;
+    }
+
     // Flush database activity from memory pool to disk log
     unsigned int nMinutes = 0;
     if (fReadOnly)
@@ -296,15 +322,19 @@ void CDB::Flush()
 
 void CDB::Close()
 {
-    if (!pdb)
+    if (!pdb && !psqlite)
         return;
     if (activeTxn)
         activeTxn->abort();
     activeTxn = NULL;
+    if (fSQLiteTxn)
+        psqlite->TxnAbort();
+    fSQLiteTxn = false;
     pdb = NULL;
 
     if (fFlushOnClose)
         Flush();
+    psqlite = NULL;
 
     {
         LOCK(bitdb.cs_db);
@@ -316,6 +346,16 @@ void CDBEnv::CloseDb(const std::string& strFile)
 {
     {
         LOCK(cs_db);
+        auto it = mapSQLiteDb.find(strFile);
+        if (it != mapSQLiteDb.end()) {
+            // A batch is open without any handle in use. Closing would commit
+            // it halfway, it is left to CommitBatch.
+            if (it->second->GetTxnDepth() > 0)
+                return;
+            // Checkpoints the log into the file
+            it->second->Close();
+            return;
+        }
         if (mapDb[strFile] != NULL) {
             // Close the database handle
             Db* pdb = mapDb[strFile];
@@ -335,11 +375,151 @@ bool CDBEnv::RemoveDb(const std::string& strFile)
     return (rc == 0);
 }
 
+bool CDBEnv::IsSQLite(const std::string& strFile, bool fCreate)
+{
+    LOCK(cs_db);
+    if (mapSQLiteDb.count(strFile))
+        return true;
+    auto it = mapDb.find(strFile);
+    if (fMockDb || (it != mapDb.end() && it->second != NULL))
+        return false;
+    const fs::path path = GetDataDir() / strFile;
+    if (fs::exists(path))
+        return IsSQLiteFile(path);
+    return fCreate && GetArg("-walletbackend", DEFAULT_WALLET_BACKEND) == WALLET_BACKEND_SQLITE;
+}
+
+CSQLiteDatabase* CDBEnv::GetSQLiteDb(const std::string& strFile)
+{
+    LOCK(cs_db);
+    auto it = mapSQLiteDb.find(strFile);
+    if (it == mapSQLiteDb.end() || !it->second->IsOpen())
+        return NULL;
+    return it->second.get();
+}
+
+bool CDBEnv::BeginBatch(const std::string& strFile)
+{
+    LOCK(cs_db);
+    CSQLiteDatabase* db = GetSQLiteDb(strFile);
+    if (!db || setBatchOpen.count(strFile) || !db->TxnBegin())
+        return false;
+    setBatchOpen.insert(strFile);
+    return true;
+}
+
+bool CDBEnv::CommitBatch(const std::string& strFile)
+{
+    LOCK(cs_db);
+    if (!setBatchOpen.erase(strFile))
+        return false;
+    // CloseDb leaves the connection open while the batch is, but it may be
+    // gone after a shutdown
+    CSQLiteDatabase* db = GetSQLiteDb(strFile);
+    return !db || db->TxnCommit();
+}
+
+bool CDB::MigrateToSQLite(const std::string& strFile, std::string& strError)
+{
+    LOCK(bitdb.cs_db);
+    if (bitdb.IsSQLite(strFile)) {
+        strError = "wallet file is already an SQLite database";
+        return false;
+    }
+    if (bitdb.mapFileUseCount.count(strFile) && bitdb.mapFileUseCount[strFile] > 0) {
+        strError = "wallet file is in use";
+        return false;
+    }
+
+    const int64_t nStart = GetTimeMillis();
+    const fs::path pathFile = GetDataDir() / strFile;
+    const fs::path pathNew = GetDataDir() / (strFile + ".migrate");
+    const fs::path pathBak = GetDataDir() / strprintf("%s.%d.bdb.bak", strFile, GetTime());
+    fs::remove(pathNew);
+
+    unsigned int nRecords = 0;
+    {
+        CSQLiteDatabase dbNew(pathNew);
+        if (!dbNew.Open(true, strError))
+            return false;
+
+        CDB db(strFile, "r");
+        std::unique_ptr<CDBCursor> pcursor = db.GetCursor();
+        if (!pcursor || !dbNew.TxnBegin()) {
+            strError = "can't read the wallet file";
+            return false;
+        }
+        while (true) {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            int ret = db.ReadAtCursor(pcursor.get(), ssKey, ssValue, DB_NEXT);
+            if (ret == DB_NOTFOUND)
+                break;
+            if (ret != 0 || !dbNew.Write(ssKey, ssValue, false)) {
+                strError = strprintf("error copying record %u", nRecords);
+                dbNew.TxnAbort();
+                return false;
+            }
+            nRecords++;
+        }
+        if (!dbNew.TxnCommit()) {
+            strError = "error committing the new wallet file";
+            return false;
+        }
+
+        // Count the records back before replacing anything
+        unsigned int nCopied = 0;
+        {
+            std::unique_ptr<CSQLiteDatabase::Cursor> pcursorNew(dbNew.GetCursor());
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            while (pcursorNew && pcursorNew->Next(ssKey, ssValue) > 0)
+                nCopied++;
+        }
+        if (nCopied != nRecords) {
+            strError = strprintf("copied %u of %u records", nCopied, nRecords);
+            return false;
+        }
+        pcursor.reset();
+        db.Close();
+        dbNew.Close();
+    }
+
+    bitdb.CloseDb(strFile);
+    bitdb.CheckpointLSN(strFile);
+    bitdb.mapFileUseCount.erase(strFile);
+    bitdb.mapDb.erase(strFile);
+    try {
+        fs::rename(pathFile, pathBak);
+        fs::rename(pathNew, pathFile);
+    } catch (const fs::filesystem_error& e) {
+        strError = e.what();
+        return false;
+    }
+    LogPrintf("Migrated %s to SQLite: %u records in %dms, Berkeley DB file kept as %s\n",
+        strFile, nRecords, GetTimeMillis() - nStart, pathBak.filename().string());
+    return true;
+}
+
 bool CDB::Rewrite(const std::string& strFile, const char* pszSkip)
 {
     while (true) {
         {
             LOCK(bitdb.cs_db);
+            if (bitdb.IsSQLite(strFile) && (!bitdb.mapFileUseCount.count(strFile) || bitdb.mapFileUseCount[strFile] == 0)) {
+                // SQLite frees pages in place: drop the skipped records and
+                // rebuild the file, no copy needed
+                LogPrintf("CDB::Rewrite : Rewriting %s...\n", strFile);
+                bool fSuccess;
+                {
+                    CDB db(strFile.c_str(), "r+");
+                    fSuccess = (!pszSkip || db.psqlite->ErasePrefix(pszSkip)) && db.WriteVersion(CLIENT_VERSION);
+                    fSuccess = fSuccess && db.psqlite->Vacuum();
+                }
+                if (!fSuccess)
+                    LogPrintf("CDB::Rewrite : Failed to rewrite database file %s\n", strFile);
+                return fSuccess;
+            }
             if (!bitdb.mapFileUseCount.count(strFile) || bitdb.mapFileUseCount[strFile] == 0) {
                 // Flush log data to the dat file
                 bitdb.CloseDb(strFile);
@@ -364,17 +544,17 @@ bool CDB::Rewrite(const std::string& strFile, const char* pszSkip)
                         fSuccess = false;
                     }
 
-                    Dbc* pcursor = db.GetCursor();
+                    std::unique_ptr<CDBCursor> pcursor = db.GetCursor();
                     if (pcursor)
                         while (fSuccess) {
                             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
                             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-                            int ret = db.ReadAtCursor(pcursor, ssKey, ssValue, DB_NEXT);
+                            int ret = db.ReadAtCursor(pcursor.get(), ssKey, ssValue, DB_NEXT);
                             if (ret == DB_NOTFOUND) {
-                                pcursor->close();
+                                pcursor.reset();
                                 break;
                             } else if (ret != 0) {
-                                pcursor->close();
+                                pcursor.reset();
                                 fSuccess = false;
                                 break;
                             }
@@ -439,7 +619,7 @@ void CDBEnv::Flush(bool fShutdown)
                 LogPrint(BCLog::DB, "CDBEnv::Flush: %s checkpoint\n", strFile);
                 dbenv->txn_checkpoint(0, 0, 0);
                 LogPrint(BCLog::DB, "CDBEnv::Flush: %s detach\n", strFile);
-                if (!fMockDb)
+                if (!fMockDb && !mapSQLiteDb.count(strFile))
                     dbenv->lsn_reset(strFile.c_str(), 0);
                 LogPrint(BCLog::DB, "CDBEnv::Flush: %s closed\n", strFile);
                 mapFileUseCount.erase(mi++);
@@ -14,8 +14,11 @@
 #include "streams.h"
 #include "sync.h"
 #include "version.h"
+#include "wallet/sqlitedb.h"
 
 #include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -45,6 +48,10 @@ public:
     DbEnv *dbenv;
     std::map<std::string, int> mapFileUseCount;
     std::map<std::string, Db*> mapDb;
+    //! Wallet files kept in SQLite instead, with their shared connection
+    std::map<std::string, std::unique_ptr<CSQLiteDatabase> > mapSQLiteDb;
+    //! SQLite wallet files with a batch open, see BeginBatch()
+    std::set<std::string> setBatchOpen;
 
     CDBEnv();
     ~CDBEnv();
@@ -81,6 +88,18 @@ public:
     void CloseDb(const std::string& strFile);
     bool RemoveDb(const std::string& strFile);
 
+    /** True if strFile is (or, when created, will be) an SQLite wallet file */
+    bool IsSQLite(const std::string& strFile, bool fCreate = false);
+    /** Open SQLite connection for strFile, nullptr if it has none */
+    CSQLiteDatabase* GetSQLiteDb(const std::string& strFile);
+
+    /**
+     * Group all writes to strFile into one transaction until CommitBatch().
+     * Only SQLite wallet files batch; returns false for Berkeley DB files.
+     */
+    bool BeginBatch(const std::string& strFile);
+    bool CommitBatch(const std::string& strFile);
+
     DbTxn* TxnBegin(int flags = DB_TXN_WRITE_NOSYNC)
     {
         DbTxn* ptxn = NULL;
@@ -93,14 +112,36 @@ public:
 
 extern CDBEnv bitdb;
 
+/** Cursor over the records of a CDB, on either backend */
+class CDBCursor
+{
+public:
+    explicit CDBCursor(Dbc* pdbcIn) : pdbc(pdbcIn) {}
+    explicit CDBCursor(CSQLiteDatabase::Cursor* psqliteIn) : pdbc(NULL), psqlite(psqliteIn) {}
+    ~CDBCursor()
+    {
+        if (pdbc)
+            pdbc->close();
+    }
 
-/** RAII class that provides access to a Berkeley database */
+    Dbc* pdbc;
+    std::unique_ptr<CSQLiteDatabase::Cursor> psqlite;
+
+private:
+    CDBCursor(const CDBCursor&);
+    void operator=(const CDBCursor&);
+};
+
+
+/** RAII class that provides access to a wallet database, Berkeley DB or SQLite */
 class CDB
 {
 protected:
     Db* pdb;
+    CSQLiteDatabase* psqlite;
     std::string strFile;
     DbTxn* activeTxn;
+    bool fSQLiteTxn;
     bool fReadOnly;
     bool fFlushOnClose;
 
@@ -119,13 +160,29 @@ protected:
     template <typename K, typename T>
     bool Read(const K& key, T& value)
     {
-        if (!pdb)
+        if (!pdb && !psqlite)
             return false;
 
         // Key
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+        if (psqlite) {
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            bool success = false;
+            if (psqlite->Read(ssKey, ssValue)) {
+                try {
+                    ssValue >> value;
+                    success = true;
+                } catch (const std::exception&) {
+                    // In this case success remains 'false'
+                }
+            }
+            memory_cleanse(&ssKey[0], ssKey.size());
+            if (!ssValue.empty())
+                memory_cleanse(&ssValue[0], ssValue.size());
+            return success;
+        }
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Read
@@ -154,7 +211,7 @@ protected:
     template <typename K, typename T>
     bool Write(const K& key, const T& value, bool fOverwrite = true)
     {
-        if (!pdb)
+        if (!pdb && !psqlite)
             return false;
         if (fReadOnly)
             assert(!"Write called on database in read-only mode");
@@ -169,6 +226,12 @@ protected:
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
         ssValue.reserve(10000);
         ssValue << value;
+        if (psqlite) {
+            bool fOk = psqlite->Write(ssKey, ssValue, fOverwrite);
+            memory_cleanse(&ssKey[0], ssKey.size());
+            memory_cleanse(&ssValue[0], ssValue.size());
+            return fOk;
+        }
         Dbt datValue(&ssValue[0], ssValue.size());
 
         // Write
@@ -183,7 +246,7 @@ protected:
     template <typename K>
     bool Erase(const K& key)
     {
-        if (!pdb)
+        if (!pdb && !psqlite)
             return false;
         if (fReadOnly)
             assert(!"Erase called on database in read-only mode");
@@ -192,6 +255,8 @@ protected:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+        if (psqlite)
+            return psqlite->Erase(ssKey);
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Erase
@@ -205,13 +270,15 @@ protected:
     template <typename K>
     bool Exists(const K& key)
     {
-        if (!pdb)
+        if (!pdb && !psqlite)
             return false;
 
         // Key
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+        if (psqlite)
+            return psqlite->Exists(ssKey);
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Exists
@@ -222,19 +289,36 @@ protected:
         return (ret == 0);
     }
 
-    Dbc* GetCursor()
+    std::unique_ptr<CDBCursor> GetCursor()
     {
+        if (psqlite) {
+            CSQLiteDatabase::Cursor* pcursor = psqlite->GetCursor();
+            if (!pcursor)
+                return nullptr;
+            return std::unique_ptr<CDBCursor>(new CDBCursor(pcursor));
+        }
         if (!pdb)
-            return NULL;
+            return nullptr;
         Dbc* pcursor = NULL;
         int ret = pdb->cursor(NULL, &pcursor, 0);
         if (ret != 0)
-            return NULL;
-        return pcursor;
+            return nullptr;
+        return std::unique_ptr<CDBCursor>(new CDBCursor(pcursor));
     }
 
-    int ReadAtCursor(Dbc* pcursor, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags = DB_NEXT)
+    /** Read the next record (DB_NEXT) or the first with a key >= ssKey (DB_SET_RANGE) */
+    int ReadAtCursor(CDBCursor* pcursor, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags = DB_NEXT)
     {
+        if (pcursor->psqlite) {
+            assert(fFlags == DB_NEXT || fFlags == DB_SET_RANGE);
+            if (fFlags == DB_SET_RANGE && !pcursor->psqlite->Seek(ssKey))
+                return 99999;
+            int ret = pcursor->psqlite->Next(ssKey, ssValue);
+            ssKey.SetType(SER_DISK);
+            ssValue.SetType(SER_DISK);
+            return ret > 0 ? 0 : (ret == 0 ? DB_NOTFOUND : 99999);
+        }
+
         // Read at cursor
         Dbt datKey;
         if (fFlags == DB_SET || fFlags == DB_SET_RANGE || fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
@@ -248,7 +332,7 @@ protected:
         }
         datKey.set_flags(DB_DBT_MALLOC);
         datValue.set_flags(DB_DBT_MALLOC);
-        int ret = pcursor->get(&datKey, &datValue, fFlags);
+        int ret = pcursor->pdbc->get(&datKey, &datValue, fFlags);
         if (ret != 0)
             return ret;
         else if (datKey.get_data() == NULL || datValue.get_data() == NULL)
@@ -273,6 +357,12 @@ protected:
 public:
     bool TxnBegin()
     {
+        if (psqlite) {
+            if (fSQLiteTxn || !psqlite->TxnBegin())
+                return false;
+            fSQLiteTxn = true;
+            return true;
+        }
         if (!pdb || activeTxn)
             return false;
         DbTxn* ptxn = bitdb.TxnBegin();
@@ -284,6 +374,12 @@ public:
 
     bool TxnCommit()
     {
+        if (psqlite) {
+            if (!fSQLiteTxn)
+                return false;
+            fSQLiteTxn = false;
+            return psqlite->TxnCommit();
+        }
         if (!pdb || !activeTxn)
             return false;
         int ret = activeTxn->commit(0);
@@ -293,6 +389,12 @@ public:
 
     bool TxnAbort()
     {
+        if (psqlite) {
+            if (!fSQLiteTxn)
+                return false;
+            fSQLiteTxn = false;
+            return psqlite->TxnAbort();
+        }
         if (!pdb || !activeTxn)
             return false;
         int ret = activeTxn->abort();
@@ -312,6 +414,11 @@ public:
     }
 
     bool static Rewrite(const std::string& strFile, const char* pszSkip = NULL);
+    /**
+     * Copy every record of the Berkeley DB wallet strFile into a new SQLite
+     * file and put it in place; the old file is kept as strFile.<time>.bdb.bak
+     */
+    bool static MigrateToSQLite(const std::string& strFile, std::string& strError);
 };
 
 #endif // BITCOIN_DB_H
@@ -21,6 +21,7 @@
 #include "wallet.h"
 #include "walletdb.h"
 
+#include <limits>
 #include <stdint.h>
 
 #include "spork.h"
@@ -2906,6 +2907,87 @@ UniValue getstakesplitthreshold(const JSONRPCRequest& request)
     return ValueFromAmount(pwalletMain->nStakeSplitThreshold);
 }
 
+UniValue getrewardhistory(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 3)
+        throw std::runtime_error(
+            "getrewardhistory ( \"groupby\" from to )\n"
+            "\nReturns the staking and masternode rewards of the wallet, summed up per day, month or year (UTC).\n"
+            "Only coinstakes in the active chain are counted.\n"
+
+            "\nArguments:\n"
+            "1. \"groupby\"    (string, optional, default=\"day\") \"day\", \"month\" or \"year\"\n"
+            "2. from         (numeric, optional) Only rewards at or after this time (seconds since epoch)\n"
+            "3. to           (numeric, optional) Only rewards before this time (seconds since epoch)\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"date\": \"yyyy-mm-dd\",      (string) The period (\"yyyy-mm\" by month, \"yyyy\" by year)\n"
+            "    \"stake\": x.xxx,            (numeric) Staking rewards in " + CURRENCY_UNIT + "\n"
+            "    \"stakes\": n,               (numeric) Number of stakes\n"
+            "    \"masternode\": x.xxx,       (numeric) Masternode rewards in " + CURRENCY_UNIT + "\n"
+            "    \"masternoderewards\": n     (numeric) Number of masternode rewards\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getrewardhistory", "") + HelpExampleCli("getrewardhistory", "\"month\" 1640995200") +
+            HelpExampleRpc("getrewardhistory", "\"month\", 1640995200"));
+
+    std::string strGroupBy = "day";
+    if (request.params.size() > 0 && !request.params[0].isNull())
+        strGroupBy = request.params[0].get_str();
+    const char* pszFormat;
+    if (strGroupBy == "day")
+        pszFormat = "%Y-%m-%d";
+    else if (strGroupBy == "month")
+        pszFormat = "%Y-%m";
+    else if (strGroupBy == "year")
+        pszFormat = "%Y";
+    else
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid groupby, expected day, month or year");
+
+    int nDayFrom = std::numeric_limits<int>::min();
+    int nDayTo = std::numeric_limits<int>::max();
+    if (request.params.size() > 1)
+        nDayFrom = CRewardDay::GetDay(request.params[1].get_int64());
+    if (request.params.size() > 2)
+        nDayTo = CRewardDay::GetDay(request.params[2].get_int64() - 1);
+
+    // days come in order, so a period is complete when the next one starts
+    UniValue ret(UniValue::VARR);
+    std::string strPeriod;
+    CRewardDay total;
+    auto pushPeriod = [&]() {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("date", strPeriod));
+        entry.push_back(Pair("stake", ValueFromAmount(total.nStake)));
+        entry.push_back(Pair("stakes", total.nStakes));
+        entry.push_back(Pair("masternode", ValueFromAmount(total.nMasternode)));
+        entry.push_back(Pair("masternoderewards", total.nMasternodeRewards));
+        ret.push_back(entry);
+    };
+    for (const auto& it : pwalletMain->GetRewardHistory(nDayFrom, nDayTo)) {
+        const std::string strDate = DateTimeStrFormat(pszFormat, (int64_t)it.first * 86400);
+        if (strDate != strPeriod) {
+            if (!strPeriod.empty())
+                pushPeriod();
+            strPeriod = strDate;
+            total = CRewardDay();
+        }
+        total.nStake += it.second.nStake;
+        total.nStakes += it.second.nStakes;
+        total.nMasternode += it.second.nMasternode;
+        total.nMasternodeRewards += it.second.nMasternodeRewards;
+    }
+    if (!strPeriod.empty())
+        pushPeriod();
+
+    return ret;
+}
+
 UniValue autocombinerewards(const JSONRPCRequest& request)
 {
     if (!IsDeprecatedRPCEnabled("autocombinerewards")) {
@@ -3278,6 +3360,7 @@ const CRPCCommand vWalletRPCCommands[] =
         { "wallet",             "getnewaddress",            &getnewaddress,            true  },
         { "wallet",             "getrawchangeaddress",      &getrawchangeaddress,      true  },
         { "wallet",             "getreceivedbyaddress",     &getreceivedbyaddress,     false },
+        { "wallet",             "getrewardhistory",         &getrewardhistory,         false },
         { "wallet",             "gettransaction",           &gettransaction,           false },
         { "wallet",             "getstakesplitthreshold",   &getstakesplitthreshold,   false },
         { "wallet",             "getunconfirmedbalance",    &getunconfirmedbalance,    false },
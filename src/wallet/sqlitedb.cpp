@@ -0,0 +1,378 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/sqlitedb.h"
+
+#include "sqlite3/sqlite3.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool IsSQLiteFile(const fs::path& path)
+{
+    static const char MAGIC[16] = "SQLite format 3";
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file)
+        return false;
+    char header[sizeof(MAGIC)];
+    const bool fRead = fread(header, 1, sizeof(header), file) == sizeof(header);
+    fclose(file);
+    return fRead && memcmp(header, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+CSQLiteDatabase::CSQLiteDatabase(const fs::path& pathIn) : path(pathIn),
+                                                           db(nullptr),
+                                                           stmtRead(nullptr),
+                                                           stmtInsert(nullptr),
+                                                           stmtInsertNew(nullptr),
+                                                           stmtErase(nullptr),
+                                                           stmtExists(nullptr),
+                                                           nTxnDepth(0)
+{
+}
+
+CSQLiteDatabase::~CSQLiteDatabase()
+{
+    Close();
+}
+
+bool CSQLiteDatabase::Exec(const char* pszSql, std::string* pstrError)
+{
+    char* pszError = nullptr;
+    if (sqlite3_exec(db, pszSql, nullptr, nullptr, &pszError) != SQLITE_OK) {
+        std::string strError = strprintf("%s: %s", pszSql, pszError ? pszError : sqlite3_errmsg(db));
+        sqlite3_free(pszError);
+        if (pstrError)
+            *pstrError = strError;
+        else
+            LogPrintf("CSQLiteDatabase: %s failed: %s\n", path.filename().string(), strError);
+        return false;
+    }
+    return true;
+}
+
+bool CSQLiteDatabase::Prepare(const char* pszSql, sqlite3_stmt*& stmt, std::string& strError)
+{
+    if (sqlite3_prepare_v2(db, pszSql, -1, &stmt, nullptr) != SQLITE_OK) {
+        strError = strprintf("%s: %s", pszSql, sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+bool CSQLiteDatabase::Open(bool fCreate, std::string& strError)
+{
+    LOCK(cs);
+    if (db)
+        return true;
+
+    int nFlags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX;
+    if (fCreate)
+        nFlags |= SQLITE_OPEN_CREATE;
+    if (sqlite3_open_v2(path.string().c_str(), &db, nFlags, nullptr) != SQLITE_OK) {
+        strError = strprintf("can't open %s: %s", path.string(), db ? sqlite3_errmsg(db) : "out of memory");
+        Close();
+        return false;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    // WAL: commits append to the log and readers don't block the writer.
+    // NORMAL sync is durable across application crashes and only risks the
+    // last commits on power loss, the same guarantee DB_TXN_WRITE_NOSYNC
+    // gave the Berkeley DB wallet.
+    if (!Exec("PRAGMA journal_mode=WAL", &strError) ||
+        !Exec("PRAGMA synchronous=NORMAL", &strError) ||
+        !Exec("PRAGMA secure_delete=ON", &strError) ||
+        !Exec("CREATE TABLE IF NOT EXISTS main(key BLOB PRIMARY KEY NOT NULL, value BLOB NOT NULL)", &strError) ||
+        !Prepare("SELECT value FROM main WHERE key = ?", stmtRead, strError) ||
+        !Prepare("INSERT OR REPLACE INTO main(key, value) VALUES(?, ?)", stmtInsert, strError) ||
+        !Prepare("INSERT OR IGNORE INTO main(key, value) VALUES(?, ?)", stmtInsertNew, strError) ||
+        !Prepare("DELETE FROM main WHERE key = ?", stmtErase, strError) ||
+        !Prepare("SELECT 1 FROM main WHERE key = ?", stmtExists, strError)) {
+        strError = strprintf("can't set up %s: %s", path.string(), strError);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void CSQLiteDatabase::Close()
+{
+    LOCK(cs);
+    if (!db)
+        return;
+    if (nTxnDepth > 0) {
+        LogPrintf("CSQLiteDatabase: committing open transaction on close of %s\n", path.filename().string());
+        Exec("COMMIT");
+        nTxnDepth = 0;
+    }
+    for (sqlite3_stmt** pstmt : {&stmtRead, &stmtInsert, &stmtInsertNew, &stmtErase, &stmtExists}) {
+        sqlite3_finalize(*pstmt);
+        *pstmt = nullptr;
+    }
+    sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr);
+    if (sqlite3_close(db) != SQLITE_OK)
+        LogPrintf("CSQLiteDatabase: failed to close %s: %s\n", path.filename().string(), sqlite3_errmsg(db));
+    db = nullptr;
+}
+
+bool CSQLiteDatabase::Step(sqlite3_stmt* stmt, const char* pszWhat)
+{
+    const int ret = sqlite3_step(stmt);
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+    if (ret != SQLITE_DONE) {
+        LogPrintf("CSQLiteDatabase: %s failed on %s: %s\n", pszWhat, path.filename().string(), sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+static int BindBlob(sqlite3_stmt* stmt, int nCol, const CDataStream& ss)
+{
+    // SQLITE_STATIC: the stream outlives the statement step
+    return sqlite3_bind_blob(stmt, nCol, ss.empty() ? "" : &ss[0], ss.size(), SQLITE_STATIC);
+}
+
+static void ReadBlob(sqlite3_stmt* stmt, int nCol, CDataStream& ss)
+{
+    const char* pch = (const char*)sqlite3_column_blob(stmt, nCol);
+    ss.clear();
+    if (pch)
+        ss.write(pch, sqlite3_column_bytes(stmt, nCol));
+}
+
+bool CSQLiteDatabase::Read(const CDataStream& ssKey, CDataStream& ssValue)
+{
+    LOCK(cs);
+    if (!db || BindBlob(stmtRead, 1, ssKey) != SQLITE_OK)
+        return false;
+    const int ret = sqlite3_step(stmtRead);
+    if (ret == SQLITE_ROW) {
+        ReadBlob(stmtRead, 0, ssValue);
+    } else if (ret != SQLITE_DONE) {
+        LogPrintf("CSQLiteDatabase: read failed on %s: %s\n", path.filename().string(), sqlite3_errmsg(db));
+    }
+    sqlite3_clear_bindings(stmtRead);
+    sqlite3_reset(stmtRead);
+    return ret == SQLITE_ROW;
+}
+
+bool CSQLiteDatabase::Write(const CDataStream& ssKey, const CDataStream& ssValue, bool fOverwrite)
+{
+    LOCK(cs);
+    if (!db)
+        return false;
+    sqlite3_stmt* stmt = fOverwrite ? stmtInsert : stmtInsertNew;
+    if (BindBlob(stmt, 1, ssKey) != SQLITE_OK || BindBlob(stmt, 2, ssValue) != SQLITE_OK) {
+        sqlite3_clear_bindings(stmt);
+        return false;
+    }
+    if (!Step(stmt, "write"))
+        return false;
+    // INSERT OR IGNORE leaves an existing record alone, like DB_NOOVERWRITE
+    return fOverwrite || sqlite3_changes(db) > 0;
+}
+
+bool CSQLiteDatabase::Erase(const CDataStream& ssKey)
+{
+    LOCK(cs);
+    if (!db || BindBlob(stmtErase, 1, ssKey) != SQLITE_OK)
+        return false;
+    return Step(stmtErase, "erase");
+}
+
+bool CSQLiteDatabase::Exists(const CDataStream& ssKey)
+{
+    LOCK(cs);
+    if (!db || BindBlob(stmtExists, 1, ssKey) != SQLITE_OK)
+        return false;
+    const int ret = sqlite3_step(stmtExists);
+    sqlite3_clear_bindings(stmtExists);
+    sqlite3_reset(stmtExists);
+    return ret == SQLITE_ROW;
+}
+
+bool CSQLiteDatabase::ErasePrefix(const std::string& strPrefix)
+{
+    LOCK(cs);
+    if (!db)
+        return false;
+    sqlite3_stmt* stmt;
+    std::string strError;
+    if (!Prepare("DELETE FROM main WHERE substr(key, 1, ?) = ?", stmt, strError)) {
+        LogPrintf("CSQLiteDatabase: %s\n", strError);
+        return false;
+    }
+    sqlite3_bind_int(stmt, 1, strPrefix.size());
+    sqlite3_bind_blob(stmt, 2, strPrefix.data(), strPrefix.size(), SQLITE_STATIC);
+    const bool fOk = Step(stmt, "erase prefix");
+    sqlite3_finalize(stmt);
+    return fOk;
+}
+
+bool CSQLiteDatabase::TxnBegin()
+{
+    LOCK(cs);
+    if (!db)
+        return false;
+    if (!Exec(nTxnDepth == 0 ? "BEGIN" : strprintf("SAVEPOINT txn%d", nTxnDepth).c_str()))
+        return false;
+    nTxnDepth++;
+    return true;
+}
+
+bool CSQLiteDatabase::TxnCommit()
+{
+    LOCK(cs);
+    if (!db || nTxnDepth == 0)
+        return false;
+    nTxnDepth--;
+    return Exec(nTxnDepth == 0 ? "COMMIT" : strprintf("RELEASE txn%d", nTxnDepth).c_str());
+}
+
+bool CSQLiteDatabase::TxnAbort()
+{
+    LOCK(cs);
+    if (!db || nTxnDepth == 0)
+        return false;
+    nTxnDepth--;
+    if (nTxnDepth == 0)
+        return Exec("ROLLBACK");
+    // ROLLBACK TO keeps the savepoint on the stack
+    return Exec(strprintf("ROLLBACK TO txn%d", nTxnDepth).c_str()) &&
+           Exec(strprintf("RELEASE txn%d", nTxnDepth).c_str());
+}
+
+int CSQLiteDatabase::GetTxnDepth() const
+{
+    LOCK(cs);
+    return nTxnDepth;
+}
+
+void CSQLiteDatabase::Checkpoint(bool fTruncate)
+{
+    LOCK(cs);
+    if (!db || nTxnDepth > 0)
+        return;
+    sqlite3_wal_checkpoint_v2(db, nullptr, fTruncate ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+}
+
+bool CSQLiteDatabase::Vacuum()
+{
+    LOCK(cs);
+    return db && nTxnDepth == 0 && Exec("VACUUM");
+}
+
+bool CSQLiteDatabase::Verify(std::string& strError)
+{
+    LOCK(cs);
+    if (!db)
+        return false;
+    sqlite3_stmt* stmt;
+    if (!Prepare("PRAGMA integrity_check", stmt, strError))
+        return false;
+    std::string strResult;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* psz = (const char*)sqlite3_column_text(stmt, 0);
+        if (psz && strcmp(psz, "ok") != 0)
+            strResult += strprintf("%s%s", strResult.empty() ? "" : "; ", psz);
+    }
+    sqlite3_finalize(stmt);
+    if (!strResult.empty()) {
+        strError = strResult;
+        return false;
+    }
+    return true;
+}
+
+bool CSQLiteDatabase::Backup(const fs::path& pathDest, std::string& strError)
+{
+    // Copy through a read connection of its own rather than under cs: in WAL
+    // mode it reads a snapshot of the last commit, and the wallet keeps
+    // writing through db meanwhile, or has it closed.
+    sqlite3* dbSrc = nullptr;
+    if (sqlite3_open_v2(path.string().c_str(), &dbSrc, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        strError = strprintf("can't open %s: %s", path.string(), dbSrc ? sqlite3_errmsg(dbSrc) : "out of memory");
+        sqlite3_close(dbSrc);
+        return false;
+    }
+    sqlite3_busy_timeout(dbSrc, 5000);
+    sqlite3* dbDest = nullptr;
+    if (sqlite3_open(pathDest.string().c_str(), &dbDest) != SQLITE_OK) {
+        strError = strprintf("can't open %s: %s", pathDest.string(), dbDest ? sqlite3_errmsg(dbDest) : "out of memory");
+        sqlite3_close(dbDest);
+        sqlite3_close(dbSrc);
+        return false;
+    }
+
+    const int64_t nStart = GetTimeMillis();
+    sqlite3_backup* backup = sqlite3_backup_init(dbDest, "main", dbSrc, "main");
+    if (!backup) {
+        strError = sqlite3_errmsg(dbDest);
+        sqlite3_close(dbDest);
+        sqlite3_close(dbSrc);
+        return false;
+    }
+    // A single step copies every page within one read transaction, so writes
+    // committed meanwhile don't restart the copy.
+    int ret;
+    do {
+        ret = sqlite3_backup_step(backup, -1);
+        if (ret == SQLITE_BUSY || ret == SQLITE_LOCKED)
+            sqlite3_sleep(10);
+    } while (ret == SQLITE_OK || ret == SQLITE_BUSY || ret == SQLITE_LOCKED);
+    sqlite3_backup_finish(backup);
+    if (ret != SQLITE_DONE)
+        strError = sqlite3_errmsg(dbDest);
+    sqlite3_close(dbDest);
+    sqlite3_close(dbSrc);
+    LogPrint(BCLog::DB, "CSQLiteDatabase: backup of %s to %s took %dms\n", path.filename().string(), pathDest.string(), GetTimeMillis() - nStart);
+    return ret == SQLITE_DONE;
+}
+
+CSQLiteDatabase::Cursor* CSQLiteDatabase::GetCursor()
+{
+    LOCK(cs);
+    if (!db)
+        return nullptr;
+    sqlite3_stmt* stmt;
+    std::string strError;
+    if (!Prepare("SELECT key, value FROM main WHERE key >= ? ORDER BY key", stmt, strError)) {
+        LogPrintf("CSQLiteDatabase: %s\n", strError);
+        return nullptr;
+    }
+    Cursor* pcursor = new Cursor(*this, stmt);
+    pcursor->Seek(CDataStream(SER_DISK, 0));
+    return pcursor;
+}
+
+CSQLiteDatabase::Cursor::~Cursor()
+{
+    LOCK(db.cs);
+    sqlite3_finalize(stmt);
+}
+
+bool CSQLiteDatabase::Cursor::Seek(const CDataStream& ssSeek)
+{
+    LOCK(db.cs);
+    sqlite3_reset(stmt);
+    // bind a copy: the statement keeps reading the key until it is reset
+    return sqlite3_bind_blob(stmt, 1, ssSeek.empty() ? "" : &ssSeek[0], ssSeek.size(), SQLITE_TRANSIENT) == SQLITE_OK;
+}
+
+int CSQLiteDatabase::Cursor::Next(CDataStream& ssKey, CDataStream& ssValue)
+{
+    LOCK(db.cs);
+    const int ret = sqlite3_step(stmt);
+    if (ret == SQLITE_DONE)
+        return 0;
+    if (ret != SQLITE_ROW)
+        return -1;
+    ReadBlob(stmt, 0, ssKey);
+    ReadBlob(stmt, 1, ssValue);
+    return 1;
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_WALLET_SQLITEDB_H
+#define BITCOIN_WALLET_SQLITEDB_H
+
+#include "fs.h"
+#include "streams.h"
+#include "sync.h"
+
+#include <string>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+static const char* const WALLET_BACKEND_BDB = "bdb";
+static const char* const WALLET_BACKEND_SQLITE = "sqlite";
+static const char* const DEFAULT_WALLET_BACKEND = WALLET_BACKEND_BDB;
+
+/** True if the file at path starts with the SQLite database header */
+bool IsSQLiteFile(const fs::path& path);
+
+/**
+ * Wallet key/value store in a single SQLite table, the alternative to a
+ * Berkeley DB wallet file. It holds the same serialized records as CDB,
+ * ordered by key bytes like a BDB btree, so cursors see the same sequence.
+ *
+ * The database runs in WAL mode: readers, including online backups, don't
+ * block the writer, and a commit only appends to the log. Statements for
+ * the point operations are prepared once.
+ *
+ * One instance per wallet file is shared by every CDB handle on it.
+ * Transactions nest: the outermost one is a real transaction and inner ones
+ * are savepoints, so a batch opened around block processing folds all the
+ * wallet writes made underneath it into a single commit. The depth is kept
+ * per connection, so transactions are only opened with the wallet's
+ * cs_wallet held, which keeps them nested on one thread.
+ */
+class CSQLiteDatabase
+{
+public:
+    explicit CSQLiteDatabase(const fs::path& pathIn);
+    ~CSQLiteDatabase();
+
+    bool Open(bool fCreate, std::string& strError);
+    /** Commit any open transaction, checkpoint the log and close */
+    void Close();
+    bool IsOpen() const { return db != nullptr; }
+    const fs::path& GetPath() const { return path; }
+
+    bool Read(const CDataStream& ssKey, CDataStream& ssValue);
+    bool Write(const CDataStream& ssKey, const CDataStream& ssValue, bool fOverwrite = true);
+    bool Erase(const CDataStream& ssKey);
+    bool Exists(const CDataStream& ssKey);
+    /** Erase every record whose key starts with strPrefix */
+    bool ErasePrefix(const std::string& strPrefix);
+
+    bool TxnBegin();
+    bool TxnCommit();
+    bool TxnAbort();
+    int GetTxnDepth() const;
+
+    /** Move the log into the database file; truncate the log when fTruncate */
+    void Checkpoint(bool fTruncate);
+    /** Rebuild the database file to reclaim free pages */
+    bool Vacuum();
+    /** Run the SQLite integrity check */
+    bool Verify(std::string& strError);
+    /** Copy the last committed state to pathDest with the SQLite online backup API, without blocking writers. Needn't be open. */
+    bool Backup(const fs::path& pathDest, std::string& strError);
+
+    /**
+     * Cursor over all records in key order. A cursor owns its statement, so
+     * several can be open at once and writes may happen in between.
+     */
+    class Cursor
+    {
+    public:
+        ~Cursor();
+        /** Position on the first record with a key >= ssSeek (empty: the first record) */
+        bool Seek(const CDataStream& ssSeek);
+        /** Read the record at the cursor and advance. Returns 1 on a record, 0 at the end, -1 on error */
+        int Next(CDataStream& ssKey, CDataStream& ssValue);
+
+    private:
+        friend class CSQLiteDatabase;
+        Cursor(CSQLiteDatabase& dbIn, sqlite3_stmt* stmtIn) : db(dbIn), stmt(stmtIn) {}
+
+        CSQLiteDatabase& db;
+        sqlite3_stmt* stmt;
+    };
+
+    /** New cursor, or nullptr when the database isn't open */
+    Cursor* GetCursor();
+
+private:
+    bool Exec(const char* pszSql, std::string* pstrError = nullptr);
+    bool Prepare(const char* pszSql, sqlite3_stmt*& stmt, std::string& strError);
+    bool Step(sqlite3_stmt* stmt, const char* pszWhat);
+
+    const fs::path path;
+    mutable RecursiveMutex cs;
+    sqlite3* db;
+    sqlite3_stmt* stmtRead;
+    sqlite3_stmt* stmtInsert;
+    sqlite3_stmt* stmtInsertNew;
+    sqlite3_stmt* stmtErase;
+    sqlite3_stmt* stmtExists;
+    int nTxnDepth;
+
+    CSQLiteDatabase(const CSQLiteDatabase&);
+    void operator=(const CSQLiteDatabase&);
+};
+
+#endif // BITCOIN_WALLET_SQLITEDB_H
@@ -0,0 +1,214 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/sqlitedb.h"
+
+#include "clientversion.h"
+#include "test/test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+static CDataStream Record(const std::string& strType, int n)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << strType << n;
+    return ss;
+}
+
+static bool HasRecord(CSQLiteDatabase& db, const CDataStream& ssKey, int nExpected)
+{
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    if (!db.Read(ssKey, ssValue))
+        return false;
+    int n;
+    ssValue >> n;
+    return n == nExpected;
+}
+
+static CDataStream Value(int n)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << n;
+    return ss;
+}
+
+BOOST_FIXTURE_TEST_SUITE(sqlitedb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sqlitedb_records)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(ph);
+    {
+        CSQLiteDatabase db(ph / "wallet.dat");
+        std::string strError;
+        BOOST_CHECK(!db.Open(false, strError)); // doesn't exist yet
+        BOOST_CHECK(db.Open(true, strError));
+        BOOST_CHECK(IsSQLiteFile(ph / "wallet.dat"));
+
+        BOOST_CHECK(db.Write(Record("name", 1), Value(10)));
+        BOOST_CHECK(HasRecord(db, Record("name", 1), 10));
+        BOOST_CHECK(db.Write(Record("name", 1), Value(11)));
+        BOOST_CHECK(HasRecord(db, Record("name", 1), 11));
+        // no overwrite, like DB_NOOVERWRITE
+        BOOST_CHECK(!db.Write(Record("name", 1), Value(12), false));
+        BOOST_CHECK(HasRecord(db, Record("name", 1), 11));
+        BOOST_CHECK(db.Write(Record("name", 2), Value(20), false));
+
+        BOOST_CHECK(db.Exists(Record("name", 2)));
+        BOOST_CHECK(db.Erase(Record("name", 2)));
+        BOOST_CHECK(!db.Exists(Record("name", 2)));
+        BOOST_CHECK(db.Erase(Record("name", 2))); // erasing a missing record is fine
+
+        for (int i = 0; i < 5; i++) {
+            BOOST_CHECK(db.Write(Record("pool", i), Value(i)));
+            BOOST_CHECK(db.Write(Record("acentry", i), Value(i)));
+        }
+        BOOST_CHECK(db.ErasePrefix(std::string("\x04pool", 5)));
+        BOOST_CHECK(!db.Exists(Record("pool", 0)));
+        BOOST_CHECK(db.Exists(Record("acentry", 0)));
+        db.Close();
+        BOOST_CHECK(db.Open(false, strError));
+        BOOST_CHECK(HasRecord(db, Record("name", 1), 11));
+        BOOST_CHECK(HasRecord(db, Record("acentry", 4), 4));
+        std::string strVerify;
+        BOOST_CHECK(db.Verify(strVerify));
+    }
+    fs::remove_all(ph);
+}
+
+BOOST_AUTO_TEST_CASE(sqlitedb_cursor)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(ph);
+    {
+        CSQLiteDatabase db(ph / "wallet.dat");
+        std::string strError;
+        BOOST_REQUIRE(db.Open(true, strError));
+
+        // insert out of order; the cursor walks them by key bytes, like a BDB btree
+        for (int i = 9; i >= 0; i--) {
+            BOOST_CHECK(db.Write(Record("acentry", i), Value(i)));
+            BOOST_CHECK(db.Write(Record("tx", i), Value(100 + i)));
+        }
+        std::unique_ptr<CSQLiteDatabase::Cursor> pcursor(db.GetCursor());
+        BOOST_REQUIRE(pcursor);
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        std::vector<unsigned char> vchPrev;
+        int nRecords = 0;
+        while (pcursor->Next(ssKey, ssValue) > 0) {
+            std::vector<unsigned char> vchKey(ssKey.begin(), ssKey.end());
+            BOOST_CHECK(vchPrev < vchKey);
+            vchPrev = vchKey;
+            nRecords++;
+        }
+        BOOST_CHECK_EQUAL(nRecords, 20);
+
+        // DB_SET_RANGE: first record at or after the given key
+        BOOST_CHECK(pcursor->Seek(Record("acentry", 5)));
+        BOOST_CHECK_EQUAL(pcursor->Next(ssKey, ssValue), 1);
+        std::string strType;
+        int n;
+        ssKey >> strType >> n;
+        BOOST_CHECK_EQUAL(strType, "acentry");
+        BOOST_CHECK_EQUAL(n, 5);
+        CDataStream ssSeek(SER_DISK, CLIENT_VERSION);
+        ssSeek << std::string("tx");
+        BOOST_CHECK(pcursor->Seek(ssSeek));
+        BOOST_CHECK_EQUAL(pcursor->Next(ssKey, ssValue), 1);
+        ssValue >> n;
+        BOOST_CHECK_EQUAL(n, 100);
+        // keys sort by their serialized length first: past "acentry" (7) is the end
+        BOOST_CHECK(pcursor->Seek(Record("zzzzzzzz", 0)));
+        BOOST_CHECK_EQUAL(pcursor->Next(ssKey, ssValue), 0);
+    }
+    fs::remove_all(ph);
+}
+
+BOOST_AUTO_TEST_CASE(sqlitedb_transactions)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(ph);
+    {
+        CSQLiteDatabase db(ph / "wallet.dat");
+        std::string strError;
+        BOOST_REQUIRE(db.Open(true, strError));
+
+        // a batch with a nested transaction that is aborted
+        BOOST_CHECK(db.TxnBegin());
+        BOOST_CHECK(db.Write(Record("tx", 1), Value(1)));
+        BOOST_CHECK(db.TxnBegin());
+        BOOST_CHECK_EQUAL(db.GetTxnDepth(), 2);
+        BOOST_CHECK(db.Write(Record("tx", 2), Value(2)));
+        BOOST_CHECK(db.TxnAbort());
+        BOOST_CHECK(db.TxnBegin());
+        BOOST_CHECK(db.Write(Record("tx", 3), Value(3)));
+        BOOST_CHECK(db.TxnCommit());
+        BOOST_CHECK(db.TxnCommit());
+        BOOST_CHECK_EQUAL(db.GetTxnDepth(), 0);
+        BOOST_CHECK(!db.TxnCommit());
+        BOOST_CHECK(db.Exists(Record("tx", 1)));
+        BOOST_CHECK(!db.Exists(Record("tx", 2)));
+        BOOST_CHECK(db.Exists(Record("tx", 3)));
+
+        // an aborted batch leaves nothing behind
+        BOOST_CHECK(db.TxnBegin());
+        BOOST_CHECK(db.Write(Record("tx", 4), Value(4)));
+        BOOST_CHECK(db.Erase(Record("tx", 1)));
+        BOOST_CHECK(db.TxnAbort());
+        BOOST_CHECK(!db.Exists(Record("tx", 4)));
+        BOOST_CHECK(db.Exists(Record("tx", 1)));
+
+        // closing with a batch open commits it
+        BOOST_CHECK(db.TxnBegin());
+        BOOST_CHECK(db.Write(Record("tx", 5), Value(5)));
+        db.Close();
+        BOOST_CHECK(db.Open(false, strError));
+        BOOST_CHECK(db.Exists(Record("tx", 5)));
+    }
+    fs::remove_all(ph);
+}
+
+BOOST_AUTO_TEST_CASE(sqlitedb_backup)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(ph);
+    {
+        CSQLiteDatabase db(ph / "wallet.dat");
+        std::string strError;
+        BOOST_REQUIRE(db.Open(true, strError));
+        BOOST_CHECK(db.TxnBegin());
+        for (int i = 0; i < 5000; i++)
+            BOOST_CHECK(db.Write(Record("tx", i), CDataStream(std::vector<unsigned char>(200, i & 0xff), SER_DISK, CLIENT_VERSION)));
+        BOOST_CHECK(db.TxnCommit());
+
+        BOOST_CHECK(db.Backup(ph / "backup.dat", strError));
+        // the source stays usable and the copy is a complete database
+        BOOST_CHECK(db.Write(Record("tx", 5000), Value(0)));
+        CSQLiteDatabase dbCopy(ph / "backup.dat");
+        BOOST_REQUIRE(dbCopy.Open(false, strError));
+        BOOST_CHECK(dbCopy.Exists(Record("tx", 4999)));
+        BOOST_CHECK(!dbCopy.Exists(Record("tx", 5000)));
+        BOOST_CHECK(dbCopy.Verify(strError));
+
+        // a batch still open is not part of the copy
+        BOOST_CHECK(db.TxnBegin());
+        BOOST_CHECK(db.Write(Record("tx", 5001), Value(0)));
+        BOOST_CHECK(db.Backup(ph / "backup2.dat", strError));
+        BOOST_CHECK(db.TxnCommit());
+        CSQLiteDatabase dbCopy2(ph / "backup2.dat");
+        BOOST_REQUIRE(dbCopy2.Open(false, strError));
+        BOOST_CHECK(dbCopy2.Exists(Record("tx", 5000)));
+        BOOST_CHECK(!dbCopy2.Exists(Record("tx", 5001)));
+
+        // the copy reads the file, whether or not the instance has it open
+        BOOST_CHECK(CSQLiteDatabase(ph / "wallet.dat").Backup(ph / "backup3.dat", strError));
+        CSQLiteDatabase dbCopy3(ph / "backup3.dat");
+        BOOST_REQUIRE(dbCopy3.Open(false, strError));
+        BOOST_CHECK(dbCopy3.Exists(Record("tx", 5001)));
+    }
+    fs::remove_all(ph);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
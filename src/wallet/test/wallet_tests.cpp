@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "wallet/wallet.h"
+#include "wallet/walletdb.h"
 #include "consensus/merkle.h"
 
 #include <set>
@@ -321,7 +322,7 @@ void removeTxFromMempool(CWalletTx& wtx)
 CBlockIndex* SimpleFakeMine(CWalletTx& wtx, CBlockIndex* pprev = nullptr)
 {
     CBlock block;
-    block.vtx.push_back(wtx);
+    block.vtx.push_back(MakeTransactionRef(wtx));
     block.hashMerkleRoot = BlockMerkleRoot(block);
     if (pprev) block.hashPrevBlock = pprev->GetBlockHash();
     CBlockIndex* fakeIndex = new CBlockIndex(block);
@@ -471,4 +472,151 @@ BOOST_AUTO_TEST_CASE(cached_balances_tests)
 
 }
 
+/**
+ * Writes more transaction records than fit in one decoding batch and reloads
+ * the wallet file: every transaction must come back, spends must be linked
+ * and records without an order position must get one.
+ */
+BOOST_AUTO_TEST_CASE(load_wallet_transactions)
+{
+    const int nTxs = 1000;
+    std::vector<uint256> vHashes;
+    {
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        uint256 hashPrev = GetRandHash();
+        for (int i = 0; i < nTxs; i++) {
+            CMutableTransaction mTx;
+            mTx.vin.emplace_back(COutPoint(hashPrev, 0));
+            mTx.vout.emplace_back(nTxs - i, CScript() << OP_TRUE);
+            CWalletTx wtx(nullptr, CTransaction(mTx));
+            wtx.nTimeReceived = 1600000000 + i;
+            // leave a few records unordered, as written by old wallets
+            wtx.nOrderPos = (i % 100 == 7) ? -1 : i;
+            BOOST_CHECK(walletdb.WriteTx(wtx));
+            hashPrev = wtx.GetHash();
+            vHashes.push_back(hashPrev);
+        }
+    }
+
+    bool fFirstRun;
+    CWallet wallet(pwalletMain->strWalletFile);
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK2(cs_main, wallet.cs_wallet);
+    BOOST_CHECK_EQUAL(wallet.mapWallet.size(), (size_t)nTxs);
+    BOOST_CHECK_EQUAL(wallet.wtxOrdered.size(), (size_t)nTxs);
+    std::set<int64_t> setOrderPos;
+    for (int i = 0; i < nTxs; i++) {
+        auto it = wallet.mapWallet.find(vHashes[i]);
+        BOOST_REQUIRE(it != wallet.mapWallet.end());
+        BOOST_CHECK_EQUAL(it->second.nTimeReceived, (unsigned int)(1600000000 + i));
+        BOOST_CHECK_EQUAL(it->second.vout[0].nValue, nTxs - i);
+        BOOST_CHECK(it->second.nOrderPos != -1);
+        setOrderPos.insert(it->second.nOrderPos);
+        // each transaction spends the previous one
+        BOOST_CHECK_EQUAL(wallet.IsSpent(vHashes[i], 0), i + 1 < nTxs);
+    }
+    BOOST_CHECK_EQUAL(setOrderPos.size(), (size_t)nTxs);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_history_pages)
+{
+    CWallet wallet;
+    LOCK(wallet.cs_wallet);
+    const int nTxs = 100;
+    std::vector<uint256> vHashes;
+    for (int i = 0; i < nTxs; i++) {
+        CMutableTransaction mTx;
+        mTx.vin.emplace_back(COutPoint(GetRandHash(), 0));
+        mTx.vout.emplace_back(i, CScript() << OP_TRUE);
+        CWalletTx wtx(nullptr, CTransaction(mTx));
+        // out of order, with ties
+        wtx.nTimeReceived = 1600000000 + (i * 37) % 50;
+        BOOST_CHECK(wallet.LoadToWallet(wtx));
+        vHashes.push_back(wtx.GetHash());
+    }
+
+    // reloading a transaction with another time moves it
+    CWalletTx wtxMoved = wallet.mapWallet.at(vHashes[0]);
+    wtxMoved.nTimeReceived = 1700000000;
+    BOOST_CHECK(wallet.LoadToWallet(wtxMoved));
+    BOOST_CHECK_EQUAL(wallet.setTxByTime.size(), (size_t)nTxs);
+
+    CWallet::TxTimeKey pos = CWallet::TxHistoryBegin();
+    std::vector<const CWalletTx*> vAll;
+    while (true) {
+        std::vector<const CWalletTx*> vPage = wallet.GetTxHistoryPage(pos, 7);
+        BOOST_CHECK(vPage.size() <= 7);
+        if (vPage.empty())
+            break;
+        vAll.insert(vAll.end(), vPage.begin(), vPage.end());
+    }
+    BOOST_REQUIRE_EQUAL(vAll.size(), (size_t)nTxs);
+    BOOST_CHECK(vAll.front()->GetHash() == vHashes[0]);
+    std::set<uint256> setSeen;
+    for (size_t i = 0; i < vAll.size(); i++) {
+        setSeen.insert(vAll[i]->GetHash());
+        if (i > 0) {
+            BOOST_CHECK(CWallet::TxTimeKey(vAll[i]->GetTxTime(), vAll[i]->GetHash()) <
+                        CWallet::TxTimeKey(vAll[i - 1]->GetTxTime(), vAll[i - 1]->GetHash()));
+        }
+    }
+    BOOST_CHECK_EQUAL(setSeen.size(), (size_t)nTxs);
+}
+
+static CTransaction CoinStake(const CScript& scriptStake, const CScript& scriptMN)
+{
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(COutPoint(GetRandHash(), 0));
+    mtx.vout.emplace_back();
+    mtx.vout[0].SetEmpty();
+    mtx.vout.emplace_back(10 * COIN, scriptStake);
+    mtx.vout.emplace_back(3 * COIN, scriptMN);
+    return CTransaction(mtx);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_reward_history)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+    const CScript scriptOther = CScript() << OP_TRUE;
+    {
+        LOCK(pwalletMain->cs_wallet);
+        BOOST_REQUIRE(pwalletMain->AddKey(key));
+    }
+
+    // blocks that are not in the index: the txs keep the time they were received
+    uint256 hashBlock = GetRandHash();
+    CBlockIndex index;
+    index.phashBlock = &hashBlock;
+
+    const CTransaction txStake = CoinStake(scriptMine, scriptOther);
+    const CTransaction txMN = CoinStake(scriptOther, scriptMine);
+    const CTransaction txOther = CoinStake(scriptOther, scriptOther);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef()); // the coinbase, none of ours
+    for (const CTransaction& tx : {txStake, txMN, txOther})
+        block.vtx.push_back(MakeTransactionRef(tx));
+    pwalletMain->BlockConnected(block, &index);
+
+    const int nToday = CRewardDay::GetDay(GetAdjustedTime());
+    std::map<int, CRewardDay> mapDays = pwalletMain->GetRewardHistory(nToday - 1, nToday + 1);
+    BOOST_REQUIRE_EQUAL(mapDays.size(), 1U);
+    const CRewardDay& day = mapDays.begin()->second;
+    BOOST_CHECK_EQUAL(day.nStakes, 1);
+    BOOST_CHECK_EQUAL(day.nStake, 10 * COIN); // the staked input isn't ours, nothing to take off
+    BOOST_CHECK_EQUAL(day.nMasternodeRewards, 1);
+    BOOST_CHECK_EQUAL(day.nMasternode, 3 * COIN);
+    BOOST_CHECK(pwalletMain->GetRewardHistory(nToday + 1, nToday + 2).empty());
+
+    // disconnected with their block
+    pwalletMain->SyncTransaction(txStake, &index, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+    mapDays = pwalletMain->GetRewardHistory(nToday - 1, nToday + 1);
+    BOOST_REQUIRE_EQUAL(mapDays.size(), 1U);
+    BOOST_CHECK_EQUAL(mapDays.begin()->second.nStakes, 0);
+    BOOST_CHECK_EQUAL(mapDays.begin()->second.nStake, 0);
+    pwalletMain->SyncTransaction(txMN, &index, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+    BOOST_CHECK(pwalletMain->GetRewardHistory(nToday - 1, nToday + 1).empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
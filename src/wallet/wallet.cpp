@@ -53,6 +53,26 @@ CAmount CWallet::minStakeSplitThreshold = DEFAULT_MIN_STAKE_SPLIT_THRESHOLD;
 
 const uint256 CMerkleTx::ABANDON_HASH(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
 
+bool EnsureWalletIsAvailable()
+{
+    if (!pwalletMain)
+        return false;
+    AssertLockNotHeld(cs_main);
+    AssertLockNotHeld(pwalletMain->cs_wallet);
+    // the wallet is updated from the validation interface queue
+    SyncWithValidationInterfaceQueue();
+    return true;
+}
+
+bool EnsureWalletIsAvailable(int64_t nMaxWaitMillis)
+{
+    if (!pwalletMain)
+        return false;
+    AssertLockNotHeld(cs_main);
+    AssertLockNotHeld(pwalletMain->cs_wallet);
+    return SyncWithValidationInterfaceQueue(nMaxWaitMillis);
+}
+
 /** @defgroup mapWallet
  *
  * @{
@@ -98,15 +118,30 @@ const CWalletTx* CWallet::GetWalletTx(const uint256& hash) const
     return &(it->second);
 }
 
-std::vector<CWalletTx> CWallet::getWalletTxs()
+std::vector<const CWalletTx*> CWallet::GetTxHistoryPage(TxTimeKey& posCursor, size_t nCount) const
 {
-    LOCK(cs_wallet);
-    std::vector<CWalletTx> result;
-    result.reserve(mapWallet.size());
-    for (const auto& entry : mapWallet) {
-        result.emplace_back(entry.second);
+    AssertLockHeld(cs_wallet);
+    std::vector<const CWalletTx*> vPage;
+    auto it = setTxByTime.lower_bound(posCursor);
+    while (vPage.size() < nCount && it != setTxByTime.begin()) {
+        --it;
+        auto mi = mapWallet.find(it->second);
+        if (mi == mapWallet.end())
+            continue;
+        vPage.push_back(&mi->second);
+        posCursor = *it;
     }
-    return result;
+    return vPage;
+}
+
+void CWallet::ReindexTxTime(const CWalletTx& wtx, int64_t nOldTime)
+{
+    AssertLockHeld(cs_wallet);
+    const int64_t nTime = wtx.GetTxTime();
+    if (nTime == nOldTime)
+        return;
+    setTxByTime.erase(TxTimeKey(nOldTime, wtx.GetHash()));
+    setTxByTime.emplace(nTime, wtx.GetHash());
 }
 
 PairResult CWallet::getNewAddress(CTxDestination& ret, std::string label){
@@ -509,7 +544,9 @@ void CWallet::SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator> ran
         copyTo->vOrderForm = copyFrom->vOrderForm;
         // fTimeReceivedIsTxTime not copied on purpose
         // nTimeReceived not copied on purpose
+        const int64_t nOldTime = copyTo->GetTxTime();
         copyTo->nTimeSmart = copyFrom->nTimeSmart;
+        ReindexTxTime(*copyTo, nOldTime);
         copyTo->fFromMe = copyFrom->fFromMe;
         copyTo->strFromAccount = copyFrom->strFromAccount;
         // nOrderPos not copied on purpose
@@ -701,6 +738,8 @@ bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
         if (fFileBacked) {
             assert(!pwalletdbEncryption);
             pwalletdbEncryption = new CWalletDB(strWalletFile);
+            // transactions nest per SQLite connection, see CSQLiteDatabase
+            AssertLockHeld(cs_wallet);
             if (!pwalletdbEncryption->TxnBegin()) {
                 delete pwalletdbEncryption;
                 pwalletdbEncryption = NULL;
@@ -836,10 +875,12 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         wtx.nOrderPos = IncOrderPosNext(&walletdb);
         wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
         wtx.UpdateTimeSmart();
+        setTxByTime.emplace(wtx.GetTxTime(), hash);
         AddToSpends(hash);
     }
 
     bool fUpdated = false;
+    const int64_t nOldTime = wtx.GetTxTime();
     if (!fInsertedNew) {
         // Merge
         if (!wtxIn.hashUnset() && wtxIn.hashBlock != wtx.hashBlock) {
@@ -861,6 +902,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
             wtx.fFromMe = wtxIn.fFromMe;
             fUpdated = true;
         }
+        ReindexTxTime(wtx, nOldTime);
     }
 
     //// debug print
@@ -891,9 +933,12 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 bool CWallet::LoadToWallet(const CWalletTx& wtxIn)
 {
     const uint256& hash = wtxIn.GetHash();
-    mapWallet[hash] = wtxIn;
-    setWallet.insert(hash);
     CWalletTx& wtx = mapWallet[hash];
+    if (setWallet.count(hash))
+        setTxByTime.erase(TxTimeKey(wtx.GetTxTime(), hash));
+    wtx = wtxIn;
+    setWallet.insert(hash);
+    setTxByTime.emplace(wtx.GetTxTime(), hash);
     wtx.BindWallet(this);
     wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
     AddToSpends(hash);
@@ -1076,10 +1121,34 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
 
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock)
 {
-    LOCK(cs_wallet);
+    // The transactions of a connected block are synced with it, BlockConnected
+    if (pindex && posInBlock != CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK)
+        return;
+
+    // Runs on the validation interface queue, cs_main isn't held by the caller
+    LOCK2(cs_main, cs_wallet);
+    SyncTransactionLocked(tx, pindex, posInBlock);
+}
+
+void CWallet::SyncTransactionLocked(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock)
+{
+    AssertLockHeld(cs_wallet);
+
+    // A coinstake only leaves the chain with its block: notified outside of
+    // a block, it was disconnected and its reward no longer counts
+    const bool fCoinStakeInBlock = tx.IsCoinStake() && posInBlock != CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK;
+    if (tx.IsCoinStake() && !fCoinStakeInBlock) {
+        auto it = mapWallet.find(tx.GetHash());
+        if (it != mapWallet.end())
+            UpdateRewardHistory(it->second, false);
+    }
+
     if (!AddToWalletIfInvolvingMe(tx, pindex, posInBlock, true))
         return; // Not one of ours
 
+    if (fCoinStakeInBlock)
+        UpdateRewardHistory(mapWallet.at(tx.GetHash()), true);
+
     // If a transaction changes 'conflicted' state, that changes the balance
     // available of the outputs it spends. So force those to be
     // recomputed, also:
@@ -1089,13 +1158,134 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex,
     }
 }
 
+void CWallet::BlockConnected(const CBlock& block, const CBlockIndex *pindex)
+{
+    // Runs on the validation interface queue, cs_main isn't held by the caller
+    LOCK2(cs_main, cs_wallet);
+
+    // On SQLite the wallet writes of the block share one commit. cs_wallet is
+    // held until it ends, no other wallet write can join it.
+    const bool fBatch = fFileBacked && bitdb.BeginBatch(strWalletFile);
+
+    for (size_t i = 0; i < block.vtx.size(); i++)
+        SyncTransactionLocked(*block.vtx[i], pindex, i);
+
+    // The reward history stays in step only while it has seen every block;
+    // if it was rebuilt or out of date it is marked so at the next startup
+    if (!hashRewardBest.IsNull()) {
+        hashRewardBest = pindex->GetBlockHash();
+        if (fFileBacked)
+            CWalletDB(strWalletFile, "r+", false).WriteRewardBest(hashRewardBest);
+    }
+
+    if (fBatch && !bitdb.CommitBatch(strWalletFile))
+        LogPrintf("%s: failed to commit the wallet writes of block %d\n", __func__, pindex->nHeight);
+}
+
+bool CWallet::GetCoinStakeReward(const CWalletTx& wtx, CAmount& nRewardRet, bool& fMasternodeRet) const
+{
+    if (!wtx.IsCoinStake())
+        return false;
+
+    if (IsMine(wtx.vout[1])) {
+        nRewardRet = GetCredit(wtx, ISMINE_ALL) - GetDebit(wtx, ISMINE_ALL);
+        fMasternodeRet = false;
+        return true;
+    }
+    const CTxOut& txoutMN = wtx.vout.back();
+    CTxDestination destMN;
+    if (ExtractDestination(txoutMN.scriptPubKey, destMN) && ::IsMine(*this, destMN)) {
+        nRewardRet = txoutMN.nValue;
+        fMasternodeRet = true;
+        return true;
+    }
+    return false;
+}
+
+void CWallet::UpdateRewardHistory(const CWalletTx& wtx, bool fConnected)
+{
+    AssertLockHeld(cs_wallet);
+
+    CAmount nReward;
+    bool fMasternode;
+    if (!GetCoinStakeReward(wtx, nReward, fMasternode))
+        return;
+
+    const int nDay = CRewardDay::GetDay(wtx.GetTxTime());
+    CRewardDay& day = mapRewardDays[nDay];
+    day.Add(nReward, fMasternode, fConnected ? 1 : -1);
+    if (day.nStakes < 0 || day.nMasternodeRewards < 0) {
+        // took out a reward that was never counted
+        LogPrintf("%s: reward history out of step at %s, it will be rebuilt on the next start\n", __func__, wtx.GetHash().ToString());
+        day = CRewardDay();
+        hashRewardBest.SetNull();
+    }
+
+    CWalletDB walletdb(strWalletFile, "r+", false);
+    if (day.IsEmpty()) {
+        mapRewardDays.erase(nDay);
+        if (fFileBacked)
+            walletdb.EraseRewardDay(nDay);
+    } else if (fFileBacked) {
+        walletdb.WriteRewardDay(nDay, day);
+    }
+    if (fFileBacked && hashRewardBest.IsNull())
+        walletdb.WriteRewardBest(hashRewardBest);
+}
+
+std::map<int, CRewardDay> CWallet::GetRewardHistory(int nDayFrom, int nDayTo) const
+{
+    LOCK(cs_wallet);
+    return std::map<int, CRewardDay>(mapRewardDays.lower_bound(nDayFrom), mapRewardDays.upper_bound(nDayTo));
+}
+
+void CWallet::RebuildRewardHistory()
+{
+    LOCK2(cs_main, cs_wallet);
+
+    const int64_t nStart = GetTimeMillis();
+    std::map<int, CRewardDay> mapOld;
+    mapOld.swap(mapRewardDays);
+    for (const auto& it : mapWallet) {
+        const CWalletTx& wtx = it.second;
+        CAmount nReward;
+        bool fMasternode;
+        if (wtx.IsCoinStake() && wtx.GetDepthInMainChain() > 0 && GetCoinStakeReward(wtx, nReward, fMasternode))
+            mapRewardDays[CRewardDay::GetDay(wtx.GetTxTime())].Add(nReward, fMasternode, 1);
+    }
+    hashRewardBest = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : UINT256_ZERO;
+
+    if (fFileBacked) {
+        CWalletDB walletdb(strWalletFile);
+        for (const auto& it : mapOld) {
+            if (!mapRewardDays.count(it.first))
+                walletdb.EraseRewardDay(it.first);
+        }
+        for (const auto& it : mapRewardDays)
+            walletdb.WriteRewardDay(it.first, it.second);
+        walletdb.WriteRewardBest(hashRewardBest);
+    }
+    LogPrintf("%s: %u days of rewards in %dms\n", __func__, mapRewardDays.size(), GetTimeMillis() - nStart);
+}
+
 void CWallet::EraseFromWallet(const uint256& hash)
 {
     if (!fFileBacked)
         return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash)) {
+        auto mi = mapWallet.find(hash);
+        if (mi != mapWallet.end()) {
+            setTxByTime.erase(TxTimeKey(mi->second.GetTxTime(), hash));
+            // don't leave a dangling pointer in the ordered list
+            auto range = wtxOrdered.equal_range(mi->second.nOrderPos);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second.first == &mi->second) {
+                    wtxOrdered.erase(it);
+                    break;
+                }
+            }
+            mapWallet.erase(mi);
             setWallet.erase(hash);
             CWalletDB(strWalletFile).EraseTx(hash);
         }
@@ -1442,7 +1632,7 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
             ReadBlockFromDisk(block, pindex);
             int posInBlock;
             for (posInBlock = 0; posInBlock < (int)block.vtx.size(); posInBlock++) {
-                if (AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate))
+                if (AddToWalletIfInvolvingMe(*block.vtx[posInBlock], pindex, posInBlock, fUpdate))
                     ret++;
             }
 
@@ -1453,6 +1643,9 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
             }
         }
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+        // the rescan adds and updates transactions without going through SyncTransaction
+        RebuildRewardHistory();
     }
     return ret;
 }
@@ -1566,6 +1759,22 @@ bool CWallet::Verify()
             return false;
     }
 
+    const std::string strBackend = GetArg("-walletbackend", DEFAULT_WALLET_BACKEND);
+    if (strBackend != WALLET_BACKEND_BDB && strBackend != WALLET_BACKEND_SQLITE)
+        return UIError(strprintf(_("Unknown wallet backend %s"), strBackend));
+
+    if (bitdb.IsSQLite(walletFile)) {
+        if (GetBoolArg("-salvagewallet", false))
+            return UIError(strprintf(_("-salvagewallet only supports Berkeley DB wallet files, %s is an SQLite database"), walletFile));
+        if (fs::exists(GetDataDir() / walletFile)) {
+            CSQLiteDatabase db(GetDataDir() / walletFile);
+            std::string strError;
+            if (!db.Open(false, strError) || !db.Verify(strError))
+                return UIError(strprintf(_("%s corrupt: %s"), walletFile, strError));
+        }
+        return true;
+    }
+
     if (fs::exists(GetDataDir() / walletFile)) {
         CDBEnv::VerifyResult r = bitdb.Verify(walletFile, CWalletDB::Recover);
         if (r == CDBEnv::RECOVER_OK) {
@@ -1577,6 +1786,13 @@ bool CWallet::Verify()
         }
         if (r == CDBEnv::RECOVER_FAIL)
             return UIError(strprintf(_("%s corrupt, salvage failed"), walletFile));
+
+        if (GetBoolArg("-migratewallet", false)) {
+            uiInterface.InitMessage(_("Migrating wallet to SQLite..."));
+            std::string strError;
+            if (!CDB::MigrateToSQLite(walletFile, strError))
+                return UIError(strprintf(_("Failed to migrate %s to SQLite: %s"), walletFile, strError));
+        }
     }
 
     return true;
@@ -2554,7 +2770,7 @@ bool CWallet::CreateCoinStake(
 
     for (const COutput &out : *availableCoins) {
         CPivStake stakeInput;
-        stakeInput.SetPrevout((CTransaction) *out.tx, out.i);
+        stakeInput.SetPrevout(*out.tx, out.i);
 
         //new block came in, move on
         if (WITH_LOCK(cs_main, return chainActive.Height()) != pindexPrev->nHeight) return false;
@@ -3526,6 +3742,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-keypool=<n>", strprintf(_("Set key pool size to <n> (default: %u)"), DEFAULT_KEYPOOL_SIZE));
     strUsage += HelpMessageOpt("-legacywallet", _("On first run, create a legacy wallet instead of a HD wallet"));
     strUsage += HelpMessageOpt("-maxtxfee=<amt>", strprintf(_("Maximum total fees to use in a single wallet transaction, setting too low may abort large transactions (default: %s)"), FormatMoney(maxTxFee)));
+    strUsage += HelpMessageOpt("-migratewallet", _("Convert a Berkeley DB wallet file to SQLite, keeping the original as <file>.<time>.bdb.bak") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-mintxfee=<amt>", strprintf(_("Fees (in %s/Kb) smaller than this are considered zero fee for transaction creation (default: %s)"), CURRENCY_UNIT, FormatMoney(CWallet::minTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"), CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions") + " " + _("on startup"));
@@ -3534,6 +3751,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-txconfirmtarget=<n>", strprintf(_("If paytxfee is not set, include enough fee so transactions begin confirmation on average within n blocks (default: %u)"), 1));
     strUsage += HelpMessageOpt("-upgradewallet", _("Upgrade wallet to latest format") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), DEFAULT_WALLET_DAT));
+    strUsage += HelpMessageOpt("-walletbackend=<backend>", strprintf(_("Storage backend for new wallet files: %s or %s (default: %s)"), WALLET_BACKEND_BDB, WALLET_BACKEND_SQLITE, DEFAULT_WALLET_BACKEND));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
         " " + _("(1 = keep tx meta data e.g. account owner and payment request information, 2 = drop tx meta data)"));
@@ -3710,6 +3928,7 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
 
         // Restore wallet transaction metadata after -zapwallettxes=1
         if (GetBoolArg("-zapwallettxes", false) && GetArg("-zapwallettxes", "1") != "2") {
+            LOCK(walletInstance->cs_wallet);
             CWalletDB walletdb(walletFile);
             for (const CWalletTx& wtxOld : vWtx) {
                 uint256 hash = wtxOld.GetHash();
@@ -3719,8 +3938,10 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
                     CWalletTx* copyTo = &mi->second;
                     copyTo->mapValue = copyFrom->mapValue;
                     copyTo->vOrderForm = copyFrom->vOrderForm;
+                    const int64_t nOldTime = copyTo->GetTxTime();
                     copyTo->nTimeReceived = copyFrom->nTimeReceived;
                     copyTo->nTimeSmart = copyFrom->nTimeSmart;
+                    walletInstance->ReindexTxTime(*copyTo, nOldTime);
                     copyTo->fFromMe = copyFrom->fFromMe;
                     copyTo->strFromAccount = copyFrom->strFromAccount;
                     copyTo->nOrderPos = copyFrom->nOrderPos;
@@ -3729,6 +3950,13 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
             }
         }
     }
+
+    {
+        // staking rewards counted up to another tip than the one we start on
+        LOCK2(cs_main, walletInstance->cs_wallet);
+        if (chainActive.Tip() && walletInstance->hashRewardBest != chainActive.Tip()->GetBlockHash())
+            walletInstance->RebuildRewardHistory();
+    }
     fVerifyingBlocks = false;
 
     return walletInstance;
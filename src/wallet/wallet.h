@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <limits>
 #include <map>
 #include <set>
 #include <stdexcept>
@@ -44,6 +45,21 @@
 
 extern CWallet* pwalletMain;
 
+/**
+ * Availability check shared by everything that uses pwalletMain outside of
+ * validation: the RPC server, the GUI and the staker. Returns false if no
+ * wallet is loaded. Otherwise waits until the wallet has processed every
+ * validation notification queued so far, so it reflects at least the current
+ * tip. Must not be called with cs_main or cs_wallet held.
+ */
+bool EnsureWalletIsAvailable();
+/**
+ * EnsureWalletIsAvailable for callers that must not block, like the GUI
+ * thread: waits at most nMaxWaitMillis. Returns false if no wallet is loaded
+ * or it is still processing notifications queued before the call.
+ */
+bool EnsureWalletIsAvailable(int64_t nMaxWaitMillis);
+
 /**
  * Settings
  */
@@ -215,6 +231,44 @@ public:
     bool IsActive() const { return (nTime + 30) >= GetTime(); }
 };
 
+/** Staking and masternode rewards received on one day (UTC) */
+class CRewardDay
+{
+public:
+    CAmount nStake{0};
+    CAmount nMasternode{0};
+    int nStakes{0};
+    int nMasternodeRewards{0};
+
+    //! Day number of a timestamp: whole days since the epoch
+    static int GetDay(int64_t nTime) { return (int)(nTime / 86400); }
+
+    bool IsEmpty() const { return nStakes == 0 && nMasternodeRewards == 0; }
+
+    //! Count a reward in (nCount 1) or take it back out (nCount -1)
+    void Add(CAmount nReward, bool fMasternode, int nCount)
+    {
+        if (fMasternode) {
+            nMasternode += nCount * nReward;
+            nMasternodeRewards += nCount;
+        } else {
+            nStake += nCount * nReward;
+            nStakes += nCount;
+        }
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nStake);
+        READWRITE(nMasternode);
+        READWRITE(nStakes);
+        READWRITE(nMasternodeRewards);
+    }
+};
+
 struct CRecipient
 {
     CScript scriptPubKey;
@@ -268,6 +322,15 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+    /* Add (or remove, when its block was disconnected) the reward of a coinstake to mapRewardDays */
+    void UpdateRewardHistory(const CWalletTx& wtx, bool fConnected);
+
+    /* SyncTransaction() with cs_wallet held, for a transaction of a connected block too */
+    void SyncTransactionLocked(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
+
+    /* Move a transaction in setTxByTime after its GetTxTime() changed from nOldTime */
+    void ReindexTxTime(const CWalletTx& wtx, int64_t nOldTime);
+
     bool IsKeyUsed(const CPubKey& vchPubKey);
 
 
@@ -353,6 +416,15 @@ public:
     typedef std::multimap<int64_t, TxPair > TxItems;
     TxItems wtxOrdered;
 
+    //! Wallet transactions by GetTxTime() and hash, to page through the history
+    typedef std::pair<int64_t, uint256> TxTimeKey;
+    std::set<TxTimeKey> setTxByTime;
+
+    //! Rewards of the wallet coinstakes in the active chain, by CRewardDay::GetDay() of GetTxTime()
+    std::map<int, CRewardDay> mapRewardDays;
+    //! Tip that mapRewardDays was last brought up to date with
+    uint256 hashRewardBest;
+
     int64_t nOrderPosNext;
 
     std::map<CTxDestination, AddressBook::CAddressBookData> mapAddressBook;
@@ -363,7 +435,26 @@ public:
 
     const CWalletTx* GetWalletTx(const uint256& hash) const;
 
-    std::vector<CWalletTx> getWalletTxs();
+    /** Cursor for GetTxHistoryPage() that starts at the newest transaction */
+    static TxTimeKey TxHistoryBegin() { return TxTimeKey(std::numeric_limits<int64_t>::max(), uint256()); }
+    /**
+     * Page through the wallet history, newest first by GetTxTime(): at most
+     * nCount transactions older than posCursor, which is moved to the last
+     * one returned. Nothing is copied, the pointers are only valid while
+     * cs_wallet stays held.
+     */
+    std::vector<const CWalletTx*> GetTxHistoryPage(TxTimeKey& posCursor, size_t nCount) const;
+
+    /**
+     * The reward of a wallet coinstake as the GUI shows it: the stake (credit
+     * minus debit) when the staked output is ours, otherwise the masternode
+     * payment to us. Returns false for other transactions.
+     */
+    bool GetCoinStakeReward(const CWalletTx& wtx, CAmount& nRewardRet, bool& fMasternodeRet) const;
+    //! The days in [nDayFrom, nDayTo] that have rewards
+    std::map<int, CRewardDay> GetRewardHistory(int nDayFrom, int nDayTo) const;
+    //! Recompute mapRewardDays from mapWallet, after a rescan or when it is out of date
+    void RebuildRewardHistory();
     std::string GetUniqueWalletBackupName() const;
 
     //! check whether we are allowed to upgrade (or already support) to the named feature
@@ -459,6 +550,7 @@ public:
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose = true);
     bool LoadToWallet(const CWalletTx& wtxIn);
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
+    void BlockConnected(const CBlock& block, const CBlockIndex *pindex);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
 
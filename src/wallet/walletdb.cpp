@@ -22,7 +22,10 @@
 #include <atomic>
 #include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 
 static uint64_t nAccountingEntryNumber = 0;
@@ -274,6 +277,24 @@ bool CWalletDB::WriteLoadedRecordsMaxCount(int nLoadedRecordsMaxCount)
     return Write(std::string("loadedrecordsmaxcount"), nLoadedRecordsMaxCount, true);
 }
 
+bool CWalletDB::WriteRewardDay(int nDay, const CRewardDay& day)
+{
+    nWalletDBUpdateCounter++;
+    return Write(std::make_pair(std::string("rewardday"), nDay), day);
+}
+
+bool CWalletDB::EraseRewardDay(int nDay)
+{
+    nWalletDBUpdateCounter++;
+    return Erase(std::make_pair(std::string("rewardday"), nDay));
+}
+
+bool CWalletDB::WriteRewardBest(const uint256& hashBest)
+{
+    nWalletDBUpdateCounter++;
+    return Write(std::string("rewardbest"), hashBest);
+}
+
 bool CWalletDB::ReadPool(int64_t nPool, CKeyPool& keypool)
 {
     return Read(std::make_pair(std::string("pool"), nPool), keypool);
@@ -345,7 +366,7 @@ void CWalletDB::ListAccountCreditDebit(const std::string& strAccount, std::list<
 {
     bool fAllAccounts = (strAccount == "*");
 
-    Dbc* pcursor = GetCursor();
+    std::unique_ptr<CDBCursor> pcursor = GetCursor();
     if (!pcursor)
         throw std::runtime_error("CWalletDB::ListAccountCreditDebit() : cannot create DB cursor");
     unsigned int fFlags = DB_SET_RANGE;
@@ -355,14 +376,12 @@ void CWalletDB::ListAccountCreditDebit(const std::string& strAccount, std::list<
         if (fFlags == DB_SET_RANGE)
             ssKey << std::make_pair(std::string("acentry"), std::make_pair((fAllAccounts ? std::string("") : strAccount), uint64_t(0)));
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        int ret = ReadAtCursor(pcursor, ssKey, ssValue, fFlags);
+        int ret = ReadAtCursor(pcursor.get(), ssKey, ssValue, fFlags);
         fFlags = DB_NEXT;
         if (ret == DB_NOTFOUND)
             break;
-        else if (ret != 0) {
-            pcursor->close();
+        else if (ret != 0)
             throw std::runtime_error("CWalletDB::ListAccountCreditDebit() : error scanning DB");
-        }
 
         // Unserialize
         std::string strType;
@@ -378,8 +397,6 @@ void CWalletDB::ListAccountCreditDebit(const std::string& strAccount, std::list<
         ssKey >> acentry.nEntryNo;
         entries.push_back(acentry);
     }
-
-    pcursor->close();
 }
 
 DBErrors CWalletDB::ReorderTransactions(CWallet* pwallet)
@@ -388,20 +405,25 @@ DBErrors CWalletDB::ReorderTransactions(CWallet* pwallet)
     // Old wallets didn't have any defined order for transactions
     // Probably a bad idea to change the output of this
 
-    // First: get all CWalletTx and CAccountingEntry into a sorted-by-time multimap.
+    // First: get all CWalletTx and CAccountingEntry sorted by time. The sort
+    // is stable, so entries with equal times keep the order they were
+    // gathered in, like the multimap this used to be.
     typedef std::pair<CWalletTx*, CAccountingEntry*> TxPair;
-    typedef std::multimap<int64_t, TxPair> TxItems;
+    typedef std::vector<std::pair<int64_t, TxPair> > TxItems;
     TxItems txByTime;
 
+    std::list<CAccountingEntry> acentries;
+    ListAccountCreditDebit("", acentries);
+    txByTime.reserve(pwallet->mapWallet.size() + acentries.size());
     for (auto it = pwallet->mapWallet.begin(); it != pwallet->mapWallet.end(); ++it) {
         CWalletTx* wtx = &((*it).second);
-        txByTime.insert(std::make_pair(wtx->nTimeReceived, TxPair(wtx, (CAccountingEntry*)0)));
+        txByTime.emplace_back(wtx->nTimeReceived, TxPair(wtx, (CAccountingEntry*)0));
     }
-    std::list<CAccountingEntry> acentries;
-    ListAccountCreditDebit("", acentries);
     for (CAccountingEntry& entry : acentries) {
-        txByTime.insert(std::make_pair(entry.nTime, TxPair((CWalletTx*)0, &entry)));
+        txByTime.emplace_back(entry.nTime, TxPair((CWalletTx*)0, &entry));
     }
+    std::stable_sort(txByTime.begin(), txByTime.end(),
+        [](const TxItems::value_type& a, const TxItems::value_type& b) { return a.first < b.first; });
 
     int64_t& nOrderPosNext = pwallet->nOrderPosNext;
     nOrderPosNext = 0;
@@ -468,6 +490,37 @@ public:
     }
 };
 
+/**
+ * Deserialize the value of a "tx" record whose key has been read up to the
+ * hash. Doesn't touch the wallet, so it is safe to call off the cursor thread.
+ */
+static bool ReadWalletTx(CDataStream& ssKey, CDataStream& ssValue, CWalletTx& wtx, bool& fUpgraded, std::string& strErr)
+{
+    uint256 hash;
+    ssKey >> hash;
+    ssValue >> wtx;
+    if (wtx.GetHash() != hash)
+        return false;
+
+    // Undo serialize changes in 31600
+    fUpgraded = false;
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703) {
+        if (!ssValue.empty()) {
+            char fTmp;
+            char fUnused;
+            ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        } else {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgraded = true;
+    }
+    return true;
+}
+
 bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CWalletScanState& wss, std::string& strType, std::string& strErr)
 {
     try {
@@ -484,29 +537,12 @@ bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CW
             ssKey >> strAddress;
             ssValue >> pwallet->mapAddressBook[DecodeDestination(strAddress)].purpose;
         } else if (strType == "tx") {
-            uint256 hash;
-            ssKey >> hash;
             CWalletTx wtx;
-            ssValue >> wtx;
-            if (wtx.GetHash() != hash)
+            bool fUpgraded;
+            if (!ReadWalletTx(ssKey, ssValue, wtx, fUpgraded, strErr))
                 return false;
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703) {
-                if (!ssValue.empty()) {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                        wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                } else {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
+            if (fUpgraded)
+                wss.vWalletUpgrade.push_back(wtx.GetHash());
             if (wtx.nOrderPos == -1)
                 wss.fAnyUnordered = true;
 
@@ -697,6 +733,12 @@ bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CW
                 pwallet->nAutoCombineThreshold *= COIN;
         } else if (strType == "loadedrecordsmaxcount") {
             ssValue >> pwallet->nLoadedRecordsMaxCount;
+        } else if (strType == "rewardday") {
+            int nDay;
+            ssKey >> nDay;
+            ssValue >> pwallet->mapRewardDays[nDay];
+        } else if (strType == "rewardbest") {
+            ssValue >> pwallet->hashRewardBest;
         } else if (strType == "destdata") {
             std::string strAddress, strKey, strValue;
             ssKey >> strAddress;
@@ -724,14 +766,172 @@ static bool IsKeyType(std::string strType)
             strType == "sapzkey" || strType == "csapzkey");
 }
 
+static bool IsTxRecordKey(const CDataStream& ssKey)
+{
+    // serialized std::string("tx"): compact size length, then the characters
+    return ssKey.size() > 3 && ssKey[0] == 2 && ssKey[1] == 't' && ssKey[2] == 'x';
+}
+
+/**
+ * Deserializes the "tx" records of a wallet scan on worker threads while the
+ * cursor keeps reading. Transactions make up the bulk of a large wallet and
+ * decoding them (including hashing) doesn't depend on any other record.
+ * Records are queued in cursor order, in batches, and read back in the same
+ * order after Finish().
+ */
+class CWalletTxLoader
+{
+public:
+    struct Record {
+        CDataStream ssKey;
+        CDataStream ssValue;
+        CWalletTx wtx;
+        bool fOk;
+        bool fUpgraded;
+        std::string strErr;
+
+        Record(CDataStream&& ssKeyIn, CDataStream&& ssValueIn) : ssKey(std::move(ssKeyIn)), ssValue(std::move(ssValueIn)), fOk(false), fUpgraded(false) {}
+    };
+    typedef std::vector<Record> Batch;
+
+    static const size_t BATCH_SIZE = 256;
+
+    explicit CWalletTxLoader(int nThreadsIn) : nThreads(nThreadsIn)
+    {
+        for (int i = 0; i < nThreads; i++)
+            vThreads.emplace_back(&CWalletTxLoader::ThreadDecode, this);
+    }
+
+    ~CWalletTxLoader()
+    {
+        Finish();
+    }
+
+    int GetThreads() const { return nThreads; }
+    size_t GetCount() const { return nRecords; }
+
+    /** Queue a "tx" record; the streams are taken over by the loader */
+    void Add(CDataStream&& ssKey, CDataStream&& ssValue)
+    {
+        if (!batchFill) {
+            batchFill.reset(new Batch());
+            batchFill->reserve(BATCH_SIZE);
+        }
+        batchFill->emplace_back(std::move(ssKey), std::move(ssValue));
+        nRecords++;
+        if (batchFill->size() >= BATCH_SIZE)
+            QueueBatch();
+    }
+
+    /** Wait until every queued record is decoded and stop the workers */
+    void Finish()
+    {
+        QueueBatch();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fDone = true;
+        }
+        cond.notify_all();
+        for (std::thread& thread : vThreads)
+            thread.join();
+        vThreads.clear();
+    }
+
+    const std::vector<std::unique_ptr<Batch> >& GetBatches() const { return vBatches; }
+
+    /** Time spent decoding, summed over all threads */
+    int64_t GetDecodeMicros() const { return nDecodeMicros; }
+
+private:
+    void QueueBatch()
+    {
+        if (!batchFill)
+            return;
+        if (nThreads == 0)
+            Decode(*batchFill);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            vBatches.push_back(std::move(batchFill));
+        }
+        cond.notify_one();
+    }
+
+    void Decode(Batch& batch)
+    {
+        const int64_t nStart = GetTimeMicros();
+        for (Record& rec : batch) {
+            try {
+                std::string strType;
+                rec.ssKey >> strType;
+                rec.fOk = ReadWalletTx(rec.ssKey, rec.ssValue, rec.wtx, rec.fUpgraded, rec.strErr);
+            } catch (...) {
+                rec.fOk = false;
+            }
+            // the raw record isn't needed anymore
+            CSerializeData vchFree;
+            rec.ssValue.swap_data(vchFree);
+        }
+        nDecodeMicros += GetTimeMicros() - nStart;
+    }
+
+    void ThreadDecode()
+    {
+        while (true) {
+            Batch* pbatch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this] { return nNextBatch < vBatches.size() || fDone; });
+                if (nNextBatch == vBatches.size())
+                    return;
+                pbatch = vBatches[nNextBatch++].get();
+            }
+            Decode(*pbatch);
+        }
+    }
+
+    const int nThreads;
+    std::vector<std::thread> vThreads;
+    std::unique_ptr<Batch> batchFill;
+    size_t nRecords = 0;
+    std::atomic<int64_t> nDecodeMicros{0};
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::unique_ptr<Batch> > vBatches;
+    size_t nNextBatch = 0;
+    bool fDone = false;
+};
+
+/** Number of records and time spent on them, per record type */
+typedef std::map<std::string, std::pair<unsigned int, int64_t> > LoadStats;
+
+static std::string FormatLoadStats(const LoadStats& stats)
+{
+    std::vector<std::pair<int64_t, std::string> > vSorted;
+    for (const auto& it : stats)
+        vSorted.emplace_back(it.second.second, it.first);
+    std::sort(vSorted.rbegin(), vSorted.rend());
+
+    std::string str;
+    for (const auto& it : vSorted) {
+        const std::pair<unsigned int, int64_t>& stat = stats.at(it.second);
+        str += strprintf("%s%s %u/%dms", str.empty() ? "" : ", ", it.second, stat.first, stat.second / 1000);
+    }
+    return str;
+}
+
 DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
 {
     CWalletScanState wss;
     bool fNoncriticalErrors = false;
     DBErrors result = DB_LOAD_OK;
+    const int64_t nLoadStart = GetTimeMicros();
+    LoadStats stats;
 
     LOCK(pwallet->cs_wallet);
     try {
+        CWalletTxLoader txLoader(std::max(0, std::min(GetNumCores() - 1, MAX_WALLET_LOAD_THREADS)));
+
         int nMinVersion = 0;
         if (Read((std::string) "minversion", nMinVersion)) {
             if (nMinVersion > CLIENT_VERSION)
@@ -740,7 +940,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
         }
 
         // Get cursor
-        Dbc* pcursor = GetCursor();
+        std::unique_ptr<CDBCursor> pcursor = GetCursor();
         if (!pcursor) {
             LogPrintf("Error getting wallet database cursor\n");
             return DB_CORRUPT;
@@ -750,7 +950,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0) {
@@ -758,9 +958,19 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                 return DB_CORRUPT;
             }
 
+            if (IsTxRecordKey(ssKey)) {
+                txLoader.Add(std::move(ssKey), std::move(ssValue));
+                continue;
+            }
+
             // Try to be tolerant of single corrupt records:
+            const int64_t nRecordStart = GetTimeMicros();
             std::string strType, strErr;
-            if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr)) {
+            bool fRead = ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr);
+            std::pair<unsigned int, int64_t>& stat = stats[strType];
+            stat.first++;
+            stat.second += GetTimeMicros() - nRecordStart;
+            if (!fRead) {
                 // losing keys is considered a catastrophic error, anything else
                 // we assume the user can live with:
                 if (IsKeyType(strType) || strType == "defaultkey")
@@ -777,7 +987,37 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             if (!strErr.empty())
                 LogPrintf("%s\n", strErr);
         }
-        pcursor->close();
+        pcursor.reset();
+
+        // Add the decoded transactions in cursor order
+        int64_t nStart = GetTimeMicros();
+        txLoader.Finish();
+        const int64_t nWaitMicros = GetTimeMicros() - nStart;
+        nStart = GetTimeMicros();
+        pwallet->mapWallet.reserve(pwallet->mapWallet.size() + txLoader.GetCount());
+        for (const auto& batch : txLoader.GetBatches()) {
+            for (CWalletTxLoader::Record& rec : *batch) {
+                if (!rec.fOk) {
+                    std::cout << "tx - " << rec.strErr << std::endl;
+                    fNoncriticalErrors = true;
+                    // Rescan if there is a bad transaction record:
+                    SoftSetBoolArg("-rescan", true);
+                } else {
+                    if (rec.fUpgraded)
+                        wss.vWalletUpgrade.push_back(rec.wtx.GetHash());
+                    if (rec.wtx.nOrderPos == -1)
+                        wss.fAnyUnordered = true;
+                    pwallet->LoadToWallet(rec.wtx);
+                }
+                if (!rec.strErr.empty())
+                    LogPrintf("%s\n", rec.strErr);
+            }
+        }
+        if (txLoader.GetCount()) {
+            stats["tx"] = std::make_pair((unsigned int)txLoader.GetCount(), GetTimeMicros() - nStart);
+            LogPrint(BCLog::DB, "%s: decoded %u transactions in %dms on %d threads (%dms waited for after the scan), added in %dms\n", __func__,
+                txLoader.GetCount(), txLoader.GetDecodeMicros() / 1000, std::max(1, txLoader.GetThreads()), nWaitMicros / 1000, stats["tx"].second / 1000);
+        }
     } catch (const boost::thread_interrupted&) {
         throw;
     } catch (...) {
@@ -814,14 +1054,21 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
     if (wss.nFileVersion < CLIENT_VERSION) // Update
         WriteVersion(CLIENT_VERSION);
 
-    if (wss.fAnyUnordered)
+    int64_t nStart = GetTimeMicros();
+    if (wss.fAnyUnordered) {
         result = ReorderTransactions(pwallet);
+        stats["reorder"] = std::make_pair((unsigned int)pwallet->mapWallet.size(), GetTimeMicros() - nStart);
+    }
 
+    nStart = GetTimeMicros();
     pwallet->laccentries.clear();
     ListAccountCreditDebit("*", pwallet->laccentries);
     for (CAccountingEntry& entry : pwallet->laccentries) {
         pwallet->wtxOrdered.insert(std::make_pair(entry.nOrderPos, CWallet::TxPair((CWalletTx*)0, &entry)));
     }
+    stats["acentries"] = std::make_pair((unsigned int)pwallet->laccentries.size(), GetTimeMicros() - nStart);
+
+    LogPrintf("Wallet records loaded in %dms: %s\n", (GetTimeMicros() - nLoadStart) / 1000, FormatLoadStats(stats));
 
     return result;
 }
@@ -841,7 +1088,7 @@ DBErrors CWalletDB::FindWalletTx(CWallet* pwallet, std::vector<uint256>& vTxHash
         }
 
         // Get cursor
-        Dbc* pcursor = GetCursor();
+        std::unique_ptr<CDBCursor> pcursor = GetCursor();
         if (!pcursor) {
             LogPrintf("Error getting wallet database cursor\n");
             return DB_CORRUPT;
@@ -851,7 +1098,7 @@ DBErrors CWalletDB::FindWalletTx(CWallet* pwallet, std::vector<uint256>& vTxHash
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = ReadAtCursor(pcursor, ssKey, ssValue);
+            int ret = ReadAtCursor(pcursor.get(), ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
             else if (ret != 0) {
@@ -872,7 +1119,7 @@ DBErrors CWalletDB::FindWalletTx(CWallet* pwallet, std::vector<uint256>& vTxHash
                 vWtx.push_back(wtx);
             }
         }
-        pcursor->close();
+        pcursor.reset();
     } catch (const boost::thread_interrupted&) {
         throw;
     } catch (...) {
@@ -988,14 +1235,21 @@ bool BackupWallet(const CWallet& wallet, const fs::path& strDest, bool fEnableCu
         }
     }
 
+    // SQLite wallets are copied online through a connection of their own and
+    // need neither cs_db nor the file to be unused, the others once nobody uses them
+    const bool fSQLite = bitdb.IsSQLite(wallet.strWalletFile);
     while (true) {
         {
-            LOCK(bitdb.cs_db);
-            if (!bitdb.mapFileUseCount.count(wallet.strWalletFile) || bitdb.mapFileUseCount[wallet.strWalletFile] == 0) {
-                // Flush log data to the dat file
-                bitdb.CloseDb(wallet.strWalletFile);
-                bitdb.CheckpointLSN(wallet.strWalletFile);
-                bitdb.mapFileUseCount.erase(wallet.strWalletFile);
+            std::unique_ptr<DebugLock<RecursiveMutex> > lockDb;
+            if (!fSQLite)
+                lockDb.reset(new DebugLock<RecursiveMutex>(bitdb.cs_db, "bitdb.cs_db", __FILE__, __LINE__));
+            if (fSQLite || !bitdb.mapFileUseCount.count(wallet.strWalletFile) || bitdb.mapFileUseCount[wallet.strWalletFile] == 0) {
+                if (!fSQLite) {
+                    // Flush log data to the dat file
+                    bitdb.CloseDb(wallet.strWalletFile);
+                    bitdb.CheckpointLSN(wallet.strWalletFile);
+                    bitdb.mapFileUseCount.erase(wallet.strWalletFile);
+                }
 
                 // Copy wallet file
                 fs::path pathDest(strDest);
@@ -1077,22 +1331,31 @@ bool AttemptBackupWallet(const CWallet& wallet, const fs::path& pathSrc, const f
             LogPrintf("cannot backup to wallet source file %s\n", pathDest.string());
             return false;
         }
+        if (bitdb.IsSQLite(wallet.strWalletFile)) {
+            // Online copy through SQLite: consistent even while the wallet writes
+            std::string strError;
+            if (fs::exists(pathDest))
+                fs::remove(pathDest);
+            if (!CSQLiteDatabase(pathSrc).Backup(pathDest, strError))
+                throw std::runtime_error(strprintf("SQLite backup to %s failed: %s", pathDest.string(), strError));
+        } else {
 #if BOOST_VERSION >= 107400 /* BOOST_LIB_VERSION 1_74 */
-        fs::copy_file(pathSrc.c_str(), pathDest, fs::copy_options::overwrite_existing);
+            fs::copy_file(pathSrc.c_str(), pathDest, fs::copy_options::overwrite_existing);
 #elif BOOST_VERSION >= 105800 /* BOOST_LIB_VERSION 1_58 */
-        fs::copy_file(pathSrc.c_str(), pathDest, fs::copy_option::overwrite_if_exists);
+            fs::copy_file(pathSrc.c_str(), pathDest, fs::copy_option::overwrite_if_exists);
 #else
-        std::ifstream src(pathSrc.c_str(),  std::ios::binary | std::ios::in);
-        std::ofstream dst(pathDest.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
-        dst << src.rdbuf();
-        dst.flush();
-        src.close();
-        dst.close();
+            std::ifstream src(pathSrc.c_str(),  std::ios::binary | std::ios::in);
+            std::ofstream dst(pathDest.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+            dst << src.rdbuf();
+            dst.flush();
+            src.close();
+            dst.close();
 #endif
+        }
         strMessage = strprintf("copied %s to %s\n", wallet.strWalletFile, pathDest.string());
         LogPrintf("%s : %s\n", __func__, strMessage);
         retStatus = true;
-    } catch (const fs::filesystem_error& e) {
+    } catch (const std::exception& e) {
         retStatus = false;
         strMessage = strprintf("%s\n", e.what());
         LogPrintf("%s : %s\n", __func__, strMessage);
@@ -22,12 +22,15 @@
 #include <vector>
 
 static const bool DEFAULT_FLUSHWALLET = true;
+//! Maximum number of threads decoding transaction records while a wallet loads
+static const int MAX_WALLET_LOAD_THREADS = 8;
 
 class CAccount;
 class CAccountingEntry;
 struct CBlockLocator;
 class CKeyPool;
 class CMasterKey;
+class CRewardDay;
 class CScript;
 class CWallet;
 class CWalletTx;
@@ -140,6 +143,10 @@ public:
     bool EraseMSDisabledAddresses(std::vector<std::string> vDisabledAddresses);
     bool WriteAutoCombineSettings(bool fEnable, CAmount nCombineThreshold);
     bool WriteLoadedRecordsMaxCount(int nLoadedRecordsMaxCount);
+
+    bool WriteRewardDay(int nDay, const CRewardDay& day);
+    bool EraseRewardDay(int nDay);
+    bool WriteRewardBest(const uint256& hashBest);
     
     bool ReadPool(int64_t nPool, CKeyPool& keypool);
     bool WritePool(int64_t nPool, const CKeyPool& keypool);
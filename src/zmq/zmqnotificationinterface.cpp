@@ -9,14 +9,21 @@
 #include "version.h"
 #include "main.h"
 #include "streams.h"
+#include "txmempool.h"
 #include "util.h"
 
+CZMQNotificationInterface* g_zmq_notification_interface = NULL;
+
 void zmqError(const char *str)
 {
     LogPrint(BCLog::ZMQ, "Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL),
+                                                         nMaxQueueSize(DEFAULT_ZMQ_QUEUE_SIZE),
+                                                         fStopPublishing(false),
+                                                         nEnqueued(0),
+                                                         nDropped(0)
 {
 }
 
@@ -42,6 +49,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubrawtxlock"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionLockNotifier>;
+    factories["pubsequence"] = CZMQAbstractNotifier::Create<CZMQPublishSequenceNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -53,6 +61,9 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
             CZMQAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+            std::map<std::string, std::string>::const_iterator k = args.find("-zmq" + i->first + "hwm");
+            if (k != args.end())
+                notifier->SetOutboundMessageHighWaterMark(atoi(k->second));
             notifiers.push_back(notifier);
         }
     }
@@ -61,6 +72,9 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     {
         notificationInterface = new CZMQNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        std::map<std::string, std::string>::const_iterator q = args.find("-zmqqueuesize");
+        if (q != args.end())
+            notificationInterface->nMaxQueueSize = std::max(1, atoi(q->second));
 
         if (!notificationInterface->Initialize())
         {
@@ -106,6 +120,12 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    for (CZMQAbstractNotifier* notifier : notifiers)
+        vNotifierInfo.push_back(NotifierInfo{notifier->GetType(), notifier->GetAddress(), notifier->GetOutboundMessageHighWaterMark()});
+
+    fStopPublishing = false;
+    threadPublish = std::thread(&TraceThread<std::function<void()> >, "zmqpub", std::function<void()>(std::bind(&CZMQNotificationInterface::ThreadPublish, this)));
+
     return true;
 }
 
@@ -113,6 +133,16 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint(BCLog::ZMQ, "Shutdown notification interface\n");
+    if (threadPublish.joinable())
+    {
+        // let the publisher flush whatever is still queued
+        {
+            std::lock_guard<std::mutex> lock(cs_queue);
+            fStopPublishing = true;
+        }
+        cond_queue.notify_all();
+        threadPublish.join();
+    }
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -127,53 +157,88 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+size_t CZMQNotificationInterface::GetQueueSize() const
+{
+    std::lock_guard<std::mutex> lock(cs_queue);
+    return queue.size();
+}
+
+void CZMQNotificationInterface::Enqueue(std::function<bool(CZMQAbstractNotifier*)> func)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+        std::lock_guard<std::mutex> lock(cs_queue);
+        if (queue.size() >= nMaxQueueSize) {
+            if (nDropped++ % 1000 == 0)
+                LogPrintf("ZMQ notification queue full (%u entries), %u notifications dropped so far\n", nMaxQueueSize, nDropped);
+            return;
         }
+        queue.push_back(std::move(func));
     }
+    nEnqueued++;
+    cond_queue.notify_one();
 }
 
-void CZMQNotificationInterface::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
+void CZMQNotificationInterface::ThreadPublish()
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
+    while (true) {
+        std::function<bool(CZMQAbstractNotifier*)> func;
         {
-            i++;
+            std::unique_lock<std::mutex> lock(cs_queue);
+            while (!fStopPublishing && queue.empty())
+                cond_queue.wait(lock);
+            if (queue.empty())
+                return;
+            func = std::move(queue.front());
+            queue.pop_front();
         }
-        else
+
+        for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
         {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+            CZMQAbstractNotifier *notifier = *i;
+            if (func(notifier))
+            {
+                i++;
+            }
+            else
+            {
+                notifier->Shutdown();
+                i = notifiers.erase(i);
+            }
         }
     }
 }
 
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    Enqueue([pindex](CZMQAbstractNotifier* notifier) { return notifier->NotifyBlock(pindex); });
+}
+
+void CZMQNotificationInterface::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
+{
+    Enqueue([tx](CZMQAbstractNotifier* notifier) { return notifier->NotifyTransaction(tx); });
+}
+
 void CZMQNotificationInterface::NotifyTransactionLock(const CTransaction &tx)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransactionLock(tx))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
-    }
+    Enqueue([tx](CZMQAbstractNotifier* notifier) { return notifier->NotifyTransactionLock(tx); });
+}
+
+void CZMQNotificationInterface::TransactionAddedToMempool(const CTransaction& tx, uint64_t nMempoolSequence)
+{
+    Enqueue([tx, nMempoolSequence](CZMQAbstractNotifier* notifier) { return notifier->NotifyTransactionAcceptance(tx, nMempoolSequence); });
+}
+
+void CZMQNotificationInterface::TransactionRemovedFromMempool(const CTransaction& tx, MemPoolRemovalReason reason, uint64_t nMempoolSequence)
+{
+    Enqueue([tx, nMempoolSequence](CZMQAbstractNotifier* notifier) { return notifier->NotifyTransactionRemoval(tx, nMempoolSequence); });
+}
+
+void CZMQNotificationInterface::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    Enqueue([pindex](CZMQAbstractNotifier* notifier) { return notifier->NotifyBlockConnect(pindex); });
+}
+
+void CZMQNotificationInterface::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    Enqueue([pindex](CZMQAbstractNotifier* notifier) { return notifier->NotifyBlockDisconnect(pindex); });
 }
@@ -7,19 +7,44 @@
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include "validationinterface.h"
-#include <string>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
 #include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+/** Default for -zmqqueuesize, the number of notifications buffered for the publisher thread */
+static const unsigned int DEFAULT_ZMQ_QUEUE_SIZE = 10000;
+
 class CZMQNotificationInterface : public CValidationInterface
 {
 public:
+    /** Publisher configuration as seen at startup, for getzmqnotifications */
+    struct NotifierInfo {
+        std::string type;
+        std::string address;
+        int hwm;
+    };
+
     virtual ~CZMQNotificationInterface();
 
     static CZMQNotificationInterface* CreateWithArguments(const std::map<std::string, std::string> &args);
 
+    std::vector<NotifierInfo> GetNotifierInfo() const { return vNotifierInfo; }
+    size_t GetQueueSize() const;
+    size_t GetMaxQueueSize() const { return nMaxQueueSize; }
+    uint64_t GetEnqueuedCount() const { return nEnqueued; }
+    uint64_t GetDroppedCount() const { return nDropped; }
+
 protected:
     bool Initialize();
     void Shutdown();
@@ -28,12 +53,38 @@ protected:
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void NotifyTransactionLock(const CTransaction &tx);
+    void TransactionAddedToMempool(const CTransaction& tx, uint64_t nMempoolSequence);
+    void TransactionRemovedFromMempool(const CTransaction& tx, MemPoolRemovalReason reason, uint64_t nMempoolSequence);
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex);
 
 private:
     CZMQNotificationInterface();
 
+    /**
+     * Hand a notification over to the publisher thread. Serialization and
+     * sending happen there so the validation thread never waits on ZMQ or
+     * disk; when the queue is full the notification is dropped and counted.
+     */
+    void Enqueue(std::function<bool(CZMQAbstractNotifier*)> func);
+    /** Publisher thread: drain the queue until shutdown */
+    void ThreadPublish();
+
     void *pcontext;
     std::list<CZMQAbstractNotifier*> notifiers;
+    std::vector<NotifierInfo> vNotifierInfo;
+
+    mutable std::mutex cs_queue;
+    std::condition_variable cond_queue;
+    std::deque<std::function<bool(CZMQAbstractNotifier*)> > queue;
+    size_t nMaxQueueSize;
+    bool fStopPublishing;
+    std::thread threadPublish;
+
+    std::atomic<uint64_t> nEnqueued;
+    std::atomic<uint64_t> nDropped;
 };
 
+extern CZMQNotificationInterface* g_zmq_notification_interface;
+
 #endif // BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
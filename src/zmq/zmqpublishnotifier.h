@@ -65,4 +65,21 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction);
 };
 
+/**
+ * Publishes chain and mempool events in the order they happened:
+ *   <32-byte hash>C                       : block connected
+ *   <32-byte hash>D                       : block disconnected
+ *   <32-byte txid>A<8-byte LE mempool seq> : transaction added to the mempool
+ *   <32-byte txid>R<8-byte LE mempool seq> : transaction removed from the mempool
+ *                                            (for any reason other than block inclusion)
+ */
+class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnect(const CBlockIndex *pindex);
+    bool NotifyBlockDisconnect(const CBlockIndex *pindex);
+    bool NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t mempool_sequence);
+    bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -0,0 +1,65 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zmq/zmqrpc.h"
+
+#include "rpc/server.h"
+#include "utilstrencodings.h"
+#include "zmq/zmqnotificationinterface.h"
+
+#include <univalue.h>
+
+UniValue getzmqnotifications(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getzmqnotifications\n"
+            "\nReturns information about the active ZeroMQ notifications and the publisher queue.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"notifications\": [\n"
+            "    {\n"
+            "      \"type\": \"pubhashtx\",          (string) Type of notification\n"
+            "      \"address\": \"...\",             (string) Address of the publisher\n"
+            "      \"hwm\": n                       (numeric) Outbound message high water mark\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"queue_size\": n,                  (numeric) Notifications waiting for the publisher thread\n"
+            "  \"max_queue_size\": n,              (numeric) Queue capacity (-zmqqueuesize)\n"
+            "  \"enqueued\": n,                    (numeric) Notifications queued since startup\n"
+            "  \"dropped\": n                      (numeric) Notifications dropped because the queue was full\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getzmqnotifications", "") + HelpExampleRpc("getzmqnotifications", ""));
+
+    UniValue notifications(UniValue::VARR);
+    UniValue ret(UniValue::VOBJ);
+    if (g_zmq_notification_interface) {
+        for (const CZMQNotificationInterface::NotifierInfo& info : g_zmq_notification_interface->GetNotifierInfo()) {
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("type", info.type));
+            obj.push_back(Pair("address", info.address));
+            obj.push_back(Pair("hwm", info.hwm));
+            notifications.push_back(obj);
+        }
+    }
+    ret.push_back(Pair("notifications", notifications));
+    ret.push_back(Pair("queue_size", (uint64_t)(g_zmq_notification_interface ? g_zmq_notification_interface->GetQueueSize() : 0)));
+    ret.push_back(Pair("max_queue_size", (uint64_t)(g_zmq_notification_interface ? g_zmq_notification_interface->GetMaxQueueSize() : 0)));
+    ret.push_back(Pair("enqueued", g_zmq_notification_interface ? g_zmq_notification_interface->GetEnqueuedCount() : 0));
+    ret.push_back(Pair("dropped", g_zmq_notification_interface ? g_zmq_notification_interface->GetDroppedCount() : 0));
+    return ret;
+}
+
+static const CRPCCommand commands[] =
+{ //  category              name                       actor (function)          okSafeMode
+  //  --------------------- -------------------------- ------------------------- ----------
+    { "zmq",                "getzmqnotifications",     &getzmqnotifications,     true  },
+};
+
+void zmqRegisterRPCCommands()
+{
+    for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
+        tableRPC.appendCommand(commands[vcidx].name, &commands[vcidx]);
+}
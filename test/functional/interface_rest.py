@@ -11,8 +11,11 @@ from io import BytesIO
 from codecs import encode
 
 import http.client
+import time
 import urllib.parse
 
+from test_framework.messages import deser_compact_size, ser_compact_size
+
 def deser_uint256(f):
     r = 0
     for i in range(8):
@@ -322,5 +325,90 @@ class RESTTest (PivxTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        ##############################
+        # /rest/blockhashbyheight/   #
+        ##############################
+        bb_height = self.nodes[0].getblockcount()
+        json_string = http_get_call(url.hostname, url.port, '/rest/blockhashbyheight/'+str(bb_height)+self.FORMAT_SEPARATOR+'json')
+        assert_equal(json.loads(json_string)['blockhash'], bb_hash)
+        hex_string = http_get_call(url.hostname, url.port, '/rest/blockhashbyheight/1'+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(hex_string.rstrip(), self.nodes[0].getblockhash(1))
+        response = http_get_call(url.hostname, url.port, '/rest/blockhashbyheight/'+str(bb_height+1)+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+        response = http_get_call(url.hostname, url.port, '/rest/blockhashbyheight/abc'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
+        #######################
+        # /rest/blockrange/   #
+        #######################
+        # the binary range is the concatenation of the single binary blocks
+        range_start = bb_height - 4
+        response = http_get_call(url.hostname, url.port, '/rest/blockrange/'+str(range_start)+'/5'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        range_bin = response.read()
+        expected = b''
+        for h in range(range_start, bb_height + 1):
+            blockhash = self.nodes[0].getblockhash(h)
+            expected += http_get_call(url.hostname, url.port, '/rest/block/'+blockhash+self.FORMAT_SEPARATOR+'bin', True).read()
+        assert_equal(range_bin, expected)
+        # the binary block must also match the RPC serialization
+        assert(expected.endswith(hex_str_to_bytes(self.nodes[0].getblock(bb_hash, False))))
+
+        json_string = http_get_call(url.hostname, url.port, '/rest/blockrange/'+str(range_start)+'/10'+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(len(json_obj), 5) # truncated at the chain tip
+        assert_equal([b['height'] for b in json_obj], list(range(range_start, bb_height + 1)))
+        assert_equal(json_obj[-1]['hash'], bb_hash)
+
+        response = http_get_call(url.hostname, url.port, '/rest/blockrange/0/0'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 400)
+        response = http_get_call(url.hostname, url.port, '/rest/blockrange/0/501'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 400)
+        response = http_get_call(url.hostname, url.port, '/rest/blockrange/'+str(bb_height+1)+'/1'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 404)
+
+        # throughput of whole-chain range fetches served to a local client
+        start_time = time.time()
+        served = 0
+        for h in range(0, bb_height + 1, 50):
+            response = http_get_call(url.hostname, url.port, '/rest/blockrange/'+str(h)+'/50'+self.FORMAT_SEPARATOR+'bin', True)
+            assert_equal(response.status, 200)
+            response.read()
+            served += min(50, bb_height + 1 - h)
+        elapsed = time.time() - start_time
+        self.log.info("blockrange served %d blocks in %.3fs (%.0f blocks/sec)" % (served, elapsed, served / max(elapsed, 1e-6)))
+
+        #################################
+        # GETUTXOS: batched body limit #
+        #################################
+        # outpoints posted in the body are allowed beyond the URI limit of 15:
+        # the unspent 0.1 output every other entry, missing outputs in between
+        nBatch = 100
+        binaryRequest = b'\x01' + ser_compact_size(nBatch) # checkmempool
+        for i in range(nBatch):
+            binaryRequest += hex_str_to_bytes(txid)[::-1] # uint256 bytes are the reversed hex
+            binaryRequest += pack("i", n if i % 2 == 0 else 1000 + i)
+        bin_response = http_post_call(url.hostname, url.port, '/rest/getutxos'+self.FORMAT_SEPARATOR+'bin', binaryRequest, True)
+        assert_equal(bin_response.status, 200)
+        output = BytesIO(bin_response.read())
+        chainHeight = unpack("i", output.read(4))[0]
+        hashFromBinResponse = hex(deser_uint256(output))[2:].zfill(64)
+        assert_equal(chainHeight, self.nodes[0].getblockcount())
+        assert_equal(hashFromBinResponse, self.nodes[0].getbestblockhash())
+        bitmap = output.read(deser_compact_size(output))
+        assert_equal(bitmap, b'\x55' * (nBatch // 8) + b'\x05')
+        assert_equal(deser_compact_size(output), nBatch // 2) # utxos
+
+        # the same request in hex gives the same answer
+        hex_response = http_post_call(url.hostname, url.port, '/rest/getutxos'+self.FORMAT_SEPARATOR+'hex', bytes_to_hex_str(binaryRequest), True)
+        assert_equal(hex_response.status, 200)
+        assert_equal(hex_str_to_bytes(hex_response.read().decode('ascii').rstrip()), output.getvalue())
+
+        binaryRequest = b'\x00' + ser_compact_size(1001)
+        for _ in range(1001):
+            binaryRequest += hex_str_to_bytes(txid)[::-1] + pack("i", n)
+        bin_response = http_post_call(url.hostname, url.port, '/rest/getutxos'+self.FORMAT_SEPARATOR+'bin', binaryRequest, True)
+        assert_equal(bin_response.status, 400)
+
 if __name__ == '__main__':
     RESTTest ().main ()
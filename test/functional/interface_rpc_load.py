@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The DECENOMY Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Load test for the multi-threaded RPC server.
+
+Drive N concurrent clients, each on its own HTTP connection, issuing the
+read-only calls an explorer uses (getblockcount, getbestblockhash, getblock,
+getrawtransaction, gettxout) and check that:
+    - every call succeeds and returns data consistent with the chain tip
+    - getrpcinfo accounts for every call, with execution and queue-wait histograms
+    - getrpcinfo reset clears the counters
+Calls/sec are logged for each client count.
+"""
+
+import threading
+import time
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    get_rpc_proxy,
+)
+
+CALLS_PER_CLIENT = 200
+CLIENT_COUNTS = [1, 4, 16]
+
+class RPCLoadTest(PivxTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.extra_args = [["-txindex=1", "-rpcthreads=16", "-rpcworkqueue=64"]]
+
+    def client_loop(self, hashes, txids, errors):
+        rpc = get_rpc_proxy(self.nodes[0].url, 0, timeout=60)
+        try:
+            for i in range(CALLS_PER_CLIENT):
+                n = i % len(hashes)
+                op = i % 5
+                if op == 0:
+                    assert_equal(rpc.getblockcount(), len(hashes) - 1)
+                elif op == 1:
+                    assert_equal(rpc.getbestblockhash(), hashes[-1])
+                elif op == 2:
+                    assert_equal(rpc.getblock(hashes[n])['hash'], hashes[n])
+                elif op == 3:
+                    assert_equal(rpc.getrawtransaction(txids[n], 1)['txid'], txids[n])
+                else:
+                    rpc.gettxout(txids[n], 0)
+        except Exception as e:
+            errors.append(e)
+
+    def run_load(self, num_clients, hashes, txids):
+        errors = []
+        threads = [threading.Thread(target=self.client_loop, args=(hashes, txids, errors))
+                   for _ in range(num_clients)]
+        start = time.time()
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        elapsed = time.time() - start
+        assert_equal(errors, [])
+        total = num_clients * CALLS_PER_CLIENT
+        self.log.info("%d clients: %d calls in %.2fs (%.0f calls/sec)" % (num_clients, total, elapsed, total / elapsed))
+        return total
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(50)
+        hashes = [node.getblockhash(h) for h in range(node.getblockcount() + 1)]
+        txids = [node.getblock(h)['tx'][0] for h in hashes]
+
+        node.getrpcinfo(True)
+        total = 0
+        for num_clients in CLIENT_COUNTS:
+            total += self.run_load(num_clients, hashes, txids)
+
+        self.log.info("Check getrpcinfo accounting")
+        info = node.getrpcinfo()
+        methods = info['methods']
+        counted = sum(methods[m]['exec']['count'] for m in
+                      ['getblockcount', 'getbestblockhash', 'getblock', 'getrawtransaction', 'gettxout'])
+        assert_equal(counted, total)
+        for m in ['getblock', 'getrawtransaction']:
+            assert_equal(methods[m]['errors'], 0)
+            assert_equal(methods[m]['exec']['count'], methods[m]['queue_wait']['count'])
+            assert_greater_than(methods[m]['exec']['max_us'], 0)
+        # the getrpcinfo call itself is in flight
+        assert_equal(info['active_commands'], 1)
+
+        self.log.info("Check getrpcinfo reset")
+        node.getrpcinfo(True)
+        assert_equal(node.getrpcinfo()['methods']['getblock']['exec']['count'], 0)
+
+if __name__ == '__main__':
+    RPCLoadTest().main()
@@ -71,8 +71,10 @@ class ZMQTest (PivxTestFramework):
         self.hashtx = ZMQSubscriber(socket, b"hashtx")
         self.rawblock = ZMQSubscriber(socket, b"rawblock")
         self.rawtx = ZMQSubscriber(socket, b"rawtx")
+        self.sequence = ZMQSubscriber(socket, b"sequence")
 
-        self.extra_args = [["-zmqpub%s=%s" % (sub.topic.decode(), address) for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx]], []]
+        self.extra_args = [["-zmqpub%s=%s" % (sub.topic.decode(), address) for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx, self.sequence]] +
+                           ["-zmqpubsequencehwm=5000"], []]
         self.add_nodes(self.num_nodes, self.extra_args)
         self.start_nodes()
         time.sleep(10)
@@ -92,6 +94,9 @@ class ZMQTest (PivxTestFramework):
         self.sync_all()
 
         for x in range(num_blocks):
+            # Should receive the block connection first.
+            self.check_sequence(genhashes[x], b'C')
+
             # Should receive the coinbase txid.
             txid = self.hashtx.receive()
 
@@ -116,6 +121,10 @@ class ZMQTest (PivxTestFramework):
         payment_txid = self.nodes[1].sendtoaddress(self.nodes[0].getnewaddress(), 1.0)
         self.sync_all()
 
+        # Should receive the mempool acceptance, tagged with a mempool sequence number.
+        mempool_seq = self.check_sequence(payment_txid, b'A')
+        assert mempool_seq is not None
+
         # Should receive the broadcasted txid.
         txid = self.hashtx.receive()
         assert_equal(payment_txid, bytes_to_hex_str(txid))
@@ -124,5 +133,23 @@ class ZMQTest (PivxTestFramework):
         hex = self.rawtx.receive()
         assert_equal(payment_txid, bytes_to_hex_str(hash256(hex)))
 
+        self.log.info("Check getzmqnotifications")
+        info = self.nodes[0].getzmqnotifications()
+        hwms = {n['type']: n['hwm'] for n in info['notifications']}
+        assert_equal(hwms['pubsequence'], 5000)
+        assert_equal(hwms['pubhashtx'], 1000)
+        assert_equal(info['dropped'], 0)
+        assert_equal(self.nodes[1].getzmqnotifications()['notifications'], [])
+
+    def check_sequence(self, hash, label):
+        body = self.sequence.receive()
+        assert_equal(bytes_to_hex_str(body[:32]), hash)
+        assert_equal(body[32:33], label)
+        if label in (b'A', b'R'):
+            assert_equal(len(body), 41)
+            return struct.unpack('<Q', body[33:])[0]
+        assert_equal(len(body), 33)
+        return None
+
 if __name__ == '__main__':
     ZMQTest().main()
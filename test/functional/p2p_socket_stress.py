@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The DECENOMY Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Stress the P2P socket handler with many loopback connections.
+
+For each -socketevents backend, open --connections raw sockets to the node,
+send a version message on every one of them and wait until the node has
+answered all of them. Checks that:
+    - every connection is accepted (select is capped below FD_SETSIZE)
+    - getnetworkinfo reports the backend, wakeups and loop latencies
+    - all connections are torn down again once the sockets are closed
+Handshake time and the loop latency percentiles are logged for comparison.
+"""
+
+import resource
+import selectors
+import socket
+import struct
+import time
+
+from test_framework.messages import msg_version, sha256
+from test_framework.mininode import MAGIC_BYTES
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    p2p_port,
+    wait_until,
+)
+
+# select() can only watch descriptors below FD_SETSIZE (1024) in the node
+SELECT_MAX_CONNECTIONS = 800
+
+def build_message(message):
+    data = message.serialize()
+    return (MAGIC_BYTES["regtest"] + message.command + b"\x00" * (12 - len(message.command)) +
+            struct.pack("<I", len(data)) + sha256(sha256(data))[:4] + data)
+
+class SocketStressTest(PivxTestFramework):
+    def add_options(self, parser):
+        parser.add_option("--connections", dest="connections", default=2000, type="int",
+                          help="number of loopback connections to open (default: %default)")
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+
+    def raise_fd_limit(self, needed):
+        soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+        if soft < needed:
+            resource.setrlimit(resource.RLIMIT_NOFILE, (min(needed, hard), hard))
+        return resource.getrlimit(resource.RLIMIT_NOFILE)[0]
+
+    def stress(self, mode, count):
+        self.log.info("Open %d connections with -socketevents=%s" % (count, mode))
+        self.restart_node(0, ["-socketevents=%s" % mode, "-maxconnections=%d" % (count + 100),
+                              "-whitelist=127.0.0.1"])
+        node = self.nodes[0]
+        assert_equal(node.getnetworkinfo()['socketevents']['mode'], mode)
+
+        version = build_message(msg_version())
+        sel = selectors.DefaultSelector()
+        socks = []
+        start = time.time()
+        for _ in range(count):
+            s = socket.create_connection(("127.0.0.1", p2p_port(0)))
+            s.setblocking(False)
+            s.send(version)
+            sel.register(s, selectors.EVENT_READ)
+            socks.append(s)
+        wait_until(lambda: node.getconnectioncount() == count, timeout=120)
+
+        # wait for the node's version reply on every socket
+        pending = set(socks)
+        deadline = time.time() + 120
+        while pending and time.time() < deadline:
+            for key, _ in sel.select(timeout=1):
+                if key.fileobj in pending and key.fileobj.recv(4096):
+                    pending.discard(key.fileobj)
+                    sel.unregister(key.fileobj)
+        assert_equal(len(pending), 0)
+        elapsed = time.time() - start
+
+        info = node.getnetworkinfo()['socketevents']
+        assert_greater_than(info['wakeups'], 0)
+        assert_greater_than(info['loop']['count'], 0)
+        self.log.info("%s: %d handshakes in %.2fs, %d wakeups, loop p50 %dus p99 %dus max %dus" % (
+            mode, count, elapsed, info['wakeups'], info['loop']['p50_us'], info['loop']['p99_us'], info['loop']['max_us']))
+
+        for s in socks:
+            s.close()
+        sel.close()
+        wait_until(lambda: node.getconnectioncount() == 0, timeout=120)
+
+    def run_test(self):
+        count = self.options.connections
+        limit = self.raise_fd_limit(count + 200)
+        if limit < count + 200:
+            count = limit - 200
+            self.log.info("File descriptor limit is %d, using %d connections" % (limit, count))
+
+        if self.nodes[0].getnetworkinfo()['socketevents']['mode'] == 'epoll':
+            self.stress('epoll', count)
+        self.stress('select', min(count, SELECT_MAX_CONNECTIONS))
+
+if __name__ == '__main__':
+    SocketStressTest().main()
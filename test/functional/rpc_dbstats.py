@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The DECENOMY Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the LevelDB tuning options and the getdbstats/compactdb RPCs.
+
+    - -dboption overrides only the named database
+    - getdbstats reports options, sizes, write histograms and leveldb.stats
+    - compactdb runs in the foreground and in the background
+"""
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    assert_raises_rpc_error,
+    wait_until,
+)
+
+class DBStatsTest(PivxTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.extra_args = [["-dboption=chainstate:writebuffer=8", "-dboption=blockindex:bloombits=0"]]
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(20)
+        node.gettxoutsetinfo()  # flushes the chainstate
+
+        self.log.info("Check getdbstats")
+        stats = node.getdbstats()
+        assert_equal(sorted(stats.keys()), ['blockindex', 'chainstate', 'sporks'])
+        assert_equal(stats['chainstate']['options']['write_buffer'], 8 << 20)
+        assert_equal(stats['chainstate']['options']['bloom_bits'], 10)
+        assert_equal(stats['blockindex']['options']['bloom_bits'], 0)
+        for name in ['blockindex', 'chainstate']:
+            db = stats[name]
+            assert_greater_than(db['batches_written'], 0)
+            assert_equal(db['batch_write']['count'], db['batches_written'])
+            assert_greater_than(db['memory_usage'], 0)
+            assert 'Compactions' in db['stats']
+        assert_equal(list(node.getdbstats('sporks').keys()), ['sporks'])
+        assert_raises_rpc_error(-8, "Unknown database", node.getdbstats, 'nosuchdb')
+
+        self.log.info("Check compactdb")
+        res = node.compactdb('blockindex', False)
+        assert_equal(res['background'], False)
+        assert_equal(node.getdbstats('blockindex')['blockindex']['compacting'], False)
+        assert_equal(node.compactdb('chainstate')['background'], True)
+        wait_until(lambda: not node.getdbstats('chainstate')['chainstate']['compacting'], timeout=60)
+        assert_raises_rpc_error(-8, "Unknown database", node.compactdb, 'nosuchdb')
+
+if __name__ == '__main__':
+    DBStatsTest().main()
@@ -148,6 +148,9 @@ EXTENDED_SCRIPTS = [
     #'example_test.py',
     'feature_notifications.py',
     'rpc_invalidateblock.py',
+    'interface_rpc_load.py',
+    'rpc_dbstats.py',
+    'p2p_socket_stress.py',
 ]
 
 LEGACY_SKIP_TESTS = [